@@ -0,0 +1,172 @@
+#!/usr/bin/env python3
+# -*- coding: utf-8 -*-
+
+# This script reads nghttpx access log written with
+# --accesslog-encoding=binary, and writes it in text as if it was
+# written with --accesslog-encoding=text.  The same
+# --accesslog-format which nghttpx used must be given to this script.
+#
+# Usage: nghttpx-accesslog-decode.py [--format FORMAT] [FILE...]
+
+import argparse
+import re
+import sys
+
+DEFAULT_FORMAT = ('$remote_addr - - [$time_local] '
+                  '"$request" $status $body_bytes_sent '
+                  '"$http_referer" "$http_user_agent"')
+
+LOGVARS = {
+    'remote_addr', 'time_local', 'time_iso8601', 'request', 'status',
+    'body_bytes_sent', 'remote_port', 'server_port', 'request_time', 'pid',
+    'alpn', 'ssl_cipher', 'ssl_protocol', 'ssl_session_id',
+    'ssl_session_reused', 'tls_cipher', 'tls_protocol', 'tls_session_id',
+    'tls_session_reused', 'tls_sni', 'tls_client_fingerprint_sha256',
+    'tls_client_fingerprint_sha1', 'tls_client_subject_name',
+    'tls_client_issuer_name', 'tls_client_serial', 'backend_host',
+    'backend_port', 'method', 'path', 'path_without_query',
+    'protocol_version', 'tls_handshake_time', 'request_header_time',
+    'backend_queue_time', 'backend_connect_time', 'backend_response_time',
+    'response_transfer_time',
+}
+
+# Variables whose values are escaped in text access log.
+ESCAPED_VARS = {'request', 'path', 'path_without_query', 'alpn', 'tls_sni'}
+
+FIELD_NONE = 0
+FIELD_STRING = 1
+FIELD_UINT = 2
+FIELD_MSEC = 3
+FIELD_BYTES = 4
+
+VAR_RE = re.compile(r'\$(?:\{([A-Za-z0-9_]*)\}|([A-Za-z0-9_]*))')
+
+
+def parse_format(fmt):
+    '''Parses |fmt| in the same way nghttpx does, and returns a list of
+    fragments.  Each fragment is a tuple of (is_var, value).'''
+    res = []
+    literal_start = 0
+    pos = 0
+    while True:
+        i = fmt.find('$', pos)
+        if i == -1:
+            break
+        m = VAR_RE.match(fmt, i)
+        if fmt.startswith('${', i) and m.group(1) is None:
+            # Missing '}'.  nghttpx skips this variable.
+            pos = i + 2
+            while pos < len(fmt) and (fmt[pos].isalnum() or fmt[pos] == '_'):
+                pos += 1
+            continue
+        name = m.group(1) if m.group(1) is not None else m.group(2)
+        pos = m.end()
+        if name.lower() not in LOGVARS and not name.lower().startswith(
+                'http_'):
+            continue
+        if literal_start < i:
+            res.append((False, fmt[literal_start:i]))
+        literal_start = pos
+        res.append((True, name.lower()))
+    if literal_start < len(fmt):
+        res.append((False, fmt[literal_start:]))
+    return res
+
+
+def escape(b):
+    res = []
+    for c in b:
+        if c < 0x20 or c >= 0x7f or c == ord('"') or c == ord('\\'):
+            res.append('\\x{:02x}'.format(c))
+        else:
+            res.append(chr(c))
+    return ''.join(res)
+
+
+def read_varint(rec, pos):
+    n = 0
+    shift = 0
+    while True:
+        b = rec[pos]
+        pos += 1
+        n |= (b & 0x7f) << shift
+        if b < 0x80:
+            return n, pos
+        shift += 7
+
+
+def decode_field(rec, pos, name):
+    t = rec[pos]
+    pos += 1
+    if t == FIELD_NONE:
+        return '-', pos
+    if t == FIELD_UINT:
+        n, pos = read_varint(rec, pos)
+        return str(n), pos
+    if t == FIELD_MSEC:
+        n, pos = read_varint(rec, pos)
+        return '{}.{:03}'.format(n // 1000, n % 1000), pos
+    if t == FIELD_STRING or t == FIELD_BYTES:
+        n, pos = read_varint(rec, pos)
+        v = rec[pos:pos + n]
+        pos += n
+        if t == FIELD_BYTES:
+            return v.hex(), pos
+        if name in ESCAPED_VARS or name.startswith('http_'):
+            return escape(v), pos
+        return v.decode('utf-8', 'replace'), pos
+    raise ValueError('unknown field type {}'.format(t))
+
+
+def decode(f, frags, out):
+    while True:
+        hdr = f.read(4)
+        if not hdr:
+            return
+        if len(hdr) < 4:
+            raise ValueError('truncated record length')
+        reclen = int.from_bytes(hdr, 'big')
+        rec = f.read(reclen)
+        if len(rec) < reclen:
+            raise ValueError('truncated record')
+        pos = 0
+        line = []
+        for is_var, v in frags:
+            if not is_var:
+                line.append(v)
+                continue
+            # A record might be truncated if it does not fit in the
+            # buffer.  The missing fields are written as "-".
+            if pos >= len(rec):
+                line.append('-')
+                continue
+            s, pos = decode_field(rec, pos, v)
+            line.append(s)
+        out.write(''.join(line))
+        out.write('\n')
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description='Convert nghttpx binary access log into text')
+    parser.add_argument('--format',
+                        default=DEFAULT_FORMAT,
+                        help='--accesslog-format used by nghttpx')
+    parser.add_argument('files',
+                        nargs='*',
+                        help='binary access log files (default: stdin)')
+    args = parser.parse_args()
+
+    frags = parse_format(args.format)
+
+    if not args.files:
+        decode(sys.stdin.buffer, frags, sys.stdout)
+        return
+
+    for path in args.files:
+        with open(path, 'rb') as f:
+            decode(f, frags, sys.stdout)
+
+
+if __name__ == '__main__':
+    main()
@@ -204,6 +204,29 @@ OPTIONS = [
     "frontend-header-timeout",
     "frontend-http2-idle-timeout",
     "frontend-http3-idle-timeout",
+    "accesslog-encoding",
+    "backend-http2-streams-per-session",
+    "backend-http2-max-sessions",
+    "backend-outlier-detection-interval",
+    "backend-outlier-failure-rate",
+    "backend-outlier-latency-factor",
+    "backend-outlier-ejection-time",
+    "backend-outlier-max-ejection-percent",
+    "backend-hedge-percentile",
+    "backend-queue-delay-target",
+    "backend-queue-delay-interval",
+    "backend-client-max-concurrency",
+    "backend-client-key-header",
+    "backend-client-ipv4-prefix",
+    "backend-client-ipv6-prefix",
+    "backend-buffer-request-max-body",
+    "backend-response-spool-dir",
+    "backend-response-spool-max",
+    "splice",
+    "memchunk-pool-max-free",
+    "backend-client-weight",
+    "backend-buffer-request-memory",
+    "backend-http2-pack-sessions",
 ]
 
 LOGVARS = [
@@ -238,6 +261,12 @@ LOGVARS = [
     "path",
     "path_without_query",
     "protocol_version",
+    "tls_handshake_time",
+    "request_header_time",
+    "backend_queue_time",
+    "backend_connect_time",
+    "backend_response_time",
+    "response_transfer_time",
 ]
 
 if __name__ == '__main__':
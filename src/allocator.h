@@ -34,7 +34,9 @@
 #include <cassert>
 #include <utility>
 #include <span>
+#include <array>
 #include <algorithm>
+#include <bit>
 
 #include "template.h"
 
@@ -57,23 +59,41 @@ struct ChunkHead {
     size_t size;
     uint64_t pad1;
   };
-  uint64_t pad2;
+  union {
+    // The next free chunk in the same size class.  This is only
+    // meaningful while the chunk is in the freelist.
+    ChunkHead *next;
+    uint64_t pad2;
+  };
 };
 
 static_assert(sizeof(ChunkHead) == 16);
 
+// The number of size classes of the freelists in BlockAllocator.  The
+// size class i holds the chunks whose size is in the range [16 << i,
+// 16 << (i + 1)).  The chunks outside of these ranges are not reused.
+constexpr size_t BLOCK_ALLOCATOR_NUM_CLASSES = 12;
+
 // BlockAllocator allocates memory block with given size at once, and
 // cuts the region from it when allocation is requested.  If the
 // requested size is larger than given threshold (plus small internal
 // overhead), it will be allocated in a distinct buffer on demand.
 // The |isolation_threshold| must be less than or equal to
 // |block_size|.
+//
+// The memory released by free(), or left behind by realloc(), is kept
+// in the freelist of its size class, and reused by the subsequent
+// allocation of the same size class.
 struct BlockAllocator {
   BlockAllocator(size_t block_size, size_t isolation_threshold)
     : retain(nullptr),
       head(nullptr),
+      freelist{},
       block_size(block_size),
-      isolation_threshold(std::min(block_size, isolation_threshold)) {
+      isolation_threshold(std::min(block_size, isolation_threshold)),
+      allocated(0),
+      wasted(0),
+      freelistsize(0) {
     assert(isolation_threshold <= block_size);
   }
 
@@ -82,16 +102,24 @@ struct BlockAllocator {
   BlockAllocator(BlockAllocator &&other) noexcept
     : retain{std::exchange(other.retain, nullptr)},
       head{std::exchange(other.head, nullptr)},
+      freelist{std::exchange(other.freelist, {})},
       block_size(other.block_size),
-      isolation_threshold(other.isolation_threshold) {}
+      isolation_threshold(other.isolation_threshold),
+      allocated{std::exchange(other.allocated, 0)},
+      wasted{std::exchange(other.wasted, 0)},
+      freelistsize{std::exchange(other.freelistsize, 0)} {}
 
   BlockAllocator &operator=(BlockAllocator &&other) noexcept {
     reset();
 
     retain = std::exchange(other.retain, nullptr);
     head = std::exchange(other.head, nullptr);
+    freelist = std::exchange(other.freelist, {});
     block_size = other.block_size;
     isolation_threshold = other.isolation_threshold;
+    allocated = std::exchange(other.allocated, 0);
+    wasted = std::exchange(other.wasted, 0);
+    freelistsize = std::exchange(other.freelistsize, 0);
 
     return *this;
   }
@@ -108,6 +136,38 @@ struct BlockAllocator {
 
     retain = nullptr;
     head = nullptr;
+    freelist = {};
+    allocated = 0;
+    wasted = 0;
+    freelistsize = 0;
+  }
+
+  // Invalidates all memory allocated so far, and makes this object
+  // ready for reuse.  Unlike reset(), the current memory block is
+  // kept so that the subsequent allocations do not have to allocate
+  // the memory block again.
+  void reuse() {
+    auto mb = head;
+
+    // Detach the current memory block so that reset() does not free
+    // it.
+    for (auto p = &retain; *p; p = &(*p)->next) {
+      if (*p == mb) {
+        *p = mb->next;
+        break;
+      }
+    }
+
+    reset();
+
+    if (!mb) {
+      return;
+    }
+
+    mb->next = nullptr;
+    mb->last = mb->begin;
+    retain = head = mb;
+    allocated = static_cast<size_t>(mb->end - mb->begin);
   }
 
   MemBlock *alloc_mem_block(size_t size) {
@@ -119,12 +179,36 @@ struct BlockAllocator {
       (reinterpret_cast<intptr_t>(block + sizeof(MemBlock)) + 0xf) & ~0xf);
     mb->end = mb->begin + size;
     retain = mb;
+    allocated += size;
     return mb;
   }
 
   constexpr size_t alloc_unit(size_t size) { return sizeof(ChunkHead) + size; }
 
+  // Returns the index of the size class which a chunk of |size| bytes
+  // belongs to.  The return value may be BLOCK_ALLOCATOR_NUM_CLASSES
+  // or larger.
+  static constexpr size_t size_class(size_t size) {
+    return static_cast<size_t>(std::bit_width(size >> 4)) - 1;
+  }
+
+  // Returns the index of the smallest size class whose chunks are all
+  // large enough to hold |size| bytes.
+  static constexpr size_t fit_size_class(size_t size) {
+    return size <= 16 ? 0 : size_class(std::bit_ceil(size));
+  }
+
   void *alloc(size_t size) {
+    auto idx = fit_size_class(size);
+    if (idx < BLOCK_ALLOCATOR_NUM_CLASSES && freelist[idx]) {
+      auto ch = freelist[idx];
+      freelist[idx] = ch->next;
+      freelistsize -= ch->size;
+      // Keep the size of the chunk, which may be larger than |size|,
+      // so that realloc() can use the remaining space.
+      return reinterpret_cast<uint8_t *>(ch) + sizeof(ChunkHead);
+    }
+
     auto au = alloc_unit(size);
 
     if (au >= isolation_threshold) {
@@ -138,6 +222,9 @@ struct BlockAllocator {
     }
 
     if (!head || static_cast<size_t>(head->end - head->last) < au) {
+      if (head) {
+        wasted += static_cast<size_t>(head->end - head->last);
+      }
       head = alloc_mem_block(block_size);
     }
 
@@ -160,13 +247,31 @@ struct BlockAllocator {
       ->size;
   }
 
+  // Releases |ptr| which was returned from alloc() or realloc().  The
+  // memory is reused by the subsequent allocation in the same size
+  // class.  |ptr| must not be used after this call.
+  void free(void *ptr) {
+    auto ch = reinterpret_cast<ChunkHead *>(static_cast<uint8_t *>(ptr) -
+                                            sizeof(ChunkHead));
+    auto idx = size_class(ch->size);
+    if (ch->size < 16 || idx >= BLOCK_ALLOCATOR_NUM_CLASSES) {
+      wasted += ch->size;
+      return;
+    }
+
+    ch->next = freelist[idx];
+    freelist[idx] = ch;
+    freelistsize += ch->size;
+  }
+
   // Allocates memory of at least |size| bytes.  If |ptr| is nullptr,
   // this is equivalent to alloc(size).  If |ptr| is not nullptr,
   // obtain the allocated size for |ptr|, assuming that |ptr| was
   // returned from alloc() or realloc().  If the allocated size is
   // greater than or equal to size, |ptr| is returned.  Otherwise,
-  // allocates at least |size| bytes of memory, and the original
-  // content pointed by |ptr| is copied to the newly allocated memory.
+  // allocates at least |size| bytes of memory, the original content
+  // pointed by |ptr| is copied to the newly allocated memory, and
+  // |ptr| is released as if free() is called.
   void *realloc(void *ptr, size_t size) {
     if (!ptr) {
       return alloc(size);
@@ -182,6 +287,8 @@ struct BlockAllocator {
     auto res = alloc(nalloclen);
     std::ranges::copy_n(p, as_signed(alloclen), static_cast<uint8_t *>(res));
 
+    free(ptr);
+
     return res;
   }
 
@@ -189,11 +296,22 @@ struct BlockAllocator {
   MemBlock *retain;
   // Current memory block to use.
   MemBlock *head;
+  // The freelists of released chunks indexed by size class.
+  std::array<ChunkHead *, BLOCK_ALLOCATOR_NUM_CLASSES> freelist;
   // size of single memory block
   size_t block_size;
   // if allocation greater or equal to isolation_threshold bytes is
   // requested, allocate dedicated block.
   size_t isolation_threshold;
+  // The number of bytes of memory blocks allocated.
+  size_t allocated;
+  // The number of bytes which cannot be used anymore until this
+  // object is reset: the unused space at the end of the memory block
+  // abandoned for a new one, and the released chunks which do not fit
+  // in any size class.
+  size_t wasted;
+  // The number of bytes in the freelists.
+  size_t freelistsize;
 };
 
 // Makes a copy of a range [|first|, |last|).  The resulting string
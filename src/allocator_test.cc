@@ -0,0 +1,142 @@
+/*
+ * nghttp2 - HTTP/2 C Library
+ *
+ * Copyright (c) 2026 Tatsuhiro Tsujikawa
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+ * LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include "allocator_test.h"
+
+#include "munitxx.h"
+
+#include "allocator.h"
+
+using namespace std::literals;
+
+namespace nghttp2 {
+
+namespace {
+const MunitTest tests[]{
+  munit_void_test(test_block_allocator_free),
+  munit_void_test(test_block_allocator_realloc),
+  munit_void_test(test_block_allocator_reuse),
+  munit_test_end(),
+};
+} // namespace
+
+const MunitSuite allocator_suite{
+  "/allocator", tests, nullptr, 1, MUNIT_SUITE_OPTION_NONE,
+};
+
+void test_block_allocator_free(void) {
+  BlockAllocator balloc(1024, 1024);
+
+  auto p = balloc.alloc(100);
+
+  assert_size(1024, ==, balloc.allocated);
+
+  balloc.free(p);
+
+  assert_size(100, ==, balloc.freelistsize);
+
+  // 100 bytes chunk is in [64, 128) class, which cannot hold 100
+  // bytes in general.
+  auto q = balloc.alloc(100);
+
+  assert_true(p != q);
+
+  auto r = balloc.alloc(50);
+
+  assert_ptr_equal(p, r);
+  assert_size(100, ==, balloc.get_alloc_length(r));
+  assert_size(0, ==, balloc.freelistsize);
+
+  // The chunk smaller than 16 bytes is not reused.
+  balloc.free(balloc.alloc(10));
+
+  assert_size(0, ==, balloc.freelistsize);
+  assert_size(10, ==, balloc.wasted);
+
+  // The isolated chunk is also reused.
+  auto s = balloc.alloc(2000);
+
+  assert_size(1024 + 2000 + sizeof(ChunkHead), ==, balloc.allocated);
+
+  balloc.free(s);
+
+  assert_size(2000, ==, balloc.freelistsize);
+  assert_ptr_equal(s, balloc.alloc(1024));
+}
+
+void test_block_allocator_realloc(void) {
+  BlockAllocator balloc(1024, 1024);
+
+  auto s = make_string_ref(balloc, "alpha"sv);
+
+  s = realloc_concat_string_ref(balloc, s, "-bravo-charlie"sv);
+
+  assert_stdsv_equal("alpha-bravo-charlie"sv, s);
+  // The original 6 bytes chunk is too small to be reused.
+  assert_size(6, ==, balloc.wasted);
+
+  auto p = s.data();
+
+  s = realloc_concat_string_ref(balloc, s, "-delta"sv);
+
+  assert_stdsv_equal("alpha-bravo-charlie-delta"sv, s);
+  assert_size(21, ==, balloc.freelistsize);
+
+  // The released chunk is reused.
+  assert_ptr_equal(p, balloc.alloc(16));
+  assert_size(0, ==, balloc.freelistsize);
+}
+
+void test_block_allocator_reuse(void) {
+  BlockAllocator balloc(1024, 1024);
+
+  balloc.reuse();
+
+  assert_null(balloc.retain);
+  assert_size(0, ==, balloc.allocated);
+
+  auto p = balloc.alloc(100);
+  balloc.alloc(2000);
+  balloc.alloc(900);
+  balloc.free(balloc.alloc(50));
+
+  assert_size(2 * 1024 + 2000 + sizeof(ChunkHead), ==, balloc.allocated);
+
+  balloc.reuse();
+
+  assert_size(1024, ==, balloc.allocated);
+  assert_size(0, ==, balloc.wasted);
+  assert_size(0, ==, balloc.freelistsize);
+  assert_ptr_equal(balloc.head, balloc.retain);
+  assert_null(balloc.retain->next);
+
+  // The first allocation after reuse() starts from the beginning of
+  // the kept block.
+  auto q = balloc.alloc(100);
+
+  assert_ptr_equal(balloc.head->begin + sizeof(ChunkHead), q);
+  assert_true(p != q);
+}
+
+} // namespace nghttp2
@@ -98,6 +98,33 @@ template <typename T> struct Pool {
     freelist = m;
     freelistsize += T::size;
   }
+  // Frees the chunks in freelist until freelistsize becomes equal
+  // to or less than |max|.  The chunks in use are not affected.
+  void shrink(size_t max) {
+    if (freelistsize <= max) {
+      return;
+    }
+
+    // The chunks removed from freelist are marked by setting pos to
+    // nullptr.  The chunk in use always has non-null pos.
+    for (; freelist && freelistsize > max; freelistsize -= T::size) {
+      auto m = freelist;
+      freelist = freelist->next;
+      m->pos = nullptr;
+    }
+
+    for (auto pp = &pool; *pp;) {
+      auto p = *pp;
+      if (p->pos) {
+        pp = &p->knext;
+        continue;
+      }
+
+      *pp = p->knext;
+      delete p;
+      poolsize -= T::size;
+    }
+  }
   void clear() {
     freelist = nullptr;
     freelistsize = 0;
@@ -304,6 +331,51 @@ template <typename Memchunk> struct Memchunks {
 
     return count - left;
   }
+  // Moves at most |count| bytes to |dest|.  Unlike remove(Memchunks
+  // &, size_t), the chunks whose data are entirely moved are
+  // relinked to |dest| without copying.  Only the partial chunk at
+  // the end is copied.  |dest| must share the same pool.  This
+  // function returns the number of bytes moved.
+  size_t splice(Memchunks &dest, size_t count) {
+    assert(pool == dest.pool);
+    assert(mark == nullptr);
+
+    auto left = count;
+
+    while (head && left) {
+      auto m = head;
+      auto n = m->len();
+
+      if (n > left) {
+        dest.append(m->pos, left);
+        m->pos += left;
+        len -= left;
+        left = 0;
+
+        break;
+      }
+
+      head = m->next;
+      m->next = nullptr;
+
+      if (dest.tail == nullptr) {
+        dest.head = m;
+      } else {
+        dest.tail->next = m;
+      }
+
+      dest.tail = m;
+      dest.len += n;
+      len -= n;
+      left -= n;
+    }
+
+    if (head == nullptr) {
+      tail = nullptr;
+    }
+
+    return count - left;
+  }
   size_t remove(Memchunks &dest) {
     assert(pool == dest.pool);
     assert(mark == nullptr);
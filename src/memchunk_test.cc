@@ -38,12 +38,14 @@ namespace nghttp2 {
 namespace {
 const MunitTest tests[]{
   munit_void_test(test_pool_recycle),
+  munit_void_test(test_pool_shrink),
   munit_void_test(test_memchunks_append),
   munit_void_test(test_memchunks_drain),
   munit_void_test(test_memchunks_riovec),
   munit_void_test(test_memchunks_recycle),
   munit_void_test(test_memchunks_reset),
   munit_void_test(test_memchunks_reserve),
+  munit_void_test(test_memchunks_splice),
   munit_void_test(test_memchunkbuffer_drain_reset),
   munit_test_end(),
 };
@@ -101,6 +103,49 @@ void test_pool_recycle(void) {
   assert_null(m2->next);
 }
 
+void test_pool_shrink(void) {
+  using Memchunk = MemchunkPool::value_type;
+
+  MemchunkPool pool;
+
+  auto m1 = pool.get();
+  auto m2 = pool.get();
+  auto m3 = pool.get();
+  auto m4 = pool.get();
+
+  pool.recycle(m1);
+  pool.recycle(m3);
+  pool.recycle(m4);
+
+  assert_size(4 * Memchunk::size, ==, pool.poolsize);
+  assert_size(3 * Memchunk::size, ==, pool.freelistsize);
+
+  pool.shrink(3 * Memchunk::size);
+
+  assert_size(4 * Memchunk::size, ==, pool.poolsize);
+  assert_size(3 * Memchunk::size, ==, pool.freelistsize);
+
+  pool.shrink(Memchunk::size);
+
+  assert_size(2 * Memchunk::size, ==, pool.poolsize);
+  assert_size(Memchunk::size, ==, pool.freelistsize);
+  assert_ptr_equal(m1, pool.freelist);
+  assert_null(m1->next);
+  assert_ptr_equal(m2, pool.pool);
+  assert_ptr_equal(m1, m2->knext);
+  assert_null(m1->knext);
+
+  pool.shrink(0);
+
+  assert_size(Memchunk::size, ==, pool.poolsize);
+  assert_size(0, ==, pool.freelistsize);
+  assert_null(pool.freelist);
+  assert_ptr_equal(m2, pool.pool);
+  assert_null(m2->knext);
+
+  pool.recycle(m2);
+}
+
 using Memchunk16 = Memchunk<16>;
 using MemchunkPool16 = Pool<Memchunk16>;
 using Memchunks16 = Memchunks<Memchunk16>;
@@ -281,6 +326,47 @@ void test_memchunks_reserve(void) {
                       iov[1].iov_len}));
 }
 
+void test_memchunks_splice(void) {
+  MemchunkPool16 pool;
+  Memchunks16 src(&pool);
+  Memchunks16 dest(&pool);
+  std::array<iovec, 4> iov;
+
+  src.append("0123456789abcdefghijklmnopqrstuv"sv);
+  dest.append("hd"sv);
+
+  auto m = src.head;
+
+  // The first chunk is relinked, and the rest is copied.
+  assert_size(20, ==, src.splice(dest, 20));
+  assert_size(12, ==, src.rleft());
+  assert_size(22, ==, dest.rleft());
+  assert_ptr_equal(m, dest.head->next);
+  assert_ptr_equal(dest.tail, m->next);
+
+  auto iovcnt = dest.riovec(iov.data(), iov.size());
+
+  assert_int(3, ==, iovcnt);
+  assert_stdsv_equal(
+    "0123456789abcdef"sv,
+    (std::string_view{reinterpret_cast<const char *>(iov[1].iov_base),
+                      iov[1].iov_len}));
+  assert_stdsv_equal(
+    "ghij"sv,
+    (std::string_view{reinterpret_cast<const char *>(iov[2].iov_base),
+                      iov[2].iov_len}));
+
+  m = src.head;
+
+  // The last chunk is relinked, and src becomes empty.
+  assert_size(12, ==, src.splice(dest, 100));
+  assert_size(0, ==, src.rleft());
+  assert_null(src.head);
+  assert_null(src.tail);
+  assert_size(34, ==, dest.rleft());
+  assert_ptr_equal(m, dest.tail);
+}
+
 void test_memchunkbuffer_drain_reset(void) {
   MemchunkPool16 pool;
   MemchunkBuffer16 buf(&pool);
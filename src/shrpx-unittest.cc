@@ -38,12 +38,20 @@
 #include "nghttp2_gzip_test.h"
 #include "buffer_test.h"
 #include "memchunk_test.h"
+#include "allocator_test.h"
 #include "template_test.h"
 #include "shrpx_http_test.h"
 #include "base64_test.h"
 #include "shrpx_config.h"
 #include "tls.h"
 #include "shrpx_router_test.h"
+#include "shrpx_metrics_test.h"
+#include "shrpx_request_rate_limiter_test.h"
+#include "shrpx_response_spool_test.h"
+#include "shrpx_log_test.h"
+#include "shrpx_downstream_queue_test.h"
+#include "shrpx_fair_queue_test.h"
+#include "shrpx_slab_allocator_test.h"
 #include "shrpx_log.h"
 #ifdef ENABLE_HTTP3
 #  include "siphash_test.h"
@@ -59,11 +67,19 @@ int main(int argc, char *argv[]) {
     shrpx::worker_suite,
     shrpx::http_suite,
     shrpx::router_suite,
+    shrpx::metrics_suite,
+    shrpx::request_rate_limiter_suite,
+    shrpx::response_spool_suite,
+    shrpx::log_suite,
+    shrpx::downstream_queue_suite,
+    shrpx::fair_queue_suite,
+    shrpx::slab_allocator_suite,
     shrpx::http2_suite,
     shrpx::util_suite,
     gzip_suite,
     buffer_suite,
     memchunk_suite,
+    allocator_suite,
     template_suite,
     base64_suite,
 #ifdef ENABLE_HTTP3
@@ -1634,6 +1634,8 @@ void fill_default_config(Config *config) {
     config->ev_loop_flags = ev_recommended_backends() | EVBACKEND_KQUEUE;
   }
 
+  config->memchunk_pool_max_free = 4_m;
+
   auto &tlsconf = config->tls;
   {
     auto &ticketconf = tlsconf.ticket;
@@ -1731,6 +1733,8 @@ void fill_default_config(Config *config) {
     downstreamconf.window_size = 64_k - 1;
     downstreamconf.connection_window_size = (1u << 31) - 1;
     downstreamconf.max_concurrent_streams = 100;
+    downstreamconf.streams_per_session = 100;
+    downstreamconf.max_sessions = 16;
 
     downstreamconf.encoder_dynamic_table_size = 4_k;
     downstreamconf.decoder_dynamic_table_size = 4_k;
@@ -1834,9 +1838,23 @@ void fill_default_config(Config *config) {
       timeoutconf.max_backoff = 120_s;
     }
 
+    {
+      auto &outlierconf = downstreamconf.outlier;
+      outlierconf.ejection_time = 30_s;
+      outlierconf.failure_rate = 50;
+      outlierconf.latency_factor = 5;
+      outlierconf.max_ejection_percent = 50;
+    }
+
+    downstreamconf.queue_delay.interval = 100_ms;
+
     downstreamconf.connections_per_host = 8;
     downstreamconf.request_buffer_size = 16_k;
     downstreamconf.response_buffer_size = 128_k;
+    downstreamconf.buffer_request_max_body = 16_m;
+    downstreamconf.buffer_request_memory = 1_m;
+    downstreamconf.response_spool.dir = "/tmp"sv;
+    downstreamconf.response_spool.max = 1_g;
     downstreamconf.family = AF_UNSPEC;
   }
 
@@ -1968,19 +1986,23 @@ Connections:
               together forming  load balancing  group.
 
               Several parameters <PARAM> are accepted after <PATTERN>.
-              The  parameters are  delimited  by  ";".  The  available
-              parameters       are:      "proto=<PROTO>",       "tls",
+              The  parameters  are  delimited  by ";".   The available
+              parameters       are:       "proto=<PROTO>",      "tls",
               "sni=<SNI_HOST>",         "fall=<N>",        "rise=<N>",
               "affinity=<METHOD>",    "dns",    "redirect-if-not-tls",
               "upgrade-scheme",                        "mruby=<PATH>",
               "read-timeout=<DURATION>",   "write-timeout=<DURATION>",
-              "group=<GROUP>",  "group-weight=<N>", "weight=<N>",  and
-              "dnf".    The  parameter   consists   of  keyword,   and
-              optionally followed by "="  and value.  For example, the
-              parameter "proto=h2" consists of the keyword "proto" and
-              value "h2".  The parameter "tls" consists of the keyword
-              "tls"  without value.   Each parameter  is described  as
-              follows.
+              "group=<GROUP>",    "group-weight=<N>",    "weight=<N>",
+              "dnf",           "lb=<METHOD>",          "min-idle=<N>",
+              "slow-start=<DURATION>",       "hedge-delay=<DURATION>",
+              "max-concurrency=<N>",               "request-rate=<N>",
+              "request-burst=<N>",        "buffer-request",        and
+              "spool-response".   The  parameter  consists of keyword,
+              and optionally followed by "=" and value.   For example,
+              the parameter "proto=h2" consists of the keyword "proto"
+              and  value  "h2".   The  parameter "tls" consists of the
+              keyword   "tls"   without  value.    Each  parameter  is
+              described as follows.
 
               The backend application protocol  can be specified using
               optional  "proto"   parameter,  and   in  the   form  of
@@ -2015,21 +2037,41 @@ Connections:
               backend  is permanently  offline, once  it goes  in that
               state, and this is the default behaviour.
 
-              The     session     affinity    is     enabled     using
-              "affinity=<METHOD>"  parameter.   If  "ip" is  given  in
-              <METHOD>, client  IP based session affinity  is enabled.
-              If "cookie"  is given in <METHOD>,  cookie based session
-              affinity is  enabled.  If  "none" is given  in <METHOD>,
-              session affinity  is disabled, and this  is the default.
-              The session  affinity is  enabled per <PATTERN>.   If at
-              least  one backend  has  "affinity"  parameter, and  its
-              <METHOD> is not "none",  session affinity is enabled for
-              all backend  servers sharing the same  <PATTERN>.  It is
-              advised  to  set  "affinity" parameter  to  all  backend
-              explicitly if session affinity  is desired.  The session
-              affinity  may   break  if   one  of  the   backend  gets
-              unreachable,  or   backend  settings  are   reloaded  or
-              replaced by API.
+              The     session     affinity     is     enabled    using
+              "affinity=<METHOD>"  parameter.   If  "ip"  is  given in
+              <METHOD>,  client  IP based session affinity is enabled.
+              If  "cookie"  is given in <METHOD>, cookie based session
+              affinity is enabled.   If "header" is given in <METHOD>,
+              session  affinity  based  on the value of request header
+              field  is  enabled.   If  "path"  is  given in <METHOD>,
+              session  affinity based on request path is enabled.   If
+              "none"   is  given  in  <METHOD>,  session  affinity  is
+              disabled, and this is the default.  The session affinity
+              is  enabled per <PATTERN>.   If at least one backend has
+              "affinity"  parameter,  and  its <METHOD> is not "none",
+              session  affinity  is  enabled  for  all backend servers
+              sharing  the  same  <PATTERN>.   It  is  advised  to set
+              "affinity"   parameter  to  all  backend  explicitly  if
+              session  affinity is desired.   The session affinity may
+              break if one of the backend gets unreachable, or backend
+              settings are reloaded or replaced by API.
+
+              If          "affinity=header"          is          used,
+              "affinity-header-name=<NAME>"  must be used to specify a
+              name of request header field whose value is hashed.   If
+              the  header  field  is  missing  in a request, client IP
+              address  is  used instead.   If "affinity=path" is used,
+              request path excluding query is hashed.
+
+              "affinity-hash=<HASH>" specifies how a hash is mapped to
+              a  backend.   <HASH>  is  either  "ketama"  or "maglev".
+              "ketama"  is  the  consistent hashing used by libketama,
+              and  it  is  the default.   If "maglev" is given, Maglev
+              hashing  is  used.   It  looks  up a backend in constant
+              time,  spreads  the load more evenly, and when a backend
+              is  added,  removed,  or  becomes  unavailable, only the
+              requests which were mapped to it, and a small portion of
+              the other requests are moved to the different backend.
 
               If   "affinity=cookie"    is   used,    the   additional
               configuration                is                required.
@@ -2129,6 +2171,136 @@ Connections:
               generated by mruby  script (see "mruby=<PATH>" parameter
               above).  "dnf" is an abbreviation of "do not forward".
 
+              If  "buffer-request"  parameter  is  specified,  nghttpx
+              receives  an  entire  request  body  before it selects a
+              backend  and  sends  the  request  to it, so that a slow
+              client  does  not  occupy  a backend connection while it
+              uploads  the request body.   The request body is kept in
+              memory   up   to   --backend-buffer-request-memory   per
+              frontend  connection,  and  the  rest  is  written  to a
+              temporary  file  in  --backend-response-spool-dir.   The
+              request      which      has     larger     body     than
+              --backend-buffer-request-max-body is responded with 413.
+              If  the  request  body  is  sent without content-length,
+              content-length  is added to the request forwarded to the
+              backend.  All backends which share the same pattern must
+              have    the    same   "buffer-request"   setting.     If
+              "buffer-request"  is  specified in at least one of them,
+              it is applied to all of them.
+
+              If  "spool-response"  parameter  is  specified,  nghttpx
+              keeps  reading  a response body from a backend even if a
+              client does not read it fast enough.   The response body
+              which  does  not  fit  in  --backend-response-buffer  is
+              written    to    an    unlinked    temporary   file   in
+              --backend-response-spool-dir, and it is read back as the
+              client  reads  the  response.   A  backend connection is
+              released  as soon as the entire response is received, so
+              that  a  slow  client does not occupy it.   The response
+              body  is  spooled up to --backend-response-spool-max per
+              response.  It is not applied to the upgraded connection.
+              All  backends which share the same pattern must have the
+              same  "spool-response" setting.   If "spool-response" is
+              specified  in at least one of them, it is applied to all
+              of them.
+
+              "lb=<METHOD>"  parameter  specifies  the  load balancing
+              method  among the backend addresses which share the same
+              <PATTERN>.   <METHOD>  is  one of "rr", "least-request",
+              and "p2c".   "rr" is the weighted round robin, and it is
+              the default.   If "least-request" is given, a request is
+              forwarded   to   the   backend   which  has  the  fewest
+              outstanding  requests relative to its weight.   If "p2c"
+              is  given,  two  backends  are  chosen  at random, and a
+              request  is  forwarded  to  the  one which has the fewer
+              outstanding requests multiplied by the moving average of
+              its  response latency, relative to its weight.   "group"
+              and  "group-weight"  are  ignored  if "least-request" or
+              "p2c"  is  used.   All  backends  which  share  the same
+              pattern must have the same <METHOD>.  If "lb" is omitted
+              in  a  backend,  but  the other backend which shares the
+              same pattern specifies "lb", its value is used.  "lb" is
+              ignored if session affinity is enabled.
+
+              "min-idle=<N>"  parameter  specifies  the number of idle
+              connections  which nghttpx establishes to the backend in
+              advance  so that a request does not have to wait for TCP
+              and  TLS  handshakes.   Each worker checks the number of
+              idle  connections  every  second,  and  establishes  new
+              connections  if it falls below <N>.   An idle connection
+              is  closed after --backend-keep-alive-timeout, and it is
+              established  again.   For  HTTP/2  backend,  <N>  is the
+              number  of  connections  which  can accept a new stream.
+              The  connections  are  not  established  in  advance for
+              HTTP/1 backend with "dns" parameter.   The default value
+              is 0, which disables this feature.
+
+              "slow-start=<DURATION>" parameter specifies the duration
+              of  slow  start.    When  the  backend  address  becomes
+              available   again   after  it  was  considered  offline,
+              temporarily  disabled  due  to  connection  failures, or
+              ejected  by outlier detection, or when it is newly added
+              by configuration reload or backendconfig API, its weight
+              starts  from  1/16  of  "weight"  and  grows linearly to
+              "weight" over <DURATION>.   Slow start is not applied if
+              session  affinity is enabled, and it does not change the
+              weight  of  the  weight group.   The default value is 0,
+              which disables slow start.
+
+              "hedge-delay=<DURATION>"    parameter   enables   hedged
+              request.   If a GET or HEAD request without request body
+              has  not  received response header fields from a backend
+              in  <DURATION>,  the  same  request  is also sent to the
+              other  backend  address  in  the  same  pattern.    Both
+              requests race, and the first one which receives response
+              is used.   The other one is canceled.  A backend request
+              which  lost  the race is counted as a failure in outlier
+              detection.   The  request  is hedged at most once.   For
+              HTTP/2  backend,  the  request  is  hedged  only  if the
+              connection   to  the  other  backend  address  has  been
+              established.   See also --backend-hedge-percentile.  All
+              backends which share the same pattern must have the same
+              <DURATION>.   If  "hedge-delay" is omitted in a backend,
+              but  the  other  backend  which  shares the same pattern
+              specifies  "hedge-delay",  its  value  is used.   Hedged
+              request is not performed if session affinity is enabled.
+              The default value is 0, which disables hedged request.
+
+              "max-concurrency=<N>"  parameter  limits  the  number of
+              concurrent requests to the backends which share the same
+              pattern  to  <N>  in  each  worker.   When  the limit is
+              reached,  the  requests  from HTTP/2 and HTTP/3 frontend
+              connections wait until a slot becomes available, and the
+              waiting  requests  are  dispatched in round robin manner
+              across  clients  so  that  a  client  cannot  starve the
+              others.   The  requests from HTTP/1 frontend connections
+              are      responded      with     503.       See     also
+              --backend-client-max-concurrency.    The  same  rule  as
+              "hedge-delay"  applies  if  the backends which share the
+              same  pattern specify different "max-concurrency".   The
+              default value is 0, which means no limit.
+
+              "request-rate=<N>"   parameter   limits  the  number  of
+              requests  per  second  which  a  client  can make to the
+              backends  which  share  the  same pattern to <N> in each
+              worker.    The  requests  which  exceed  the  limit  are
+              responded  with  429.   The  limit  is enforced by token
+              bucket  per  client,  and  "request-burst=<N>" parameter
+              specifies  the  bucket  size,  which  is  the  number of
+              requests   a   client   can   make   in  a  burst.    If
+              "request-burst"  is  omitted,  it  defaults  to  <N>  of
+              "request-rate".   A client is identified in the same way
+              as  --backend-client-max-concurrency,  and IPv4 and IPv6
+              remote        addresses       are       grouped       by
+              --backend-client-ipv4-prefix                         and
+              --backend-client-ipv6-prefix.   Each  worker  tracks  at
+              most  65536  clients per pattern, and the least recently
+              seen  client  is  forgotten  first.   The  same  rule as
+              "hedge-delay"  applies  if  the backends which share the
+              same   pattern   specify   different  "request-rate"  or
+              "request-burst".  The default value of "request-rate" is
+              0, which means no limit.
+
               Since ";" and ":" are  used as delimiter, <PATTERN> must
               not contain  these characters.  In order  to include ":"
               in  <PATTERN>,  one  has  to  specify  "%3A"  (which  is
@@ -2283,6 +2455,47 @@ Performance:
               --backend-connections-per-host.
               Default: )"
       << config->conn.downstream->connections_per_frontend << R"(
+  --backend-client-max-concurrency=<N>
+              Limit  the  number  of concurrent requests per client to
+              <N>  in  each  worker.   A  client  is identified by its
+              remote  address,  or  by  the  value of the header field
+              specified  by  --backend-client-key-header.    When  the
+              limit is reached, the requests are queued or rejected in
+              the same way as "max-concurrency" parameter in --backend
+              option.  0 means no limit.
+              Default: )"
+      << config->conn.downstream->client_max_concurrency << R"(
+  --backend-client-weight=<CLIENT>,<N>
+              Set  the  weight of the client identified by <CLIENT> to
+              <N>.    <CLIENT>  is  the  value  of  the  header  field
+              specified  by --backend-client-key-header, or the remote
+              address   masked   by   --backend-client-ipv4-prefix  or
+              --backend-client-ipv6-prefix.   <N> must be in the range
+              [1, 256].  The limit of --backend-client-max-concurrency
+              is multiplied by <N> for this client.  When requests are
+              queued,  the  client  is  given  up to <N> slots in each
+              round  of  dispatching.    The  clients  which  are  not
+              specified  have  weight  1.   This  option  can  be used
+              multiple  times  to  specify  the  weights  of  multiple
+              clients.
+  --backend-client-key-header=<HEADER>
+              Identify  a  client  by  the  value  of the header field
+              <HEADER>   for   --backend-client-max-concurrency,   and
+              "max-concurrency"   and   "request-rate"  parameters  in
+              --backend  option.    If  a  request  does  not  contain
+              <HEADER>, its remote address is used.
+  --backend-client-ipv4-prefix=<N>
+              Identify  a  client  by  the  first <N> bits of its IPv4
+              remote  address for --backend-client-max-concurrency and
+              "request-rate" parameter in --backend option.
+              Default: )"
+      << config->conn.downstream->client_ipv4_prefix << R"(
+  --backend-client-ipv6-prefix=<N>
+              Identify  a  client  by  the  first <N> bits of its IPv6
+              remote  address for --backend-client-max-concurrency and
+              "request-rate" parameter in --backend option.
+              Default: )"
+      << config->conn.downstream->client_ipv6_prefix << R"(
   --rlimit-nofile=<N>
               Set maximum number of open files (RLIMIT_NOFILE) to <N>.
               If 0 is given, nghttpx does not set the limit.
@@ -2302,6 +2515,43 @@ Performance:
               Set buffer size used to store backend response.
               Default: )"
       << util::utos_unit(config->conn.downstream->response_buffer_size) << R"(
+  --backend-buffer-request-max-body=<SIZE>
+              Set  the  maximum size of request body which is buffered
+              by "buffer-request" parameter in --backend option.  If a
+              request  body  exceeds  <SIZE>, the request is responded
+              with 413.
+              Default: )"
+      << util::utos_unit(config->conn.downstream->buffer_request_max_body)
+      << R"(
+  --backend-buffer-request-memory=<SIZE>
+              Set  the  maximum size of request body which is buffered
+              in  memory  by  "buffer-request"  parameter in --backend
+              option per frontend connection.   The request body which
+              exceeds  <SIZE>  is  written  to  a  temporary  file  in
+              --backend-response-spool-dir.   If the temporary file is
+              not  available,  and  the  request  body  kept in memory
+              exceeds <SIZE>, nghttpx stops receiving the request body
+              from  HTTP/2  and  HTTP/3 clients, except for the oldest
+              request on the connection, until the memory is released.
+              Default: )"
+      << util::utos_unit(config->conn.downstream->buffer_request_memory)
+      << R"(
+  --backend-response-spool-dir=<PATH>
+              Set  the  directory where temporary files are created to
+              spool a response body by "spool-response" parameter, and
+              a   request   body   by  "buffer-request"  parameter  in
+              --backend option.
+              Default: )"
+      << config->conn.downstream->response_spool.dir << R"(
+  --backend-response-spool-max=<SIZE>
+              Set the maximum size of a response body which is spooled
+              by  "spool-response" parameter in --backend option.   If
+              the  spooled response body exceeds <SIZE>, nghttpx stops
+              reading  the  response from the backend until the client
+              reads the spooled data.
+              Default: )"
+      << util::utos_unit(config->conn.downstream->response_spool.max)
+      << R"(
   --fastopen=<N>
               Enables  "TCP Fast  Open" for  the listening  socket and
               limits the  maximum length for the  queue of connections
@@ -2312,6 +2562,27 @@ Performance:
   --no-kqueue Don't use  kqueue.  This  option is only  applicable for
               the platforms  which have kqueue.  For  other platforms,
               this option will be simply ignored.
+  --splice
+              Relay  the  data of CONNECT and HTTP Upgrade tunnel, and
+              the  response  body  which  has  content-length, between
+              cleartext   HTTP/1.1  frontend  and  cleartext  HTTP/1.1
+              backend  with  splice(2), without copying them into user
+              space.  The response body is relayed from the point just
+              after  the  response  header fields, and the connections
+              are   used   as   usual   for   the  next  request  once
+              content-length   bytes   have  been  relayed.    Chunked
+              response  body is not relayed with splice(2).   The data
+              pass  through  the  pipes  which  each worker keeps in a
+              pool.   This  option  is  ignored  if  splice(2)  is not
+              available.
+  --memchunk-pool-max-free=<SIZE>
+              Set  the  maximum size of memory which each worker keeps
+              in the freelist of its buffer pool after the buffers are
+              released.    The   buffers   above   <SIZE>   are  freed
+              periodically,  so  that  the  memory  allocated during a
+              traffic spike is returned.
+              Default: )"
+      << util::utos_unit(config->memchunk_pool_max_free) << R"(
 
 Timeout:
   --frontend-http2-idle-timeout=<DURATION>
@@ -2398,6 +2669,81 @@ Timeout:
               option caps its maximum value.
               Default: )"
       << util::duration_str(config->conn.downstream->timeout.max_backoff) << R"(
+  --backend-outlier-detection-interval=<DURATION>
+              Enable  outlier  detection  and  run  it  at  the  given
+              interval.   nghttpx  evaluates  the backend addresses in
+              each backend group, and temporarily ejects the addresses
+              which  fail  too  often  or respond much slower than the
+              others.   An  ejected  address  is  excluded  from  load
+              balancing  until  the ejection time elapses.   A request
+              fails  if the response status code is 5xx, including the
+              one  generated by nghttpx due to a backend error, or the
+              stream is reset.  0 disables outlier detection.
+              Default: )"
+      << util::duration_str(config->conn.downstream->outlier.interval) << R"(
+  --backend-outlier-failure-rate=<PERCENT>
+              Eject  a  backend  address  if  the percentage of failed
+              requests  in  the last 2 intervals is equal to or larger
+              than  this  value.   At least 5 requests are required to
+              evaluate  the  failure  rate.   0  disables failure rate
+              based ejection.
+              Default: )"
+      << config->conn.downstream->outlier.failure_rate << R"(
+  --backend-outlier-latency-factor=<N>
+              Eject  a  backend  address if its exponentially weighted
+              moving  average  of  response latency is larger than the
+              median of the backend group multiplied by this value.  0
+              disables latency based ejection.
+              Default: )"
+      << config->conn.downstream->outlier.latency_factor << R"(
+  --backend-outlier-ejection-time=<DURATION>
+              Specify  the  base  duration  of  ejection.   The actual
+              duration  is  this  value  multiplied  by  the number of
+              consecutive  ejections of the address, up to 10 times of
+              this value.
+              Default: )"
+      << util::duration_str(config->conn.downstream->outlier.ejection_time)
+      << R"(
+  --backend-outlier-max-ejection-percent=<PERCENT>
+              Specify the maximum percentage of backend addresses in a
+              backend group which can be ejected at the same time.
+              Default: )"
+      << config->conn.downstream->outlier.max_ejection_percent << R"(
+  --backend-hedge-percentile=<P>
+              Use the given percentile of backend response time, which
+              each  worker  has  observed for the same pattern, as the
+              delay  of  hedged request if it is longer than the value
+              of "hedge-delay" parameter in --backend option.   <P> is
+              a number in the range [0, 100), for example, 99.9.   The
+              percentile  is  only  used  after  enough  responses are
+              observed.    0   disables   this   feature,   and   only
+              "hedge-delay" is used.
+              Default: )"
+      << config->conn.downstream->hedge_percentile << R"(
+  --backend-queue-delay-target=<DURATION>
+              Enable  load  shedding  of the requests which are queued
+              because    of   --backend-connections-per-frontend,   or
+              --backend-connections-per-host    with    --http2-proxy.
+              nghttpx measures the time that each request waits in the
+              queue.     If    it    stays    above   <DURATION>   for
+              --backend-queue-delay-interval,  nghttpx  responds  with
+              503  to  the  requests  at  the head of the queue at the
+              increasing  rate  until  the  waiting  time  drops below
+              <DURATION>  in  the same way as CoDel does.   This keeps
+              the queueing delay bounded under overload.   Only HTTP/2
+              and  HTTP/3  frontend  connections  queue  requests.   0
+              disables this feature.
+              Default: )"
+      << util::duration_str(config->conn.downstream->queue_delay.target)
+      << R"(
+  --backend-queue-delay-interval=<DURATION>
+              Specify        the        interval        used        by
+              --backend-queue-delay-target.   The  waiting  time  must
+              stay above the target for this duration before the first
+              request is shed.
+              Default: )"
+      << util::duration_str(config->conn.downstream->queue_delay.interval)
+      << R"(
 
 SSL/TLS:
   --ciphers=<SUITE>
@@ -2698,6 +3044,32 @@ HTTP/2:
               concurrent requests are set by a remote server.
               Default: )"
       << config->http2.downstream.max_concurrent_streams << R"(
+  --backend-http2-streams-per-session=<N>
+              Set  the  number  of  concurrent requests in one backend
+              HTTP/2 session at which nghttpx opens another session to
+              the same backend address.   A session whose flow control
+              window  is  exhausted  is  also treated as full.   A new
+              request is forwarded to the session which has the fewest
+              concurrent  requests  among  the  sessions which are not
+              full.   A  session which becomes idle when load drops is
+              closed  after --backend-read-timeout.   If 0 is given, a
+              new  session  is opened only when the maximum concurrent
+              streams advertised by the backend server is reached.
+              Default: )"
+      << config->http2.downstream.streams_per_session << R"(
+  --backend-http2-max-sessions=<N>
+              Set  the  maximum  number of backend HTTP/2 sessions per
+              backend  address in a worker which nghttpx opens because
+              of --backend-http2-streams-per-session.
+              Default: )"
+      << config->http2.downstream.max_sessions << R"(
+  --backend-http2-pack-sessions
+              Forward  a  new  request  to  the busiest backend HTTP/2
+              session  which  is  not full instead of the least loaded
+              one so that the requests are packed into as few sessions
+              as possible, and the surplus sessions become idle sooner
+              when   load  drops.    This  option  has  no  effect  if
+              --backend-http2-streams-per-session is 0.
   --frontend-http2-window-size=<SIZE>
               Sets  the  per-stream  initial  window  size  of  HTTP/2
               frontend connection.
@@ -2857,6 +3229,26 @@ Logging:
               * $protocol_version:   HTTP  version   (e.g.,  HTTP/1.1,
                 HTTP/2)
 
+              The following variables break down $request_time.  They
+              are in seconds with milliseconds resolution, and "-" if
+              the request did not go through the phase.
+
+              * $tls_handshake_time:  time  taken  to  complete  TLS
+                handshake  with  client.   It  is  the  same  for  all
+                requests in a connection.
+              * $request_header_time: time taken to receive request
+                header fields.
+              * $backend_queue_time: time between receiving request
+                header fields and getting a backend connection.
+              * $backend_connect_time:  time  taken  to  establish  a
+                backend  connection (including  TLS  handshake).  "-"
+                if an existing connection was reused.
+              * $backend_response_time: time between sending request
+                to backend and receiving response header fields.
+              * $response_transfer_time: time between receiving response
+                header fields from backend and sending the last byte of
+                response to client.
+
               The  variable  can  be  enclosed  by  "{"  and  "}"  for
               disambiguation (e.g., ${remote_addr}).
 
@@ -2866,6 +3258,22 @@ Logging:
               Write  access  log  when   response  header  fields  are
               received   from  backend   rather   than  when   request
               transaction finishes.
+  --accesslog-encoding=(text|json|binary)
+              Specify the encoding of access log.  If "text" is given,
+              access  log is  written as  specified by  --accesslog-
+              format.  If "json" is given, each  record is written as
+              a JSON object per line, and  each variable that appears
+              in  --accesslog-format  becomes  its member  (e.g.,  {
+              "remote_addr":"127.0.0.1",  "status":200}).   Literals
+              in  --accesslog-format  are  ignored.  If  "binary"  is
+              given,  each  record is  written  as  a length  prefixed
+              binary record which contains  the variables in the order
+              of  --accesslog-format.    Numbers  are   written  as
+              integers,  and  no  escaping   is  done.   Use  contrib/
+              nghttpx-accesslog-decode.py  to  convert  binary  access
+              log into  text.  "binary"  cannot be used  together with
+              --accesslog-syslog.
+              Default: text
   --errorlog-file=<PATH>
               Set path to write error  log.  To reopen file, send USR1
               signal  to nghttpx.   stderr will  be redirected  to the
@@ -3308,6 +3716,13 @@ int process_options(
 
   auto &loggingconf = config->logging;
 
+  if (loggingconf.access.syslog &&
+      loggingconf.access.encoding == AccessLogEncoding::BINARY) {
+    LOG(FATAL) << "accesslog-encoding=binary cannot be used with "
+                  "accesslog-syslog";
+    return -1;
+  }
+
   if (loggingconf.access.syslog || loggingconf.error.syslog) {
     openlog("nghttpx", LOG_NDELAY | LOG_NOWAIT | LOG_PID,
             loggingconf.syslog_facility);
@@ -3976,6 +4391,47 @@ int main(int argc, char **argv) {
        195},
       {SHRPX_OPT_FRONTEND_HTTP3_IDLE_TIMEOUT.data(), required_argument, &flag,
        196},
+      {SHRPX_OPT_ACCESSLOG_ENCODING.data(), required_argument, &flag, 197},
+      {SHRPX_OPT_BACKEND_HTTP2_STREAMS_PER_SESSION.data(), required_argument,
+       &flag, 198},
+      {SHRPX_OPT_BACKEND_HTTP2_MAX_SESSIONS.data(), required_argument, &flag,
+       199},
+      {SHRPX_OPT_BACKEND_OUTLIER_DETECTION_INTERVAL.data(), required_argument,
+       &flag, 200},
+      {SHRPX_OPT_BACKEND_OUTLIER_FAILURE_RATE.data(), required_argument, &flag,
+       201},
+      {SHRPX_OPT_BACKEND_OUTLIER_LATENCY_FACTOR.data(), required_argument,
+       &flag, 202},
+      {SHRPX_OPT_BACKEND_OUTLIER_EJECTION_TIME.data(), required_argument, &flag,
+       203},
+      {SHRPX_OPT_BACKEND_OUTLIER_MAX_EJECTION_PERCENT.data(), required_argument,
+       &flag, 204},
+      {SHRPX_OPT_BACKEND_HEDGE_PERCENTILE.data(), required_argument, &flag,
+       205},
+      {SHRPX_OPT_BACKEND_QUEUE_DELAY_TARGET.data(), required_argument, &flag,
+       206},
+      {SHRPX_OPT_BACKEND_QUEUE_DELAY_INTERVAL.data(), required_argument, &flag,
+       207},
+      {SHRPX_OPT_BACKEND_CLIENT_MAX_CONCURRENCY.data(), required_argument,
+       &flag, 208},
+      {SHRPX_OPT_BACKEND_CLIENT_KEY_HEADER.data(), required_argument, &flag,
+       209},
+      {SHRPX_OPT_BACKEND_CLIENT_IPV4_PREFIX.data(), required_argument, &flag,
+       210},
+      {SHRPX_OPT_BACKEND_CLIENT_IPV6_PREFIX.data(), required_argument, &flag,
+       211},
+      {SHRPX_OPT_BACKEND_BUFFER_REQUEST_MAX_BODY.data(), required_argument,
+       &flag, 212},
+      {SHRPX_OPT_BACKEND_RESPONSE_SPOOL_DIR.data(), required_argument, &flag,
+       213},
+      {SHRPX_OPT_BACKEND_RESPONSE_SPOOL_MAX.data(), required_argument, &flag,
+       214},
+      {SHRPX_OPT_SPLICE.data(), no_argument, &flag, 215},
+      {SHRPX_OPT_MEMCHUNK_POOL_MAX_FREE.data(), required_argument, &flag, 216},
+      {SHRPX_OPT_BACKEND_CLIENT_WEIGHT.data(), required_argument, &flag, 217},
+      {SHRPX_OPT_BACKEND_BUFFER_REQUEST_MEMORY.data(), required_argument, &flag,
+       218},
+      {SHRPX_OPT_BACKEND_HTTP2_PACK_SESSIONS.data(), no_argument, &flag, 219},
       {nullptr, 0, nullptr, 0}};
 
     int option_index = 0;
@@ -4901,6 +5357,119 @@ int main(int argc, char **argv) {
         cmdcfgs.emplace_back(SHRPX_OPT_FRONTEND_HTTP3_IDLE_TIMEOUT,
                              std::string_view{optarg});
         break;
+      case 197:
+        // --accesslog-encoding
+        cmdcfgs.emplace_back(SHRPX_OPT_ACCESSLOG_ENCODING,
+                             std::string_view{optarg});
+        break;
+      case 198:
+        // --backend-http2-streams-per-session
+        cmdcfgs.emplace_back(SHRPX_OPT_BACKEND_HTTP2_STREAMS_PER_SESSION,
+                             std::string_view{optarg});
+        break;
+      case 199:
+        // --backend-http2-max-sessions
+        cmdcfgs.emplace_back(SHRPX_OPT_BACKEND_HTTP2_MAX_SESSIONS,
+                             std::string_view{optarg});
+        break;
+      case 200:
+        // --backend-outlier-detection-interval
+        cmdcfgs.emplace_back(SHRPX_OPT_BACKEND_OUTLIER_DETECTION_INTERVAL,
+                             std::string_view{optarg});
+        break;
+      case 201:
+        // --backend-outlier-failure-rate
+        cmdcfgs.emplace_back(SHRPX_OPT_BACKEND_OUTLIER_FAILURE_RATE,
+                             std::string_view{optarg});
+        break;
+      case 202:
+        // --backend-outlier-latency-factor
+        cmdcfgs.emplace_back(SHRPX_OPT_BACKEND_OUTLIER_LATENCY_FACTOR,
+                             std::string_view{optarg});
+        break;
+      case 203:
+        // --backend-outlier-ejection-time
+        cmdcfgs.emplace_back(SHRPX_OPT_BACKEND_OUTLIER_EJECTION_TIME,
+                             std::string_view{optarg});
+        break;
+      case 204:
+        // --backend-outlier-max-ejection-percent
+        cmdcfgs.emplace_back(SHRPX_OPT_BACKEND_OUTLIER_MAX_EJECTION_PERCENT,
+                             std::string_view{optarg});
+        break;
+      case 205:
+        // --backend-hedge-percentile
+        cmdcfgs.emplace_back(SHRPX_OPT_BACKEND_HEDGE_PERCENTILE,
+                             std::string_view{optarg});
+        break;
+      case 206:
+        // --backend-queue-delay-target
+        cmdcfgs.emplace_back(SHRPX_OPT_BACKEND_QUEUE_DELAY_TARGET,
+                             std::string_view{optarg});
+        break;
+      case 207:
+        // --backend-queue-delay-interval
+        cmdcfgs.emplace_back(SHRPX_OPT_BACKEND_QUEUE_DELAY_INTERVAL,
+                             std::string_view{optarg});
+        break;
+      case 208:
+        // --backend-client-max-concurrency
+        cmdcfgs.emplace_back(SHRPX_OPT_BACKEND_CLIENT_MAX_CONCURRENCY,
+                             std::string_view{optarg});
+        break;
+      case 209:
+        // --backend-client-key-header
+        cmdcfgs.emplace_back(SHRPX_OPT_BACKEND_CLIENT_KEY_HEADER,
+                             std::string_view{optarg});
+        break;
+      case 210:
+        // --backend-client-ipv4-prefix
+        cmdcfgs.emplace_back(SHRPX_OPT_BACKEND_CLIENT_IPV4_PREFIX,
+                             std::string_view{optarg});
+        break;
+      case 211:
+        // --backend-client-ipv6-prefix
+        cmdcfgs.emplace_back(SHRPX_OPT_BACKEND_CLIENT_IPV6_PREFIX,
+                             std::string_view{optarg});
+        break;
+      case 212:
+        // --backend-buffer-request-max-body
+        cmdcfgs.emplace_back(SHRPX_OPT_BACKEND_BUFFER_REQUEST_MAX_BODY,
+                             std::string_view{optarg});
+        break;
+      case 213:
+        // --backend-response-spool-dir
+        cmdcfgs.emplace_back(SHRPX_OPT_BACKEND_RESPONSE_SPOOL_DIR,
+                             std::string_view{optarg});
+        break;
+      case 214:
+        // --backend-response-spool-max
+        cmdcfgs.emplace_back(SHRPX_OPT_BACKEND_RESPONSE_SPOOL_MAX,
+                             std::string_view{optarg});
+        break;
+      case 215:
+        // --splice
+        cmdcfgs.emplace_back(SHRPX_OPT_SPLICE, "yes"sv);
+        break;
+      case 216:
+        // --memchunk-pool-max-free
+        cmdcfgs.emplace_back(SHRPX_OPT_MEMCHUNK_POOL_MAX_FREE,
+                             std::string_view{optarg});
+        break;
+      case 217:
+        // --backend-client-weight
+        cmdcfgs.emplace_back(SHRPX_OPT_BACKEND_CLIENT_WEIGHT,
+                             std::string_view{optarg});
+        break;
+      case 218:
+        // --backend-buffer-request-memory
+        cmdcfgs.emplace_back(SHRPX_OPT_BACKEND_BUFFER_REQUEST_MEMORY,
+                             std::string_view{optarg});
+        break;
+      case 219:
+        // --backend-http2-pack-sessions
+        cmdcfgs.emplace_back(SHRPX_OPT_BACKEND_HTTP2_PACK_SESSIONS, "yes"sv);
+        break;
       default:
         break;
       }
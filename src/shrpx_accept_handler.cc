@@ -60,47 +60,55 @@ AcceptHandler::~AcceptHandler() {
 }
 
 void AcceptHandler::accept_connection() {
-  sockaddr_union sockaddr;
-  socklen_t addrlen = sizeof(sockaddr);
+  // Each worker has its own TCP listener with SO_REUSEPORT, so
+  // accepting a burst of connections in one go saves the round trips
+  // of the event loop without skewing the load.  UNIX domain socket
+  // is shared by all workers.
+  auto batch = faddr_->host_unix ? 1 : MAX_ACCEPT_BATCH;
+
+  for (size_t i = 0; i < batch; ++i) {
+    sockaddr_union sockaddr;
+    socklen_t addrlen = sizeof(sockaddr);
 
 #ifdef HAVE_ACCEPT4
-  auto cfd =
-    accept4(faddr_->fd, &sockaddr.sa, &addrlen, SOCK_NONBLOCK | SOCK_CLOEXEC);
+    auto cfd = accept4(faddr_->fd, &sockaddr.sa, &addrlen,
+                       SOCK_NONBLOCK | SOCK_CLOEXEC);
 #else  // !HAVE_ACCEPT4
-  auto cfd = accept(faddr_->fd, &sockaddr.sa, &addrlen);
+    auto cfd = accept(faddr_->fd, &sockaddr.sa, &addrlen);
 #endif // !HAVE_ACCEPT4
 
-  if (cfd == -1) {
-    switch (errno) {
-    case EINTR:
-    case ENETDOWN:
-    case EPROTO:
-    case ENOPROTOOPT:
-    case EHOSTDOWN:
+    if (cfd == -1) {
+      switch (errno) {
+      case EINTR:
+      case ENETDOWN:
+      case EPROTO:
+      case ENOPROTOOPT:
+      case EHOSTDOWN:
 #ifdef ENONET
-    case ENONET:
+      case ENONET:
 #endif // ENONET
-    case EHOSTUNREACH:
-    case EOPNOTSUPP:
-    case ENETUNREACH:
-      return;
-    case EMFILE:
-    case ENFILE:
-      LOG(WARN) << "acceptor: running out file descriptor; disable acceptor "
-                   "temporarily";
-      worker_->sleep_listener(get_config()->conn.listener.timeout.sleep);
-      return;
-    default:
-      return;
+      case EHOSTUNREACH:
+      case EOPNOTSUPP:
+      case ENETUNREACH:
+        return;
+      case EMFILE:
+      case ENFILE:
+        LOG(WARN) << "acceptor: running out file descriptor; disable "
+                     "acceptor temporarily";
+        worker_->sleep_listener(get_config()->conn.listener.timeout.sleep);
+        return;
+      default:
+        return;
+      }
     }
-  }
 
 #ifndef HAVE_ACCEPT4
-  util::make_socket_nonblocking(cfd);
-  util::make_socket_closeonexec(cfd);
+    util::make_socket_nonblocking(cfd);
+    util::make_socket_closeonexec(cfd);
 #endif // !HAVE_ACCEPT4
 
-  worker_->handle_connection(cfd, &sockaddr.sa, addrlen, faddr_);
+    worker_->handle_connection(cfd, &sockaddr.sa, addrlen, faddr_);
+  }
 }
 
 void AcceptHandler::enable() { ev_io_start(worker_->get_loop(), &wev_); }
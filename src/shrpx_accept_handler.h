@@ -34,10 +34,15 @@ namespace shrpx {
 class Worker;
 struct UpstreamAddr;
 
+// The maximum number of connections which AcceptHandler accepts from
+// TCP listener per readiness notification.
+constexpr size_t MAX_ACCEPT_BATCH = 16;
+
 class AcceptHandler {
 public:
   AcceptHandler(Worker *worker, const UpstreamAddr *faddr);
   ~AcceptHandler();
+  // Accepts the pending connections.
   void accept_connection();
   void enable();
   void disable();
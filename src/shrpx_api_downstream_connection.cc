@@ -34,6 +34,7 @@
 #include "shrpx_downstream.h"
 #include "shrpx_worker.h"
 #include "shrpx_connection_handler.h"
+#include "shrpx_metrics.h"
 #include "shrpx_log.h"
 
 namespace shrpx {
@@ -52,6 +53,13 @@ const auto configrevision_endpoint = APIEndpoint{
   (1 << API_METHOD_GET),
   &APIDownstreamConnection::handle_configrevision,
 };
+
+const auto metrics_endpoint = APIEndpoint{
+  "/api/v1beta1/metrics"sv,
+  false,
+  (1 << API_METHOD_GET),
+  &APIDownstreamConnection::handle_metrics,
+};
 } // namespace
 
 namespace {
@@ -160,6 +168,15 @@ int APIDownstreamConnection::send_reply(unsigned int http_status,
 namespace {
 const APIEndpoint *lookup_api(const std::string_view &path) {
   switch (path.size()) {
+  case 20:
+    switch (path[19]) {
+    case 's':
+      if (util::streq("/api/v1beta1/metric"sv, path.substr(0, 19))) {
+        return &metrics_endpoint;
+      }
+      break;
+    }
+    break;
   case 26:
     switch (path[25]) {
     case 'g':
@@ -359,10 +376,24 @@ int APIDownstreamConnection::handle_backendconfig() {
   auto &src = config->conn.downstream;
 
   downstreamconf->timeout = src->timeout;
+  downstreamconf->outlier = src->outlier;
+  downstreamconf->queue_delay = src->queue_delay;
   downstreamconf->connections_per_host = src->connections_per_host;
   downstreamconf->connections_per_frontend = src->connections_per_frontend;
   downstreamconf->request_buffer_size = src->request_buffer_size;
   downstreamconf->response_buffer_size = src->response_buffer_size;
+  downstreamconf->hedge_percentile = src->hedge_percentile;
+  downstreamconf->client_max_concurrency = src->client_max_concurrency;
+  downstreamconf->client_weights = src->client_weights;
+  downstreamconf->client_key_header =
+    make_string_ref(downstreamconf->balloc, src->client_key_header);
+  downstreamconf->buffer_request_max_body = src->buffer_request_max_body;
+  downstreamconf->buffer_request_memory = src->buffer_request_memory;
+  downstreamconf->response_spool.dir =
+    make_string_ref(downstreamconf->balloc, src->response_spool.dir);
+  downstreamconf->response_spool.max = src->response_spool.max;
+  downstreamconf->client_ipv4_prefix = src->client_ipv4_prefix;
+  downstreamconf->client_ipv6_prefix = src->client_ipv6_prefix;
   downstreamconf->family = src->family;
 
   std::unordered_set<std::string_view> include_set;
@@ -443,6 +474,34 @@ int APIDownstreamConnection::handle_configrevision() {
   return 0;
 }
 
+int APIDownstreamConnection::handle_metrics() {
+  shutdown_read_ = true;
+
+  auto upstream = downstream_->get_upstream();
+  auto &resp = downstream_->response();
+  auto &balloc = downstream_->get_block_allocator();
+
+  auto metrics = worker_->get_connection_handler()->get_metrics();
+  auto data = metrics->format_prometheus();
+
+  resp.http_status = 200;
+
+  resp.fs.add_header_token("content-type"sv,
+                           "text/plain; version=0.0.4; charset=utf-8"sv,
+                           false, http2::HD_CONTENT_TYPE);
+  resp.fs.add_header_token("content-length"sv,
+                           util::make_string_ref_uint(balloc, data.size()),
+                           false, http2::HD_CONTENT_LENGTH);
+
+  if (upstream->send_reply(downstream_,
+                           reinterpret_cast<const uint8_t *>(data.data()),
+                           data.size()) != 0) {
+    return -1;
+  }
+
+  return 0;
+}
+
 void APIDownstreamConnection::pause_read(IOCtrlReason reason) {}
 
 int APIDownstreamConnection::resume_read(IOCtrlReason reason, size_t consumed) {
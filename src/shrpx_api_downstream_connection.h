@@ -99,6 +99,9 @@ public:
   int handle_backendconfig();
   // Handles configrevision API request.
   int handle_configrevision();
+  // Handles metrics API request.  Unlike the other APIs, the response
+  // is in Prometheus text exposition format.
+  int handle_metrics();
 
 private:
   Worker *worker_;
@@ -36,6 +36,7 @@
 
 #include <cerrno>
 #include <algorithm>
+#include <tuple>
 
 #include "shrpx_upstream.h"
 #include "shrpx_http2_upstream.h"
@@ -52,6 +53,7 @@
 #include "shrpx_api_downstream_connection.h"
 #include "shrpx_health_monitor_downstream_connection.h"
 #include "shrpx_null_downstream_connection.h"
+#include "shrpx_metrics.h"
 #ifdef ENABLE_HTTP3
 #  include "shrpx_http3_upstream.h"
 #endif // ENABLE_HTTP3
@@ -69,6 +71,10 @@ void timeoutcb(struct ev_loop *loop, ev_timer *w, int revents) {
   auto conn = static_cast<Connection *>(w->data);
   auto handler = static_cast<ClientHandler *>(conn->data);
 
+  if (w == &conn->wt && !conn->expired_wt()) {
+    return;
+  }
+
   if (LOG_ENABLED(INFO)) {
     CLOG(INFO, handler) << "Time out";
   }
@@ -152,7 +158,9 @@ int ClientHandler::read_clear() {
 }
 
 int ClientHandler::write_clear() {
-  std::array<iovec, 2> iov;
+  // Gather as many chunks as possible so that the whole response
+  // buffer is usually written by a single writev(2).
+  std::array<iovec, MAX_WR_IOVCNT> iov;
 
   for (;;) {
     if (on_write() != 0) {
@@ -182,6 +190,120 @@ int ClientHandler::write_clear() {
   return 0;
 }
 
+int ClientHandler::read_splice() {
+  // The data which were read before splicing started must be sent
+  // first.
+  if (rb_.chunk_avail()) {
+    if (rb_.rleft()) {
+      if (on_read() != 0) {
+        return -1;
+      }
+
+      if (rb_.rleft()) {
+        conn_.rlimit.stopw();
+        return 0;
+      }
+    }
+
+    rb_.release_chunk();
+  }
+
+  auto downstream =
+    static_cast<HttpsUpstream *>(upstream_.get())->get_downstream();
+  if (!downstream || !downstream->get_request_pipe()) {
+    return read_clear();
+  }
+
+  auto pipe = downstream->get_request_pipe();
+
+  for (;;) {
+    if (!ev_is_active(&conn_.rev)) {
+      return 0;
+    }
+
+    if (pipe->full()) {
+      upstream_->pause_read(SHRPX_NO_BUFFER);
+      return 0;
+    }
+
+    auto nread = conn_.splice_read(*pipe, pipe->capacity);
+    if (nread == 0) {
+      return 0;
+    }
+
+    if (nread < 0) {
+      return -1;
+    }
+
+    downstream->request().recv_body_length += nread;
+
+    // The splice is started only if backend connection is
+    // HttpDownstreamConnection.
+    auto dconn = static_cast<HttpDownstreamConnection *>(
+      downstream->get_downstream_connection());
+    if (!dconn) {
+      return -1;
+    }
+
+    dconn->signal_write();
+  }
+}
+
+int ClientHandler::write_splice() {
+  std::array<iovec, MAX_WR_IOVCNT> iov;
+
+  for (;;) {
+    if (on_write() != 0) {
+      return -1;
+    }
+
+    nghttp2_ssize nwrite;
+
+    // The data in response buffer, such as response header fields,
+    // precede the data in the pipe.
+    auto iovcnt = upstream_->response_riovec(iov.data(), iov.size());
+    if (iovcnt) {
+      nwrite = conn_.writev_clear(iov.data(), iovcnt);
+      if (nwrite < 0) {
+        return -1;
+      }
+
+      if (nwrite == 0) {
+        return 0;
+      }
+
+      upstream_->response_drain(as_unsigned(nwrite));
+
+      continue;
+    }
+
+    auto downstream =
+      static_cast<HttpsUpstream *>(upstream_.get())->get_downstream();
+    if (!downstream) {
+      break;
+    }
+
+    auto pipe = downstream->get_response_pipe();
+    if (!pipe || pipe->len == 0) {
+      break;
+    }
+
+    nwrite = conn_.splice_write(*pipe);
+    if (nwrite < 0) {
+      return -1;
+    }
+
+    if (nwrite == 0) {
+      return 0;
+    }
+  }
+
+  conn_.wlimit.stopw();
+  ev_timer_stop(conn_.loop, &conn_.wt);
+
+  return 0;
+}
+
 int ClientHandler::proxy_protocol_peek_clear() {
   rb_.ensure_chunk();
 
@@ -222,7 +344,11 @@ int ClientHandler::tls_handshake() {
     return 0;
   }
 
+  auto metrics = worker_->get_metrics();
+
   if (rv < 0) {
+    metrics->tls_handshake_failures_total.inc();
+
     return -1;
   }
 
@@ -230,6 +356,16 @@ int ClientHandler::tls_handshake() {
     CLOG(INFO, this) << "SSL/TLS handshake completed";
   }
 
+  tls_handshake_end_time_ = std::chrono::high_resolution_clock::now();
+
+  metrics->tls_handshakes_total.inc();
+  if (SSL_session_reused(conn_.tls.ssl)) {
+    metrics->tls_sessions_reused_total.inc();
+  }
+  metrics->tls_handshake_duration.observe(
+    std::chrono::duration_cast<std::chrono::microseconds>(
+      tls_handshake_end_time_ - tls_handshake_start_time_));
+
   if (validate_next_proto() != 0) {
     return -1;
   }
@@ -471,11 +607,16 @@ ClientHandler::ClientHandler(Worker *worker, int fd, SSL *ssl,
     faddr_(faddr),
     worker_(worker),
     left_connhd_len_(NGHTTP2_CLIENT_MAGIC_LEN),
+    buffered_request_memory_(0),
     affinity_hash_(0),
     should_close_after_write_(false),
     affinity_hash_computed_(false) {
   ++worker_->get_worker_stat()->num_connections;
 
+  auto metrics = worker_->get_metrics();
+  metrics->connections_active.inc();
+  metrics->connections_total.inc();
+
   ev_timer_init(&reneg_shutdown_timer_, shutdowncb, 0., 0.);
 
   reneg_shutdown_timer_.data = this;
@@ -543,6 +684,7 @@ void ClientHandler::init_forwarded_for(int family,
 void ClientHandler::setup_upstream_io_callback() {
   if (conn_.tls.ssl) {
     conn_.prepare_server_handshake();
+    tls_handshake_start_time_ = std::chrono::high_resolution_clock::now();
     read_ = write_ = &ClientHandler::tls_handshake;
     on_read_ = &ClientHandler::upstream_noop;
     on_write_ = &ClientHandler::upstream_write;
@@ -583,6 +725,8 @@ ClientHandler::~ClientHandler() {
   auto worker_stat = worker_->get_worker_stat();
   --worker_stat->num_connections;
 
+  worker_->get_metrics()->connections_active.dec();
+
   if (worker_stat->num_connections == 0) {
     worker_->schedule_clear_mcpool();
   }
@@ -738,16 +882,17 @@ void ClientHandler::pool_downstream_connection(
 }
 
 namespace {
-// Computes 32bits hash for session affinity for IP address |ip|.
-uint32_t compute_affinity_from_ip(const std::string_view &ip) {
+// Computes 32bits hash for session affinity for |key| (e.g., IP
+// address).
+uint32_t compute_affinity_from_key(const std::string_view &key) {
   int rv;
   std::array<uint8_t, 32> buf;
 
-  rv = util::sha256(buf.data(), ip);
+  rv = util::sha256(buf.data(), key);
   if (rv != 0) {
     // Not sure when sha256 failed.  Just fall back to another
     // function.
-    return util::hash32(ip);
+    return util::hash32(key);
   }
 
   return (static_cast<uint32_t>(buf[0]) << 24) |
@@ -756,6 +901,132 @@ uint32_t compute_affinity_from_ip(const std::string_view &ip) {
 }
 } // namespace
 
+namespace {
+// Returns the network address which |ipaddr| belongs to in the form
+// of "<ADDR>/<PREFIX>".  |ipv4_prefix| and |ipv6_prefix| are the
+// prefix length for IPv4 and IPv6 address respectively.  |ipaddr| is
+// returned as is if it is not a numeric IP address, or the prefix
+// covers the whole address.
+std::string_view mask_client_addr(BlockAllocator &balloc,
+                                  const std::string_view &ipaddr,
+                                  size_t ipv4_prefix, size_t ipv6_prefix) {
+  std::array<uint8_t, sizeof(in6_addr)> buf;
+  int family;
+  size_t prefix;
+  size_t addrlen;
+
+  if (inet_pton(AF_INET, ipaddr.data(), buf.data()) == 1) {
+    family = AF_INET;
+    prefix = ipv4_prefix;
+    addrlen = sizeof(in_addr);
+  } else if (inet_pton(AF_INET6, ipaddr.data(), buf.data()) == 1) {
+    family = AF_INET6;
+    prefix = ipv6_prefix;
+    addrlen = sizeof(in6_addr);
+  } else {
+    return ipaddr;
+  }
+
+  if (prefix >= addrlen * 8) {
+    return ipaddr;
+  }
+
+  auto n = prefix / 8;
+  if (prefix % 8) {
+    buf[n] &= static_cast<uint8_t>(0xff << (8 - prefix % 8));
+    ++n;
+  }
+
+  std::ranges::fill(std::ranges::begin(buf) + n,
+                    std::ranges::begin(buf) + addrlen, 0);
+
+  std::array<char, INET6_ADDRSTRLEN> host;
+  if (inet_ntop(family, buf.data(), host.data(), host.size()) == nullptr) {
+    return ipaddr;
+  }
+
+  return concat_string_ref(balloc, std::string_view{host.data()}, "/"sv,
+                           util::make_string_ref_uint(balloc, prefix));
+}
+} // namespace
+
+std::string_view ClientHandler::get_client_key(const Downstream *downstream) {
+  auto &downstreamconf = *worker_->get_downstream_config();
+
+  if (!downstreamconf.client_key_header.empty()) {
+    auto kv =
+      downstream->request().fs.header(downstreamconf.client_key_header);
+    if (kv) {
+      return kv->value;
+    }
+  }
+
+  if (client_addr_key_.empty()) {
+    client_addr_key_ =
+      mask_client_addr(balloc_, ipaddr_, downstreamconf.client_ipv4_prefix,
+                       downstreamconf.client_ipv6_prefix);
+  }
+
+  return client_addr_key_;
+}
+
+namespace {
+// Returns true if |session| should not take a new request while
+// another session to the same address can.  It always returns false
+// if --backend-http2-streams-per-session is not set.
+bool http2_session_full(const Http2Session *session) {
+  auto &downstreamconf = get_config()->http2.downstream;
+
+  if (downstreamconf.streams_per_session == 0) {
+    return false;
+  }
+
+  return session->get_num_dconns() >= downstreamconf.streams_per_session ||
+         session->flow_control_stalled();
+}
+} // namespace
+
+namespace {
+// Returns true if |lhs| should take a new request rather than |rhs|.
+// The session which is not full wins.  Then the connected session
+// wins because the request sent to the connecting session has to
+// wait for the handshake.  Then the one which has fewer concurrent
+// requests wins so that the load is spread over the sessions.  If
+// --backend-http2-pack-sessions is given, among the sessions which
+// are not full, the one which has more concurrent requests wins
+// instead so that requests are packed into as few sessions as
+// possible.  Finally the one with the lower round trip time wins.
+bool http2_session_preferred(const Http2Session *lhs,
+                             const Http2Session *rhs) {
+  auto lfull = http2_session_full(lhs);
+  auto rfull = http2_session_full(rhs);
+  if (lfull != rfull) {
+    return !lfull;
+  }
+
+  auto lconnected = lhs->get_state() == Http2SessionState::CONNECTED;
+  auto rconnected = rhs->get_state() == Http2SessionState::CONNECTED;
+  if (lconnected != rconnected) {
+    return lconnected;
+  }
+
+  auto lnum = lhs->get_num_dconns();
+  auto rnum = rhs->get_num_dconns();
+  if (lnum != rnum) {
+    if (!lfull && get_config()->http2.downstream.pack_sessions) {
+      return lnum > rnum;
+    }
+
+    return lnum < rnum;
+  }
+
+  auto lrtt = lhs->get_rtt();
+  auto rrtt = rhs->get_rtt();
+
+  return lrtt.count() && rrtt.count() && lrtt < rrtt;
+}
+} // namespace
+
 Http2Session *ClientHandler::get_http2_session(
   const std::shared_ptr<DownstreamAddrGroup> &group, DownstreamAddr *addr) {
   auto &shared_addr = group->shared_addr;
@@ -765,6 +1036,8 @@ Http2Session *ClientHandler::get_http2_session(
                      << ", index=" << (addr - shared_addr->addrs.data());
   }
 
+  Http2Session *best = nullptr;
+
   for (auto session = addr->http2_extra_freelist.head; session;) {
     auto next = session->dlnext;
 
@@ -781,20 +1054,31 @@ Http2Session *ClientHandler::get_http2_session(
       continue;
     }
 
+    if (!best || http2_session_preferred(session, best)) {
+      best = session;
+    }
+
+    session = next;
+  }
+
+  if (best &&
+      (!http2_session_full(best) ||
+       addr->num_http2_sessions >=
+         get_config()->http2.downstream.max_sessions)) {
     if (LOG_ENABLED(INFO)) {
-      CLOG(INFO, this) << "Use Http2Session " << session
+      CLOG(INFO, this) << "Use Http2Session " << best
                        << " from http2_extra_freelist";
     }
 
-    if (session->max_concurrency_reached(1)) {
+    if (best->max_concurrency_reached(1)) {
       if (LOG_ENABLED(INFO)) {
         CLOG(INFO, this) << "Maximum streams are reached for Http2Session("
-                         << session << ").";
+                         << best << ").";
       }
 
-      session->remove_from_freelist();
+      best->remove_from_freelist();
     }
-    return session;
+    return best;
   }
 
   auto session = new Http2Session(conn_.loop, worker_->get_cl_ssl_ctx(),
@@ -830,10 +1114,12 @@ namespace {
 void reschedule_addr(
   std::priority_queue<DownstreamAddrEntry, std::vector<DownstreamAddrEntry>,
                       DownstreamAddrEntryGreater> &pq,
-  DownstreamAddr *addr) {
-  auto penalty = MAX_DOWNSTREAM_ADDR_WEIGHT + addr->pending_penalty;
-  addr->cycle += penalty / addr->weight;
-  addr->pending_penalty = penalty % addr->weight;
+  DownstreamAddr *addr, ev_tstamp now) {
+  auto weight = get_downstream_addr_effective_weight(addr, now);
+  auto penalty = MAX_DOWNSTREAM_ADDR_WEIGHT * DOWNSTREAM_ADDR_RAMP_SCALE +
+                 addr->pending_penalty;
+  addr->cycle += penalty / weight;
+  addr->pending_penalty = penalty % weight;
 
   pq.push(DownstreamAddrEntry{addr, addr->seq, addr->cycle});
   addr->queued = true;
@@ -854,6 +1140,61 @@ void reschedule_wg(
 }
 } // namespace
 
+namespace {
+// Returns the address which |hash| is mapped to by the consistent
+// hashing of |shared_addr|.  If the address is blocked, the address
+// which follows it in the hash table is chosen.  This function
+// returns nullptr if all addresses are blocked.
+DownstreamAddr *get_affinity_addr(SharedDownstreamAddr &shared_addr,
+                                  uint32_t hash) {
+  if (shared_addr.affinity.hash_method == AffinityHashMethod::MAGLEV) {
+    const auto &table = *shared_addr.maglev_table;
+    auto start = hash % table.size();
+
+    for (size_t i = 0; i < table.size(); ++i) {
+      auto addr = &shared_addr.addrs[table[(start + i) % table.size()]];
+      if (!addr->connect_blocker->blocked()) {
+        return addr;
+      }
+    }
+
+    return nullptr;
+  }
+
+  const auto &affinity_hash = shared_addr.affinity_hash;
+
+  auto it =
+    std::ranges::lower_bound(affinity_hash, hash, {}, &AffinityHash::hash);
+  if (it == std::ranges::end(affinity_hash)) {
+    it = std::ranges::begin(affinity_hash);
+  }
+
+  auto aff_idx = static_cast<size_t>(
+    std::ranges::distance(std::ranges::begin(affinity_hash), it));
+  auto idx = (*it).idx;
+  auto addr = &shared_addr.addrs[idx];
+
+  if (addr->connect_blocker->blocked()) {
+    size_t i;
+    for (i = aff_idx + 1; i != aff_idx; ++i) {
+      if (i == affinity_hash.size()) {
+        i = 0;
+      }
+      addr = &shared_addr.addrs[affinity_hash[i].idx];
+      if (addr->connect_blocker->blocked()) {
+        continue;
+      }
+      break;
+    }
+    if (i == aff_idx) {
+      return nullptr;
+    }
+  }
+
+  return addr;
+}
+} // namespace
+
 DownstreamAddr *ClientHandler::get_downstream_addr(int &err,
                                                    DownstreamAddrGroup *group,
                                                    Downstream *downstream) {
@@ -874,7 +1215,7 @@ DownstreamAddr *ClientHandler::get_downstream_addr(int &err,
     switch (shared_addr->affinity.type) {
     case SessionAffinity::IP:
       if (!affinity_hash_computed_) {
-        affinity_hash_ = compute_affinity_from_ip(ipaddr_);
+        affinity_hash_ = compute_affinity_from_key(ipaddr_);
         affinity_hash_computed_ = true;
       }
       hash = affinity_hash_;
@@ -888,44 +1229,52 @@ DownstreamAddr *ClientHandler::get_downstream_addr(int &err,
 
       hash = get_affinity_cookie(downstream, shared_addr->affinity.cookie.name);
       break;
+    case SessionAffinity::HEADER: {
+      const auto &req = downstream->request();
+      auto kv = req.fs.header(shared_addr->affinity.header.name);
+      if (!kv) {
+        // Fall back to client IP address if the header field is
+        // missing.
+        if (!affinity_hash_computed_) {
+          affinity_hash_ = compute_affinity_from_key(ipaddr_);
+          affinity_hash_computed_ = true;
+        }
+        hash = affinity_hash_;
+        break;
+      }
+      hash = compute_affinity_from_key(kv->value);
+      break;
+    }
+    case SessionAffinity::PATH: {
+      const auto &req = downstream->request();
+      auto path = req.orig_path;
+      // Query is not part of the key.
+      path = path.substr(0, path.find('?'));
+      hash = compute_affinity_from_key(path);
+      break;
+    }
     default:
       assert(0);
     }
 
-    const auto &affinity_hash = shared_addr->affinity_hash;
-
-    auto it =
-      std::ranges::lower_bound(affinity_hash, hash, {}, &AffinityHash::hash);
-    if (it == std::ranges::end(affinity_hash)) {
-      it = std::ranges::begin(affinity_hash);
-    }
-
-    auto aff_idx = static_cast<size_t>(
-      std::ranges::distance(std::ranges::begin(affinity_hash), it));
-    auto idx = (*it).idx;
-    auto addr = &shared_addr->addrs[idx];
-
-    if (addr->connect_blocker->blocked()) {
-      size_t i;
-      for (i = aff_idx + 1; i != aff_idx; ++i) {
-        if (i == shared_addr->affinity_hash.size()) {
-          i = 0;
-        }
-        addr = &shared_addr->addrs[shared_addr->affinity_hash[i].idx];
-        if (addr->connect_blocker->blocked()) {
-          continue;
-        }
-        break;
-      }
-      if (i == aff_idx) {
-        err = -1;
-        return nullptr;
-      }
+    auto addr = get_affinity_addr(*shared_addr, hash);
+    if (!addr) {
+      err = -1;
+      return nullptr;
     }
 
     return addr;
   }
 
+  switch (shared_addr->lb) {
+  case LoadBalancing::LEAST_REQUEST:
+    return get_downstream_addr_least_request(err, shared_addr);
+  case LoadBalancing::P2C:
+    return get_downstream_addr_p2c(err, shared_addr);
+  default:
+    break;
+  }
+
   auto &wgpq = shared_addr->pq;
 
   for (;;) {
@@ -952,7 +1301,7 @@ DownstreamAddr *ClientHandler::get_downstream_addr(int &err,
         continue;
       }
 
-      reschedule_addr(wg->pq, addr);
+      reschedule_addr(wg->pq, addr, ev_now(conn_.loop));
       reschedule_wg(wgpq, wg);
 
       return addr;
@@ -960,11 +1309,105 @@ DownstreamAddr *ClientHandler::get_downstream_addr(int &err,
   }
 }
 
+DownstreamAddr *ClientHandler::get_downstream_addr_least_request(
+  int &err, const std::shared_ptr<SharedDownstreamAddr> &shared_addr) {
+  auto &addrs = shared_addr->addrs;
+  DownstreamAddr *selected = nullptr;
+  uint32_t selected_weight = 0;
+  auto now = ev_now(conn_.loop);
+
+  // Start scanning from the different position each time so that
+  // the addresses with the same load are chosen in turn.
+  auto start = shared_addr->next_addr_idx;
+  for (size_t i = 0; i < addrs.size(); ++i) {
+    auto addr = &addrs[(start + i) % addrs.size()];
+    if (addr->connect_blocker->blocked()) {
+      continue;
+    }
+
+    auto weight = get_downstream_addr_effective_weight(addr, now);
+
+    // Compare (num_inflight + 1) / weight without division.
+    if (!selected || (addr->num_inflight + 1) * selected_weight <
+                       (selected->num_inflight + 1) * weight) {
+      selected = addr;
+      selected_weight = weight;
+    }
+  }
+
+  if (!selected) {
+    CLOG(INFO, this) << "No working downstream address found";
+    err = -1;
+    return nullptr;
+  }
+
+  shared_addr->next_addr_idx = (start + 1) % addrs.size();
+
+  return selected;
+}
+
+namespace {
+// Returns true if |lhs| is less loaded than |rhs|.  The load is the
+// number of outstanding requests including the new one, multiplied
+// by the average latency, and divided by the weight at |now|.  The
+// latency is only taken into account if it is known for both
+// addresses.
+bool less_loaded(DownstreamAddr *lhs, DownstreamAddr *rhs, ev_tstamp now) {
+  auto lhs_load =
+    static_cast<double>(lhs->num_inflight + 1) /
+    static_cast<double>(get_downstream_addr_effective_weight(lhs, now));
+  auto rhs_load =
+    static_cast<double>(rhs->num_inflight + 1) /
+    static_cast<double>(get_downstream_addr_effective_weight(rhs, now));
+
+  if (lhs->latency_ewma > 0. && rhs->latency_ewma > 0.) {
+    lhs_load *= lhs->latency_ewma;
+    rhs_load *= rhs->latency_ewma;
+  }
+
+  return lhs_load < rhs_load;
+}
+} // namespace
+
+DownstreamAddr *ClientHandler::get_downstream_addr_p2c(
+  int &err, const std::shared_ptr<SharedDownstreamAddr> &shared_addr) {
+  auto &addrs = shared_addr->addrs;
+
+  if (addrs.size() < 2) {
+    return get_downstream_addr_least_request(err, shared_addr);
+  }
+
+  auto &gen = worker_->get_randgen();
+
+  auto i = std::uniform_int_distribution<size_t>(0, addrs.size() - 1)(gen);
+  auto j = std::uniform_int_distribution<size_t>(0, addrs.size() - 2)(gen);
+  if (j >= i) {
+    ++j;
+  }
+
+  auto a = &addrs[i];
+  auto b = &addrs[j];
+
+  if (a->connect_blocker->blocked()) {
+    if (b->connect_blocker->blocked()) {
+      // Both are unavailable.  Look for the available one among all
+      // addresses.
+      return get_downstream_addr_least_request(err, shared_addr);
+    }
+
+    return b;
+  }
+
+  if (b->connect_blocker->blocked()) {
+    return a;
+  }
+
+  return less_loaded(b, a, ev_now(conn_.loop)) ? b : a;
+}
+
 DownstreamAddr *ClientHandler::get_downstream_addr_strict_affinity(
   int &err, const std::shared_ptr<SharedDownstreamAddr> &shared_addr,
   Downstream *downstream) {
-  const auto &affinity_hash = shared_addr->affinity_hash;
-
   auto h = downstream->find_affinity_cookie(shared_addr->affinity.cookie.name);
   if (h) {
     auto it = shared_addr->affinity_hash_map.find(h);
@@ -986,37 +1429,80 @@ DownstreamAddr *ClientHandler::get_downstream_addr_strict_affinity(
   // existing h allows us to find new server in a deterministic way.
   // It is preferable because multiple concurrent requests with the
   // stale cookie might be in-flight.
-  auto it = std::ranges::lower_bound(affinity_hash, h, {}, &AffinityHash::hash);
-  if (it == std::ranges::end(affinity_hash)) {
-    it = std::ranges::begin(affinity_hash);
+  auto addr = get_affinity_addr(*shared_addr, h);
+  if (!addr) {
+    err = -1;
+    return nullptr;
   }
 
-  auto aff_idx = static_cast<size_t>(
-    std::ranges::distance(std::ranges::begin(affinity_hash), it));
-  auto idx = (*it).idx;
-  auto addr = &shared_addr->addrs[idx];
+  downstream->renew_affinity_cookie(addr->affinity_hash);
 
-  if (addr->connect_blocker->blocked()) {
-    size_t i;
-    for (i = aff_idx + 1; i != aff_idx; ++i) {
-      if (i == shared_addr->affinity_hash.size()) {
-        i = 0;
-      }
-      addr = &shared_addr->addrs[shared_addr->affinity_hash[i].idx];
-      if (addr->connect_blocker->blocked()) {
-        continue;
-      }
-      break;
-    }
-    if (i == aff_idx) {
-      err = -1;
-      return nullptr;
+  return addr;
+}
+
+std::pair<std::string_view, std::string_view>
+ClientHandler::get_routing_authority_path(const Request &req) const {
+  std::string_view authority, path;
+
+  if (faddr_->sni_fwd) {
+    authority = sni_;
+  } else if (!req.authority.empty()) {
+    authority = req.authority;
+  } else {
+    auto h = req.fs.header(http2::HD_HOST);
+    if (h) {
+      authority = h->value;
     }
   }
 
-  downstream->renew_affinity_cookie(addr->affinity_hash);
+  // CONNECT method does not have path.  But we requires path in
+  // host-path mapping.  As workaround, we assume that path is "/".
+  if (!req.regular_connect_method()) {
+    path = req.path;
+  }
 
-  return addr;
+  return {authority, path};
+}
+
+bool ClientHandler::should_buffer_request(Downstream *downstream) {
+  if (faddr_->alt_mode != UpstreamAltMode::NONE ||
+      !worker_->get_buffer_request()) {
+    return false;
+  }
+
+  const auto &req = downstream->request();
+
+  // Tunneled data cannot be buffered.
+  if (req.method == HTTP_CONNECT || req.connect_proto != ConnectProto::NONE) {
+    return false;
+  }
+
+  auto &downstreamconf = *worker_->get_downstream_config();
+  auto &groups = worker_->get_downstream_addr_groups();
+
+  if (groups.size() == 1) {
+    return groups[0]->shared_addr->buffer_request;
+  }
+
+  auto [authority, path] = get_routing_authority_path(req);
+  auto group_idx = match_downstream_addr_group(
+    downstreamconf.router, authority, path, groups,
+    downstreamconf.addr_group_catch_all, downstream->get_block_allocator());
+
+  return groups[group_idx]->shared_addr->buffer_request;
+}
+
+size_t ClientHandler::get_buffered_request_memory() const {
+  return buffered_request_memory_;
+}
+
+void ClientHandler::set_buffered_request_memory(size_t n) {
+  buffered_request_memory_ = n;
+}
+
+bool ClientHandler::buffered_request_memory_exceeded() const {
+  return buffered_request_memory_ >
+         worker_->get_downstream_config()->buffer_request_memory;
 }
 
 std::unique_ptr<DownstreamConnection>
@@ -1029,6 +1515,8 @@ ClientHandler::get_downstream_connection(int &err, Downstream *downstream) {
   auto &groups = worker_->get_downstream_addr_groups();
 
   auto &req = downstream->request();
+  // true if this is the first backend selection for |downstream|.
+  auto first_routing = !req.forwarded_once;
 
   err = 0;
 
@@ -1057,23 +1545,7 @@ ClientHandler::get_downstream_connection(int &err, Downstream *downstream) {
       path = req.orig_path;
     }
   } else {
-    if (faddr_->sni_fwd) {
-      authority = sni_;
-    } else if (!req.authority.empty()) {
-      authority = req.authority;
-    } else {
-      auto h = req.fs.header(http2::HD_HOST);
-      if (h) {
-        authority = h->value;
-      }
-    }
-
-    // CONNECT method does not have path.  But we requires path in
-    // host-path mapping.  As workaround, we assume that path is
-    // "/".
-    if (!req.regular_connect_method()) {
-      path = req.path;
-    }
+    std::tie(authority, path) = get_routing_authority_path(req);
 
     // Cache the authority and path used for the first-time backend
     // selection because per-pattern mruby script can change them.
@@ -1111,6 +1583,36 @@ ClientHandler::get_downstream_connection(int &err, Downstream *downstream) {
     return dconn;
   }
 
+  // The rate and concurrency limits apply to the first backend
+  // selection.  A retried or hedged request keeps the slot acquired
+  // first.
+  if (first_routing) {
+    auto client_key = get_client_key(downstream);
+
+    auto &rate_limiter = group->shared_addr->rate_limiter;
+    if (rate_limiter && !rate_limiter->allow(client_key, ev_now(conn_.loop))) {
+      if (LOG_ENABLED(INFO)) {
+        CLOG(INFO, this) << "Request rate limit exceeded for client "
+                         << client_key;
+      }
+
+      worker_->get_metrics()->streams_rate_limited_total.inc();
+
+      err = SHRPX_ERR_RATE_LIMITED;
+      return nullptr;
+    }
+
+    // Only the requests which are managed by DownstreamQueue can wait
+    // for a slot.  Others are rejected immediately.
+    auto rv = worker_->get_fair_queue()->acquire(
+      downstream, group->shared_addr, client_key,
+      downstream->get_dispatch_state() != DispatchState::NONE);
+    if (rv != 0) {
+      err = rv;
+      return nullptr;
+    }
+  }
+
   auto addr = get_downstream_addr(err, group.get(), downstream);
   if (addr == nullptr) {
     return nullptr;
@@ -1164,6 +1666,23 @@ void ClientHandler::direct_http2_upgrade() {
   write_ = &ClientHandler::write_clear;
 }
 
+void ClientHandler::start_splice() {
+  assert(!conn_.tls.ssl);
+
+  read_ = &ClientHandler::read_splice;
+  write_ = &ClientHandler::write_splice;
+}
+
+void ClientHandler::start_response_splice() {
+  assert(!conn_.tls.ssl);
+
+  write_ = &ClientHandler::write_splice;
+}
+
+void ClientHandler::end_response_splice() {
+  write_ = &ClientHandler::write_clear;
+}
+
 int ClientHandler::perform_http2_upgrade(HttpsUpstream *http) {
   auto upstream = std::make_unique<Http2Upstream>(this);
 
@@ -1217,6 +1736,12 @@ void ClientHandler::start_immediate_shutdown() {
 }
 
 void ClientHandler::write_accesslog(Downstream *downstream) {
+  write_accesslog(downstream, std::chrono::high_resolution_clock::now());
+}
+
+void ClientHandler::write_accesslog(
+  Downstream *downstream,
+  const std::chrono::high_resolution_clock::time_point &request_end_time) {
   auto &req = downstream->request();
 
   auto config = get_config();
@@ -1235,13 +1760,45 @@ void ClientHandler::write_accesslog(Downstream *downstream) {
       alpn_,
       sni_,
       conn_.tls.ssl,
-      std::chrono::high_resolution_clock::now(), // request_end_time
+      request_end_time,
+      tls_handshake_start_time_,
+      tls_handshake_end_time_,
       port_,
       faddr_->port,
       config->pid,
     });
 }
 
+void ClientHandler::finish_downstream(Downstream *downstream) {
+  auto request_end_time = std::chrono::high_resolution_clock::now();
+
+  // Metrics are recorded here rather than when access log is written
+  // because access log might be written as soon as response header
+  // fields are received.  The duration and the number of body bytes
+  // are not known yet at that point, and the response might still
+  // fail after that.
+  if (downstream->metrics_ready()) {
+    downstream->set_metrics_recorded(true);
+
+    record_request_metrics(*worker_->get_metrics(), *downstream,
+                           request_end_time);
+
+    auto addr = downstream->get_attached_addr();
+    if (addr) {
+      auto &resp = downstream->response();
+
+      downstream_request_done(
+        addr,
+        resp.http_status >= 500 ||
+          downstream->get_response_state() == DownstreamState::MSG_RESET);
+    }
+  }
+
+  if (downstream->accesslog_ready()) {
+    write_accesslog(downstream, request_end_time);
+  }
+}
+
 ClientHandler::ReadBuf *ClientHandler::get_rb() { return &rb_; }
 
 void ClientHandler::signal_write() { conn_.wlimit.startw(); }
@@ -28,6 +28,7 @@
 #include "shrpx.h"
 
 #include <memory>
+#include <utility>
 
 #include <ev.h>
 
@@ -57,6 +58,7 @@ class ConnectBlocker;
 class DownstreamConnectionPool;
 class Worker;
 class Downstream;
+struct Request;
 struct WorkerStat;
 struct DownstreamAddrGroup;
 struct SharedDownstreamAddr;
@@ -83,6 +85,10 @@ public:
   // Performs TLS I/O
   int read_tls();
   int write_tls();
+  // Performs clear text I/O for tunnel or response body with
+  // splice(2).  They are used only with HttpsUpstream.
+  int read_splice();
+  int write_splice();
 
   int upstream_noop();
   int upstream_read();
@@ -108,6 +114,21 @@ public:
 
   int validate_next_proto();
   const std::string_view &get_ipaddr() const;
+  // Returns the key which identifies the client of |downstream| for
+  // per-client limits.  It is the value of the header field
+  // configured by --backend-client-key-header, or the network
+  // address of this connection.
+  std::string_view get_client_key(const Downstream *downstream);
+  // Returns true if the backend group selected for |downstream| has
+  // buffer-request parameter.
+  bool should_buffer_request(Downstream *downstream);
+  // Returns the number of bytes of request body which are buffered
+  // in memory by buffer-request parameter on this connection.
+  size_t get_buffered_request_memory() const;
+  void set_buffered_request_memory(size_t n);
+  // Returns true if the request body buffered in memory exceeds
+  // --backend-buffer-request-memory.
+  bool buffered_request_memory_exceeded() const;
   bool get_should_close_after_write() const;
   void set_should_close_after_write(bool f);
   Upstream *get_upstream();
@@ -131,6 +152,16 @@ public:
   // |http|. If this function fails, the connection must be
   // terminated. This function returns 0 if it succeeds, or -1.
   int perform_http2_upgrade(HttpsUpstream *http);
+  // Switches I/O so that the tunneled data are relayed with
+  // splice(2).  The connection must be cleartext, and managed by
+  // HttpsUpstream.
+  void start_splice();
+  // Switches write I/O so that the response body in the response
+  // pipe is sent with splice(2).  end_response_splice() switches it
+  // back.  The connection must be cleartext, and managed by
+  // HttpsUpstream.
+  void start_response_splice();
+  void end_response_splice();
   bool get_http2_upgrade_allowed() const;
   // Returns upstream scheme, either "http" or "https"
   std::string_view get_upstream_scheme() const;
@@ -139,6 +170,11 @@ public:
   // Writes upstream accesslog using |downstream|.  The |downstream|
   // must not be nullptr.
   void write_accesslog(Downstream *downstream);
+  // Called when |downstream| finishes.  It records the metrics and
+  // the outlier detection statistics of |downstream|, and writes
+  // upstream accesslog unless it has been written early.  The
+  // |downstream| must not be nullptr.
+  void finish_downstream(Downstream *downstream);
 
   Worker *get_worker() const;
 
@@ -185,6 +221,15 @@ public:
     int &err, const std::shared_ptr<SharedDownstreamAddr> &shared_addr,
     Downstream *downstream);
 
+  // Returns the address which has the fewest outstanding requests
+  // relative to its weight.
+  DownstreamAddr *get_downstream_addr_least_request(
+    int &err, const std::shared_ptr<SharedDownstreamAddr> &shared_addr);
+
+  // Returns the less loaded address from 2 randomly chosen addresses.
+  DownstreamAddr *get_downstream_addr_p2c(
+    int &err, const std::shared_ptr<SharedDownstreamAddr> &shared_addr);
+
   const UpstreamAddr *get_upstream_addr() const;
 
   void repeat_read_timer();
@@ -208,6 +253,17 @@ public:
   void set_local_hostport(const sockaddr *addr, socklen_t addrlen);
 
 private:
+  // Returns the authority and path of |req| which are used to select
+  // a backend group for the first time.
+  std::pair<std::string_view, std::string_view>
+  get_routing_authority_path(const Request &req) const;
+
+  // Writes upstream accesslog using |downstream| which has finished
+  // at |request_end_time|.
+  void write_accesslog(
+    Downstream *downstream,
+    const std::chrono::high_resolution_clock::time_point &request_end_time);
+
   // Allocator to allocate memory for connection-wide objects.  Make
   // sure that the allocations must be bounded, and not proportional
   // to the number of requests.
@@ -232,6 +288,14 @@ private:
   // to client address migration, but this value stays the same for
   // now.
   std::string_view local_hostport_;
+  // The remote address masked by the configured prefix length, which
+  // identifies a client.  It is lazily computed, and empty if it is
+  // not computed yet.
+  std::string_view client_addr_key_;
+  // The time when TLS handshake started, and completed.  They are
+  // default constructed if TLS is not used.
+  std::chrono::high_resolution_clock::time_point tls_handshake_start_time_;
+  std::chrono::high_resolution_clock::time_point tls_handshake_end_time_;
   std::function<int(ClientHandler &)> read_, write_;
   std::function<int(ClientHandler &)> on_read_, on_write_;
   // Address of frontend listening socket
@@ -239,6 +303,9 @@ private:
   Worker *worker_;
   // The number of bytes of HTTP/2 client connection header to read
   size_t left_connhd_len_;
+  // The number of bytes of request body which are buffered in memory
+  // by buffer-request parameter.
+  size_t buffered_request_memory_;
   // hash for session affinity using client IP
   uint32_t affinity_hash_;
   bool should_close_after_write_;
@@ -46,6 +46,7 @@
 #include <cstring>
 #include <cerrno>
 #include <limits>
+#include <charconv>
 #include <fstream>
 #include <unordered_map>
 
@@ -666,6 +667,14 @@ LogFragmentType log_var_lookup_token(const std::string_view &name) {
         return LogFragmentType::TLS_SESSION_REUSED;
       }
       break;
+    case 'e':
+      if (util::strieq("backend_queue_tim"sv, name.substr(0, 17))) {
+        return LogFragmentType::BACKEND_QUEUE_TIME;
+      }
+      if (util::strieq("tls_handshake_tim"sv, name.substr(0, 17))) {
+        return LogFragmentType::TLS_HANDSHAKE_TIME;
+      }
+      break;
     case 'y':
       if (util::strieq("path_without_quer"sv, name.substr(0, 17))) {
         return LogFragmentType::PATH_WITHOUT_QUERY;
@@ -673,9 +682,39 @@ LogFragmentType log_var_lookup_token(const std::string_view &name) {
       break;
     }
     break;
+  case 19:
+    switch (name[18]) {
+    case 'e':
+      if (util::strieq("request_header_tim"sv, name.substr(0, 18))) {
+        return LogFragmentType::REQUEST_HEADER_TIME;
+      }
+      break;
+    }
+    break;
+  case 20:
+    switch (name[19]) {
+    case 'e':
+      if (util::strieq("backend_connect_tim"sv, name.substr(0, 19))) {
+        return LogFragmentType::BACKEND_CONNECT_TIME;
+      }
+      break;
+    }
+    break;
+  case 21:
+    switch (name[20]) {
+    case 'e':
+      if (util::strieq("backend_response_tim"sv, name.substr(0, 20))) {
+        return LogFragmentType::BACKEND_RESPONSE_TIME;
+      }
+      break;
+    }
+    break;
   case 22:
     switch (name[21]) {
     case 'e':
+      if (util::strieq("response_transfer_tim"sv, name.substr(0, 21))) {
+        return LogFragmentType::RESPONSE_TRANSFER_TIME;
+      }
       if (util::strieq("tls_client_issuer_nam"sv, name.substr(0, 21))) {
         return LogFragmentType::TLS_CLIENT_ISSUER_NAME;
       }
@@ -972,10 +1011,17 @@ struct DownstreamParams {
   std::string_view mruby;
   std::string_view group;
   AffinityConfig affinity;
+  LoadBalancing lb;
   ev_tstamp read_timeout;
   ev_tstamp write_timeout;
+  ev_tstamp hedge_delay;
+  ev_tstamp slow_start;
+  size_t max_concurrency;
+  size_t request_rate;
+  size_t request_burst;
   size_t fall;
   size_t rise;
+  size_t min_idle;
   uint32_t weight;
   uint32_t group_weight;
   Proto proto;
@@ -984,6 +1030,8 @@ struct DownstreamParams {
   bool redirect_if_not_tls;
   bool upgrade_scheme;
   bool dnf;
+  bool buffer_request;
+  bool spool_response;
 };
 
 namespace {
@@ -1057,6 +1105,65 @@ int parse_downstream_params(DownstreamParams &out,
       }
 
       out.rise = static_cast<size_t>(*n);
+    } else if (util::istarts_with(param, "min-idle="sv)) {
+      auto valstr = std::string_view{first + str_size("min-idle="), end};
+      if (valstr.empty()) {
+        LOG(ERROR) << "backend: min-idle: non-negative integer is expected";
+        return -1;
+      }
+
+      auto n = util::parse_uint(valstr);
+      if (!n) {
+        LOG(ERROR) << "backend: min-idle: non-negative integer is expected";
+        return -1;
+      }
+
+      out.min_idle = static_cast<size_t>(*n);
+    } else if (util::istarts_with(param, "max-concurrency="sv)) {
+      auto valstr =
+        std::string_view{first + str_size("max-concurrency="), end};
+      if (valstr.empty()) {
+        LOG(ERROR)
+          << "backend: max-concurrency: non-negative integer is expected";
+        return -1;
+      }
+
+      auto n = util::parse_uint(valstr);
+      if (!n) {
+        LOG(ERROR)
+          << "backend: max-concurrency: non-negative integer is expected";
+        return -1;
+      }
+
+      out.max_concurrency = static_cast<size_t>(*n);
+    } else if (util::istarts_with(param, "request-rate="sv)) {
+      auto valstr = std::string_view{first + str_size("request-rate="), end};
+      if (valstr.empty()) {
+        LOG(ERROR) << "backend: request-rate: non-negative integer is expected";
+        return -1;
+      }
+
+      auto n = util::parse_uint(valstr);
+      if (!n) {
+        LOG(ERROR) << "backend: request-rate: non-negative integer is expected";
+        return -1;
+      }
+
+      out.request_rate = static_cast<size_t>(*n);
+    } else if (util::istarts_with(param, "request-burst="sv)) {
+      auto valstr = std::string_view{first + str_size("request-burst="), end};
+      if (valstr.empty()) {
+        LOG(ERROR) << "backend: request-burst: positive integer is expected";
+        return -1;
+      }
+
+      auto n = util::parse_uint(valstr);
+      if (!n || *n == 0) {
+        LOG(ERROR) << "backend: request-burst: positive integer is expected";
+        return -1;
+      }
+
+      out.request_burst = static_cast<size_t>(*n);
     } else if (util::strieq("tls"sv, param)) {
       out.tls = true;
     } else if (util::strieq("no-tls"sv, param)) {
@@ -1071,9 +1178,33 @@ int parse_downstream_params(DownstreamParams &out,
         out.affinity.type = SessionAffinity::IP;
       } else if (util::strieq("cookie"sv, valstr)) {
         out.affinity.type = SessionAffinity::COOKIE;
+      } else if (util::strieq("header"sv, valstr)) {
+        out.affinity.type = SessionAffinity::HEADER;
+      } else if (util::strieq("path"sv, valstr)) {
+        out.affinity.type = SessionAffinity::PATH;
       } else {
+        LOG(ERROR) << "backend: affinity: value must be one of none, ip, "
+                      "cookie, header, and path";
+        return -1;
+      }
+    } else if (util::istarts_with(param, "affinity-header-name="sv)) {
+      auto val =
+        std::string_view{first + str_size("affinity-header-name="), end};
+      if (val.empty()) {
         LOG(ERROR)
-          << "backend: affinity: value must be one of none, ip, and cookie";
+          << "backend: affinity-header-name: non empty string is expected";
+        return -1;
+      }
+      out.affinity.header.name = val;
+    } else if (util::istarts_with(param, "affinity-hash="sv)) {
+      auto valstr = std::string_view{first + str_size("affinity-hash="), end};
+      if (util::strieq("ketama"sv, valstr)) {
+        out.affinity.hash_method = AffinityHashMethod::KETAMA;
+      } else if (util::strieq("maglev"sv, valstr)) {
+        out.affinity.hash_method = AffinityHashMethod::MAGLEV;
+      } else {
+        LOG(ERROR)
+          << "backend: affinity-hash: value must be either ketama or maglev";
         return -1;
       }
     } else if (util::istarts_with(param, "affinity-cookie-name="sv)) {
@@ -1136,6 +1267,18 @@ int parse_downstream_params(DownstreamParams &out,
             std::string_view{first + str_size("write-timeout="), end}) == -1) {
         return -1;
       }
+    } else if (util::istarts_with(param, "hedge-delay="sv)) {
+      if (parse_downstream_param_duration(
+            out.hedge_delay, "hedge-delay"sv,
+            std::string_view{first + str_size("hedge-delay="), end}) == -1) {
+        return -1;
+      }
+    } else if (util::istarts_with(param, "slow-start="sv)) {
+      if (parse_downstream_param_duration(
+            out.slow_start, "slow-start"sv,
+            std::string_view{first + str_size("slow-start="), end}) == -1) {
+        return -1;
+      }
     } else if (util::istarts_with(param, "weight="sv)) {
       auto valstr = std::string_view{first + str_size("weight="), end};
       if (valstr.empty()) {
@@ -1175,6 +1318,23 @@ int parse_downstream_params(DownstreamParams &out,
       out.group_weight = static_cast<uint32_t>(*n);
     } else if (util::strieq("dnf"sv, param)) {
       out.dnf = true;
+    } else if (util::strieq("buffer-request"sv, param)) {
+      out.buffer_request = true;
+    } else if (util::strieq("spool-response"sv, param)) {
+      out.spool_response = true;
+    } else if (util::istarts_with(param, "lb="sv)) {
+      auto valstr = std::string_view{first + str_size("lb="), end};
+      if (util::strieq("rr"sv, valstr)) {
+        out.lb = LoadBalancing::ROUND_ROBIN;
+      } else if (util::strieq("least-request"sv, valstr)) {
+        out.lb = LoadBalancing::LEAST_REQUEST;
+      } else if (util::strieq("p2c"sv, valstr)) {
+        out.lb = LoadBalancing::P2C;
+      } else {
+        LOG(ERROR) << "backend: lb: value must be one of rr, least-request, "
+                      "and p2c";
+        return -1;
+      }
     } else if (!param.empty()) {
       LOG(ERROR) << "backend: " << param << ": unknown keyword";
       return -1;
@@ -1191,6 +1351,17 @@ int parse_downstream_params(DownstreamParams &out,
 }
 } // namespace
 
+namespace {
+// Returns lowercased copy of |s| allocated by |balloc|.
+std::string_view make_lowercase_string_ref(BlockAllocator &balloc,
+                                           const std::string_view &s) {
+  auto iov = make_byte_ref(balloc, s.size() + 1);
+  auto p = util::tolower(s, std::ranges::begin(iov));
+  *p = '\0';
+  return as_string_view(std::ranges::begin(iov), p);
+}
+} // namespace
+
 namespace {
 // Parses host-path mapping patterns in |src_pattern|, and stores
 // mappings in config.  We will store each host-path pattern found in
@@ -1230,8 +1401,17 @@ int parse_mapping(
     return -1;
   }
 
+  if (params.affinity.type == SessionAffinity::HEADER &&
+      params.affinity.header.name.empty()) {
+    LOG(ERROR) << "backend: affinity-header-name is mandatory if "
+                  "affinity=header is specified";
+    return -1;
+  }
+
   addr.fall = params.fall;
   addr.rise = params.rise;
+  addr.min_idle = params.min_idle;
+  addr.slow_start = params.slow_start;
   addr.weight = params.weight;
   addr.group = make_string_ref(downstreamconf.balloc, params.group);
   addr.group_weight = params.group_weight;
@@ -1289,13 +1469,20 @@ int parse_mapping(
             }
             g.affinity.cookie.secure = params.affinity.cookie.secure;
             g.affinity.cookie.stickiness = params.affinity.cookie.stickiness;
+          } else if (params.affinity.type == SessionAffinity::HEADER) {
+            g.affinity.header.name = make_lowercase_string_ref(
+              downstreamconf.balloc, params.affinity.header.name);
           }
+          g.affinity.hash_method = params.affinity.hash_method;
         } else if (g.affinity.type != params.affinity.type ||
                    g.affinity.cookie.name != params.affinity.cookie.name ||
                    g.affinity.cookie.path != params.affinity.cookie.path ||
                    g.affinity.cookie.secure != params.affinity.cookie.secure ||
                    g.affinity.cookie.stickiness !=
-                     params.affinity.cookie.stickiness) {
+                     params.affinity.cookie.stickiness ||
+                   !util::strieq(g.affinity.header.name,
+                                 params.affinity.header.name) ||
+                   g.affinity.hash_method != params.affinity.hash_method) {
           LOG(ERROR) << "backend: affinity: multiple different affinity "
                         "configurations found in a single group";
           return -1;
@@ -1342,6 +1529,44 @@ int parse_mapping(
           return -1;
         }
       }
+      // The same rule as read/write timeout applies to hedge delay.
+      if (params.hedge_delay > 1e-9) {
+        if (g.hedge_delay < 1e-9) {
+          g.hedge_delay = params.hedge_delay;
+        } else if (fabs(g.hedge_delay - params.hedge_delay) > 1e-9) {
+          LOG(ERROR) << "backend: hedge-delay: multiple different "
+                        "hedge-delay found in a single group";
+          return -1;
+        }
+      }
+      if (params.max_concurrency) {
+        if (g.max_concurrency == 0) {
+          g.max_concurrency = params.max_concurrency;
+        } else if (g.max_concurrency != params.max_concurrency) {
+          LOG(ERROR) << "backend: max-concurrency: multiple different "
+                        "max-concurrency found in a single group";
+          return -1;
+        }
+      }
+      // The same rule applies to request rate limit.
+      if (params.request_rate) {
+        if (g.request_rate == 0) {
+          g.request_rate = params.request_rate;
+        } else if (g.request_rate != params.request_rate) {
+          LOG(ERROR) << "backend: request-rate: multiple different "
+                        "request-rate found in a single group";
+          return -1;
+        }
+      }
+      if (params.request_burst) {
+        if (g.request_burst == 0) {
+          g.request_burst = params.request_burst;
+        } else if (g.request_burst != params.request_burst) {
+          LOG(ERROR) << "backend: request-burst: multiple different "
+                        "request-burst found in a single group";
+          return -1;
+        }
+      }
       // All backends in the same group must have the same dnf
       // setting.  If some backends do not specify dnf, and there is
       // at least one backend with dnf, it is used for all backends in
@@ -1350,6 +1575,26 @@ int parse_mapping(
       if (params.dnf) {
         g.dnf = true;
       }
+      // The same rule applies to buffer-request and spool-response.
+      if (params.buffer_request) {
+        g.buffer_request = true;
+      }
+      if (params.spool_response) {
+        g.spool_response = true;
+      }
+      // All backends in the same group must have the same load
+      // balancing method.  If some backends do not specify lb, and
+      // there is at least one backend with lb, it is used for all
+      // backends in the group.
+      if (params.lb != LoadBalancing::ROUND_ROBIN) {
+        if (g.lb == LoadBalancing::ROUND_ROBIN) {
+          g.lb = params.lb;
+        } else if (g.lb != params.lb) {
+          LOG(ERROR) << "backend: lb: multiple different load balancing "
+                        "methods found in a single group";
+          return -1;
+        }
+      }
 
       g.addrs.push_back(addr);
       continue;
@@ -1370,12 +1615,23 @@ int parse_mapping(
       }
       g.affinity.cookie.secure = params.affinity.cookie.secure;
       g.affinity.cookie.stickiness = params.affinity.cookie.stickiness;
+    } else if (params.affinity.type == SessionAffinity::HEADER) {
+      g.affinity.header.name = make_lowercase_string_ref(
+        downstreamconf.balloc, params.affinity.header.name);
     }
+    g.affinity.hash_method = params.affinity.hash_method;
     g.redirect_if_not_tls = params.redirect_if_not_tls;
     g.mruby_file = make_string_ref(downstreamconf.balloc, params.mruby);
     g.timeout.read = params.read_timeout;
     g.timeout.write = params.write_timeout;
+    g.hedge_delay = params.hedge_delay;
+    g.max_concurrency = params.max_concurrency;
+    g.request_rate = params.request_rate;
+    g.request_burst = params.request_burst;
     g.dnf = params.dnf;
+    g.buffer_request = params.buffer_request;
+    g.spool_response = params.spool_response;
+    g.lb = params.lb;
 
     if (pattern[0] == '*') {
       // wildcard pattern
@@ -1837,6 +2093,11 @@ int option_lookup_token(const std::string_view &name) {
         return SHRPX_OPTID_ALTSVC;
       }
       break;
+    case 'e':
+      if (util::strieq("splic"sv, name.substr(0, 5))) {
+        return SHRPX_OPTID_SPLICE;
+      }
+      break;
     case 'n':
       if (util::strieq("daemo"sv, name.substr(0, 5))) {
         return SHRPX_OPTID_DAEMON;
@@ -2219,6 +2480,11 @@ int option_lookup_token(const std::string_view &name) {
         return SHRPX_OPTID_TLS_MAX_EARLY_DATA;
       }
       break;
+    case 'g':
+      if (util::strieq("accesslog-encodin"sv, name.substr(0, 17))) {
+        return SHRPX_OPTID_ACCESSLOG_ENCODING;
+      }
+      break;
     case 'r':
       if (util::strieq("add-request-heade"sv, name.substr(0, 17))) {
         return SHRPX_OPTID_ADD_REQUEST_HEADER;
@@ -2352,6 +2618,9 @@ int option_lookup_token(const std::string_view &name) {
       }
       break;
     case 't':
+      if (util::strieq("backend-client-weigh"sv, name.substr(0, 20))) {
+        return SHRPX_OPTID_BACKEND_CLIENT_WEIGHT;
+      }
       if (util::strieq("backend-write-timeou"sv, name.substr(0, 20))) {
         return SHRPX_OPTID_BACKEND_WRITE_TIMEOUT;
       }
@@ -2368,6 +2637,11 @@ int option_lookup_token(const std::string_view &name) {
     break;
   case 22:
     switch (name[21]) {
+    case 'e':
+      if (util::strieq("memchunk-pool-max-fre"sv, name.substr(0, 21))) {
+        return SHRPX_OPTID_MEMCHUNK_POOL_MAX_FREE;
+      }
+      break;
     case 'i':
       if (util::strieq("backend-http-proxy-ur"sv, name.substr(0, 21))) {
         return SHRPX_OPTID_BACKEND_HTTP_PROXY_URI;
@@ -2439,6 +2713,9 @@ int option_lookup_token(const std::string_view &name) {
       }
       break;
     case 'e':
+      if (util::strieq("backend-hedge-percentil"sv, name.substr(0, 23))) {
+        return SHRPX_OPTID_BACKEND_HEDGE_PERCENTILE;
+      }
       if (util::strieq("fetch-ocsp-response-fil"sv, name.substr(0, 23))) {
         return SHRPX_OPTID_FETCH_OCSP_RESPONSE_FILE;
       }
@@ -2473,6 +2750,11 @@ int option_lookup_token(const std::string_view &name) {
         return SHRPX_OPTID_HTTP2_NO_COOKIE_CRUMBLING;
       }
       break;
+    case 'r':
+      if (util::strieq("backend-client-key-heade"sv, name.substr(0, 24))) {
+        return SHRPX_OPTID_BACKEND_CLIENT_KEY_HEADER;
+      }
+      break;
     case 's':
       if (util::strieq("backend-http2-window-bit"sv, name.substr(0, 24))) {
         return SHRPX_OPTID_BACKEND_HTTP2_WINDOW_BITS;
@@ -2503,7 +2785,15 @@ int option_lookup_token(const std::string_view &name) {
         return SHRPX_OPTID_FRONTEND_HTTP3_WINDOW_SIZE;
       }
       break;
+    case 'r':
+      if (util::strieq("backend-response-spool-di"sv, name.substr(0, 25))) {
+        return SHRPX_OPTID_BACKEND_RESPONSE_SPOOL_DIR;
+      }
+      break;
     case 's':
+      if (util::strieq("backend-http2-max-session"sv, name.substr(0, 25))) {
+        return SHRPX_OPTID_BACKEND_HTTP2_MAX_SESSIONS;
+      }
       if (util::strieq("frontend-http2-window-bit"sv, name.substr(0, 25))) {
         return SHRPX_OPTID_FRONTEND_HTTP2_WINDOW_BITS;
       }
@@ -2515,6 +2805,9 @@ int option_lookup_token(const std::string_view &name) {
       if (util::strieq("backend-keep-alive-timeou"sv, name.substr(0, 25))) {
         return SHRPX_OPTID_BACKEND_KEEP_ALIVE_TIMEOUT;
       }
+      if (util::strieq("backend-queue-delay-targe"sv, name.substr(0, 25))) {
+        return SHRPX_OPTID_BACKEND_QUEUE_DELAY_TARGET;
+      }
       if (util::strieq("frontend-quic-idle-timeou"sv, name.substr(0, 25))) {
         return SHRPX_OPTID_FRONTEND_QUIC_IDLE_TIMEOUT;
       }
@@ -2525,6 +2818,17 @@ int option_lookup_token(const std::string_view &name) {
         return SHRPX_OPTID_NO_HTTP2_CIPHER_BLOCK_LIST;
       }
       break;
+    case 'x':
+      if (util::strieq("backend-client-ipv4-prefi"sv, name.substr(0, 25))) {
+        return SHRPX_OPTID_BACKEND_CLIENT_IPV4_PREFIX;
+      }
+      if (util::strieq("backend-client-ipv6-prefi"sv, name.substr(0, 25))) {
+        return SHRPX_OPTID_BACKEND_CLIENT_IPV6_PREFIX;
+      }
+      if (util::strieq("backend-response-spool-ma"sv, name.substr(0, 25))) {
+        return SHRPX_OPTID_BACKEND_RESPONSE_SPOOL_MAX;
+      }
+      break;
     }
     break;
   case 27:
@@ -2545,6 +2849,9 @@ int option_lookup_token(const std::string_view &name) {
       }
       break;
     case 's':
+      if (util::strieq("backend-http2-pack-session"sv, name.substr(0, 26))) {
+        return SHRPX_OPTID_BACKEND_HTTP2_PACK_SESSIONS;
+      }
       if (util::strieq("worker-frontend-connection"sv, name.substr(0, 26))) {
         return SHRPX_OPTID_WORKER_FRONTEND_CONNECTIONS;
       }
@@ -2580,6 +2887,16 @@ int option_lookup_token(const std::string_view &name) {
         return SHRPX_OPTID_TLS_DYN_REC_WARMUP_THRESHOLD;
       }
       break;
+    case 'e':
+      if (util::strieq("backend-outlier-failure-rat"sv, name.substr(0, 27))) {
+        return SHRPX_OPTID_BACKEND_OUTLIER_FAILURE_RATE;
+      }
+      break;
+    case 'l':
+      if (util::strieq("backend-queue-delay-interva"sv, name.substr(0, 27))) {
+        return SHRPX_OPTID_BACKEND_QUEUE_DELAY_INTERVAL;
+      }
+      break;
     case 'r':
       if (util::strieq("response-header-field-buffe"sv, name.substr(0, 27))) {
         return SHRPX_OPTID_RESPONSE_HEADER_FIELD_BUFFER;
@@ -2600,6 +2917,20 @@ int option_lookup_token(const std::string_view &name) {
       break;
     }
     break;
+  case 29:
+    switch (name[28]) {
+    case 'e':
+      if (util::strieq("backend-outlier-ejection-tim"sv, name.substr(0, 28))) {
+        return SHRPX_OPTID_BACKEND_OUTLIER_EJECTION_TIME;
+      }
+      break;
+    case 'y':
+      if (util::strieq("backend-buffer-request-memor"sv, name.substr(0, 28))) {
+        return SHRPX_OPTID_BACKEND_BUFFER_REQUEST_MEMORY;
+      }
+      break;
+    }
+    break;
   case 30:
     switch (name[29]) {
     case 'd':
@@ -2613,6 +2944,9 @@ int option_lookup_token(const std::string_view &name) {
       }
       break;
     case 'r':
+      if (util::strieq("backend-outlier-latency-facto"sv, name.substr(0, 29))) {
+        return SHRPX_OPTID_BACKEND_OUTLIER_LATENCY_FACTOR;
+      }
       if (util::strieq("ignore-per-pattern-mruby-erro"sv, name.substr(0, 29))) {
         return SHRPX_OPTID_IGNORE_PER_PATTERN_MRUBY_ERROR;
       }
@@ -2625,6 +2959,11 @@ int option_lookup_token(const std::string_view &name) {
         return SHRPX_OPTID_BACKEND_HTTP2_SETTINGS_TIMEOUT;
       }
       break;
+    case 'y':
+      if (util::strieq("backend-client-max-concurrenc"sv, name.substr(0, 29))) {
+        return SHRPX_OPTID_BACKEND_CLIENT_MAX_CONCURRENCY;
+      }
+      break;
     }
     break;
   case 31:
@@ -2641,6 +2980,12 @@ int option_lookup_token(const std::string_view &name) {
         return SHRPX_OPTID_FRONTEND_HTTP2_SETTINGS_TIMEOUT;
       }
       break;
+    case 'y':
+      if (util::strieq("backend-buffer-request-max-bod"sv,
+                       name.substr(0, 30))) {
+        return SHRPX_OPTID_BACKEND_BUFFER_REQUEST_MAX_BODY;
+      }
+      break;
     }
     break;
   case 32:
@@ -2665,6 +3010,12 @@ int option_lookup_token(const std::string_view &name) {
         return SHRPX_OPTID_TLS_TICKET_KEY_MEMCACHED_MAX_FAIL;
       }
       break;
+    case 'n':
+      if (util::strieq("backend-http2-streams-per-sessio"sv,
+                       name.substr(0, 32))) {
+        return SHRPX_OPTID_BACKEND_HTTP2_STREAMS_PER_SESSION;
+      }
+      break;
     case 't':
       if (util::strieq("client-no-http2-cipher-black-lis"sv,
                        name.substr(0, 32))) {
@@ -2685,6 +3036,12 @@ int option_lookup_token(const std::string_view &name) {
         return SHRPX_OPTID_TLS_TICKET_KEY_MEMCACHED_CERT_FILE;
       }
       break;
+    case 'l':
+      if (util::strieq("backend-outlier-detection-interva"sv,
+                       name.substr(0, 33))) {
+        return SHRPX_OPTID_BACKEND_OUTLIER_DETECTION_INTERVAL;
+      }
+      break;
     case 'r':
       if (util::strieq("frontend-http2-dump-request-heade"sv,
                        name.substr(0, 33))) {
@@ -2761,6 +3118,12 @@ int option_lookup_token(const std::string_view &name) {
         return SHRPX_OPTID_BACKEND_HTTP2_MAX_CONCURRENT_STREAMS;
       }
       break;
+    case 't':
+      if (util::strieq("backend-outlier-max-ejection-percen"sv,
+                       name.substr(0, 35))) {
+        return SHRPX_OPTID_BACKEND_OUTLIER_MAX_EJECTION_PERCENT;
+      }
+      break;
     }
     break;
   case 37:
@@ -3602,6 +3965,20 @@ int parse_config(
 
     return 0;
   }
+  case SHRPX_OPTID_BACKEND_BUFFER_REQUEST_MAX_BODY:
+    return parse_uint_with_unit(
+      &config->conn.downstream->buffer_request_max_body, opt, optarg);
+  case SHRPX_OPTID_BACKEND_BUFFER_REQUEST_MEMORY:
+    return parse_uint_with_unit(
+      &config->conn.downstream->buffer_request_memory, opt, optarg);
+  case SHRPX_OPTID_BACKEND_RESPONSE_SPOOL_DIR:
+    config->conn.downstream->response_spool.dir =
+      make_string_ref(config->conn.downstream->balloc, optarg);
+
+    return 0;
+  case SHRPX_OPTID_BACKEND_RESPONSE_SPOOL_MAX:
+    return parse_uint_with_unit(&config->conn.downstream->response_spool.max,
+                                opt, optarg);
 
   case SHRPX_OPTID_NO_SERVER_PUSH:
     config->http2.no_server_push = util::strieq("yes"sv, optarg);
@@ -3854,6 +4231,18 @@ int parse_config(
                       optarg);
   case SHRPX_OPTID_ERROR_PAGE:
     return parse_error_page(config->http.error_pages, opt, optarg);
+  case SHRPX_OPTID_SPLICE:
+#ifdef HAVE_SPLICE
+    config->conn.splice = util::strieq("yes"sv, optarg);
+#else  // !HAVE_SPLICE
+    LOG(WARN) << opt
+              << ": ignored because splice(2) is not available on this "
+                 "platform";
+#endif // !HAVE_SPLICE
+
+    return 0;
+  case SHRPX_OPTID_MEMCHUNK_POOL_MAX_FREE:
+    return parse_uint_with_unit(&config->memchunk_pool_max_free, opt, optarg);
   case SHRPX_OPTID_NO_KQUEUE:
     if ((ev_supported_backends() & EVBACKEND_KQUEUE) == 0) {
       LOG(WARN) << opt << ": kqueue is not supported on this platform";
@@ -4262,6 +4651,145 @@ int parse_config(
 
     return 0;
   }
+  case SHRPX_OPTID_ACCESSLOG_ENCODING:
+    if (util::strieq("text"sv, optarg)) {
+      config->logging.access.encoding = AccessLogEncoding::TEXT;
+    } else if (util::strieq("json"sv, optarg)) {
+      config->logging.access.encoding = AccessLogEncoding::JSON;
+    } else if (util::strieq("binary"sv, optarg)) {
+      config->logging.access.encoding = AccessLogEncoding::BINARY;
+    } else {
+      LOG(ERROR) << opt << ": must be one of text, json, and binary";
+      return -1;
+    }
+
+    return 0;
+  case SHRPX_OPTID_BACKEND_HTTP2_STREAMS_PER_SESSION:
+    return parse_uint(&config->http2.downstream.streams_per_session, opt,
+                      optarg);
+  case SHRPX_OPTID_BACKEND_QUEUE_DELAY_TARGET:
+    return parse_duration(&config->conn.downstream->queue_delay.target, opt,
+                          optarg);
+  case SHRPX_OPTID_BACKEND_QUEUE_DELAY_INTERVAL:
+    return parse_duration(&config->conn.downstream->queue_delay.interval, opt,
+                          optarg);
+  case SHRPX_OPTID_BACKEND_CLIENT_MAX_CONCURRENCY:
+    return parse_uint(&config->conn.downstream->client_max_concurrency, opt,
+                      optarg);
+  case SHRPX_OPTID_BACKEND_CLIENT_WEIGHT: {
+    // The client key might contain ',' if it is a header field value.
+    auto pos = optarg.rfind(',');
+    if (pos == std::string_view::npos || pos == 0) {
+      LOG(ERROR) << opt << ": <CLIENT>,<N> is expected";
+      return -1;
+    }
+
+    auto n = util::parse_uint(optarg.substr(pos + 1));
+    if (!n || *n < 1 || *n > 256) {
+      LOG(ERROR) << opt << ": weight: integer [1, 256] is expected";
+      return -1;
+    }
+
+    config->conn.downstream->client_weights.insert_or_assign(
+      std::string{optarg.substr(0, pos)}, static_cast<uint32_t>(*n));
+
+    return 0;
+  }
+  case SHRPX_OPTID_BACKEND_CLIENT_KEY_HEADER:
+    config->conn.downstream->client_key_header =
+      make_lowercase_string_ref(config->conn.downstream->balloc, optarg);
+
+    return 0;
+  case SHRPX_OPTID_BACKEND_CLIENT_IPV4_PREFIX: {
+    auto n = util::parse_uint(optarg);
+    if (!n || *n > 32) {
+      LOG(ERROR) << opt << ": integer in [0, 32] is expected";
+      return -1;
+    }
+
+    config->conn.downstream->client_ipv4_prefix = static_cast<size_t>(*n);
+
+    return 0;
+  }
+  case SHRPX_OPTID_BACKEND_CLIENT_IPV6_PREFIX: {
+    auto n = util::parse_uint(optarg);
+    if (!n || *n > 128) {
+      LOG(ERROR) << opt << ": integer in [0, 128] is expected";
+      return -1;
+    }
+
+    config->conn.downstream->client_ipv6_prefix = static_cast<size_t>(*n);
+
+    return 0;
+  }
+  case SHRPX_OPTID_BACKEND_OUTLIER_DETECTION_INTERVAL:
+    return parse_duration(&config->conn.downstream->outlier.interval, opt,
+                          optarg);
+  case SHRPX_OPTID_BACKEND_OUTLIER_EJECTION_TIME:
+    return parse_duration(&config->conn.downstream->outlier.ejection_time, opt,
+                          optarg);
+  case SHRPX_OPTID_BACKEND_OUTLIER_LATENCY_FACTOR:
+    return parse_uint(&config->conn.downstream->outlier.latency_factor, opt,
+                      optarg);
+  case SHRPX_OPTID_BACKEND_OUTLIER_FAILURE_RATE:
+  case SHRPX_OPTID_BACKEND_OUTLIER_MAX_EJECTION_PERCENT: {
+    size_t n;
+    if (parse_uint(&n, opt, optarg) != 0) {
+      return -1;
+    }
+
+    if (n > 100) {
+      LOG(ERROR) << opt
+                 << ": specify the integer in the range [0, 100], inclusive";
+
+      return -1;
+    }
+
+    auto &outlierconf = config->conn.downstream->outlier;
+
+    if (optid == SHRPX_OPTID_BACKEND_OUTLIER_FAILURE_RATE) {
+      outlierconf.failure_rate = n;
+    } else {
+      outlierconf.max_ejection_percent = n;
+    }
+
+    return 0;
+  }
+  case SHRPX_OPTID_BACKEND_HEDGE_PERCENTILE: {
+    double p;
+    auto last = optarg.data() + optarg.size();
+    auto [ptr, ec] = std::from_chars(optarg.data(), last, p);
+    if (ec != std::errc{} || ptr != last || p < 0. || p >= 100.) {
+      LOG(ERROR) << opt
+                 << ": specify the number in the range [0, 100), "
+                    "exclusive of 100";
+      return -1;
+    }
+
+    config->conn.downstream->hedge_percentile = p;
+
+    return 0;
+  }
+  case SHRPX_OPTID_BACKEND_HTTP2_MAX_SESSIONS: {
+    size_t n;
+    if (parse_uint(&n, opt, optarg) != 0) {
+      return -1;
+    }
+
+    if (n == 0) {
+      LOG(ERROR) << opt << ": specify an integer strictly more than 0";
+
+      return -1;
+    }
+
+    config->http2.downstream.max_sessions = n;
+
+    return 0;
+  }
+  case SHRPX_OPTID_BACKEND_HTTP2_PACK_SESSIONS:
+    config->http2.downstream.pack_sessions = util::strieq("yes"sv, optarg);
+
+    return 0;
   case SHRPX_OPTID_CONF:
     LOG(WARN) << "conf: ignored";
 
@@ -4499,6 +5027,70 @@ int compute_affinity_hash(std::vector<AffinityHash> &res, size_t idx,
 }
 } // namespace
 
+int compute_maglev_table(std::vector<uint32_t> &table,
+                         const std::vector<std::string_view> &keys) {
+  int rv;
+  std::array<uint8_t, 32> buf;
+
+  assert(!keys.empty());
+
+  constexpr auto m = MAGLEV_TABLE_SIZE;
+
+  // Each backend has its own permutation of table positions which is
+  // determined by offset and skip derived from its key.
+  std::vector<std::pair<uint64_t, uint64_t>> perms;
+  perms.reserve(keys.size());
+
+  for (auto &key : keys) {
+    rv = util::sha256(buf.data(), key);
+    if (rv != 0) {
+      return -1;
+    }
+
+    auto h1 = (static_cast<uint32_t>(buf[0]) << 24) |
+              (static_cast<uint32_t>(buf[1]) << 16) |
+              (static_cast<uint32_t>(buf[2]) << 8) |
+              static_cast<uint32_t>(buf[3]);
+    auto h2 = (static_cast<uint32_t>(buf[4]) << 24) |
+              (static_cast<uint32_t>(buf[5]) << 16) |
+              (static_cast<uint32_t>(buf[6]) << 8) |
+              static_cast<uint32_t>(buf[7]);
+
+    perms.emplace_back(h1 % m, h2 % (m - 1) + 1);
+  }
+
+  constexpr auto unassigned = std::numeric_limits<uint32_t>::max();
+
+  table.assign(m, unassigned);
+
+  // Backends take turns to claim the next unassigned position in
+  // their permutation until the table is filled.
+  std::vector<uint64_t> next(keys.size());
+  size_t n = 0;
+
+  for (;;) {
+    for (size_t i = 0; i < keys.size(); ++i) {
+      auto [offset, skip] = perms[i];
+      uint64_t c;
+
+      for (;;) {
+        c = (offset + next[i] * skip) % m;
+        ++next[i];
+
+        if (table[c] == unassigned) {
+          break;
+        }
+      }
+
+      table[c] = static_cast<uint32_t>(i);
+
+      if (++n == m) {
+        return 0;
+      }
+    }
+  }
+}
+
 // Configures the following member in |config|:
 // conn.downstream_router, conn.downstream.addr_groups,
 // conn.downstream.addr_group_catch_all.
@@ -4675,6 +5267,7 @@ int configure_downstream_group(Config *config, bool http2_proxy,
     }
 
     if (g.affinity.type != SessionAffinity::NONE) {
+      std::vector<std::string_view> keys;
       size_t idx = 0;
       for (auto &addr : g.addrs) {
         std::string_view key;
@@ -4688,9 +5281,13 @@ int configure_downstream_group(Config *config, bool http2_proxy,
           key = std::string_view{reinterpret_cast<char *>(&addr.addr.su),
                                  addr.addr.len};
         }
-        rv = compute_affinity_hash(g.affinity_hash, idx, key);
-        if (rv != 0) {
-          return -1;
+        if (g.affinity.hash_method == AffinityHashMethod::MAGLEV) {
+          keys.push_back(key);
+        } else {
+          rv = compute_affinity_hash(g.affinity_hash, idx, key);
+          if (rv != 0) {
+            return -1;
+          }
         }
 
         if (g.affinity.cookie.stickiness ==
@@ -4702,9 +5299,19 @@ int configure_downstream_group(Config *config, bool http2_proxy,
         ++idx;
       }
 
-      std::ranges::sort(g.affinity_hash, [](const auto &lhs, const auto &rhs) {
-        return lhs.hash < rhs.hash;
-      });
+      if (g.affinity.hash_method == AffinityHashMethod::MAGLEV) {
+        auto table = std::make_shared<std::vector<uint32_t>>();
+        rv = compute_maglev_table(*table, keys);
+        if (rv != 0) {
+          return -1;
+        }
+        g.maglev_table = std::move(table);
+      } else {
+        std::ranges::sort(g.affinity_hash,
+                          [](const auto &lhs, const auto &rhs) {
+                            return lhs.hash < rhs.hash;
+                          });
+      }
     }
 
     auto &timeout = g.timeout;
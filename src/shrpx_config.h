@@ -44,6 +44,8 @@
 #include <memory>
 #include <unordered_set>
 #include <unordered_map>
+#include <map>
+#include <string>
 
 #include "ssl_compat.h"
 
@@ -361,6 +363,48 @@ constexpr auto SHRPX_OPT_FRONTEND_HTTP2_IDLE_TIMEOUT =
   "frontend-http2-idle-timeout"sv;
 constexpr auto SHRPX_OPT_FRONTEND_HTTP3_IDLE_TIMEOUT =
   "frontend-http3-idle-timeout"sv;
+constexpr auto SHRPX_OPT_ACCESSLOG_ENCODING = "accesslog-encoding"sv;
+constexpr auto SHRPX_OPT_BACKEND_HTTP2_STREAMS_PER_SESSION =
+  "backend-http2-streams-per-session"sv;
+constexpr auto SHRPX_OPT_BACKEND_HTTP2_MAX_SESSIONS =
+  "backend-http2-max-sessions"sv;
+constexpr auto SHRPX_OPT_BACKEND_OUTLIER_DETECTION_INTERVAL =
+  "backend-outlier-detection-interval"sv;
+constexpr auto SHRPX_OPT_BACKEND_OUTLIER_FAILURE_RATE =
+  "backend-outlier-failure-rate"sv;
+constexpr auto SHRPX_OPT_BACKEND_OUTLIER_LATENCY_FACTOR =
+  "backend-outlier-latency-factor"sv;
+constexpr auto SHRPX_OPT_BACKEND_OUTLIER_EJECTION_TIME =
+  "backend-outlier-ejection-time"sv;
+constexpr auto SHRPX_OPT_BACKEND_OUTLIER_MAX_EJECTION_PERCENT =
+  "backend-outlier-max-ejection-percent"sv;
+constexpr auto SHRPX_OPT_BACKEND_HEDGE_PERCENTILE =
+  "backend-hedge-percentile"sv;
+constexpr auto SHRPX_OPT_BACKEND_QUEUE_DELAY_TARGET =
+  "backend-queue-delay-target"sv;
+constexpr auto SHRPX_OPT_BACKEND_QUEUE_DELAY_INTERVAL =
+  "backend-queue-delay-interval"sv;
+constexpr auto SHRPX_OPT_BACKEND_CLIENT_MAX_CONCURRENCY =
+  "backend-client-max-concurrency"sv;
+constexpr auto SHRPX_OPT_BACKEND_CLIENT_KEY_HEADER =
+  "backend-client-key-header"sv;
+constexpr auto SHRPX_OPT_BACKEND_CLIENT_IPV4_PREFIX =
+  "backend-client-ipv4-prefix"sv;
+constexpr auto SHRPX_OPT_BACKEND_CLIENT_IPV6_PREFIX =
+  "backend-client-ipv6-prefix"sv;
+constexpr auto SHRPX_OPT_BACKEND_BUFFER_REQUEST_MAX_BODY =
+  "backend-buffer-request-max-body"sv;
+constexpr auto SHRPX_OPT_BACKEND_RESPONSE_SPOOL_DIR =
+  "backend-response-spool-dir"sv;
+constexpr auto SHRPX_OPT_BACKEND_RESPONSE_SPOOL_MAX =
+  "backend-response-spool-max"sv;
+constexpr auto SHRPX_OPT_SPLICE = "splice"sv;
+constexpr auto SHRPX_OPT_MEMCHUNK_POOL_MAX_FREE = "memchunk-pool-max-free"sv;
+constexpr auto SHRPX_OPT_BACKEND_CLIENT_WEIGHT = "backend-client-weight"sv;
+constexpr auto SHRPX_OPT_BACKEND_BUFFER_REQUEST_MEMORY =
+  "backend-buffer-request-memory"sv;
+constexpr auto SHRPX_OPT_BACKEND_HTTP2_PACK_SESSIONS =
+  "backend-http2-pack-sessions"sv;
 
 constexpr size_t SHRPX_OBFUSCATED_NODE_LENGTH = 8;
 
@@ -382,6 +426,26 @@ enum class SessionAffinity {
   IP,
   // Cookie based affinity
   COOKIE,
+  // Request header field based affinity
+  HEADER,
+  // Request path based affinity
+  PATH,
+};
+
+enum class AffinityHashMethod {
+  // Consistent hashing described in https://github.com/RJ/ketama
+  KETAMA,
+  // Maglev hashing
+  MAGLEV,
+};
+
+enum class LoadBalancing {
+  // Weighted round robin
+  ROUND_ROBIN,
+  // Choose a backend which has the fewest outstanding requests
+  LEAST_REQUEST,
+  // Choose the less loaded backend from 2 randomly chosen backends
+  P2C,
 };
 
 enum class SessionAffinityCookieSecure {
@@ -417,6 +481,12 @@ struct AffinityConfig {
     // Affinity Stickiness
     SessionAffinityCookieStickiness stickiness;
   } cookie;
+  struct {
+    // Lowercased name of a request header field to use.
+    std::string_view name;
+  } header;
+  // The method to map a hash to a backend.
+  AffinityHashMethod hash_method;
 };
 
 enum shrpx_forwarded_param {
@@ -498,6 +568,12 @@ struct DownstreamAddrConfig {
   std::string_view group;
   size_t fall;
   size_t rise;
+  // The number of idle connections to this address which each worker
+  // establishes in advance.
+  size_t min_idle;
+  // The duration during which the weight of this address ramps up
+  // after it becomes available.  0 disables slow start.
+  ev_tstamp slow_start;
   // weight of this address inside a weight group.  Its range is [1,
   // 256], inclusive.
   uint32_t weight;
@@ -536,9 +612,16 @@ struct DownstreamAddrGroupConfig {
   DownstreamAddrGroupConfig(const std::string_view &pattern)
     : pattern(pattern),
       affinity{SessionAffinity::NONE},
+      lb{LoadBalancing::ROUND_ROBIN},
       redirect_if_not_tls(false),
       dnf{false},
-      timeout{} {}
+      buffer_request{false},
+      spool_response{false},
+      timeout{},
+      hedge_delay{0},
+      max_concurrency{0},
+      request_rate{0},
+      request_burst{0} {}
 
   std::string_view pattern;
   std::string_view mruby_file;
@@ -549,18 +632,43 @@ struct DownstreamAddrGroupConfig {
   // Maps affinity hash of each DownstreamAddrConfig to its index in
   // addrs.  It is only assigned when strict stickiness is enabled.
   std::unordered_map<uint32_t, size_t> affinity_hash_map;
+  // Maglev lookup table.  Each element is an index into addrs.  Only
+  // used if affinity.hash_method == AffinityHashMethod::MAGLEV.  It
+  // is immutable, and shared by all workers.
+  std::shared_ptr<const std::vector<uint32_t>> maglev_table;
   // Cookie based session affinity configuration.
   AffinityConfig affinity;
+  // Load balancing method among addrs.  It is ignored if session
+  // affinity is enabled.
+  LoadBalancing lb;
   // true if this group requires that client connection must be TLS,
   // and the request must be redirected to https URI.
   bool redirect_if_not_tls;
   // true if a request should not be forwarded to a backend.
   bool dnf;
+  // true if a request body is buffered entirely before a backend is
+  // selected.
+  bool buffer_request;
+  // true if a response body is spooled so that a backend
+  // connection is released regardless of a client.
+  bool spool_response;
   // Timeouts for backend connection.
   struct {
     ev_tstamp read;
     ev_tstamp write;
   } timeout;
+  // The delay before a hedged request is sent.  0 disables hedged
+  // request.
+  ev_tstamp hedge_delay;
+  // The maximum number of concurrent requests to this group in a
+  // worker.  0 means no limit.
+  size_t max_concurrency;
+  // The number of requests per second which a client can make to
+  // this group in a worker.  0 means no limit.
+  size_t request_rate;
+  // The maximum number of requests which a client can make in a
+  // burst.  0 means that it is the same as request_rate.
+  size_t request_burst;
 };
 
 struct TicketKey {
@@ -861,6 +969,16 @@ struct Http2Config {
     int32_t window_size;
     int32_t connection_window_size;
     size_t max_concurrent_streams;
+    // The number of concurrent requests in one session above which
+    // another session is created.  0 means that only the limit
+    // advertised by backend server is used.
+    size_t streams_per_session;
+    // The maximum number of sessions per backend address which are
+    // created because of streams_per_session.
+    size_t max_sessions;
+    // true if a new request is forwarded to the busiest session
+    // which is not full, rather than the least loaded one.
+    bool pack_sessions;
   } downstream;
   struct {
     ev_tstamp stream_read;
@@ -874,6 +992,7 @@ struct LoggingConfig {
   struct {
     std::vector<LogFragment> format;
     std::string_view file;
+    AccessLogEncoding encoding;
     // Send accesslog to syslog, ignoring accesslog_file.
     bool syslog;
     // Write accesslog when response headers are received from
@@ -918,15 +1037,46 @@ struct RouterConfig {
   std::vector<WildcardPattern> wildcard_patterns;
 };
 
+// The map from client key to its weight in FairQueue.
+using ClientWeightMap = std::map<std::string, uint32_t, std::less<>>;
+
+struct OutlierConfig {
+  // The interval to evaluate backends for outlier detection.  0
+  // disables outlier detection.
+  ev_tstamp interval;
+  // The duration of the first ejection.  It is multiplied by the
+  // number of consecutive ejections.
+  ev_tstamp ejection_time;
+  // A backend whose failure rate in percent is equal to or larger
+  // than this value is ejected.
+  size_t failure_rate;
+  // A backend whose latency is larger than this value times the
+  // median latency of the group is ejected.  0 disables latency
+  // based ejection.
+  size_t latency_factor;
+  // The maximum percentage of backends in a group which can be
+  // ejected at the same time.
+  size_t max_ejection_percent;
+};
+
 struct DownstreamConfig {
   DownstreamConfig()
     : balloc(1024, 1024),
       timeout{},
+      outlier{},
+      queue_delay{},
       addr_group_catch_all{0},
       connections_per_host{0},
       connections_per_frontend{0},
       request_buffer_size{0},
       response_buffer_size{0},
+      buffer_request_max_body{0},
+      buffer_request_memory{0},
+      response_spool{},
+      hedge_percentile{0},
+      client_max_concurrency{0},
+      client_ipv4_prefix{32},
+      client_ipv6_prefix{128},
       family{0} {}
 
   DownstreamConfig(const DownstreamConfig &) = delete;
@@ -949,6 +1099,18 @@ struct DownstreamConfig {
     // group temporarily.
     ev_tstamp max_backoff;
   } timeout;
+  OutlierConfig outlier;
+  // CoDel parameters of the queue of requests which are blocked by
+  // --backend-connections-per-frontend or
+  // --backend-connections-per-host.
+  struct {
+    // The target of the time that a request waits in the queue.  0
+    // disables it.
+    ev_tstamp target;
+    // The interval that the waiting time must stay above the target
+    // before requests are shed.
+    ev_tstamp interval;
+  } queue_delay;
   RouterConfig router;
   std::vector<DownstreamAddrGroupConfig> addr_groups;
   // The index of catch-all group in downstream_addr_groups.
@@ -957,6 +1119,39 @@ struct DownstreamConfig {
   size_t connections_per_frontend;
   size_t request_buffer_size;
   size_t response_buffer_size;
+  // The maximum size of request body which is buffered by
+  // buffer-request parameter.
+  size_t buffer_request_max_body;
+  // The maximum size of request body which is buffered in memory by
+  // buffer-request parameter per frontend connection.
+  size_t buffer_request_memory;
+  // The configuration of spool-response parameter.
+  struct {
+    // The directory where temporary files are created.
+    std::string_view dir;
+    // The maximum number of bytes spooled per response.  If it is
+    // exceeded, nghttpx stops reading the response from backend
+    // until the client reads the spooled data.
+    size_t max;
+  } response_spool;
+  // The percentile of backend response time which is used as the
+  // delay of hedged request if it is longer than the configured
+  // delay.  0 disables it.
+  double hedge_percentile;
+  // The header field name which identifies a client for
+  // client_max_concurrency.  If it is empty, or a request does not
+  // have it, the remote address is used.
+  std::string_view client_key_header;
+  // The maximum number of concurrent requests per client in a
+  // worker.  0 means no limit.
+  size_t client_max_concurrency;
+  // The weight of the clients.  The client which is not listed here
+  // has weight 1.
+  ClientWeightMap client_weights;
+  // The prefix length of IPv4 and IPv6 remote address which
+  // identifies a client if client_key_header is not used.
+  size_t client_ipv4_prefix;
+  size_t client_ipv6_prefix;
   // Address family of backend connection.  One of either AF_INET,
   // AF_INET6 or AF_UNSPEC.  This is ignored if backend connection
   // is made via Unix domain socket.
@@ -999,6 +1194,10 @@ struct ConnectionConfig {
   } upstream;
 
   std::shared_ptr<DownstreamConfig> downstream;
+  // true if the tunneled data and the response body with
+  // content-length between cleartext connections are relayed with
+  // splice(2).
+  bool splice;
 };
 
 struct APIConfig {
@@ -1048,7 +1247,8 @@ struct Config {
       ignore_per_pattern_mruby_error{false},
       ev_loop_flags{0},
       max_worker_processes{0},
-      worker_process_grace_shutdown_period{0.} {
+      worker_process_grace_shutdown_period{0.},
+      memchunk_pool_max_free{0} {
   }
   ~Config();
 
@@ -1104,6 +1304,9 @@ struct Config {
   uint32_t ev_loop_flags;
   size_t max_worker_processes;
   ev_tstamp worker_process_grace_shutdown_period;
+  // The maximum number of bytes which each worker keeps in the
+  // freelist of its Memchunk pool.  The excess is periodically freed.
+  size_t memchunk_pool_max_free;
 };
 
 const Config *get_config();
@@ -1116,6 +1319,7 @@ void create_config();
 // generated by gennghttpxfun.py
 enum {
   SHRPX_OPTID_ACCEPT_PROXY_PROTOCOL,
+  SHRPX_OPTID_ACCESSLOG_ENCODING,
   SHRPX_OPTID_ACCESSLOG_FILE,
   SHRPX_OPTID_ACCESSLOG_FORMAT,
   SHRPX_OPTID_ACCESSLOG_SYSLOG,
@@ -1129,9 +1333,17 @@ enum {
   SHRPX_OPTID_API_MAX_REQUEST_BODY,
   SHRPX_OPTID_BACKEND,
   SHRPX_OPTID_BACKEND_ADDRESS_FAMILY,
+  SHRPX_OPTID_BACKEND_BUFFER_REQUEST_MAX_BODY,
+  SHRPX_OPTID_BACKEND_BUFFER_REQUEST_MEMORY,
+  SHRPX_OPTID_BACKEND_CLIENT_IPV4_PREFIX,
+  SHRPX_OPTID_BACKEND_CLIENT_IPV6_PREFIX,
+  SHRPX_OPTID_BACKEND_CLIENT_KEY_HEADER,
+  SHRPX_OPTID_BACKEND_CLIENT_MAX_CONCURRENCY,
+  SHRPX_OPTID_BACKEND_CLIENT_WEIGHT,
   SHRPX_OPTID_BACKEND_CONNECT_TIMEOUT,
   SHRPX_OPTID_BACKEND_CONNECTIONS_PER_FRONTEND,
   SHRPX_OPTID_BACKEND_CONNECTIONS_PER_HOST,
+  SHRPX_OPTID_BACKEND_HEDGE_PERCENTILE,
   SHRPX_OPTID_BACKEND_HTTP_PROXY_URI,
   SHRPX_OPTID_BACKEND_HTTP1_CONNECTIONS_PER_FRONTEND,
   SHRPX_OPTID_BACKEND_HTTP1_CONNECTIONS_PER_HOST,
@@ -1142,7 +1354,10 @@ enum {
   SHRPX_OPTID_BACKEND_HTTP2_DECODER_DYNAMIC_TABLE_SIZE,
   SHRPX_OPTID_BACKEND_HTTP2_ENCODER_DYNAMIC_TABLE_SIZE,
   SHRPX_OPTID_BACKEND_HTTP2_MAX_CONCURRENT_STREAMS,
+  SHRPX_OPTID_BACKEND_HTTP2_MAX_SESSIONS,
+  SHRPX_OPTID_BACKEND_HTTP2_PACK_SESSIONS,
   SHRPX_OPTID_BACKEND_HTTP2_SETTINGS_TIMEOUT,
+  SHRPX_OPTID_BACKEND_HTTP2_STREAMS_PER_SESSION,
   SHRPX_OPTID_BACKEND_HTTP2_WINDOW_BITS,
   SHRPX_OPTID_BACKEND_HTTP2_WINDOW_SIZE,
   SHRPX_OPTID_BACKEND_IPV4,
@@ -1150,9 +1365,18 @@ enum {
   SHRPX_OPTID_BACKEND_KEEP_ALIVE_TIMEOUT,
   SHRPX_OPTID_BACKEND_MAX_BACKOFF,
   SHRPX_OPTID_BACKEND_NO_TLS,
+  SHRPX_OPTID_BACKEND_OUTLIER_DETECTION_INTERVAL,
+  SHRPX_OPTID_BACKEND_OUTLIER_EJECTION_TIME,
+  SHRPX_OPTID_BACKEND_OUTLIER_FAILURE_RATE,
+  SHRPX_OPTID_BACKEND_OUTLIER_LATENCY_FACTOR,
+  SHRPX_OPTID_BACKEND_OUTLIER_MAX_EJECTION_PERCENT,
+  SHRPX_OPTID_BACKEND_QUEUE_DELAY_INTERVAL,
+  SHRPX_OPTID_BACKEND_QUEUE_DELAY_TARGET,
   SHRPX_OPTID_BACKEND_READ_TIMEOUT,
   SHRPX_OPTID_BACKEND_REQUEST_BUFFER,
   SHRPX_OPTID_BACKEND_RESPONSE_BUFFER,
+  SHRPX_OPTID_BACKEND_RESPONSE_SPOOL_DIR,
+  SHRPX_OPTID_BACKEND_RESPONSE_SPOOL_MAX,
   SHRPX_OPTID_BACKEND_TLS,
   SHRPX_OPTID_BACKEND_TLS_SNI_FIELD,
   SHRPX_OPTID_BACKEND_WRITE_TIMEOUT,
@@ -1235,6 +1459,7 @@ enum {
   SHRPX_OPTID_MAX_REQUEST_HEADER_FIELDS,
   SHRPX_OPTID_MAX_RESPONSE_HEADER_FIELDS,
   SHRPX_OPTID_MAX_WORKER_PROCESSES,
+  SHRPX_OPTID_MEMCHUNK_POOL_MAX_FREE,
   SHRPX_OPTID_MRUBY_FILE,
   SHRPX_OPTID_NO_ADD_X_FORWARDED_PROTO,
   SHRPX_OPTID_NO_HOST_REWRITE,
@@ -1271,6 +1496,7 @@ enum {
   SHRPX_OPTID_SERVER_NAME,
   SHRPX_OPTID_SINGLE_PROCESS,
   SHRPX_OPTID_SINGLE_THREAD,
+  SHRPX_OPTID_SPLICE,
   SHRPX_OPTID_STREAM_READ_TIMEOUT,
   SHRPX_OPTID_STREAM_WRITE_TIMEOUT,
   SHRPX_OPTID_STRIP_INCOMING_FORWARDED,
@@ -1385,6 +1611,19 @@ read_quic_secret_file(const std::string_view &path);
 // Returns string representation of |proto|.
 std::string_view strproto(Proto proto);
 
+// The size of Maglev lookup table.  It must be a prime number.
+constexpr size_t MAGLEV_TABLE_SIZE = 65537;
+
+// Builds Maglev lookup table described in "Maglev: A Fast and
+// Reliable Software Network Load Balancer" from backend |keys|, and
+// assigns it to |table|.  The table has MAGLEV_TABLE_SIZE elements,
+// and each element is an index into |keys|.  Each backend gets
+// almost the same number of elements, and adding or removing a
+// backend changes only a small portion of the table.  |keys| must
+// not be empty.  This function returns 0 if it succeeds, or -1.
+int compute_maglev_table(std::vector<uint32_t> &table,
+                         const std::vector<std::string_view> &keys);
+
 int configure_downstream_group(Config *config, bool http2_proxy,
                                bool numeric_addr_only,
                                const TLSConfig &tlsconf);
@@ -45,6 +45,7 @@ const MunitTest tests[]{
   munit_void_test(test_shrpx_config_parse_log_format),
   munit_void_test(test_shrpx_config_read_tls_ticket_key_file),
   munit_void_test(test_shrpx_config_read_tls_ticket_key_file_aes_256),
+  munit_void_test(test_shrpx_config_compute_maglev_table),
   munit_test_end(),
 };
 } // namespace
@@ -255,4 +256,54 @@ void test_shrpx_config_read_tls_ticket_key_file_aes_256(void) {
                                  "a..............................b"sv));
 }
 
+void test_shrpx_config_compute_maglev_table(void) {
+  std::vector<uint32_t> table;
+
+  assert_int(0, ==,
+             compute_maglev_table(table, {"alpha"sv, "bravo"sv, "charlie"sv,
+                                          "delta"sv, "echo"sv}));
+  assert_size(MAGLEV_TABLE_SIZE, ==, table.size());
+
+  // Each backend gets almost the same number of entries.
+  std::array<size_t, 5> counts{};
+  for (auto idx : table) {
+    assert_uint32(5, >, idx);
+    ++counts[idx];
+  }
+
+  for (auto n : counts) {
+    assert_size(MAGLEV_TABLE_SIZE / 5, <=, n);
+    assert_size(MAGLEV_TABLE_SIZE / 5 + 1, >=, n);
+  }
+
+  // Removing "charlie" moves its entries, and only a small portion
+  // of the others.
+  std::vector<uint32_t> table2;
+
+  assert_int(0, ==,
+             compute_maglev_table(table2,
+                                  {"alpha"sv, "bravo"sv, "delta"sv, "echo"sv}));
+
+  constexpr std::array<uint32_t, 4> idxmap{0, 1, 3, 4};
+
+  size_t moved = 0;
+  for (size_t i = 0; i < table.size(); ++i) {
+    if (table[i] == 2) {
+      assert_uint32(2, !=, idxmap[table2[i]]);
+      continue;
+    }
+    if (table[i] != idxmap[table2[i]]) {
+      ++moved;
+    }
+  }
+
+  assert_size(MAGLEV_TABLE_SIZE / 10, >, moved);
+
+  // The same table is built from the same keys.
+  assert_int(0, ==,
+             compute_maglev_table(table2, {"alpha"sv, "bravo"sv, "charlie"sv,
+                                           "delta"sv, "echo"sv}));
+  assert_true(table == table2);
+}
+
 } // namespace shrpx
@@ -98,6 +98,17 @@ void ConnectBlocker::on_failure() {
   ev_timer_start(loop_, &timer_);
 }
 
+void ConnectBlocker::block(ev_tstamp t) {
+  if (ev_is_active(&timer_)) {
+    return;
+  }
+
+  call_block_func();
+
+  ev_timer_set(&timer_, t, 0.);
+  ev_timer_start(loop_, &timer_);
+}
+
 size_t ConnectBlocker::get_fail_count() const { return fail_count_; }
 
 void ConnectBlocker::offline() {
@@ -51,6 +51,11 @@ public:
   // backoff.
   void on_failure();
 
+  // Blocks connection establishment for |t| seconds without counting
+  // it as a connection failure.  This function does nothing if
+  // connection is already blocked.
+  void block(ev_tstamp t);
+
   size_t get_fail_count() const;
 
   // Peer is now considered offline.  This effectively means that the
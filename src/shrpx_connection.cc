@@ -28,6 +28,7 @@
 #  include <unistd.h>
 #endif // HAVE_UNISTD_H
 #include <netinet/tcp.h>
+#include <fcntl.h>
 
 #include <limits>
 
@@ -42,6 +43,7 @@
 
 #include "shrpx_tls.h"
 #include "shrpx_log.h"
+#include "shrpx_splice_pipe.h"
 #include "memchunk.h"
 #include "util.h"
 
@@ -280,7 +282,7 @@ int Connection::tls_handshake() {
       break;
     case SSL_ERROR_WANT_WRITE:
       wlimit.startw();
-      ev_timer_again(loop, &wt);
+      again_wt();
       break;
     case SSL_ERROR_SSL: {
       if (LOG_ENABLED(INFO)) {
@@ -527,7 +529,7 @@ nghttp2_ssize Connection::write_tls(const void *data, size_t len) {
     case SSL_ERROR_WANT_WRITE:
       tls.last_writelen = len;
       wlimit.startw();
-      ev_timer_again(loop, &wt);
+      again_wt();
 
       return 0;
     case SSL_ERROR_SSL:
@@ -547,7 +549,7 @@ nghttp2_ssize Connection::write_tls(const void *data, size_t len) {
   wlimit.drain(static_cast<size_t>(rv));
 
   if (ev_is_active(&wt)) {
-    ev_timer_again(loop, &wt);
+    last_write = std::chrono::steady_clock::now();
   }
 
   update_tls_warmup_writelen(static_cast<size_t>(rv));
@@ -716,7 +718,7 @@ nghttp2_ssize Connection::write_clear(const void *data, size_t len) {
   if (nwrite == -1) {
     if (errno == EAGAIN || errno == EWOULDBLOCK) {
       wlimit.startw();
-      ev_timer_again(loop, &wt);
+      again_wt();
       return 0;
     }
     return SHRPX_ERR_NETWORK;
@@ -725,7 +727,7 @@ nghttp2_ssize Connection::write_clear(const void *data, size_t len) {
   wlimit.drain(as_unsigned(nwrite));
 
   if (ev_is_active(&wt)) {
-    ev_timer_again(loop, &wt);
+    last_write = std::chrono::steady_clock::now();
   }
 
   return nwrite;
@@ -743,7 +745,7 @@ nghttp2_ssize Connection::writev_clear(struct iovec *iov, int iovcnt) {
   if (nwrite == -1) {
     if (errno == EAGAIN || errno == EWOULDBLOCK) {
       wlimit.startw();
-      ev_timer_again(loop, &wt);
+      again_wt();
       return 0;
     }
     return SHRPX_ERR_NETWORK;
@@ -752,7 +754,7 @@ nghttp2_ssize Connection::writev_clear(struct iovec *iov, int iovcnt) {
   wlimit.drain(as_unsigned(nwrite));
 
   if (ev_is_active(&wt)) {
-    ev_timer_again(loop, &wt);
+    last_write = std::chrono::steady_clock::now();
   }
 
   return nwrite;
@@ -819,6 +821,80 @@ nghttp2_ssize Connection::peek_clear(void *data, size_t len) {
   return nread;
 }
 
+nghttp2_ssize Connection::splice_read(SplicePipe &pipe, size_t max) {
+#ifdef HAVE_SPLICE
+  auto len = std::min({pipe.capacity - std::min(pipe.len, pipe.capacity),
+                       rlimit.avail(), max});
+  if (len == 0) {
+    return 0;
+  }
+
+  ssize_t nread;
+  while ((nread = splice(fd, nullptr, pipe.wfd, nullptr, len,
+                         SPLICE_F_MOVE | SPLICE_F_NONBLOCK)) == -1 &&
+         errno == EINTR)
+    ;
+  if (nread == -1) {
+    if (errno == EAGAIN || errno == EWOULDBLOCK) {
+      // We cannot tell whether socket or pipe blocks.  If pipe has
+      // data, assume that it is full so that we do not spin on
+      // readable socket.
+      if (pipe.len) {
+        pipe.stalled = true;
+      }
+      return 0;
+    }
+    return SHRPX_ERR_NETWORK;
+  }
+
+  if (nread == 0) {
+    return SHRPX_ERR_EOF;
+  }
+
+  rlimit.drain(as_unsigned(nread));
+  pipe.len += as_unsigned(nread);
+
+  return nread;
+#else  // !HAVE_SPLICE
+  return SHRPX_ERR_NETWORK;
+#endif // !HAVE_SPLICE
+}
+
+nghttp2_ssize Connection::splice_write(SplicePipe &pipe) {
+#ifdef HAVE_SPLICE
+  auto len = std::min(pipe.len, wlimit.avail());
+  if (len == 0) {
+    return 0;
+  }
+
+  ssize_t nwrite;
+  while ((nwrite = splice(pipe.rfd, nullptr, fd, nullptr, len,
+                          SPLICE_F_MOVE | SPLICE_F_NONBLOCK)) == -1 &&
+         errno == EINTR)
+    ;
+  if (nwrite == -1) {
+    if (errno == EAGAIN || errno == EWOULDBLOCK) {
+      wlimit.startw();
+      again_wt();
+      return 0;
+    }
+    return SHRPX_ERR_NETWORK;
+  }
+
+  wlimit.drain(as_unsigned(nwrite));
+  pipe.len -= as_unsigned(nwrite);
+  pipe.stalled = false;
+
+  if (ev_is_active(&wt)) {
+    last_write = std::chrono::steady_clock::now();
+  }
+
+  return nwrite;
+#else  // !HAVE_SPLICE
+  return SHRPX_ERR_NETWORK;
+#endif // !HAVE_SPLICE
+}
+
 void Connection::handle_tls_pending_read() {
   if (!ev_is_active(&rev)) {
     return;
@@ -915,4 +991,26 @@ bool Connection::expired_rt() {
   return false;
 }
 
+void Connection::again_wt() {
+  last_write = std::chrono::steady_clock::now();
+
+  if (!ev_is_active(&wt)) {
+    ev_timer_again(loop, &wt);
+  }
+}
+
+bool Connection::expired_wt() {
+  auto delta = wt.repeat - util::ev_tstamp_from(
+                             std::chrono::steady_clock::now() - last_write);
+  if (delta < 1e-9) {
+    return true;
+  }
+  // Unlike read timer, wt.repeat is the timeout value, so it must be
+  // kept.
+  ev_timer_stop(loop, &wt);
+  ev_timer_set(&wt, delta, wt.repeat);
+  ev_timer_start(loop, &wt);
+  return false;
+}
+
 } // namespace shrpx
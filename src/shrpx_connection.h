@@ -56,6 +56,8 @@ namespace tls {
 struct TLSSessionCache;
 } // namespace tls
 
+struct SplicePipe;
+
 struct TLSConnection {
   // Stores TLSv1.3 early data.
   DefaultMemchunks earlybuf;
@@ -138,6 +140,13 @@ struct Connection {
   nghttp2_ssize read_nolim_clear(void *data, size_t len);
   // Peek at most |len| bytes of data from socket without rate limit.
   nghttp2_ssize peek_clear(void *data, size_t len);
+  // Moves at most |max| bytes of data from socket into |pipe| with
+  // splice(2).  The return value follows the rule of read_*
+  // functions.
+  nghttp2_ssize splice_read(SplicePipe &pipe, size_t max);
+  // Moves data in |pipe| to socket with splice(2).  The return value
+  // follows the rule of write_* functions.
+  nghttp2_ssize splice_write(SplicePipe &pipe);
 
   void handle_tls_pending_read();
 
@@ -156,6 +165,17 @@ struct Connection {
   // Returns true if read timer expired.
   bool expired_rt();
 
+  // The same trick is used for write timer which is restarted
+  // whenever data are written.
+
+  // Restarts write timer.  If it is running, this function just
+  // records the time, and expired_wt() reschedules the timer when it
+  // fires.
+  void again_wt();
+  // Returns true if write timer expired.  Otherwise, reschedules
+  // write timer for the remaining time, and returns false.
+  bool expired_wt();
+
 #ifdef ENABLE_HTTP3
   // This must be the first member of Connection.
   ngtcp2_crypto_conn_ref conn_ref;
@@ -181,6 +201,8 @@ struct Connection {
   std::chrono::steady_clock::time_point last_read;
   // Timeout for read timer |rt|.
   ev_tstamp read_timeout;
+  // The point of time when write timer |wt| is last restarted.
+  std::chrono::steady_clock::time_point last_write;
 };
 
 #ifdef ENABLE_HTTP3
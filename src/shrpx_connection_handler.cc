@@ -44,6 +44,7 @@
 #include "shrpx_memcached_dispatcher.h"
 #include "shrpx_signal.h"
 #include "shrpx_log.h"
+#include "shrpx_metrics.h"
 #include "xsi_strerror.h"
 #include "util.h"
 #include "template.h"
@@ -196,6 +197,8 @@ int ConnectionHandler::create_single_worker() {
   const auto &wid = worker_ids_[0];
 #endif // ENABLE_HTTP3
 
+  metrics_ = std::make_unique<Metrics>(1);
+
   single_worker_ = std::make_unique<Worker>(
     loop_, sv_ssl_ctx, cl_ssl_ctx, cert_tree_.get(),
 #ifdef ENABLE_HTTP3
@@ -270,6 +273,8 @@ int ConnectionHandler::create_worker_thread(size_t num) {
     ++num;
   }
 
+  metrics_ = std::make_unique<Metrics>(num);
+
 #  ifdef ENABLE_HTTP3
   assert(worker_ids_.size() == num);
 #  endif // ENABLE_HTTP3
@@ -372,6 +377,8 @@ Worker *ConnectionHandler::get_single_worker() const {
   return single_worker_.get();
 }
 
+Metrics *ConnectionHandler::get_metrics() const { return metrics_.get(); }
+
 void ConnectionHandler::set_ticket_keys(
   std::shared_ptr<TicketKeys> ticket_keys) {
   ticket_keys_ = std::move(ticket_keys);
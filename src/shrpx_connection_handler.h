@@ -68,6 +68,7 @@ class Http2Session;
 class ConnectBlocker;
 class Worker;
 struct WorkerStat;
+class Metrics;
 struct TicketKeys;
 class MemcachedDispatcher;
 struct UpstreamAddr;
@@ -137,6 +138,7 @@ public:
   const std::shared_ptr<TicketKeys> &get_ticket_keys() const;
   struct ev_loop *get_loop() const;
   Worker *get_single_worker() const;
+  Metrics *get_metrics() const;
   void graceful_shutdown_worker();
   void set_graceful_shutdown(bool f);
   bool get_graceful_shutdown() const;
@@ -235,6 +237,8 @@ private:
   std::mt19937 &gen_;
   // ev_loop for each worker
   std::vector<struct ev_loop *> worker_loops_;
+  // Metrics of all workers.  It must outlive workers.
+  std::unique_ptr<Metrics> metrics_;
   // Worker instances when multi threaded mode (-nN, N >= 2) is used.
   // If at least one frontend enables API request, we allocate 1
   // additional worker dedicated to API request .
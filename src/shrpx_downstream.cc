@@ -26,6 +26,7 @@
 
 #include <cassert>
 #include <algorithm>
+#include <array>
 
 #include "urlparse.h"
 
@@ -38,6 +39,7 @@
 #include "shrpx_worker.h"
 #include "shrpx_http2_session.h"
 #include "shrpx_log.h"
+#include "shrpx_metrics.h"
 #ifdef HAVE_MRUBY
 #  include "shrpx_mruby.h"
 #endif // HAVE_MRUBY
@@ -68,6 +70,10 @@ void upstream_timeoutcb(struct ev_loop *loop, ev_timer *w, int revents) {
   auto downstream = static_cast<Downstream *>(w->data);
   auto upstream = downstream->get_upstream();
 
+  if (!downstream->stream_timer_expired(w)) {
+    return;
+  }
+
   auto which = revents == EV_READ ? "read" : "write";
 
   if (LOG_ENABLED(INFO)) {
@@ -98,6 +104,10 @@ namespace {
 void downstream_timeoutcb(struct ev_loop *loop, ev_timer *w, int revents) {
   auto downstream = static_cast<Downstream *>(w->data);
 
+  if (!downstream->stream_timer_expired(w)) {
+    return;
+  }
+
   auto which = revents == EV_READ ? "read" : "write";
 
   if (LOG_ENABLED(INFO)) {
@@ -129,26 +139,82 @@ void downstream_wtimeoutcb(struct ev_loop *loop, ev_timer *w, int revents) {
 }
 } // namespace
 
+namespace {
+void hedge_timeoutcb(struct ev_loop *loop, ev_timer *w, int revents) {
+  auto downstream = static_cast<Downstream *>(w->data);
+  auto upstream = downstream->get_upstream();
+  auto handler = upstream->get_client_handler();
+
+  if (downstream->hedge_request() != 0) {
+    delete handler;
+  }
+}
+} // namespace
+
+namespace {
+DownstreamPool *get_downstream_pool(Upstream *upstream) {
+  // upstream could be nullptr for unittests
+  if (!upstream) {
+    return nullptr;
+  }
+
+  return upstream->get_client_handler()->get_worker()->get_downstream_pool();
+}
+} // namespace
+
+namespace {
+BlockAllocator make_block_allocator(DownstreamPool *pool) {
+  if (!pool) {
+    return BlockAllocator(DOWNSTREAM_BALLOC_BLOCK_SIZE,
+                          DOWNSTREAM_BALLOC_BLOCK_SIZE);
+  }
+
+  return pool->get_block_allocator();
+}
+} // namespace
+
+namespace {
+HeaderRefs make_headers(DownstreamPool *pool, size_t capacity) {
+  if (!pool) {
+    HeaderRefs headers;
+    headers.reserve(capacity);
+    return headers;
+  }
+
+  return pool->get_headers(capacity);
+}
+} // namespace
+
 // upstream could be nullptr for unittests
 Downstream::Downstream(Upstream *upstream, MemchunkPool *mcpool,
                        int64_t stream_id)
   : dlnext(nullptr),
     dlprev(nullptr),
     response_sent_body_length(0),
-    balloc_(1024, 1024),
-    req_(balloc_),
-    resp_(balloc_),
+    pool_(get_downstream_pool(upstream)),
+    balloc_(make_block_allocator(pool_)),
+    req_(balloc_, make_headers(pool_, 16)),
+    resp_(balloc_, make_headers(pool_, 32)),
     request_start_time_(std::chrono::high_resolution_clock::now()),
     blocked_request_buf_(mcpool),
     request_buf_(mcpool),
     response_buf_(mcpool),
+    splice_pipe_pool_(nullptr),
+    upstream_rtimer_last_(0.),
+    upstream_wtimer_last_(0.),
+    downstream_rtimer_last_(0.),
+    downstream_wtimer_last_(0.),
     upstream_(upstream),
     blocked_link_(nullptr),
+    fair_queue_entry_(nullptr),
     addr_(nullptr),
+    attached_addr_(nullptr),
     num_retry_(0),
+    request_buffer_memory_(0),
     stream_id_(stream_id),
     assoc_stream_id_(-1),
     downstream_stream_id_(-1),
+    hedge_stream_id_(-1),
     response_rst_stream_error_code_(NGHTTP2_NO_ERROR),
     affinity_cookie_(0),
     request_state_(DownstreamState::INITIAL),
@@ -161,10 +227,13 @@ Downstream::Downstream(Upstream *upstream, MemchunkPool *mcpool,
     request_pending_(false),
     request_header_sent_(false),
     accesslog_written_(false),
+    metrics_recorded_(false),
     new_affinity_cookie_(false),
     blocked_request_data_eof_(false),
     expect_100_continue_(false),
-    stop_reading_(false) {
+    stop_reading_(false),
+    hedged_(false),
+    buffer_request_(false) {
   auto config = get_config();
   auto &httpconf = config->http;
 
@@ -180,17 +249,29 @@ Downstream::Downstream(Upstream *upstream, MemchunkPool *mcpool,
                 timeoutconf.stream_read);
   ev_timer_init(&downstream_wtimer_, &downstream_wtimeoutcb, 0.,
                 timeoutconf.stream_write);
+  ev_timer_init(&hedge_timer_, &hedge_timeoutcb, 0., 0.);
 
   header_timer_.data = this;
   upstream_rtimer_.data = this;
   upstream_wtimer_.data = this;
   downstream_rtimer_.data = this;
   downstream_wtimer_.data = this;
+  hedge_timer_.data = this;
 
-  rcbufs_.reserve(32);
+  if (pool_) {
+    rcbufs_ = pool_->get_rcbufs(32);
+  } else {
+    rcbufs_.reserve(32);
+  }
 #ifdef ENABLE_HTTP3
   rcbufs3_.reserve(32);
 #endif // ENABLE_HTTP3
+
+  // upstream could be nullptr for unittests
+  if (upstream_) {
+    auto metrics = upstream_->get_client_handler()->get_worker()->get_metrics();
+    metrics->streams_active.inc();
+  }
 }
 
 Downstream::~Downstream() {
@@ -202,11 +283,25 @@ Downstream::~Downstream() {
   if (upstream_) {
     auto loop = upstream_->get_client_handler()->get_loop();
 
+    auto metrics = upstream_->get_client_handler()->get_worker()->get_metrics();
+    metrics->streams_active.dec();
+    if (blocked_link_) {
+      metrics->streams_blocked.dec();
+    }
+
     ev_timer_stop(loop, &upstream_rtimer_);
     ev_timer_stop(loop, &upstream_wtimer_);
     ev_timer_stop(loop, &downstream_rtimer_);
     ev_timer_stop(loop, &downstream_wtimer_);
     ev_timer_stop(loop, &header_timer_);
+    ev_timer_stop(loop, &hedge_timer_);
+
+    if (fair_queue_entry_) {
+      upstream_->get_client_handler()->get_worker()->get_fair_queue()->release(
+        this);
+    }
+
+    set_request_buffer_memory(0);
 
 #ifdef HAVE_MRUBY
     auto handler = upstream_->get_client_handler();
@@ -229,8 +324,11 @@ Downstream::~Downstream() {
 
   // DownstreamConnection may refer to this object.  Delete it now
   // explicitly.
+  cancel_hedge();
   dconn_.reset();
 
+  release_splice_pipes();
+
 #ifdef ENABLE_HTTP3
   for (auto rcbuf : rcbufs3_) {
     nghttp3_rcbuf_decref(rcbuf);
@@ -244,6 +342,16 @@ Downstream::~Downstream() {
   if (LOG_ENABLED(INFO)) {
     DLOG(INFO, this) << "Deleted";
   }
+
+  if (pool_) {
+    pool_->recycle(std::move(rcbufs_));
+    // The pool hands out the vectors in LIFO order.  Recycle the
+    // response header fields first so that the next request takes
+    // the request header fields back.
+    pool_->recycle(std::move(resp_.fs.headers()));
+    pool_->recycle(std::move(req_.fs.headers()));
+    pool_->recycle(std::move(balloc_));
+  }
 }
 
 int Downstream::attach_downstream_connection(
@@ -254,6 +362,14 @@ int Downstream::attach_downstream_connection(
 
   dconn_ = std::move(dconn);
 
+  attached_group_ = dconn_->get_downstream_addr_group();
+  attached_addr_ = dconn_->get_addr();
+
+  if (timings_.backend_attach ==
+      std::chrono::high_resolution_clock::time_point{}) {
+    timings_.backend_attach = std::chrono::high_resolution_clock::now();
+  }
+
   return 0;
 }
 
@@ -644,6 +760,12 @@ void Downstream::set_stream_id(int64_t stream_id) { stream_id_ = stream_id; }
 int64_t Downstream::get_stream_id() const { return stream_id_; }
 
 void Downstream::set_request_state(DownstreamState state) {
+  if (state == DownstreamState::HEADER_COMPLETE &&
+      timings_.request_header_end ==
+        std::chrono::high_resolution_clock::time_point{}) {
+    timings_.request_header_end = std::chrono::high_resolution_clock::now();
+  }
+
   request_state_ = state;
 }
 
@@ -654,6 +776,10 @@ bool Downstream::get_chunked_request() const { return chunked_request_; }
 void Downstream::set_chunked_request(bool f) { chunked_request_ = f; }
 
 bool Downstream::request_buf_full() {
+  if (request_pipe_ && request_pipe_->full()) {
+    return true;
+  }
+
   auto handler = upstream_->get_client_handler();
   auto faddr = handler->get_upstream_addr();
   auto worker = handler->get_worker();
@@ -681,12 +807,265 @@ int Downstream::push_request_headers() {
     DLOG(INFO, this) << "dconn_ is NULL";
     return -1;
   }
-  return dconn_->push_request_headers();
+
+  if (dconn_->push_request_headers() != 0) {
+    return -1;
+  }
+
+  if (hedged_) {
+    return 0;
+  }
+
+  // Only idempotent requests without request body are hedged.
+  if (req_.method != HTTP_GET && req_.method != HTTP_HEAD) {
+    hedged_ = true;
+    return 0;
+  }
+
+  const auto &group = dconn_->get_downstream_addr_group();
+  if (!group) {
+    hedged_ = true;
+    return 0;
+  }
+
+  const auto &shared_addr = group->shared_addr;
+  if (shared_addr->hedge_delay == 0. || shared_addr->addrs.size() < 2 ||
+      shared_addr->affinity.type != SessionAffinity::NONE) {
+    hedged_ = true;
+    return 0;
+  }
+
+  auto delay = shared_addr->hedge_delay;
+
+  auto percentile = get_config()->conn.downstream->hedge_percentile;
+  if (percentile > 0.) {
+    auto us = shared_addr->hedge_latency->percentile(percentile);
+    delay = std::max(delay, static_cast<ev_tstamp>(us) / 1e6);
+  }
+
+  auto handler = upstream_->get_client_handler();
+
+  ev_timer_set(&hedge_timer_, delay, 0.);
+  ev_timer_start(handler->get_loop(), &hedge_timer_);
+
+  return 0;
+}
+
+int Downstream::hedge_request() {
+  hedged_ = true;
+
+  // Because the request has no body, and request_buf_ has been
+  // drained, request_buf_ only holds the hedged request from now on.
+  if (!dconn_ || !request_header_sent_ ||
+      request_state_ != DownstreamState::MSG_COMPLETE ||
+      response_state_ != DownstreamState::INITIAL ||
+      req_.recv_body_length != 0 || resp_.http_status != 0 ||
+      !resp_.fs.headers().empty() || request_buf_.rleft()) {
+    return 0;
+  }
+
+  auto handler = upstream_->get_client_handler();
+  auto addr = dconn_->get_addr();
+
+  std::unique_ptr<DownstreamConnection> dconn;
+
+  // The request is sent to the different backend address.  Try
+  // twice because the load balancer may choose the same address.
+  for (size_t i = 0; i < 2; ++i) {
+    int rv;
+    dconn = handler->get_downstream_connection(rv, this);
+    if (!dconn) {
+      return 0;
+    }
+
+    if (dconn->get_addr() != addr) {
+      break;
+    }
+
+    // Drop it instead of pooling because it has not been attached
+    // to this object, and might not be connected yet.
+    dconn.reset();
+  }
+
+  if (!dconn) {
+    return 0;
+  }
+
+  if (LOG_ENABLED(INFO)) {
+    DLOG(INFO, this) << "Hedge request to the other backend";
+  }
+
+  hedge_saved_timings_ = timings_;
+
+  if (dconn->attach_downstream(this) != 0) {
+    timings_ = hedge_saved_timings_;
+
+    return 0;
+  }
+
+  hedge_dconn_ = std::move(dconn);
+
+  // The backend connection takes the stream ID from
+  // downstream_stream_id_.  Switch it during the submission.
+  auto stream_id = std::exchange(downstream_stream_id_, -1);
+
+  auto rv = hedge_dconn_->push_request_headers();
+
+  hedge_stream_id_ = std::exchange(downstream_stream_id_, stream_id);
+
+  if (rv != 0 || request_pending_) {
+    // HTTP/2 backend session is not ready.  Hedged request is only
+    // sent through the established one.
+    request_pending_ = false;
+
+    cancel_hedge();
+  }
+
+  return 0;
+}
+
+DownstreamConnection *Downstream::get_hedge_connection() const {
+  return hedge_dconn_.get();
+}
+
+bool Downstream::settle_hedge(DownstreamConnection *dconn, bool responded) {
+  auto hedge = dconn == hedge_dconn_.get();
+
+  if (!dconn_ || response_state_ != DownstreamState::INITIAL) {
+    // The original request has been finished in the other way.
+    cancel_hedge();
+
+    return !hedge;
+  }
+
+  if (hedge == responded) {
+    commit_hedge();
+  } else {
+    cancel_hedge();
+  }
+
+  return responded;
+}
+
+void Downstream::commit_hedge() {
+  if (LOG_ENABLED(INFO)) {
+    DLOG(INFO, this) << "Hedged request won";
+  }
+
+  auto rtimer_active = ev_is_active(&downstream_rtimer_);
+
+  // The original request is abandoned because its backend is slower.
+  // Count it as a failure, and take the elapsed time as the latency
+  // although the actual one is longer.
+  if (attached_addr_) {
+    auto timings = hedge_saved_timings_;
+    timings.response_header_end = std::chrono::high_resolution_clock::now();
+
+    downstream_response_header_received(nullptr, attached_addr_, timings);
+    downstream_request_done(attached_addr_, true);
+  }
+
+  // Deleting the connection cancels the original request.  HTTP/2
+  // backend sends RST_STREAM, and HTTP/1 backend closes connection.
+  pop_downstream_connection();
+
+  dconn_ = std::move(hedge_dconn_);
+  downstream_stream_id_ = std::exchange(hedge_stream_id_, -1);
+
+  attached_group_ = dconn_->get_downstream_addr_group();
+  attached_addr_ = dconn_->get_addr();
+
+  if (rtimer_active) {
+    reset_downstream_rtimer();
+  }
+}
+
+void Downstream::cancel_hedge() {
+  if (!hedge_dconn_) {
+    return;
+  }
+
+  if (LOG_ENABLED(INFO)) {
+    DLOG(INFO, this) << "Cancel hedged request";
+  }
+
+  auto rtimer_active = ev_is_active(&downstream_rtimer_);
+
+  // Make HTTP/2 backend send RST_STREAM to the hedged stream.
+  std::swap(downstream_stream_id_, hedge_stream_id_);
+  hedge_dconn_.reset();
+  downstream_stream_id_ = std::exchange(hedge_stream_id_, -1);
+
+  // Discard the hedged request which HTTP/1 backend has not written
+  // yet.
+  request_buf_.reset();
+
+  timings_.backend_connect_start = hedge_saved_timings_.backend_connect_start;
+  timings_.backend_connect_end = hedge_saved_timings_.backend_connect_end;
+  timings_.backend_request_start = hedge_saved_timings_.backend_request_start;
+
+  if (rtimer_active) {
+    reset_downstream_rtimer();
+  }
 }
 
 int Downstream::push_upload_data_chunk(const uint8_t *data, size_t datalen) {
   req_.recv_body_length += datalen;
 
+  if (request_buffering()) {
+    auto handler = upstream_->get_client_handler();
+    auto worker = handler->get_worker();
+    auto &downstreamconf = *worker->get_downstream_config();
+
+    auto buffered = blocked_request_buf_.rleft();
+    if (request_spool_) {
+      buffered += request_spool_->rleft();
+    }
+
+    if (buffered + datalen > downstreamconf.buffer_request_max_body) {
+      if (LOG_ENABLED(INFO)) {
+        DLOG(INFO, this) << "Buffered request body is too large";
+      }
+
+      if (response_state_ != DownstreamState::MSG_COMPLETE) {
+        upstream_->on_downstream_abort_request(this, 413);
+      }
+
+      return -1;
+    }
+
+    // Upstream consumes it while the memory budget of the connection
+    // allows.
+    req_.unconsumed_body_length += datalen;
+
+    if (!request_spool_ && handler->get_buffered_request_memory() + datalen <=
+                             downstreamconf.buffer_request_memory) {
+      blocked_request_buf_.append(data, datalen);
+      set_request_buffer_memory(request_buffer_memory_ + datalen);
+
+      return 0;
+    }
+
+    if (!request_spool_) {
+      if (LOG_ENABLED(INFO)) {
+        DLOG(INFO, this) << "Start spooling request body";
+      }
+
+      request_spool_ = std::make_unique<ResponseSpool>(
+        blocked_request_buf_.pool, downstreamconf.response_spool.dir);
+    }
+
+    request_spool_->get_buf()->append(data, datalen);
+    request_spool_->flush();
+
+    // The data are kept in memory if they cannot be written to the
+    // temporary file.
+    set_request_buffer_memory(blocked_request_buf_.rleft() +
+                              request_spool_->rleft_memory());
+
+    return 0;
+  }
+
   if (!dconn_ && !request_header_sent_) {
     blocked_request_buf_.append(data, datalen);
     req_.unconsumed_body_length += datalen;
@@ -770,18 +1149,148 @@ DownstreamState Downstream::get_response_state() const {
 
 DefaultMemchunks *Downstream::get_response_buf() { return &response_buf_; }
 
+bool Downstream::response_spool_enabled() const {
+  return attached_group_ && attached_group_->shared_addr->spool_response &&
+         !upgraded_;
+}
+
+DefaultMemchunks *Downstream::get_response_body_buf() {
+  if (response_spool_ && response_spool_->rleft()) {
+    return response_spool_->get_buf();
+  }
+
+  if (!response_spool_enabled()) {
+    return &response_buf_;
+  }
+
+  auto handler = upstream_->get_client_handler();
+  auto worker = handler->get_worker();
+  auto &downstreamconf = *worker->get_downstream_config();
+
+  if (response_buf_.rleft() < downstreamconf.response_buffer_size) {
+    return &response_buf_;
+  }
+
+  if (!response_spool_) {
+    if (LOG_ENABLED(INFO)) {
+      DLOG(INFO, this) << "Start spooling response body";
+    }
+
+    response_spool_ = std::make_unique<ResponseSpool>(
+      response_buf_.pool, downstreamconf.response_spool.dir);
+  }
+
+  return response_spool_->get_buf();
+}
+
+int Downstream::refill_response_buf() {
+  if (!response_spooled()) {
+    return 0;
+  }
+
+  auto handler = upstream_->get_client_handler();
+  auto worker = handler->get_worker();
+  auto &downstreamconf = *worker->get_downstream_config();
+
+  if (response_buf_.rleft() >= downstreamconf.response_buffer_size) {
+    return 0;
+  }
+
+  if (response_spool_->remove(response_buf_,
+                              downstreamconf.response_buffer_size -
+                                response_buf_.rleft()) < 0) {
+    return -1;
+  }
+
+  return 0;
+}
+
+bool Downstream::response_spooled() const {
+  return response_spool_ && response_spool_->rleft();
+}
+
 bool Downstream::response_buf_full() {
+  if (response_pipe_ && response_pipe_->full()) {
+    return true;
+  }
+
   if (dconn_) {
     auto handler = upstream_->get_client_handler();
     auto worker = handler->get_worker();
     auto &downstreamconf = *worker->get_downstream_config();
 
+    if (response_spool_enabled()) {
+      if (!response_spool_) {
+        return false;
+      }
+
+      // The data are kept in memory if they cannot be written to the
+      // temporary file.
+      return response_spool_->rleft() >= downstreamconf.response_spool.max ||
+             response_spool_->rleft_memory() >=
+               downstreamconf.response_buffer_size;
+    }
+
     return response_buf_.rleft() >= downstreamconf.response_buffer_size;
   }
 
   return false;
 }
 
+int Downstream::create_splice_pipes() {
+  assert(!request_pipe_);
+  assert(!response_pipe_);
+
+  auto worker = upstream_->get_client_handler()->get_worker();
+  auto pool = worker->get_splice_pipe_pool();
+
+  auto rpipe = pool->get();
+  if (!rpipe) {
+    return -1;
+  }
+
+  auto wpipe = pool->get();
+  if (!wpipe) {
+    pool->recycle(std::move(rpipe));
+    return -1;
+  }
+
+  request_pipe_ = std::move(rpipe);
+  response_pipe_ = std::move(wpipe);
+  splice_pipe_pool_ = pool;
+
+  return 0;
+}
+
+int Downstream::create_response_pipe() {
+  assert(!response_pipe_);
+
+  auto worker = upstream_->get_client_handler()->get_worker();
+  auto pool = worker->get_splice_pipe_pool();
+
+  auto wpipe = pool->get();
+  if (!wpipe) {
+    return -1;
+  }
+
+  response_pipe_ = std::move(wpipe);
+  splice_pipe_pool_ = pool;
+
+  return 0;
+}
+
+void Downstream::release_splice_pipes() {
+  if (!splice_pipe_pool_) {
+    return;
+  }
+
+  if (request_pipe_) {
+    splice_pipe_pool_->recycle(std::move(request_pipe_));
+  }
+  splice_pipe_pool_->recycle(std::move(response_pipe_));
+  splice_pipe_pool_ = nullptr;
+}
+
 bool Downstream::validate_request_recv_body_length() const {
   if (req_.fs.content_length == -1) {
     return true;
@@ -980,28 +1489,52 @@ void Downstream::stop_header_timer() {
   ev_timer_stop(loop, &header_timer_);
 }
 
+// The stream timers are reset on every DATA frame.  In order to avoid
+// rescheduling them in libev on each reset, the timer which is
+// already running just records the time in |last|, and it is
+// rescheduled by timer_expired() when it fires.
 namespace {
-void reset_timer(struct ev_loop *loop, ev_timer *w) { ev_timer_again(loop, w); }
+void reset_timer(struct ev_loop *loop, ev_timer *w, ev_tstamp &last) {
+  last = ev_now(loop);
+  if (ev_is_active(w)) {
+    return;
+  }
+  ev_timer_again(loop, w);
+}
 } // namespace
 
 namespace {
-void try_reset_timer(struct ev_loop *loop, ev_timer *w) {
+void try_reset_timer(struct ev_loop *loop, ev_timer *w, ev_tstamp &last) {
   if (!ev_is_active(w)) {
     return;
   }
-  ev_timer_again(loop, w);
+  last = ev_now(loop);
 }
 } // namespace
 
 namespace {
-void ensure_timer(struct ev_loop *loop, ev_timer *w) {
+void ensure_timer(struct ev_loop *loop, ev_timer *w, ev_tstamp &last) {
   if (ev_is_active(w)) {
     return;
   }
+  last = ev_now(loop);
   ev_timer_again(loop, w);
 }
 } // namespace
 
+namespace {
+bool timer_expired(struct ev_loop *loop, ev_timer *w, ev_tstamp last) {
+  auto delta = last + w->repeat - ev_now(loop);
+  if (delta < 1e-9) {
+    return true;
+  }
+  ev_timer_stop(loop, w);
+  ev_timer_set(w, delta, w->repeat);
+  ev_timer_start(loop, w);
+  return false;
+}
+} // namespace
+
 namespace {
 void disable_timer(struct ev_loop *loop, ev_timer *w) {
   ev_timer_stop(loop, w);
@@ -1013,7 +1546,7 @@ void Downstream::reset_upstream_rtimer() {
     return;
   }
   auto loop = upstream_->get_client_handler()->get_loop();
-  reset_timer(loop, &upstream_rtimer_);
+  reset_timer(loop, &upstream_rtimer_, upstream_rtimer_last_);
 }
 
 void Downstream::reset_upstream_wtimer() {
@@ -1021,10 +1554,10 @@ void Downstream::reset_upstream_wtimer() {
   auto &timeoutconf = get_config()->http2.timeout;
 
   if (timeoutconf.stream_write != 0.) {
-    reset_timer(loop, &upstream_wtimer_);
+    reset_timer(loop, &upstream_wtimer_, upstream_wtimer_last_);
   }
   if (timeoutconf.stream_read != 0.) {
-    try_reset_timer(loop, &upstream_rtimer_);
+    try_reset_timer(loop, &upstream_rtimer_, upstream_rtimer_last_);
   }
 }
 
@@ -1033,7 +1566,7 @@ void Downstream::ensure_upstream_wtimer() {
     return;
   }
   auto loop = upstream_->get_client_handler()->get_loop();
-  ensure_timer(loop, &upstream_wtimer_);
+  ensure_timer(loop, &upstream_wtimer_, upstream_wtimer_last_);
 }
 
 void Downstream::disable_upstream_rtimer() {
@@ -1057,7 +1590,7 @@ void Downstream::reset_downstream_rtimer() {
     return;
   }
   auto loop = upstream_->get_client_handler()->get_loop();
-  reset_timer(loop, &downstream_rtimer_);
+  reset_timer(loop, &downstream_rtimer_, downstream_rtimer_last_);
 }
 
 void Downstream::reset_downstream_wtimer() {
@@ -1065,10 +1598,10 @@ void Downstream::reset_downstream_wtimer() {
   auto &timeoutconf = get_config()->http2.timeout;
 
   if (timeoutconf.stream_write != 0.) {
-    reset_timer(loop, &downstream_wtimer_);
+    reset_timer(loop, &downstream_wtimer_, downstream_wtimer_last_);
   }
   if (timeoutconf.stream_read != 0.) {
-    try_reset_timer(loop, &downstream_rtimer_);
+    try_reset_timer(loop, &downstream_rtimer_, downstream_rtimer_last_);
   }
 }
 
@@ -1077,7 +1610,7 @@ void Downstream::ensure_downstream_wtimer() {
     return;
   }
   auto loop = upstream_->get_client_handler()->get_loop();
-  ensure_timer(loop, &downstream_wtimer_);
+  ensure_timer(loop, &downstream_wtimer_, downstream_wtimer_last_);
 }
 
 void Downstream::disable_downstream_rtimer() {
@@ -1096,10 +1629,33 @@ void Downstream::disable_downstream_wtimer() {
   disable_timer(loop, &downstream_wtimer_);
 }
 
+bool Downstream::stream_timer_expired(ev_timer *w) {
+  auto loop = upstream_->get_client_handler()->get_loop();
+
+  if (w == &upstream_rtimer_) {
+    return timer_expired(loop, w, upstream_rtimer_last_);
+  }
+  if (w == &upstream_wtimer_) {
+    return timer_expired(loop, w, upstream_wtimer_last_);
+  }
+  if (w == &downstream_rtimer_) {
+    return timer_expired(loop, w, downstream_rtimer_last_);
+  }
+  if (w == &downstream_wtimer_) {
+    return timer_expired(loop, w, downstream_wtimer_last_);
+  }
+
+  return true;
+}
+
 bool Downstream::accesslog_ready() const {
   return !accesslog_written_ && resp_.http_status > 0;
 }
 
+bool Downstream::metrics_ready() const {
+  return !metrics_recorded_ && resp_.http_status > 0;
+}
+
 void Downstream::add_retry() { ++num_retry_; }
 
 bool Downstream::no_more_retry() const { return num_retry_ > 50; }
@@ -1134,11 +1690,38 @@ void Downstream::attach_blocked_link(BlockedLink *l) {
 
   l->downstream = this;
   blocked_link_ = l;
+
+  // check nullptr for unittest
+  if (upstream_) {
+    auto metrics = upstream_->get_client_handler()->get_worker()->get_metrics();
+    metrics->streams_blocked.inc();
+  }
+}
+
+void Downstream::attach_fair_queue_entry(FairQueue::Entry *ent) {
+  assert(!fair_queue_entry_);
+
+  ent->downstream = this;
+  fair_queue_entry_ = ent;
+}
+
+FairQueue::Entry *Downstream::detach_fair_queue_entry() {
+  return std::exchange(fair_queue_entry_, nullptr);
+}
+
+const FairQueue::Entry *Downstream::get_fair_queue_entry() const {
+  return fair_queue_entry_;
 }
 
 BlockedLink *Downstream::detach_blocked_link() {
   auto link = blocked_link_;
   blocked_link_ = nullptr;
+
+  if (link && upstream_) {
+    auto metrics = upstream_->get_client_handler()->get_worker()->get_metrics();
+    metrics->streams_blocked.dec();
+  }
+
   return link;
 }
 
@@ -1164,12 +1747,21 @@ int64_t Downstream::get_assoc_stream_id() const { return assoc_stream_id_; }
 BlockAllocator &Downstream::get_block_allocator() { return balloc_; }
 
 void Downstream::add_rcbuf(nghttp2_rcbuf *rcbuf) {
+  // The header field names in HPACK static table are static.
+  if (nghttp2_rcbuf_is_static(rcbuf)) {
+    return;
+  }
+
   nghttp2_rcbuf_incref(rcbuf);
   rcbufs_.push_back(rcbuf);
 }
 
 #ifdef ENABLE_HTTP3
 void Downstream::add_rcbuf(nghttp3_rcbuf *rcbuf) {
+  if (nghttp3_rcbuf_is_static(rcbuf)) {
+    return;
+  }
+
   nghttp3_rcbuf_incref(rcbuf);
   rcbufs3_.push_back(rcbuf);
 }
@@ -1184,8 +1776,19 @@ void Downstream::set_addr(const DownstreamAddr *addr) { addr_ = addr; }
 
 const DownstreamAddr *Downstream::get_addr() const { return addr_; }
 
+DownstreamAddr *Downstream::get_attached_addr() const {
+  return attached_addr_;
+}
+
+const std::shared_ptr<DownstreamAddrGroup> &
+Downstream::get_downstream_addr_group() const {
+  return group_;
+}
+
 void Downstream::set_accesslog_written(bool f) { accesslog_written_ = f; }
 
+void Downstream::set_metrics_recorded(bool f) { metrics_recorded_ = f; }
+
 void Downstream::renew_affinity_cookie(uint32_t h) {
   affinity_cookie_ = h;
   new_affinity_cookie_ = true;
@@ -1210,6 +1813,87 @@ void Downstream::set_blocked_request_data_eof(bool f) {
   blocked_request_data_eof_ = f;
 }
 
+void Downstream::set_buffer_request(bool f) { buffer_request_ = f; }
+
+bool Downstream::get_buffer_request() const { return buffer_request_; }
+
+bool Downstream::request_buffering() const {
+  return buffer_request_ && !dconn_ && !request_header_sent_;
+}
+
+void Downstream::end_request_buffering() {
+  // The buffered request body is now sent to a backend under the
+  // usual flow control.
+  set_request_buffer_memory(0);
+
+  if (req_.fs.content_length != -1) {
+    return;
+  }
+
+  req_.fs.erase_content_length_and_transfer_encoding();
+  req_.fs.add_header_token(
+    "content-length"sv,
+    util::make_string_ref_uint(balloc_,
+                               static_cast<uint64_t>(req_.recv_body_length)),
+    false, http2::HD_CONTENT_LENGTH);
+  req_.fs.content_length = req_.recv_body_length;
+
+  chunked_request_ = false;
+}
+
+int Downstream::refill_request_buf() {
+  if (!request_spooled() || !dconn_ || !request_header_sent_) {
+    return 0;
+  }
+
+  auto handler = upstream_->get_client_handler();
+  auto worker = handler->get_worker();
+  auto &downstreamconf = *worker->get_downstream_config();
+
+  if (request_buf_.rleft() >= downstreamconf.request_buffer_size) {
+    return 0;
+  }
+
+  DefaultMemchunks buf(request_buf_.pool);
+
+  if (request_spool_->remove(buf, downstreamconf.request_buffer_size -
+                                    request_buf_.rleft()) < 0) {
+    return -1;
+  }
+
+  for (;;) {
+    std::array<iovec, 1> iov{};
+
+    if (buf.riovec(iov.data(), iov.size()) == 0) {
+      return 0;
+    }
+
+    if (dconn_->push_upload_data_chunk(
+          static_cast<const uint8_t *>(iov[0].iov_base), iov[0].iov_len) !=
+        0) {
+      return -1;
+    }
+
+    buf.drain(iov[0].iov_len);
+  }
+}
+
+bool Downstream::request_spooled() const {
+  return request_spool_ && request_spool_->rleft();
+}
+
+void Downstream::set_request_buffer_memory(size_t n) {
+  if (request_buffer_memory_ == n) {
+    return;
+  }
+
+  auto handler = upstream_->get_client_handler();
+
+  handler->set_buffered_request_memory(handler->get_buffered_request_memory() -
+                                       request_buffer_memory_ + n);
+  request_buffer_memory_ = n;
+}
+
 void Downstream::set_ws_key(const std::string_view &key) { ws_key_ = key; }
 
 bool Downstream::get_expect_100_continue() const {
@@ -46,6 +46,9 @@
 
 #include "shrpx_io_control.h"
 #include "shrpx_log_config.h"
+#include "shrpx_fair_queue.h"
+#include "shrpx_response_spool.h"
+#include "shrpx_downstream_pool.h"
 #include "http2.h"
 #include "memchunk.h"
 #include "allocator.h"
@@ -59,6 +62,8 @@ class DownstreamConnection;
 struct BlockedLink;
 struct DownstreamAddrGroup;
 struct DownstreamAddr;
+struct SplicePipe;
+class SplicePipePool;
 
 class FieldStore {
 public:
@@ -70,6 +75,14 @@ public:
       trailer_key_prev_(false) {
     headers_.reserve(headers_initial_capacity);
   }
+  // |headers| is an empty vector, which may have capacity already.
+  FieldStore(BlockAllocator &balloc, HeaderRefs headers)
+    : content_length(-1),
+      balloc_(balloc),
+      headers_(std::move(headers)),
+      buffer_size_(0),
+      header_key_prev_(false),
+      trailer_key_prev_(false) {}
 
   const HeaderRefs &headers() const { return headers_; }
   const HeaderRefs &trailers() const { return trailers_; }
@@ -154,8 +167,8 @@ enum class ConnectProto {
 };
 
 struct Request {
-  Request(BlockAllocator &balloc)
-    : fs(balloc, 16),
+  Request(BlockAllocator &balloc, HeaderRefs headers)
+    : fs(balloc, std::move(headers)),
       recv_body_length(0),
       unconsumed_body_length(0),
       method(-1),
@@ -236,8 +249,8 @@ struct Request {
 };
 
 struct Response {
-  Response(BlockAllocator &balloc)
-    : fs(balloc, 32),
+  Response(BlockAllocator &balloc, HeaderRefs headers)
+    : fs(balloc, std::move(headers)),
       recv_body_length(0),
       unconsumed_body_length(0),
       http_status(0),
@@ -327,6 +340,26 @@ enum class DispatchState {
   FAILURE,
 };
 
+// Timestamps of the phases a request goes through.  They are used to
+// break down $request_time in access log.  A default constructed
+// time_point means that the request has not reached that phase.
+struct DownstreamTimings {
+  // The time when request header fields have been received.
+  std::chrono::high_resolution_clock::time_point request_header_end;
+  // The time when a backend connection was first attached.
+  std::chrono::high_resolution_clock::time_point backend_attach;
+  // The time when connecting to backend started, and when it
+  // finished (including TLS handshake).  They are only set if a new
+  // backend connection was made for this request.
+  std::chrono::high_resolution_clock::time_point backend_connect_start;
+  std::chrono::high_resolution_clock::time_point backend_connect_end;
+  // The time when request header fields were sent to backend.
+  std::chrono::high_resolution_clock::time_point backend_request_start;
+  // The time when response header fields have been received from
+  // backend.
+  std::chrono::high_resolution_clock::time_point response_header_end;
+};
+
 class Downstream {
 public:
   Downstream(Upstream *upstream, MemchunkPool *mcpool, int64_t stream_id);
@@ -389,6 +422,8 @@ public:
   set_request_start_time(std::chrono::high_resolution_clock::time_point time);
   const std::chrono::high_resolution_clock::time_point &
   get_request_start_time() const;
+  const DownstreamTimings &timings() const { return timings_; }
+  DownstreamTimings &timings() { return timings_; }
   int push_request_headers();
   bool get_chunked_request() const;
   void set_chunked_request(bool f);
@@ -417,6 +452,27 @@ public:
   bool get_blocked_request_data_eof() const;
   void set_blocked_request_data_eof(bool f);
 
+  // Makes this request buffer its entire request body before a
+  // backend is selected.  The buffered body is counted in
+  // Request::unconsumed_body_length, and upstream should consume it
+  // unless ClientHandler::buffered_request_memory_exceeded() returns
+  // true.
+  void set_buffer_request(bool f);
+  bool get_buffer_request() const;
+  // Returns true if the request body is being buffered.
+  bool request_buffering() const;
+  // Called when the entire request body has been buffered.  It sets
+  // content-length to the buffered length if it is not known.
+  void end_request_buffering();
+  // Sends the request body spooled by buffer-request parameter to the
+  // backend connection.  Upstream must call this function when the
+  // backend connection drains the request buffer.  It returns 0 if it
+  // succeeds, or -1.
+  int refill_request_buf();
+  // Returns true if there is spooled request body which has not been
+  // sent to the backend connection.
+  bool request_spooled() const;
+
   // downstream response API
   const Response &response() const { return resp_; }
   Response &response() { return resp_; }
@@ -431,7 +487,34 @@ public:
   void set_response_state(DownstreamState state);
   DownstreamState get_response_state() const;
   DefaultMemchunks *get_response_buf();
+  // Returns true if the response body which overflows the response
+  // buffer is spooled by spool-response parameter.
+  bool response_spool_enabled() const;
+  // Returns the buffer to append response body and trailer fields.
+  // It is the response buffer unless the response body overflows it
+  // and is spooled by spool-response parameter.
+  DefaultMemchunks *get_response_body_buf();
+  // Moves the spooled response body to the response buffer.
+  // Upstream must call this function after it drains the response
+  // buffer.  It returns 0 if it succeeds, or -1.
+  int refill_response_buf();
+  // Returns true if there is spooled response body which has not
+  // been moved to the response buffer.
+  bool response_spooled() const;
   bool response_buf_full();
+  // Creates the pipes to relay the tunneled data with splice(2).  The
+  // data in request and response buffer must be sent before the data
+  // in the pipes.  This function returns 0 if it succeeds, or -1.
+  int create_splice_pipes();
+  // Creates only the pipe to relay the response body with splice(2).
+  // This function returns 0 if it succeeds, or -1.
+  int create_response_pipe();
+  // Returns the pipes to the worker.
+  void release_splice_pipes();
+  // Returns the pipe to relay request (response) data.  It returns
+  // nullptr unless the pipe has been created.
+  SplicePipe *get_request_pipe() const { return request_pipe_.get(); }
+  SplicePipe *get_response_pipe() const { return response_pipe_.get(); }
   // Validates that received response body length and content-length
   // matches.
   bool validate_response_recv_body_length() const;
@@ -479,9 +562,37 @@ public:
   void ensure_downstream_wtimer();
   void disable_downstream_rtimer();
   void disable_downstream_wtimer();
+  // Returns true if the stream timer |w| has expired.  Because the
+  // stream timers are reset lazily, |w| may fire before the actual
+  // timeout.  In that case, this function reschedules |w| for the
+  // remaining time, and returns false.
+  bool stream_timer_expired(ev_timer *w);
 
   // Returns true if accesslog can be written for this downstream.
   bool accesslog_ready() const;
+  // Returns true if the metrics of this downstream can be recorded.
+  // Unlike accesslog_ready(), it is not affected by early access log
+  // writing.
+  bool metrics_ready() const;
+
+  // Sends the same request to the other backend address if no
+  // response has been received yet.  The original request is kept in
+  // flight, and both race for the response.  This is called when the
+  // hedge timer expires.  This function returns 0 if it succeeds, or
+  // -1.
+  int hedge_request();
+  // Returns the downstream connection which the hedged request is
+  // sent through, or nullptr if no hedged request is in flight.
+  DownstreamConnection *get_hedge_connection() const;
+  // Settles the race between the original and the hedged requests.
+  // |dconn| is either of them.  If |responded| is true, |dconn| has
+  // started receiving a response, and the other request is canceled.
+  // Otherwise, |dconn| has failed, and it is canceled in favor of the
+  // other.  This function returns true if |dconn| is still alive, and
+  // it is now the downstream connection of this object.
+  bool settle_hedge(DownstreamConnection *dconn, bool responded);
+  // Cancels the hedged request if it is in flight.
+  void cancel_hedge();
 
   // Increment retry count
   void add_retry();
@@ -494,6 +605,10 @@ public:
   void attach_blocked_link(BlockedLink *l);
   BlockedLink *detach_blocked_link();
 
+  void attach_fair_queue_entry(FairQueue::Entry *ent);
+  FairQueue::Entry *detach_fair_queue_entry();
+  const FairQueue::Entry *get_fair_queue_entry() const;
+
   // Returns true if downstream_connection can be detached and reused.
   bool can_detach_downstream_connection() const;
 
@@ -501,6 +616,9 @@ public:
 
   BlockAllocator &get_block_allocator();
 
+  // Keeps a reference to |rcbuf| until this object is destroyed, so
+  // that header fields can point to its buffer without copying it.
+  // Static buffers, which are always valid, are not kept.
   void add_rcbuf(nghttp2_rcbuf *rcbuf);
 #ifdef ENABLE_HTTP3
   void add_rcbuf(nghttp3_rcbuf *rcbuf);
@@ -511,8 +629,18 @@ public:
   void set_addr(const DownstreamAddr *addr);
 
   const DownstreamAddr *get_addr() const;
+  const std::shared_ptr<DownstreamAddrGroup> &
+  get_downstream_addr_group() const;
+
+  // Returns the backend address which the last attached downstream
+  // connection connects to.  Unlike get_addr(), it is available even
+  // if no response header has been received from the backend.  It
+  // returns nullptr if no downstream connection has been attached,
+  // or the connection does not have a backend address.
+  DownstreamAddr *get_attached_addr() const;
 
   void set_accesslog_written(bool f);
+  void set_metrics_recorded(bool f);
 
   // Finds affinity cookie from request header fields.  The name of
   // cookie is given in |name|.  If an affinity cookie is found, it is
@@ -544,6 +672,17 @@ public:
   int64_t response_sent_body_length;
 
 private:
+  // Sets the number of bytes of the buffered request body kept in
+  // memory, and updates the total of the frontend connection.
+  void set_request_buffer_memory(size_t n);
+  // Makes the hedged request the one which this object uses, and
+  // cancels the original request.
+  void commit_hedge();
+
+  // The pool which this object takes its memory from, and returns it
+  // to on destruction.  This is nullptr for unittests.
+  DownstreamPool *pool_;
+
   BlockAllocator balloc_;
 
   std::vector<nghttp2_rcbuf *> rcbufs_;
@@ -555,6 +694,7 @@ private:
   Response resp_;
 
   std::chrono::high_resolution_clock::time_point request_start_time_;
+  DownstreamTimings timings_;
 
   // host we requested to downstream.  This is used to rewrite
   // location header field to decide the location should be rewritten
@@ -566,6 +706,18 @@ private:
   DefaultMemchunks blocked_request_buf_;
   DefaultMemchunks request_buf_;
   DefaultMemchunks response_buf_;
+  // The response body which overflows response_buf_.  It is created
+  // only if spool-response parameter is specified.
+  std::unique_ptr<ResponseSpool> response_spool_;
+  // The request body buffered by buffer-request parameter which does
+  // not fit in the memory budget of the frontend connection.
+  std::unique_ptr<ResponseSpool> request_spool_;
+  // The pipes to relay the tunneled data with splice(2).  Only
+  // response_pipe_ is created to relay the response body.
+  std::unique_ptr<SplicePipe> request_pipe_;
+  std::unique_ptr<SplicePipe> response_pipe_;
+  // The pool which request_pipe_ and response_pipe_ are taken from.
+  SplicePipePool *splice_pipe_pool_;
 
   // The Sec-WebSocket-Key field sent to the peer.  This field is used
   // if frontend uses RFC 8441 WebSocket bootstrapping via HTTP/2.
@@ -579,17 +731,39 @@ private:
   ev_timer downstream_rtimer_;
   ev_timer downstream_wtimer_;
 
+  // The time when the stream timers above are last reset.
+  ev_tstamp upstream_rtimer_last_;
+  ev_tstamp upstream_wtimer_last_;
+  ev_tstamp downstream_rtimer_last_;
+  ev_tstamp downstream_wtimer_last_;
+
+  ev_timer hedge_timer_;
+
   Upstream *upstream_;
   std::unique_ptr<DownstreamConnection> dconn_;
+  // The downstream connection which the hedged request is sent
+  // through while it races with dconn_.
+  std::unique_ptr<DownstreamConnection> hedge_dconn_;
+  // The backend timings of the original request saved when the hedged
+  // request is sent because both requests share timings_.
+  DownstreamTimings hedge_saved_timings_;
 
   // only used by HTTP/2 upstream
   BlockedLink *blocked_link_;
+  // The slot of FairQueue which this object holds, or waits for.
+  FairQueue::Entry *fair_queue_entry_;
   // The backend address used to fulfill this request.  These are for
   // logging purpose.
   std::shared_ptr<DownstreamAddrGroup> group_;
   const DownstreamAddr *addr_;
+  // The backend address which the last attached downstream
+  // connection connects to.  attached_group_ keeps it alive.
+  std::shared_ptr<DownstreamAddrGroup> attached_group_;
+  DownstreamAddr *attached_addr_;
   // How many times we tried in backend connection
   size_t num_retry_;
+  // The number of bytes of the buffered request body kept in memory.
+  size_t request_buffer_memory_;
   // The stream ID in frontend connection
   int64_t stream_id_;
   // The associated stream ID in frontend connection if this is pushed
@@ -597,6 +771,8 @@ private:
   int64_t assoc_stream_id_;
   // stream ID in backend connection
   int64_t downstream_stream_id_;
+  // stream ID of the hedged request in backend connection
+  int64_t hedge_stream_id_;
   // RST_STREAM error_code from downstream HTTP2 connection
   uint32_t response_rst_stream_error_code_;
   // An affinity cookie value.
@@ -624,6 +800,8 @@ private:
   bool request_header_sent_;
   // true if access.log has been written.
   bool accesslog_written_;
+  // true if the metrics of this downstream have been recorded.
+  bool metrics_recorded_;
   // true if affinity cookie is generated for this request.
   bool new_affinity_cookie_;
   // true if eof is received from client before sending header fields
@@ -632,6 +810,12 @@ private:
   // true if request contains "expect: 100-continue" header field.
   bool expect_100_continue_;
   bool stop_reading_;
+  // true if the request has been hedged, or it is not eligible for
+  // hedged request.
+  bool hedged_;
+  // true if the request body is buffered entirely before a backend is
+  // selected.
+  bool buffer_request_;
 };
 
 } // namespace shrpx
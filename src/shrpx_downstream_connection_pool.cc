@@ -37,6 +37,12 @@ void DownstreamConnectionPool::remove_all() {
   }
 
   pool_.clear();
+
+  for (auto dconn : prewarming_) {
+    delete dconn;
+  }
+
+  prewarming_.clear();
 }
 
 void DownstreamConnectionPool::add_downstream_connection(
@@ -59,8 +65,24 @@ DownstreamConnectionPool::pop_downstream_connection() {
 
 void DownstreamConnectionPool::remove_downstream_connection(
   DownstreamConnection *dconn) {
-  pool_.erase(dconn);
+  if (pool_.erase(dconn) == 0) {
+    prewarming_.erase(dconn);
+  }
   delete dconn;
 }
 
+void DownstreamConnectionPool::add_prewarming_downstream_connection(
+  std::unique_ptr<DownstreamConnection> dconn) {
+  prewarming_.insert(dconn.release());
+}
+
+void DownstreamConnectionPool::on_prewarmed(DownstreamConnection *dconn) {
+  prewarming_.erase(dconn);
+  pool_.insert(dconn);
+}
+
+size_t DownstreamConnectionPool::size() const {
+  return pool_.size() + prewarming_.size();
+}
+
 } // namespace shrpx
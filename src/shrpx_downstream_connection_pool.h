@@ -43,9 +43,21 @@ public:
   std::unique_ptr<DownstreamConnection> pop_downstream_connection();
   void remove_downstream_connection(DownstreamConnection *dconn);
   void remove_all();
+  // Adds |dconn| which is establishing a connection in advance.  It
+  // is not returned by pop_downstream_connection() until
+  // on_prewarmed() is called.
+  void add_prewarming_downstream_connection(
+    std::unique_ptr<DownstreamConnection> dconn);
+  // Makes |dconn| added by add_prewarming_downstream_connection()
+  // available.
+  void on_prewarmed(DownstreamConnection *dconn);
+  // Returns the number of connections including the ones which are
+  // being established.
+  size_t size() const;
 
 private:
   std::unordered_set<DownstreamConnection *> pool_;
+  std::unordered_set<DownstreamConnection *> prewarming_;
 };
 
 } // namespace shrpx
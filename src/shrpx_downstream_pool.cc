@@ -0,0 +1,106 @@
+/*
+ * nghttp2 - HTTP/2 C Library
+ *
+ * Copyright (c) 2026 Tatsuhiro Tsujikawa
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+ * LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include "shrpx_downstream_pool.h"
+
+namespace shrpx {
+
+namespace {
+// The vector which has grown larger than this number of elements is
+// not kept in the pool.
+constexpr size_t DOWNSTREAM_POOL_MAX_CAPACITY = 128;
+} // namespace
+
+namespace {
+// Returns the vector in |pool| which has capacity for at least
+// |capacity| elements, or a new vector if there is no such vector.
+template <typename T>
+std::vector<T> get_vector(std::vector<std::vector<T>> &pool,
+                          size_t capacity) {
+  if (!pool.empty() && pool.back().capacity() >= capacity) {
+    auto v = std::move(pool.back());
+    pool.pop_back();
+    return v;
+  }
+
+  std::vector<T> v;
+  v.reserve(capacity);
+
+  return v;
+}
+} // namespace
+
+namespace {
+template <typename T>
+void recycle_vector(std::vector<std::vector<T>> &pool, std::vector<T> v) {
+  if (pool.size() >= DOWNSTREAM_POOL_MAX || v.capacity() == 0 ||
+      v.capacity() > DOWNSTREAM_POOL_MAX_CAPACITY) {
+    return;
+  }
+
+  v.clear();
+
+  pool.push_back(std::move(v));
+}
+} // namespace
+
+BlockAllocator DownstreamPool::get_block_allocator() {
+  if (ballocs_.empty()) {
+    return BlockAllocator(DOWNSTREAM_BALLOC_BLOCK_SIZE,
+                          DOWNSTREAM_BALLOC_BLOCK_SIZE);
+  }
+
+  auto balloc = std::move(ballocs_.back());
+  ballocs_.pop_back();
+
+  return balloc;
+}
+
+void DownstreamPool::recycle(BlockAllocator balloc) {
+  if (ballocs_.size() >= DOWNSTREAM_POOL_MAX) {
+    return;
+  }
+
+  balloc.reuse();
+
+  ballocs_.push_back(std::move(balloc));
+}
+
+HeaderRefs DownstreamPool::get_headers(size_t capacity) {
+  return get_vector(headers_, capacity);
+}
+
+void DownstreamPool::recycle(HeaderRefs headers) {
+  recycle_vector(headers_, std::move(headers));
+}
+
+std::vector<nghttp2_rcbuf *> DownstreamPool::get_rcbufs(size_t capacity) {
+  return get_vector(rcbufs_, capacity);
+}
+
+void DownstreamPool::recycle(std::vector<nghttp2_rcbuf *> rcbufs) {
+  recycle_vector(rcbufs_, std::move(rcbufs));
+}
+
+} // namespace shrpx
@@ -0,0 +1,77 @@
+/*
+ * nghttp2 - HTTP/2 C Library
+ *
+ * Copyright (c) 2026 Tatsuhiro Tsujikawa
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+ * LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#ifndef SHRPX_DOWNSTREAM_POOL_H
+#define SHRPX_DOWNSTREAM_POOL_H
+
+#include "shrpx.h"
+
+#include <vector>
+
+#include <nghttp2/nghttp2.h>
+
+#include "http2.h"
+#include "allocator.h"
+
+using namespace nghttp2;
+
+namespace shrpx {
+
+// The maximum number of objects of each kind kept in DownstreamPool.
+constexpr size_t DOWNSTREAM_POOL_MAX = 256;
+// The block size of BlockAllocator of Downstream.
+constexpr size_t DOWNSTREAM_BALLOC_BLOCK_SIZE = 1024;
+
+// DownstreamPool keeps the memory which finished Downstream objects
+// used, so that a new Downstream can take it without allocating
+// again: BlockAllocator with its first memory block, and the capacity
+// of the vectors.  This object is owned by a worker, and is not
+// thread-safe.
+class DownstreamPool {
+public:
+  // Returns BlockAllocator which is ready for use.  It may have the
+  // memory block already.
+  BlockAllocator get_block_allocator();
+  void recycle(BlockAllocator balloc);
+  // Returns an empty HeaderRefs which has capacity for at least
+  // |capacity| header fields.
+  HeaderRefs get_headers(size_t capacity);
+  void recycle(HeaderRefs headers);
+  // Returns an empty vector of nghttp2_rcbuf which has capacity for
+  // at least |capacity| objects.
+  std::vector<nghttp2_rcbuf *> get_rcbufs(size_t capacity);
+  void recycle(std::vector<nghttp2_rcbuf *> rcbufs);
+
+  size_t get_num_ballocs() const { return ballocs_.size(); }
+  size_t get_num_headers() const { return headers_.size(); }
+
+private:
+  std::vector<BlockAllocator> ballocs_;
+  std::vector<HeaderRefs> headers_;
+  std::vector<std::vector<nghttp2_rcbuf *>> rcbufs_;
+};
+
+} // namespace shrpx
+
+#endif // SHRPX_DOWNSTREAM_POOL_H
@@ -25,6 +25,8 @@
 #include "shrpx_downstream_queue.h"
 
 #include <cassert>
+#include <cmath>
+#include <algorithm>
 #include <limits>
 
 #include "shrpx_downstream.h"
@@ -32,19 +34,33 @@
 namespace shrpx {
 
 DownstreamQueue::HostEntry::HostEntry(ImmutableString &&key)
-  : key(std::move(key)), num_active(0) {}
+  : key(std::move(key)),
+    num_active(0),
+    first_above_time(0.),
+    drop_next(0.),
+    drop_count(0),
+    last_drop_count(0),
+    dropping(false) {}
 
-DownstreamQueue::DownstreamQueue(size_t conn_max_per_host, bool unified_host)
-  : conn_max_per_host_(conn_max_per_host == 0
+DownstreamQueue::DownstreamQueue(size_t conn_max_per_host, bool unified_host,
+                                 struct ev_loop *loop, ev_tstamp delay_target,
+                                 ev_tstamp delay_interval)
+  : loop_(loop),
+    delay_target_(delay_target),
+    delay_interval_(delay_interval),
+    conn_max_per_host_(conn_max_per_host == 0
                          ? std::numeric_limits<size_t>::max()
                          : conn_max_per_host),
     unified_host_(unified_host) {}
 
 DownstreamQueue::~DownstreamQueue() {
+  dlist_delete_all(shed_);
   dlist_delete_all(downstreams_);
   for (auto &p : host_entries_) {
     auto &ent = p.second;
-    dlist_delete_all(ent.blocked);
+    for (auto &blocked : ent.blocked) {
+      dlist_delete_all(blocked);
+    }
   }
 }
 
@@ -85,14 +101,22 @@ void DownstreamQueue::mark_active(Downstream *downstream) {
   downstream->set_dispatch_state(DispatchState::ACTIVE);
 }
 
-void DownstreamQueue::mark_blocked(Downstream *downstream) {
+void DownstreamQueue::mark_blocked(Downstream *downstream, uint32_t urgency) {
   auto &ent = find_host_entry(make_host_key(downstream));
 
   downstream->set_dispatch_state(DispatchState::BLOCKED);
 
-  auto link = new BlockedLink{};
+  urgency =
+    std::min(urgency, static_cast<uint32_t>(NGHTTP2_EXTPRI_URGENCY_LOW));
+
+  auto link = new BlockedLink{
+    .urgency = urgency,
+  };
+  if (loop_) {
+    link->blocked_time = ev_now(loop_);
+  }
   downstream->attach_blocked_link(link);
-  ent.blocked.append(link);
+  ent.blocked[urgency].append(link);
 }
 
 bool DownstreamQueue::can_activate(const std::string_view &host) const {
@@ -104,11 +128,25 @@ bool DownstreamQueue::can_activate(const std::string_view &host) const {
   return ent.num_active < conn_max_per_host_;
 }
 
+namespace {
+// Returns the blocked link which should be dispatched next, or
+// nullptr if there is no blocked link in |ent|.
+BlockedLink *get_next_blocked(const DownstreamQueue::HostEntry &ent) {
+  for (auto &blocked : ent.blocked) {
+    if (blocked.head) {
+      return blocked.head;
+    }
+  }
+
+  return nullptr;
+}
+} // namespace
+
 namespace {
 bool remove_host_entry_if_empty(const DownstreamQueue::HostEntry &ent,
                                 DownstreamQueue::HostEntryMap &host_entries,
                                 const std::string_view &host) {
-  if (ent.blocked.empty() && ent.num_active == 0) {
+  if (ent.num_active == 0 && !get_next_blocked(ent)) {
     host_entries.erase(host);
     return true;
   }
@@ -132,7 +170,13 @@ Downstream *DownstreamQueue::remove_and_get_blocked(Downstream *downstream,
     // For those downstreams deleted while in blocked state
     auto link = downstream->detach_blocked_link();
     if (link) {
-      ent.blocked.remove(link);
+      // The Downstream object which is shed, but has not been
+      // retrieved by pop_shed() is in DispatchState::FAILURE.
+      if (downstream->get_dispatch_state() == DispatchState::FAILURE) {
+        shed_.remove(link);
+      } else {
+        ent.blocked[link->urgency].remove(link);
+      }
       delete link;
     }
   }
@@ -145,26 +189,125 @@ Downstream *DownstreamQueue::remove_and_get_blocked(Downstream *downstream,
     return nullptr;
   }
 
-  auto link = ent.blocked.head;
+  for (;;) {
+    auto link = get_next_blocked(ent);
+
+    if (!link) {
+      remove_host_entry_if_empty(ent, host_entries_, host);
+
+      return nullptr;
+    }
+
+    ent.blocked[link->urgency].remove(link);
+
+    if (delay_target_ > 0.) {
+      auto now = ev_now(loop_);
+
+      if (codel_should_shed(ent, now - link->blocked_time, now)) {
+        // Keep the link attached so that it is freed when the
+        // Downstream object is deleted before pop_shed() is called.
+        link->downstream->set_dispatch_state(DispatchState::FAILURE);
+        shed_.append(link);
+
+        continue;
+      }
+    }
+
+    auto next_downstream = link->downstream;
+    auto link2 = next_downstream->detach_blocked_link();
+    // This is required with --disable-assert.
+    (void)link2;
+    assert(link2 == link);
+    delete link;
+    remove_host_entry_if_empty(ent, host_entries_, host);
+
+    return next_downstream;
+  }
+}
+
+Downstream *DownstreamQueue::pop_shed() {
+  auto link = shed_.head;
 
   if (!link) {
     return nullptr;
   }
 
-  auto next_downstream = link->downstream;
-  auto link2 = next_downstream->detach_blocked_link();
+  shed_.remove(link);
+
+  auto downstream = link->downstream;
+  auto link2 = downstream->detach_blocked_link();
   // This is required with --disable-assert.
   (void)link2;
   assert(link2 == link);
-  ent.blocked.remove(link);
   delete link;
-  remove_host_entry_if_empty(ent, host_entries_, host);
 
-  return next_downstream;
+  return downstream;
+}
+
+bool DownstreamQueue::codel_should_shed(HostEntry &ent, ev_tstamp sojourn,
+                                        ev_tstamp now) {
+  auto ok_to_shed = false;
+
+  if (sojourn < delay_target_) {
+    ent.first_above_time = 0.;
+  } else if (ent.first_above_time == 0.) {
+    ent.first_above_time = now + delay_interval_;
+  } else if (now >= ent.first_above_time) {
+    ok_to_shed = true;
+  }
+
+  if (ent.dropping) {
+    if (!ok_to_shed) {
+      ent.dropping = false;
+
+      return false;
+    }
+
+    if (now < ent.drop_next) {
+      return false;
+    }
+
+    ++ent.drop_count;
+    ent.drop_next +=
+      delay_interval_ / std::sqrt(static_cast<double>(ent.drop_count));
+
+    return true;
+  }
+
+  if (!ok_to_shed) {
+    return false;
+  }
+
+  ent.dropping = true;
+
+  // If we were in dropping state recently, start from the shedding
+  // rate which was reached last time.
+  auto delta = ent.drop_count - ent.last_drop_count;
+  if (delta > 1 && now - ent.drop_next < 16 * delay_interval_) {
+    ent.drop_count = delta;
+  } else {
+    ent.drop_count = 1;
+  }
+
+  ent.last_drop_count = ent.drop_count;
+  ent.drop_next =
+    now + delay_interval_ / std::sqrt(static_cast<double>(ent.drop_count));
+
+  return true;
 }
 
 Downstream *DownstreamQueue::get_downstreams() const {
   return downstreams_.head;
 }
 
+Downstream *DownstreamQueue::get_first_request_buffering() const {
+  for (auto d = downstreams_.head; d; d = d->dlnext) {
+    if (d->request_buffering()) {
+      return d;
+    }
+  }
+
+  return nullptr;
+}
+
 } // namespace shrpx
@@ -30,6 +30,11 @@
 #include <cinttypes>
 #include <unordered_map>
 #include <memory>
+#include <array>
+
+#include <ev.h>
+
+#include <nghttp2/nghttp2.h>
 
 #include "template.h"
 
@@ -45,6 +50,10 @@ class Downstream;
 struct BlockedLink {
   Downstream *downstream;
   BlockedLink *dlnext, *dlprev;
+  // The time when downstream was blocked.
+  ev_tstamp blocked_time;
+  // The urgency of downstream defined in RFC 9218.
+  uint32_t urgency;
 };
 
 class DownstreamQueue {
@@ -60,16 +69,37 @@ public:
 
     // Key that associates this object
     ImmutableString key;
-    // Set of stream ID that blocked by conn_max_per_host_.
-    DList<BlockedLink> blocked;
+    // Set of stream ID that blocked by conn_max_per_host_, indexed
+    // by urgency.  The requests with the lower urgency value are
+    // dispatched first, and the requests with the same urgency are
+    // dispatched in arrival order.
+    std::array<DList<BlockedLink>, NGHTTP2_EXTPRI_URGENCY_LEVELS> blocked;
     // The number of connections currently made to this host.
     size_t num_active;
+    // The following fields are the state of CoDel.  first_above_time
+    // is the time when the waiting time has stayed above the target
+    // for an interval.  It is 0 if the waiting time is below the
+    // target.
+    ev_tstamp first_above_time;
+    // The time when the next request is shed in dropping state.
+    ev_tstamp drop_next;
+    // The number of requests shed since entering dropping state,
+    // and its value when the last dropping state was entered.
+    size_t drop_count;
+    size_t last_drop_count;
+    // true if requests are being shed.
+    bool dropping;
   };
 
   using HostEntryMap = std::unordered_map<std::string_view, HostEntry>;
 
   // conn_max_per_host == 0 means no limit for downstream connection.
-  DownstreamQueue(size_t conn_max_per_host = 0, bool unified_host = true);
+  // If |delay_target| is positive, the blocked Downstream objects are
+  // shed using CoDel algorithm with |delay_target| and
+  // |delay_interval|.  |loop| is used to get the current time.
+  DownstreamQueue(size_t conn_max_per_host = 0, bool unified_host = true,
+                  struct ev_loop *loop = nullptr, ev_tstamp delay_target = 0.,
+                  ev_tstamp delay_interval = 0.);
   ~DownstreamQueue();
   // Add |downstream| to this queue.  This is entry point for
   // Downstream object.
@@ -82,7 +112,9 @@ public:
   void mark_active(Downstream *downstream);
   // Set |downstream| to blocked state, which means that download
   // connection was blocked because conn_max_per_host_ limit.
-  void mark_blocked(Downstream *downstream);
+  // |urgency| is the urgency of |downstream| defined in RFC 9218.
+  void mark_blocked(Downstream *downstream,
+                    uint32_t urgency = NGHTTP2_EXTPRI_DEFAULT_URGENCY);
   // Returns true if we can make downstream connection to given
   // |host|.
   bool can_activate(const std::string_view &host) const;
@@ -90,19 +122,38 @@ public:
   // DispatchState::ACTIVE, and |next_blocked| is true, this function
   // may return Downstream object with the same target host in
   // DispatchState::BLOCKED if its connection is now not blocked by
-  // conn_max_per_host_ limit.
+  // conn_max_per_host_ limit.  The blocked Downstream objects which
+  // CoDel decides to shed are skipped, and they are retrieved by
+  // pop_shed().
   Downstream *remove_and_get_blocked(Downstream *downstream,
                                      bool next_blocked = true);
+  // Returns Downstream object which was shed by
+  // remove_and_get_blocked(), or nullptr if there is no such object.
+  // It is in DispatchState::FAILURE state, and the caller must send
+  // an error response to it.
+  Downstream *pop_shed();
   Downstream *get_downstreams() const;
+  // Returns the oldest Downstream object which is buffering its
+  // request body by buffer-request parameter, or nullptr.
+  Downstream *get_first_request_buffering() const;
   HostEntry &find_host_entry(const std::string_view &host);
   std::string_view make_host_key(const std::string_view &host) const;
   std::string_view make_host_key(Downstream *downstream) const;
 
 private:
+  // Returns true if the blocked Downstream object which has waited
+  // for |sojourn| seconds should be shed.
+  bool codel_should_shed(HostEntry &ent, ev_tstamp sojourn, ev_tstamp now);
+
   // Per target host structure to keep track of the number of
   // connections to the same host.
   HostEntryMap host_entries_;
   DList<Downstream> downstreams_;
+  // The Downstream objects which were shed.
+  DList<BlockedLink> shed_;
+  struct ev_loop *loop_;
+  ev_tstamp delay_target_;
+  ev_tstamp delay_interval_;
   // Maximum number of concurrent connections to the same host.
   size_t conn_max_per_host_;
   // true if downstream host is treated as the same.  Used for reverse
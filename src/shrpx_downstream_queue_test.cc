@@ -0,0 +1,240 @@
+/*
+ * nghttp2 - HTTP/2 C Library
+ *
+ * Copyright (c) 2026 Tatsuhiro Tsujikawa
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+ * LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include "shrpx_downstream_queue_test.h"
+
+#include <thread>
+
+#include "munitxx.h"
+
+#include "shrpx_downstream_queue.h"
+#include "shrpx_downstream.h"
+
+using namespace std::literals;
+
+namespace shrpx {
+
+namespace {
+const MunitTest tests[]{
+  munit_void_test(test_shrpx_downstream_queue_codel),
+  munit_void_test(test_shrpx_downstream_queue_codel_delete_shed),
+  munit_void_test(test_shrpx_downstream_queue_urgency),
+  munit_void_test(test_shrpx_downstream_queue_first_request_buffering),
+  munit_test_end(),
+};
+} // namespace
+
+const MunitSuite downstream_queue_suite{
+  "/downstream_queue", tests, nullptr, 1, MUNIT_SUITE_OPTION_NONE,
+};
+
+namespace {
+// Adds new Downstream object to |q|, and returns it.
+Downstream *add_downstream(DownstreamQueue &q) {
+  auto downstream = std::make_unique<Downstream>(nullptr, nullptr, 0);
+  auto d = downstream.get();
+  q.add_pending(std::move(downstream));
+  return d;
+}
+} // namespace
+
+namespace {
+// Sleeps for |d|, and updates the current time of |loop|.
+void advance(struct ev_loop *loop, std::chrono::milliseconds d) {
+  std::this_thread::sleep_for(d);
+  ev_now_update(loop);
+}
+} // namespace
+
+void test_shrpx_downstream_queue_codel(void) {
+  auto loop = ev_loop_new(0);
+  {
+    // 10ms target, and 10ms interval.
+    DownstreamQueue q(2, true, loop, 0.01, 0.01);
+
+    // z keeps the host entry alive throughout this test.
+    auto z = add_downstream(q);
+    q.mark_active(z);
+    auto a = add_downstream(q);
+    q.mark_active(a);
+
+    auto &ent = q.find_host_entry(""sv);
+
+    auto b = add_downstream(q);
+    q.mark_blocked(b);
+    auto c = add_downstream(q);
+    q.mark_blocked(c);
+    auto d = add_downstream(q);
+    q.mark_blocked(d);
+    auto e = add_downstream(q);
+    q.mark_blocked(e);
+
+    advance(loop, 20ms);
+
+    // The waiting time is above the target, but it has not stayed
+    // above the target for an interval.
+    assert_ptr_equal(b, q.remove_and_get_blocked(a));
+    assert_false(ent.dropping);
+    assert_null(q.pop_shed());
+
+    q.mark_active(b);
+
+    advance(loop, 20ms);
+
+    // Enter dropping state, and c is shed.  d is not shed because
+    // the next drop is scheduled an interval later.
+    assert_ptr_equal(d, q.remove_and_get_blocked(b));
+    assert_true(ent.dropping);
+    assert_size(1, ==, ent.drop_count);
+    assert_ptr_equal(c, q.pop_shed());
+    assert_true(DispatchState::FAILURE == c->get_dispatch_state());
+    assert_null(q.pop_shed());
+
+    q.remove_and_get_blocked(c, false);
+    q.mark_active(d);
+
+    assert_ptr_equal(e, q.remove_and_get_blocked(d));
+    assert_true(ent.dropping);
+    assert_null(q.pop_shed());
+
+    q.mark_active(e);
+
+    // The waiting time of f is below the target.  Leave dropping
+    // state.
+    auto f = add_downstream(q);
+    q.mark_blocked(f);
+
+    assert_ptr_equal(f, q.remove_and_get_blocked(e));
+    assert_false(ent.dropping);
+    assert_null(q.pop_shed());
+
+    q.mark_active(f);
+    q.remove_and_get_blocked(f);
+    q.remove_and_get_blocked(z);
+
+    assert_null(q.get_downstreams());
+  }
+  ev_loop_destroy(loop);
+}
+
+void test_shrpx_downstream_queue_codel_delete_shed(void) {
+  auto loop = ev_loop_new(0);
+  {
+    // 10ms target, and 0 interval so that a request is shed as soon
+    // as the waiting time goes above the target twice.
+    DownstreamQueue q(1, true, loop, 0.01, 0.);
+
+    auto a = add_downstream(q);
+    q.mark_active(a);
+
+    auto b = add_downstream(q);
+    q.mark_blocked(b);
+    auto c = add_downstream(q);
+    q.mark_blocked(c);
+    auto d = add_downstream(q);
+    q.mark_blocked(d);
+
+    advance(loop, 20ms);
+
+    assert_ptr_equal(b, q.remove_and_get_blocked(a));
+
+    q.mark_active(b);
+
+    // Both c and d are shed.
+    assert_null(q.remove_and_get_blocked(b));
+
+    // c is deleted before pop_shed() is called.  Its link must be
+    // removed from the queue, and freed.
+    q.remove_and_get_blocked(c, false);
+
+    assert_ptr_equal(d, q.pop_shed());
+    assert_null(q.pop_shed());
+
+    q.remove_and_get_blocked(d, false);
+
+    assert_null(q.get_downstreams());
+  }
+  ev_loop_destroy(loop);
+}
+
+void test_shrpx_downstream_queue_urgency(void) {
+  DownstreamQueue q(1);
+
+  auto a = add_downstream(q);
+  q.mark_active(a);
+
+  auto b = add_downstream(q);
+  q.mark_blocked(b);
+  auto c = add_downstream(q);
+  q.mark_blocked(c, 1);
+  auto d = add_downstream(q);
+  // Out of range urgency is treated as the lowest priority.
+  q.mark_blocked(d, 100);
+  auto e = add_downstream(q);
+  q.mark_blocked(e, NGHTTP2_EXTPRI_DEFAULT_URGENCY);
+  auto f = add_downstream(q);
+  q.mark_blocked(f, 1);
+  auto g = add_downstream(q);
+  q.mark_blocked(g, 0);
+
+  // Lower urgency first, and the same urgency in arrival order.
+  for (auto next : {g, c, f, b, e, d}) {
+    assert_ptr_equal(next, q.remove_and_get_blocked(a));
+
+    q.mark_active(next);
+    a = next;
+  }
+
+  assert_null(q.remove_and_get_blocked(a));
+  assert_null(q.get_downstreams());
+}
+
+void test_shrpx_downstream_queue_first_request_buffering(void) {
+  DownstreamQueue q;
+
+  assert_null(q.get_first_request_buffering());
+
+  auto a = add_downstream(q);
+  auto b = add_downstream(q);
+  b->set_buffer_request(true);
+  auto c = add_downstream(q);
+  c->set_buffer_request(true);
+
+  assert_ptr_equal(b, q.get_first_request_buffering());
+
+  // The request which has sent its header fields is not buffering
+  // anymore.
+  b->set_request_header_sent(true);
+
+  assert_ptr_equal(c, q.get_first_request_buffering());
+
+  q.remove_and_get_blocked(c);
+
+  assert_null(q.get_first_request_buffering());
+
+  q.remove_and_get_blocked(a);
+  q.remove_and_get_blocked(b);
+}
+
+} // namespace shrpx
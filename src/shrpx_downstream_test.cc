@@ -43,6 +43,7 @@ const MunitTest tests[]{
   munit_void_test(test_downstream_rewrite_location_response_header),
   munit_void_test(test_downstream_supports_non_final_response),
   munit_void_test(test_downstream_find_affinity_cookie),
+  munit_void_test(test_downstream_pool),
   munit_test_end(),
 };
 } // namespace
@@ -217,4 +218,49 @@ void test_downstream_find_affinity_cookie(void) {
   assert_uint32(0, ==, aff);
 }
 
+void test_downstream_pool(void) {
+  DownstreamPool pool;
+
+  auto balloc = pool.get_block_allocator();
+
+  assert_size(DOWNSTREAM_BALLOC_BLOCK_SIZE, ==, balloc.block_size);
+
+  auto p = balloc.alloc(100);
+  balloc.alloc(2000);
+
+  pool.recycle(std::move(balloc));
+
+  assert_size(1, ==, pool.get_num_ballocs());
+
+  balloc = pool.get_block_allocator();
+
+  assert_size(0, ==, pool.get_num_ballocs());
+  // The memory block is kept, and used from the beginning.
+  assert_size(DOWNSTREAM_BALLOC_BLOCK_SIZE, ==, balloc.allocated);
+  assert_ptr_equal(p, balloc.alloc(100));
+
+  auto headers = pool.get_headers(16);
+
+  assert_size(16, <=, headers.capacity());
+
+  headers.emplace_back("alpha"sv, "bravo"sv);
+  auto data = headers.data();
+
+  pool.recycle(std::move(headers));
+
+  assert_size(1, ==, pool.get_num_headers());
+
+  // The vector is too small.
+  headers = pool.get_headers(32);
+
+  assert_size(1, ==, pool.get_num_headers());
+  assert_size(32, <=, headers.capacity());
+
+  headers = pool.get_headers(16);
+
+  assert_size(0, ==, pool.get_num_headers());
+  assert_true(headers.empty());
+  assert_ptr_equal(data, headers.data());
+}
+
 } // namespace shrpx
@@ -40,6 +40,9 @@ enum ErrorCode {
   SHRPX_ERR_RETRY = -104,
   SHRPX_ERR_TLS_REQUIRED = -105,
   SHRPX_ERR_SEND_BLOCKED = -106,
+  SHRPX_ERR_QUEUED = -107,
+  SHRPX_ERR_CONCURRENCY_LIMIT = -108,
+  SHRPX_ERR_RATE_LIMITED = -109,
 };
 
 } // namespace shrpx
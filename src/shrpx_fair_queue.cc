@@ -0,0 +1,256 @@
+/*
+ * nghttp2 - HTTP/2 C Library
+ *
+ * Copyright (c) 2026 Tatsuhiro Tsujikawa
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+ * LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include "shrpx_fair_queue.h"
+
+#include <vector>
+
+#include "shrpx_downstream.h"
+#include "shrpx_upstream.h"
+#include "shrpx_worker.h"
+#include "shrpx_error.h"
+#include "shrpx_log.h"
+
+namespace shrpx {
+
+namespace {
+void dispatchcb(struct ev_loop *loop, ev_timer *w, int revents) {
+  auto fq = static_cast<FairQueue *>(w->data);
+
+  fq->dispatch();
+}
+} // namespace
+
+FairQueue::Client::Client(ImmutableString &&key, uint32_t weight)
+  : key(std::move(key)),
+    dlnext(nullptr),
+    dlprev(nullptr),
+    num_active(0),
+    weight(weight),
+    credit(weight) {}
+
+FairQueue::FairQueue(struct ev_loop *loop, size_t client_max,
+                     ClientWeightMap client_weights)
+  : client_weights_(std::move(client_weights)),
+    loop_(loop),
+    client_max_(client_max) {
+  ev_timer_init(&dispatchev_, dispatchcb, 0., 0.);
+  dispatchev_.data = this;
+}
+
+FairQueue::~FairQueue() { ev_timer_stop(loop_, &dispatchev_); }
+
+FairQueue::Client &FairQueue::find_client(const std::string_view &key) {
+  auto itr = clients_.find(key);
+  if (itr == std::ranges::end(clients_)) {
+    auto k = ImmutableString{key};
+    auto key_ref = std::string_view{k.begin(), k.end()};
+    auto witr = client_weights_.find(key);
+    auto weight =
+      witr == std::ranges::end(client_weights_) ? 1 : (*witr).second;
+    std::tie(itr, std::ignore) =
+      clients_.emplace(key_ref, Client(std::move(k), weight));
+  }
+  return (*itr).second;
+}
+
+void FairQueue::remove_client_if_empty(Client *client) {
+  if (client->num_active == 0 && client->waiting.empty()) {
+    clients_.erase(std::string_view{client->key.begin(), client->key.end()});
+  }
+}
+
+bool FairQueue::can_acquire(const SharedDownstreamAddr &shared_addr,
+                            const Client &client) const {
+  return (shared_addr.max_concurrency == 0 ||
+          shared_addr.num_active_requests < shared_addr.max_concurrency) &&
+         (client_max_ == 0 ||
+          client.num_active < client_max_ * client.weight);
+}
+
+int FairQueue::acquire(Downstream *downstream,
+                       const std::shared_ptr<SharedDownstreamAddr> &shared_addr,
+                       const std::string_view &client_key,
+                       bool queueable) {
+  if (shared_addr->max_concurrency == 0 && client_max_ == 0) {
+    return 0;
+  }
+
+  auto &client = find_client(client_key);
+
+  // Do not overtake the requests which are already queued for the
+  // same group or by the same client.  If the group has no limit, the
+  // requests queued for it only wait for their own client.
+  if (client.waiting.empty() &&
+      (shared_addr->max_concurrency == 0 ||
+       shared_addr->num_waiting_requests == 0) &&
+      can_acquire(*shared_addr, client)) {
+    ++shared_addr->num_active_requests;
+    ++client.num_active;
+
+    downstream->attach_fair_queue_entry(new Entry{
+      .shared_addr = shared_addr,
+      .client = &client,
+    });
+
+    return 0;
+  }
+
+  if (!queueable) {
+    remove_client_if_empty(&client);
+
+    return SHRPX_ERR_CONCURRENCY_LIMIT;
+  }
+
+  if (LOG_ENABLED(INFO)) {
+    DLOG(INFO, downstream) << "Concurrency limit reached; queued";
+  }
+
+  auto ent = new Entry{
+    .shared_addr = shared_addr,
+    .client = &client,
+    .waiting = true,
+  };
+
+  downstream->attach_fair_queue_entry(ent);
+
+  ++shared_addr->num_waiting_requests;
+
+  if (client.waiting.empty()) {
+    waiting_clients_.append(&client);
+  }
+
+  client.waiting.append(ent);
+
+  if (can_acquire(*shared_addr, client)) {
+    // The slot is free, but the other requests are queued before this
+    // one.
+    ev_timer_start(loop_, &dispatchev_);
+  }
+
+  return SHRPX_ERR_QUEUED;
+}
+
+void FairQueue::release(Downstream *downstream) {
+  auto ent = downstream->detach_fair_queue_entry();
+  if (!ent) {
+    return;
+  }
+
+  auto client = ent->client;
+  auto &shared_addr = ent->shared_addr;
+
+  if (ent->waiting) {
+    --shared_addr->num_waiting_requests;
+
+    client->waiting.remove(ent);
+    if (client->waiting.empty()) {
+      waiting_clients_.remove(client);
+      client->credit = client->weight;
+    }
+  } else {
+    --shared_addr->num_active_requests;
+    --client->num_active;
+
+    if (!waiting_clients_.empty()) {
+      // Defer dispatching because this function is called while
+      // Downstream object is being deleted.
+      ev_timer_start(loop_, &dispatchev_);
+    }
+  }
+
+  delete ent;
+
+  remove_client_if_empty(client);
+}
+
+void FairQueue::dispatch() {
+  std::vector<Downstream *> ready;
+
+  // Each pass visits each client once, and gives it at most as many
+  // slots as its remaining credit so that a client with many queued
+  // requests cannot starve the others.  A client which cannot use up
+  // its credit keeps its position, and takes the remaining slots
+  // first when the next slot becomes available.
+  for (;;) {
+    auto progress = false;
+
+    auto last = waiting_clients_.tail;
+
+    for (auto client = waiting_clients_.head; client;) {
+      auto next = client == last ? nullptr : client->dlnext;
+
+      for (; client->credit && !client->waiting.empty(); --client->credit) {
+        auto ent = client->waiting.head;
+        auto &shared_addr = ent->shared_addr;
+
+        if (!can_acquire(*shared_addr, *client)) {
+          break;
+        }
+
+        client->waiting.remove(ent);
+        ent->waiting = false;
+
+        --shared_addr->num_waiting_requests;
+        ++shared_addr->num_active_requests;
+        ++client->num_active;
+
+        ready.push_back(ent->downstream);
+
+        progress = true;
+      }
+
+      if (client->credit == 0 || client->waiting.empty()) {
+        client->credit = client->weight;
+
+        // Move the client to the tail so that the other clients are
+        // served first next time.
+        waiting_clients_.remove(client);
+        if (!client->waiting.empty()) {
+          waiting_clients_.append(client);
+        }
+      }
+
+      client = next;
+    }
+
+    if (!progress) {
+      break;
+    }
+  }
+
+  for (auto downstream : ready) {
+    if (LOG_ENABLED(INFO)) {
+      DLOG(INFO, downstream) << "Acquired concurrency slot";
+    }
+
+    auto upstream = downstream->get_upstream();
+    // check nullptr for unittest
+    if (upstream) {
+      upstream->on_downstream_slot_acquired(downstream);
+    }
+  }
+}
+
+} // namespace shrpx
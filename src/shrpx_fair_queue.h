@@ -0,0 +1,139 @@
+/*
+ * nghttp2 - HTTP/2 C Library
+ *
+ * Copyright (c) 2026 Tatsuhiro Tsujikawa
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+ * LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#ifndef SHRPX_FAIR_QUEUE_H
+#define SHRPX_FAIR_QUEUE_H
+
+#include "shrpx.h"
+
+#include <memory>
+#include <unordered_map>
+
+#include <ev.h>
+
+#include "shrpx_config.h"
+#include "template.h"
+
+using namespace nghttp2;
+
+namespace shrpx {
+
+class Downstream;
+struct SharedDownstreamAddr;
+
+// FairQueue limits the number of concurrent requests per backend
+// group and per client in a worker.  The requests which exceed the
+// limits wait in the per client queue, and they are dispatched in
+// weighted round robin manner across clients when a slot becomes
+// available.
+class FairQueue {
+public:
+  struct Client;
+
+  // Entry links Downstream which holds, or waits for a slot.
+  // Downstream has field to link back to this object.
+  struct Entry {
+    Downstream *downstream;
+    std::shared_ptr<SharedDownstreamAddr> shared_addr;
+    Client *client;
+    Entry *dlnext, *dlprev;
+    // true if downstream is waiting for a slot.
+    bool waiting;
+  };
+
+  struct Client {
+    Client(ImmutableString &&key, uint32_t weight);
+
+    Client(Client &&) = default;
+    Client &operator=(Client &&) = default;
+
+    Client(const Client &) = delete;
+    Client &operator=(const Client &) = delete;
+
+    // Key that associates this object
+    ImmutableString key;
+    // Downstream objects waiting for a slot in arrival order.
+    DList<Entry> waiting;
+    Client *dlnext, *dlprev;
+    // The number of Downstream objects holding a slot.
+    size_t num_active;
+    // The weight of this client.  The client can hold weight times
+    // as many slots as the other clients, and it is given up to
+    // weight slots in each round of dispatching.
+    uint32_t weight;
+    // The number of slots this client can still take in the current
+    // round of dispatching.
+    uint32_t credit;
+  };
+
+  // |client_max| is the maximum number of concurrent requests per
+  // client with weight 1, and 0 means no limit.  |client_weights| is
+  // the weight of each client.
+  FairQueue(struct ev_loop *loop, size_t client_max = 0,
+            ClientWeightMap client_weights = {});
+  ~FairQueue();
+
+  FairQueue(const FairQueue &) = delete;
+  FairQueue &operator=(const FairQueue &) = delete;
+
+  // Acquires a slot for |downstream| which is forwarded to the group
+  // |shared_addr| on behalf of the client identified by |client_key|.
+  // This function returns 0 if it acquires a slot, or there is no
+  // limit to apply.  If no slot is
+  // available and |queueable| is true, |downstream| is queued, and
+  // this function returns SHRPX_ERR_QUEUED.  Upstream::
+  // on_downstream_slot_acquired() is called when it acquires a slot
+  // later.  If |queueable| is false, this function returns
+  // SHRPX_ERR_CONCURRENCY_LIMIT.
+  int acquire(Downstream *downstream,
+              const std::shared_ptr<SharedDownstreamAddr> &shared_addr,
+              const std::string_view &client_key, bool queueable);
+  // Releases a slot held by |downstream|, or removes |downstream|
+  // from the queue.  This function does nothing if |downstream| has
+  // no slot and is not queued.
+  void release(Downstream *downstream);
+  // Dispatches queued Downstream objects while slots are available.
+  void dispatch();
+
+private:
+  Client &find_client(const std::string_view &key);
+  void remove_client_if_empty(Client *client);
+  bool can_acquire(const SharedDownstreamAddr &shared_addr,
+                   const Client &client) const;
+
+  std::unordered_map<std::string_view, Client> clients_;
+  // The clients which have queued Downstream objects.  The client
+  // which used up its credit last is moved to the tail.
+  DList<Client> waiting_clients_;
+  ClientWeightMap client_weights_;
+  ev_timer dispatchev_;
+  struct ev_loop *loop_;
+  // The maximum number of concurrent requests per client with weight
+  // 1.
+  size_t client_max_;
+};
+
+} // namespace shrpx
+
+#endif // SHRPX_FAIR_QUEUE_H
@@ -0,0 +1,270 @@
+/*
+ * nghttp2 - HTTP/2 C Library
+ *
+ * Copyright (c) 2026 Tatsuhiro Tsujikawa
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+ * LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include "shrpx_fair_queue_test.h"
+
+#include "munitxx.h"
+
+#include "shrpx_fair_queue.h"
+#include "shrpx_downstream.h"
+#include "shrpx_worker.h"
+#include "shrpx_error.h"
+
+using namespace std::literals;
+
+namespace shrpx {
+
+namespace {
+const MunitTest tests[]{
+  munit_void_test(test_shrpx_fair_queue_round_robin),
+  munit_void_test(test_shrpx_fair_queue_weight),
+  munit_void_test(test_shrpx_fair_queue_release_waiting),
+  munit_void_test(test_shrpx_fair_queue_no_overtaking),
+  munit_test_end(),
+};
+} // namespace
+
+const MunitSuite fair_queue_suite{
+  "/fair_queue", tests, nullptr, 1, MUNIT_SUITE_OPTION_NONE,
+};
+
+namespace {
+// Returns true if |downstream| holds a slot.
+bool active(const Downstream &downstream) {
+  auto ent = downstream.get_fair_queue_entry();
+  return ent && !ent->waiting;
+}
+} // namespace
+
+namespace {
+// Returns true if |downstream| waits for a slot.
+bool waiting(const Downstream &downstream) {
+  auto ent = downstream.get_fair_queue_entry();
+  return ent && ent->waiting;
+}
+} // namespace
+
+void test_shrpx_fair_queue_round_robin(void) {
+  auto loop = ev_loop_new(0);
+  {
+    auto shared_addr = std::make_shared<SharedDownstreamAddr>();
+    shared_addr->max_concurrency = 1;
+
+    FairQueue q(loop);
+    Downstream a1(nullptr, nullptr, 0), a2(nullptr, nullptr, 0),
+      a3(nullptr, nullptr, 0), b1(nullptr, nullptr, 0),
+      b2(nullptr, nullptr, 0), c1(nullptr, nullptr, 0);
+
+    assert_int(0, ==, q.acquire(&a1, shared_addr, "a"sv, true));
+    assert_int(SHRPX_ERR_QUEUED, ==, q.acquire(&a2, shared_addr, "a"sv, true));
+    assert_int(SHRPX_ERR_QUEUED, ==, q.acquire(&a3, shared_addr, "a"sv, true));
+    assert_int(SHRPX_ERR_QUEUED, ==, q.acquire(&b1, shared_addr, "b"sv, true));
+    assert_int(SHRPX_ERR_QUEUED, ==, q.acquire(&b2, shared_addr, "b"sv, true));
+    assert_int(SHRPX_ERR_QUEUED, ==, q.acquire(&c1, shared_addr, "c"sv, true));
+    assert_size(5, ==, shared_addr->num_waiting_requests);
+
+    // Each client takes a slot in turn regardless of the number of
+    // queued requests.
+    auto prev = &a1;
+    for (auto next : {&a2, &b1, &c1, &a3, &b2}) {
+      q.release(prev);
+      q.dispatch();
+
+      assert_true(active(*next));
+      assert_size(1, ==, shared_addr->num_active_requests);
+
+      prev = next;
+    }
+
+    assert_size(0, ==, shared_addr->num_waiting_requests);
+
+    q.release(prev);
+
+    assert_size(0, ==, shared_addr->num_active_requests);
+  }
+  ev_loop_destroy(loop);
+}
+
+void test_shrpx_fair_queue_weight(void) {
+  auto loop = ev_loop_new(0);
+  {
+    auto shared_addr = std::make_shared<SharedDownstreamAddr>();
+    shared_addr->max_concurrency = 1;
+
+    FairQueue q(loop, 0, {{"a", 2}});
+    Downstream a1(nullptr, nullptr, 0), a2(nullptr, nullptr, 0),
+      a3(nullptr, nullptr, 0), a4(nullptr, nullptr, 0),
+      b1(nullptr, nullptr, 0), b2(nullptr, nullptr, 0);
+
+    assert_int(0, ==, q.acquire(&a1, shared_addr, "a"sv, true));
+    assert_int(SHRPX_ERR_QUEUED, ==, q.acquire(&a2, shared_addr, "a"sv, true));
+    assert_int(SHRPX_ERR_QUEUED, ==, q.acquire(&a3, shared_addr, "a"sv, true));
+    assert_int(SHRPX_ERR_QUEUED, ==, q.acquire(&a4, shared_addr, "a"sv, true));
+    assert_int(SHRPX_ERR_QUEUED, ==, q.acquire(&b1, shared_addr, "b"sv, true));
+    assert_int(SHRPX_ERR_QUEUED, ==, q.acquire(&b2, shared_addr, "b"sv, true));
+
+    // Client "a" takes 2 slots for each slot of client "b".
+    auto prev = &a1;
+    for (auto next : {&a2, &a3, &b1, &a4, &b2}) {
+      q.release(prev);
+      q.dispatch();
+
+      assert_true(active(*next));
+
+      prev = next;
+    }
+
+    q.release(prev);
+  }
+  {
+    auto shared_addr = std::make_shared<SharedDownstreamAddr>();
+
+    // The per client limit is multiplied by the weight.
+    FairQueue q(loop, 1, {{"a", 2}});
+    Downstream a1(nullptr, nullptr, 0), a2(nullptr, nullptr, 0),
+      a3(nullptr, nullptr, 0), b1(nullptr, nullptr, 0),
+      b2(nullptr, nullptr, 0);
+
+    assert_int(0, ==, q.acquire(&a1, shared_addr, "a"sv, true));
+    assert_int(0, ==, q.acquire(&a2, shared_addr, "a"sv, true));
+    assert_int(SHRPX_ERR_QUEUED, ==, q.acquire(&a3, shared_addr, "a"sv, true));
+    assert_int(0, ==, q.acquire(&b1, shared_addr, "b"sv, true));
+    assert_int(SHRPX_ERR_CONCURRENCY_LIMIT, ==,
+               q.acquire(&b2, shared_addr, "b"sv, false));
+    assert_null(b2.get_fair_queue_entry());
+
+    for (auto d : {&a1, &a2, &a3, &b1}) {
+      q.release(d);
+    }
+  }
+  ev_loop_destroy(loop);
+}
+
+void test_shrpx_fair_queue_release_waiting(void) {
+  auto loop = ev_loop_new(0);
+  {
+    auto shared_addr = std::make_shared<SharedDownstreamAddr>();
+    shared_addr->max_concurrency = 1;
+
+    FairQueue q(loop);
+    Downstream a1(nullptr, nullptr, 0), a2(nullptr, nullptr, 0),
+      b1(nullptr, nullptr, 0), c1(nullptr, nullptr, 0);
+
+    assert_int(0, ==, q.acquire(&a1, shared_addr, "a"sv, true));
+    assert_int(SHRPX_ERR_QUEUED, ==, q.acquire(&a2, shared_addr, "a"sv, true));
+    assert_int(SHRPX_ERR_QUEUED, ==, q.acquire(&b1, shared_addr, "b"sv, true));
+
+    // Releasing a waiting entry does not free a slot.
+    q.release(&a2);
+
+    assert_null(a2.get_fair_queue_entry());
+    assert_size(1, ==, shared_addr->num_waiting_requests);
+    assert_size(1, ==, shared_addr->num_active_requests);
+
+    q.dispatch();
+
+    assert_true(waiting(b1));
+
+    // Releasing Downstream which has no entry does nothing.
+    q.release(&c1);
+    q.release(&a2);
+
+    assert_size(1, ==, shared_addr->num_waiting_requests);
+    assert_size(1, ==, shared_addr->num_active_requests);
+
+    q.release(&a1);
+    q.dispatch();
+
+    assert_true(active(b1));
+    assert_size(0, ==, shared_addr->num_waiting_requests);
+
+    q.release(&b1);
+
+    assert_size(0, ==, shared_addr->num_active_requests);
+  }
+  ev_loop_destroy(loop);
+}
+
+void test_shrpx_fair_queue_no_overtaking(void) {
+  auto loop = ev_loop_new(0);
+  {
+    auto shared_addr = std::make_shared<SharedDownstreamAddr>();
+    shared_addr->max_concurrency = 1;
+
+    FairQueue q(loop);
+    Downstream a1(nullptr, nullptr, 0), b1(nullptr, nullptr, 0),
+      c1(nullptr, nullptr, 0);
+
+    assert_int(0, ==, q.acquire(&a1, shared_addr, "a"sv, true));
+    assert_int(SHRPX_ERR_QUEUED, ==, q.acquire(&b1, shared_addr, "b"sv, true));
+
+    // The slot is free, but b1 has not been dispatched yet.  c1 must
+    // not take it.
+    q.release(&a1);
+
+    assert_int(SHRPX_ERR_QUEUED, ==, q.acquire(&c1, shared_addr, "c"sv, true));
+
+    q.dispatch();
+
+    assert_true(active(b1));
+    assert_true(waiting(c1));
+
+    q.release(&b1);
+    q.dispatch();
+
+    assert_true(active(c1));
+
+    q.release(&c1);
+  }
+  {
+    auto shared_addr = std::make_shared<SharedDownstreamAddr>();
+
+    // The same rule applies to the requests from the same client.
+    FairQueue q(loop, 1);
+    Downstream a1(nullptr, nullptr, 0), a2(nullptr, nullptr, 0),
+      a3(nullptr, nullptr, 0);
+
+    assert_int(0, ==, q.acquire(&a1, shared_addr, "a"sv, true));
+    assert_int(SHRPX_ERR_QUEUED, ==, q.acquire(&a2, shared_addr, "a"sv, true));
+
+    q.release(&a1);
+
+    assert_int(SHRPX_ERR_QUEUED, ==, q.acquire(&a3, shared_addr, "a"sv, true));
+
+    q.dispatch();
+
+    assert_true(active(a2));
+    assert_true(waiting(a3));
+
+    q.release(&a2);
+    q.dispatch();
+
+    assert_true(active(a3));
+
+    q.release(&a3);
+  }
+  ev_loop_destroy(loop);
+}
+
+} // namespace shrpx
@@ -28,6 +28,8 @@
 #  include <unistd.h>
 #endif // HAVE_UNISTD_H
 
+#include <algorithm>
+
 #include "llhttp.h"
 
 #include "shrpx_client_handler.h"
@@ -51,7 +53,8 @@ Http2DownstreamConnection::Http2DownstreamConnection(Http2Session *http2session)
   : dlnext(nullptr),
     dlprev(nullptr),
     http2session_(http2session),
-    sd_(nullptr) {}
+    sd_(nullptr),
+    added_(false) {}
 
 Http2DownstreamConnection::~Http2DownstreamConnection() {
   if (LOG_ENABLED(INFO)) {
@@ -85,8 +88,13 @@ Http2DownstreamConnection::~Http2DownstreamConnection() {
 
       http2session_->signal_write();
     }
+
+    --http2session_->get_addr()->num_inflight;
+  }
+
+  if (added_) {
+    http2session_->remove_downstream_connection(this);
   }
-  http2session_->remove_downstream_connection(this);
 
   if (LOG_ENABLED(INFO)) {
     DCLOG(INFO, this) << "Deleted";
@@ -100,9 +108,13 @@ int Http2DownstreamConnection::attach_downstream(Downstream *downstream) {
   http2session_->add_downstream_connection(this);
   http2session_->signal_write();
 
+  added_ = true;
+
   downstream_ = downstream;
   downstream_->reset_downstream_rtimer();
 
+  ++http2session_->get_addr()->num_inflight;
+
   auto &req = downstream_->request();
 
   // HTTP/2 disables HTTP Upgrade.
@@ -137,6 +149,8 @@ void Http2DownstreamConnection::detach_downstream(Downstream *downstream) {
   downstream->disable_downstream_rtimer();
   downstream->disable_downstream_wtimer();
   downstream_ = nullptr;
+
+  --http2session_->get_addr()->num_inflight;
 }
 
 int Http2DownstreamConnection::submit_rst_stream(Downstream *downstream,
@@ -193,6 +207,7 @@ nghttp2_ssize http2_data_read_callback(nghttp2_session *session,
 
   if (input_empty &&
       downstream->get_request_state() == DownstreamState::MSG_COMPLETE &&
+      !downstream->request_spooled() &&
       // If connection is upgraded, don't set EOF flag, since HTTP/1
       // will set MSG_COMPLETE to request state after upgrade response
       // header is seen.
@@ -238,6 +253,12 @@ int Http2DownstreamConnection::push_request_headers() {
     // The HTTP2 session to the backend has not been established or
     // connection is now being checked.  This function will be called
     // again just after it is established.
+    auto &timings = downstream_->timings();
+    if (timings.backend_connect_start ==
+        std::chrono::high_resolution_clock::time_point{}) {
+      timings.backend_connect_start =
+        std::chrono::high_resolution_clock::now();
+    }
     downstream_->set_request_pending(true);
     http2session_->start_checking_connection();
     return 0;
@@ -245,6 +266,13 @@ int Http2DownstreamConnection::push_request_headers() {
 
   downstream_->set_request_pending(false);
 
+  auto &timings = downstream_->timings();
+  timings.backend_request_start = std::chrono::high_resolution_clock::now();
+  if (timings.backend_connect_start !=
+      std::chrono::high_resolution_clock::time_point{}) {
+    timings.backend_connect_end = timings.backend_request_start;
+  }
+
   const auto &req = downstream_->request();
 
   if (req.connect_proto != ConnectProto::NONE &&
@@ -563,6 +591,12 @@ int Http2DownstreamConnection::resume_read(IOCtrlReason reason,
     return 0;
   }
 
+  auto &resp = downstream_->response();
+
+  // The spooled response body has been consumed when it was
+  // received.
+  consumed = std::min(consumed, resp.unconsumed_body_length);
+
   if (consumed > 0) {
     rv = http2session_->consume(
       static_cast<int32_t>(downstream_->get_downstream_stream_id()), consumed);
@@ -571,8 +605,6 @@ int Http2DownstreamConnection::resume_read(IOCtrlReason reason,
       return -1;
     }
 
-    auto &resp = downstream_->response();
-
     resp.unconsumed_body_length -= consumed;
 
     http2session_->signal_write();
@@ -619,6 +651,8 @@ Http2DownstreamConnection::get_downstream_addr_group() const {
   return http2session_->get_downstream_addr_group();
 }
 
-DownstreamAddr *Http2DownstreamConnection::get_addr() const { return nullptr; }
+DownstreamAddr *Http2DownstreamConnection::get_addr() const {
+  return http2session_->get_addr();
+}
 
 } // namespace shrpx
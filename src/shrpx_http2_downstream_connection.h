@@ -88,6 +88,10 @@ public:
 private:
   Http2Session *http2session_;
   StreamData *sd_;
+  // true if this object has been added to http2session_.  It is
+  // false if this object is deleted without being attached to
+  // Downstream.
+  bool added_;
 };
 
 } // namespace shrpx
@@ -122,6 +122,10 @@ void timeoutcb(struct ev_loop *loop, ev_timer *w, int revents) {
     return;
   }
 
+  if (w == &conn->wt && !conn->expired_wt()) {
+    return;
+  }
+
   if (LOG_ENABLED(INFO)) {
     SSLOG(INFO, http2session) << "Timeout";
   }
@@ -201,11 +205,14 @@ Http2Session::Http2Session(struct ev_loop *loop, SSL_CTX *ssl_ctx,
     ssl_ctx_(ssl_ctx),
     group_(group),
     addr_(addr),
+    mem_(worker->get_slab_allocator()),
     session_(nullptr),
     raddr_(nullptr),
+    rtt_(0),
     state_(Http2SessionState::DISCONNECTED),
     connection_check_state_(ConnectionCheck::NONE),
     freelist_zone_(FreelistZone::NONE),
+    rtt_probe_frame_type_(0),
     settings_recved_(false),
     allow_connect_proto_(false) {
   read_ = write_ = &Http2Session::noop;
@@ -231,19 +238,30 @@ Http2Session::Http2Session(struct ev_loop *loop, SSL_CTX *ssl_ctx,
   ev_prepare_init(&prep_, prepare_cb);
   prep_.data = this;
   ev_prepare_start(loop, &prep_);
+
+  ++addr_->num_http2_sessions;
 }
 
 Http2Session::~Http2Session() {
   exclude_from_scheduling();
   disconnect(should_hard_fail());
+
+  --addr_->num_http2_sessions;
 }
 
 int Http2Session::disconnect(bool hard) {
   if (LOG_ENABLED(INFO)) {
     SSLOG(INFO, this) << "Disconnecting";
   }
-  nghttp2_session_del(session_);
-  session_ = nullptr;
+  if (session_) {
+    nghttp2_session_del(session_);
+    session_ = nullptr;
+
+    if (LOG_ENABLED(INFO)) {
+      SSLOG(INFO, this) << "nghttp2 session used " << mem_.get_peak()
+                        << " bytes at peak";
+    }
+  }
 
   wb_.reset();
 
@@ -288,6 +306,17 @@ int Http2Session::disconnect(bool hard) {
   for (auto dc = dconns_.head; dc;) {
     auto next = dc->dlnext;
     auto downstream = dc->get_downstream();
+
+    // If the hedged request is in flight, the other one continues.
+    // The other one never belongs to this object because it is sent
+    // to the different backend address.
+    if (downstream->get_hedge_connection() &&
+        !downstream->settle_hedge(dc, false)) {
+      // dc was deleted
+      dc = next;
+      continue;
+    }
+
     auto upstream = downstream->get_upstream();
 
     // Failure is allowed only for HTTP/1 upstream where upstream is
@@ -826,7 +855,10 @@ int on_stream_close_callback(nghttp2_session *session, int32_t stream_id,
     auto downstream = dconn->get_downstream();
     auto upstream = downstream->get_upstream();
 
-    if (downstream->get_downstream_stream_id() % 2 == 0 &&
+    if (downstream->get_hedge_connection() &&
+        !downstream->settle_hedge(dconn, false)) {
+      // The other request continues.  dconn was deleted.
+    } else if (downstream->get_downstream_stream_id() % 2 == 0 &&
         downstream->get_request_state() == DownstreamState::INITIAL) {
       // Downstream is canceled in backend before it is submitted in
       // frontend session.
@@ -1043,6 +1075,15 @@ int on_begin_headers_callback(nghttp2_session *session,
                                       NGHTTP2_INTERNAL_ERROR);
       return 0;
     }
+
+    // The first one which receives response wins if the hedged
+    // request is in flight.
+    auto downstream = sd->dconn->get_downstream();
+    if (frame->headers.cat == NGHTTP2_HCAT_RESPONSE &&
+        downstream->get_hedge_connection()) {
+      downstream->settle_hedge(sd->dconn, true);
+    }
+
     return 0;
   }
   case NGHTTP2_PUSH_PROMISE: {
@@ -1133,6 +1174,11 @@ int on_response_headers(Http2Session *http2session, Downstream *downstream,
   }
 
   downstream->set_response_state(DownstreamState::HEADER_COMPLETE);
+  downstream->timings().response_header_end =
+    std::chrono::high_resolution_clock::now();
+  downstream_response_header_received(
+    http2session->get_downstream_addr_group()->shared_addr.get(),
+    http2session->get_addr(), downstream->timings());
   downstream->check_upgrade_fulfilled_http2();
 
   if (downstream->get_upgraded()) {
@@ -1305,6 +1351,7 @@ int on_frame_recv_callback(nghttp2_session *session, const nghttp2_frame *frame,
     }
 
     http2session->stop_settings_timer();
+    http2session->on_rtt_probe_acked(NGHTTP2_SETTINGS);
 
     auto addr = http2session->get_addr();
     auto &connect_blocker = addr->connect_blocker;
@@ -1318,6 +1365,7 @@ int on_frame_recv_callback(nghttp2_session *session, const nghttp2_frame *frame,
       if (LOG_ENABLED(INFO)) {
         LOG(INFO) << "PING ACK received";
       }
+      http2session->on_rtt_probe_acked(NGHTTP2_PING);
       http2session->connection_alive();
     }
     return 0;
@@ -1435,6 +1483,15 @@ int on_data_chunk_recv_callback(nghttp2_session *session, uint8_t flags,
     }
 
     downstream->set_response_state(DownstreamState::MSG_RESET);
+  } else if (downstream->response_spool_enabled() &&
+             !downstream->response_buf_full()) {
+    // The response body is spooled, and it does not have to wait for
+    // the client to read it.
+    if (http2session->consume(stream_id, len) != 0) {
+      return NGHTTP2_ERR_CALLBACK_FAILURE;
+    }
+
+    resp.unconsumed_body_length -= len;
   }
 
   call_downstream_readcb(http2session, downstream);
@@ -1469,6 +1526,9 @@ int on_frame_send_callback(nghttp2_session *session, const nghttp2_frame *frame,
         }
         downstream->ensure_downstream_wtimer();
       }
+      if (downstream->refill_request_buf() != 0) {
+        return NGHTTP2_ERR_CALLBACK_FAILURE;
+      }
     }
 
     if ((frame->hd.flags & NGHTTP2_FLAG_END_STREAM) == 0) {
@@ -1480,9 +1540,15 @@ int on_frame_send_callback(nghttp2_session *session, const nghttp2_frame *frame,
     return 0;
   }
 
-  if (frame->hd.type == NGHTTP2_SETTINGS &&
-      (frame->hd.flags & NGHTTP2_FLAG_ACK) == 0) {
-    http2session->start_settings_timer();
+  if ((frame->hd.flags & NGHTTP2_FLAG_ACK) == 0) {
+    switch (frame->hd.type) {
+    case NGHTTP2_SETTINGS:
+      http2session->start_settings_timer();
+      // fall through
+    case NGHTTP2_PING:
+      http2session->on_rtt_probe_sent(frame->hd.type);
+      break;
+    }
   }
   return 0;
 }
@@ -1515,6 +1581,11 @@ int on_frame_not_send_callback(nghttp2_session *session,
   }
   auto downstream = sd->dconn->get_downstream();
 
+  if (downstream->get_hedge_connection() &&
+      !downstream->settle_hedge(sd->dconn, false)) {
+    return 0;
+  }
+
   if (lib_error_code == NGHTTP2_ERR_START_STREAM_NOT_ALLOWED) {
     // Migrate to another downstream connection.
     auto upstream = downstream->get_upstream();
@@ -1565,7 +1636,7 @@ int send_data_callback(nghttp2_session *session, nghttp2_frame *frame,
     wb->append(static_cast<char>(padlen));
   }
 
-  input->remove(*wb, length);
+  input->splice(*wb, length);
 
   wb->append(PADDING.data(), padlen);
 
@@ -1670,8 +1741,9 @@ int Http2Session::connection_made() {
   auto config = get_config();
   auto &http2conf = config->http2;
 
-  rv = nghttp2_session_client_new2(&session_, http2conf.downstream.callbacks,
-                                   this, http2conf.downstream.option);
+  rv = nghttp2_session_client_new3(&session_, http2conf.downstream.callbacks,
+                                   this, http2conf.downstream.option,
+                                   mem_.get_nghttp2_mem());
 
   if (rv != 0) {
     return -1;
@@ -2293,6 +2365,53 @@ bool Http2Session::max_concurrency_reached(size_t extra) const {
              session_, NGHTTP2_SETTINGS_MAX_CONCURRENT_STREAMS);
 }
 
+bool Http2Session::flow_control_stalled() const {
+  if (!session_) {
+    return false;
+  }
+
+  return nghttp2_session_get_remote_window_size(session_) <= 0 ||
+         nghttp2_session_get_local_window_size(session_) <= 0;
+}
+
+void Http2Session::on_rtt_probe_sent(uint8_t frame_type) {
+  if (rtt_probe_frame_type_) {
+    return;
+  }
+
+  rtt_probe_frame_type_ = frame_type;
+  rtt_probe_sent_ = std::chrono::steady_clock::now();
+}
+
+void Http2Session::on_rtt_probe_acked(uint8_t frame_type) {
+  if (rtt_probe_frame_type_ != frame_type) {
+    return;
+  }
+
+  rtt_probe_frame_type_ = 0;
+
+  auto sample = std::chrono::steady_clock::now() - rtt_probe_sent_;
+
+  if (rtt_.count() == 0) {
+    rtt_ = sample;
+  } else {
+    // The same smoothing factor as RFC 6298.
+    rtt_ = (rtt_ * 7 + sample) / 8;
+  }
+
+  if (LOG_ENABLED(INFO)) {
+    SSLOG(INFO, this) << "rtt="
+                      << std::chrono::duration_cast<std::chrono::microseconds>(
+                           rtt_)
+                           .count()
+                      << "us";
+  }
+}
+
+std::chrono::steady_clock::duration Http2Session::get_rtt() const {
+  return rtt_;
+}
+
 const std::shared_ptr<DownstreamAddrGroup> &
 Http2Session::get_downstream_addr_group() const {
   return group_;
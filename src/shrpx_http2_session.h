@@ -29,6 +29,7 @@
 
 #include <unordered_set>
 #include <memory>
+#include <chrono>
 
 #include "ssl_compat.h"
 
@@ -46,6 +47,7 @@
 #include "llhttp.h"
 
 #include "shrpx_connection.h"
+#include "shrpx_slab_allocator.h"
 #include "buffer.h"
 #include "template.h"
 
@@ -232,6 +234,19 @@ public:
   // server initiated concurrency limit.
   bool max_concurrency_reached(size_t extra = 0) const;
 
+  // Returns true if this session cannot send or receive DATA frames
+  // because connection level flow control window is exhausted.
+  bool flow_control_stalled() const;
+
+  // Called when a frame which is answered by ACK (SETTINGS or PING)
+  // of |frame_type| is sent.  It starts measuring round trip time.
+  void on_rtt_probe_sent(uint8_t frame_type);
+  // Called when ACK of |frame_type| is received.
+  void on_rtt_probe_acked(uint8_t frame_type);
+  // Returns smoothed round trip time.  It returns 0 if it has not
+  // been measured yet.
+  std::chrono::steady_clock::duration get_rtt() const;
+
   DefaultMemchunks *get_request_buf();
 
   void on_timeout();
@@ -279,6 +294,7 @@ private:
   std::shared_ptr<DownstreamAddrGroup> group_;
   // Address of remote endpoint
   DownstreamAddr *addr_;
+  SlabMem mem_;
   nghttp2_session *session_;
   // Actual remote address used to contact backend.  This is initially
   // nullptr, and may point to either &addr_->addr,
@@ -287,9 +303,17 @@ private:
   // Resolved IP address if dns parameter is used
   std::unique_ptr<Address> resolved_addr_;
   std::unique_ptr<DNSQuery> dns_query_;
+  // The time when the frame to measure round trip time was sent.
+  std::chrono::steady_clock::time_point rtt_probe_sent_;
+  // Smoothed round trip time.
+  std::chrono::steady_clock::duration rtt_;
   Http2SessionState state_;
   ConnectionCheck connection_check_state_;
   FreelistZone freelist_zone_;
+  // The type of frame which is being used to measure round trip
+  // time.  0 if no measurement is in progress.  Since DATA frame
+  // has type 0, it is never used for this purpose.
+  uint8_t rtt_probe_frame_type_;
   // true if SETTINGS without ACK is received from peer.
   bool settings_recved_;
   // true if peer enables RFC 8441 CONNECT protocol.
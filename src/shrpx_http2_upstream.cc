@@ -38,6 +38,7 @@
 #include "shrpx_worker.h"
 #include "shrpx_http2_session.h"
 #include "shrpx_log.h"
+#include "shrpx_metrics.h"
 #ifdef HAVE_MRUBY
 #  include "shrpx_mruby.h"
 #endif // HAVE_MRUBY
@@ -448,18 +449,96 @@ int Http2Upstream::on_request_headers(Downstream *downstream,
     return 0;
   }
 
+  // Receive the entire request body before a backend is selected.
+  // The request is started in start_buffered_downstream().
+  if (req.http2_expect_body && handler_->should_buffer_request(downstream)) {
+    downstream->set_buffer_request(true);
+
+    return 0;
+  }
+
   start_downstream(downstream);
 
   return 0;
 }
 
+void Http2Upstream::start_buffered_downstream(Downstream *downstream) {
+  if (!downstream->request_buffering() ||
+      downstream->get_response_state() == DownstreamState::MSG_COMPLETE) {
+    return;
+  }
+
+  downstream->end_request_buffering();
+
+  // The whole request body has been received.  Let the client finish
+  // the stream regardless of the memory budget.
+  auto &req = downstream->request();
+
+  consume(static_cast<int32_t>(downstream->get_stream_id()),
+          req.unconsumed_body_length);
+
+  req.unconsumed_body_length = 0;
+
+  consume_buffered_request_bodies();
+
+  start_downstream(downstream);
+}
+
+int Http2Upstream::consume_buffered_request_body(Downstream *downstream) {
+  auto &req = downstream->request();
+
+  // The oldest buffered request always makes progress so that the
+  // requests waiting for the memory budget do not wait for each
+  // other.
+  if (req.unconsumed_body_length == 0 ||
+      (handler_->buffered_request_memory_exceeded() &&
+       downstream_queue_.get_first_request_buffering() != downstream)) {
+    return 0;
+  }
+
+  if (consume(static_cast<int32_t>(downstream->get_stream_id()),
+              req.unconsumed_body_length) != 0) {
+    return -1;
+  }
+
+  req.unconsumed_body_length = 0;
+
+  return 0;
+}
+
+void Http2Upstream::consume_buffered_request_bodies() {
+  for (auto d = downstream_queue_.get_downstreams(); d; d = d->dlnext) {
+    if (d->request_buffering()) {
+      consume_buffered_request_body(d);
+    }
+  }
+}
+
 void Http2Upstream::start_downstream(Downstream *downstream) {
   if (downstream_queue_.can_activate(downstream->request().authority)) {
     initiate_downstream(downstream);
     return;
   }
 
-  downstream_queue_.mark_blocked(downstream);
+  nghttp2_extpri extpri;
+
+  if (nghttp2_session_get_extpri_stream_priority(
+        session_, &extpri,
+        static_cast<int32_t>(downstream->get_stream_id())) != 0) {
+    extpri.urgency = NGHTTP2_EXTPRI_DEFAULT_URGENCY;
+    extpri.inc = 0;
+  }
+
+  // nghttp2 applies the priority header field after the request
+  // HEADERS is processed.  Parse it here to get the urgency.
+  auto priority = downstream->request().fs.header(http2::HD_PRIORITY);
+  if (priority) {
+    nghttp2_extpri_parse_priority(
+      &extpri, reinterpret_cast<const uint8_t *>(priority->value.data()),
+      priority->value.size());
+  }
+
+  downstream_queue_.mark_blocked(downstream, extpri.urgency);
 }
 
 void Http2Upstream::initiate_downstream(Downstream *downstream) {
@@ -472,8 +551,15 @@ void Http2Upstream::initiate_downstream(Downstream *downstream) {
   for (;;) {
     auto dconn = handler_->get_downstream_connection(rv, downstream);
     if (!dconn) {
+      if (rv == SHRPX_ERR_QUEUED) {
+        // on_downstream_slot_acquired() is called later.
+        return;
+      }
+
       if (rv == SHRPX_ERR_TLS_REQUIRED) {
         rv = redirect_to_https(downstream);
+      } else if (rv == SHRPX_ERR_RATE_LIMITED) {
+        rv = error_reply(downstream, 429);
       } else {
         rv = error_reply(downstream, 502);
       }
@@ -567,6 +653,8 @@ int on_frame_recv_callback(nghttp2_session *session, const nghttp2_frame *frame,
       }
 
       downstream->set_request_state(DownstreamState::MSG_COMPLETE);
+
+      upstream->start_buffered_downstream(downstream);
     }
 
     return 0;
@@ -596,6 +684,8 @@ int on_frame_recv_callback(nghttp2_session *session, const nghttp2_frame *frame,
       }
 
       downstream->set_request_state(DownstreamState::MSG_COMPLETE);
+
+      upstream->start_buffered_downstream(downstream);
     }
 
     return 0;
@@ -653,6 +743,14 @@ int on_data_chunk_recv_callback(nghttp2_session *session, uint8_t flags,
     return 0;
   }
 
+  // The buffered request body is not forwarded until it is entirely
+  // received.  Consume it now so that the client can send the rest,
+  // unless it would exceed the memory budget.
+  if (downstream->request_buffering() &&
+      upstream->consume_buffered_request_body(downstream) != 0) {
+    return NGHTTP2_ERR_CALLBACK_FAILURE;
+  }
+
   return 0;
 }
 } // namespace
@@ -850,10 +948,14 @@ int send_data_callback(nghttp2_session *session, nghttp2_frame *frame,
     wb->append(static_cast<char>(padlen));
   }
 
-  body->remove(*wb, length);
+  body->splice(*wb, length);
 
   wb->append(PADDING.data(), padlen);
 
+  if (downstream->refill_response_buf() != 0) {
+    return NGHTTP2_ERR_CALLBACK_FAILURE;
+  }
+
   if (body->rleft() == 0) {
     downstream->disable_upstream_wtimer();
   } else {
@@ -1019,9 +1121,13 @@ size_t downstream_queue_size(Worker *worker) {
 
 Http2Upstream::Http2Upstream(ClientHandler *handler)
   : wb_(handler->get_worker()->get_mcpool()),
-    downstream_queue_(downstream_queue_size(handler->get_worker()),
-                      !get_config()->http2_proxy),
+    downstream_queue_(
+      downstream_queue_size(handler->get_worker()), !get_config()->http2_proxy,
+      handler->get_loop(),
+      handler->get_worker()->get_downstream_config()->queue_delay.target,
+      handler->get_worker()->get_downstream_config()->queue_delay.interval),
     handler_(handler),
+    mem_(handler->get_worker()->get_slab_allocator()),
     session_(nullptr),
     max_buffer_size_(MAX_BUFFER_SIZE),
     num_requests_(0) {
@@ -1032,11 +1138,12 @@ Http2Upstream::Http2Upstream(ClientHandler *handler)
 
   auto faddr = handler_->get_upstream_addr();
 
-  rv =
-    nghttp2_session_server_new2(&session_, http2conf.upstream.callbacks, this,
-                                faddr->alt_mode != UpstreamAltMode::NONE
-                                  ? http2conf.upstream.alt_mode_option
-                                  : http2conf.upstream.option);
+  auto option = faddr->alt_mode != UpstreamAltMode::NONE
+                  ? http2conf.upstream.alt_mode_option
+                  : http2conf.upstream.option;
+
+  rv = nghttp2_session_server_new3(&session_, http2conf.upstream.callbacks,
+                                   this, option, mem_.get_nghttp2_mem());
 
   assert(rv == 0);
 
@@ -1139,6 +1246,12 @@ Http2Upstream::Http2Upstream(ClientHandler *handler)
 
 Http2Upstream::~Http2Upstream() {
   nghttp2_session_del(session_);
+
+  if (LOG_ENABLED(INFO)) {
+    ULOG(INFO, this) << "nghttp2 session used " << mem_.get_peak()
+                     << " bytes at peak";
+  }
+
   ev_prepare_stop(handler_->get_loop(), &prep_);
   ev_timer_stop(handler_->get_loop(), &shutdown_timer_);
   ev_timer_stop(handler_->get_loop(), &settings_timer_);
@@ -1464,7 +1577,7 @@ nghttp2_ssize downstream_data_read_callback(nghttp2_session *session,
 
   nread = std::min(nread, max_buffer_size - 9 - buffer->rleft());
 
-  auto body_empty = body->rleft() == nread;
+  auto body_empty = body->rleft() == nread && !downstream->response_spooled();
 
   *data_flags |= NGHTTP2_DATA_FLAG_NO_COPY;
 
@@ -1638,19 +1751,26 @@ void Http2Upstream::add_pending_downstream(
 }
 
 void Http2Upstream::remove_downstream(Downstream *downstream) {
-  if (downstream->accesslog_ready()) {
-    handler_->write_accesslog(downstream);
-  }
+  handler_->finish_downstream(downstream);
 
   nghttp2_session_set_stream_user_data(
     session_, static_cast<int32_t>(downstream->get_stream_id()), nullptr);
 
+  auto request_buffering = downstream->request_buffering();
+
   auto next_downstream = downstream_queue_.remove_and_get_blocked(downstream);
 
+  if (request_buffering) {
+    // downstream has released the buffered request body.
+    consume_buffered_request_bodies();
+  }
+
   if (next_downstream) {
     initiate_downstream(next_downstream);
   }
 
+  send_shed_downstreams();
+
   if (downstream_queue_.get_downstreams() == nullptr) {
     // There is no downstream at the moment.  Start idle timer now.
     auto config = get_config();
@@ -1660,6 +1780,24 @@ void Http2Upstream::remove_downstream(Downstream *downstream) {
   }
 }
 
+void Http2Upstream::send_shed_downstreams() {
+  auto metrics = handler_->get_worker()->get_metrics();
+
+  for (auto downstream = downstream_queue_.pop_shed(); downstream;
+       downstream = downstream_queue_.pop_shed()) {
+    if (LOG_ENABLED(INFO)) {
+      ULOG(INFO, this) << "Shed queued request stream_id="
+                       << downstream->get_stream_id();
+    }
+
+    metrics->streams_shed_total.inc();
+
+    if (error_reply(downstream, 503) != 0) {
+      rst_stream(downstream, NGHTTP2_INTERNAL_ERROR);
+    }
+  }
+}
+
 // WARNING: Never call directly or indirectly nghttp2_session_send or
 // nghttp2_session_recv. These calls may delete downstream.
 int Http2Upstream::on_downstream_header_complete(Downstream *downstream) {
@@ -1928,7 +2066,7 @@ int Http2Upstream::on_downstream_header_complete(Downstream *downstream) {
 int Http2Upstream::on_downstream_body(Downstream *downstream,
                                       const uint8_t *data, size_t len,
                                       bool flush) {
-  auto body = downstream->get_response_buf();
+  auto body = downstream->get_response_body_buf();
   body->append(data, len);
 
   if (flush) {
@@ -1969,7 +2107,13 @@ void Http2Upstream::pause_read(IOCtrlReason reason) {}
 
 int Http2Upstream::resume_read(IOCtrlReason reason, Downstream *downstream,
                                size_t consumed) {
-  if (get_flow_control()) {
+  // The buffered request body has been consumed when it was
+  // received.  The spooled one is sent as the backend drains it.
+  if (downstream->get_buffer_request()) {
+    if (downstream->refill_request_buf() != 0) {
+      return -1;
+    }
+  } else if (get_flow_control()) {
     if (consume(static_cast<int32_t>(downstream->get_stream_id()), consumed) !=
         0) {
       return -1;
@@ -2087,9 +2231,8 @@ int Http2Upstream::on_timeout(Downstream *downstream) {
 
 void Http2Upstream::on_handler_delete() {
   for (auto d = downstream_queue_.get_downstreams(); d; d = d->dlnext) {
-    if (d->get_dispatch_state() == DispatchState::ACTIVE &&
-        d->accesslog_ready()) {
-      handler_->write_accesslog(d);
+    if (d->get_dispatch_state() == DispatchState::ACTIVE) {
+      handler_->finish_downstream(d);
     }
   }
 }
@@ -2424,6 +2567,12 @@ void Http2Upstream::cancel_premature_downstream(
   downstream_queue_.remove_and_get_blocked(promised_downstream, false);
 }
 
+void Http2Upstream::on_downstream_slot_acquired(Downstream *downstream) {
+  start_downstream(downstream);
+
+  handler_->signal_write();
+}
+
 size_t Http2Upstream::get_max_buffer_size() const { return max_buffer_size_; }
 
 } // namespace shrpx
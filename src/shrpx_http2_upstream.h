@@ -35,6 +35,7 @@
 
 #include "shrpx_upstream.h"
 #include "shrpx_downstream_queue.h"
+#include "shrpx_slab_allocator.h"
 #include "memchunk.h"
 #include "buffer.h"
 
@@ -65,6 +66,9 @@ public:
 
   void add_pending_downstream(std::unique_ptr<Downstream> downstream);
   void remove_downstream(Downstream *downstream);
+  // Sends 503 response to the queued requests which are shed by
+  // downstream_queue_.
+  void send_shed_downstreams();
 
   int rst_stream(Downstream *downstream, uint32_t error_code);
   int terminate_session(uint32_t error_code);
@@ -96,6 +100,7 @@ public:
                                       Downstream *promised_downstream);
   virtual bool push_enabled() const;
   virtual void cancel_premature_downstream(Downstream *promised_downstream);
+  virtual void on_downstream_slot_acquired(Downstream *downstream);
 
   bool get_flow_control() const;
   // Perform HTTP/2 upgrade from |upstream|. On success, this object
@@ -108,6 +113,18 @@ public:
   void log_response_headers(Downstream *downstream,
                             const std::vector<nghttp2_nv> &nva) const;
   void start_downstream(Downstream *downstream);
+  // Starts |downstream| whose request body has been buffered
+  // entirely.
+  void start_buffered_downstream(Downstream *downstream);
+  // Consumes the request body of |downstream| which is buffered by
+  // buffer-request parameter unless the memory budget of this
+  // connection is exceeded.  This function returns 0 if it succeeds,
+  // or -1.
+  int consume_buffered_request_body(Downstream *downstream);
+  // Consumes the request body which has not been consumed because of
+  // the memory budget.  Call this function when the buffered request
+  // body is released from memory.
+  void consume_buffered_request_bodies();
   void initiate_downstream(Downstream *downstream);
 
   void submit_goaway();
@@ -138,6 +155,7 @@ private:
   ev_timer shutdown_timer_;
   ev_prepare prep_;
   ClientHandler *handler_;
+  SlabMem mem_;
   nghttp2_session *session_;
   size_t max_buffer_size_;
   // The number of requests seen so far.
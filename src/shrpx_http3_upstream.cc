@@ -41,6 +41,7 @@
 #include "shrpx_worker.h"
 #include "shrpx_http.h"
 #include "shrpx_connection_handler.h"
+#include "shrpx_metrics.h"
 #ifdef HAVE_MRUBY
 #  include "shrpx_mruby.h"
 #endif // HAVE_MRUBY
@@ -118,8 +119,11 @@ Http3Upstream::Http3Upstream(ClientHandler *handler)
     ossl_ctx_{nullptr},
 #endif // OPENSSL_3_5_0_API,
     httpconn_{nullptr},
-    downstream_queue_{downstream_queue_size(handler->get_worker()),
-                      !get_config()->http2_proxy},
+    downstream_queue_{
+      downstream_queue_size(handler->get_worker()), !get_config()->http2_proxy,
+      handler->get_loop(),
+      handler->get_worker()->get_downstream_config()->queue_delay.target,
+      handler->get_worker()->get_downstream_config()->queue_delay.interval},
     tx_{
       .data = std::unique_ptr<uint8_t[]>(new uint8_t[64_k]),
 #ifndef UDP_SEGMENT
@@ -1216,7 +1220,8 @@ nghttp3_ssize downstream_read_data_callback(nghttp3_conn *conn,
 
   assert(body);
 
-  if (downstream->get_response_state() != DownstreamState::MSG_COMPLETE &&
+  if ((downstream->get_response_state() != DownstreamState::MSG_COMPLETE ||
+       downstream->response_spooled()) &&
       body->rleft_mark() == 0) {
     downstream->disable_upstream_wtimer();
     return NGHTTP3_ERR_WOULDBLOCK;
@@ -1228,7 +1233,7 @@ nghttp3_ssize downstream_read_data_callback(nghttp3_conn *conn,
     reinterpret_cast<struct iovec *>(vec), static_cast<int>(veccnt)));
 
   if (downstream->get_response_state() == DownstreamState::MSG_COMPLETE &&
-      body->rleft_mark() == 0) {
+      body->rleft_mark() == 0 && !downstream->response_spooled()) {
     *pflags |= NGHTTP3_DATA_FLAG_EOF;
   }
 
@@ -1460,7 +1465,7 @@ int Http3Upstream::on_downstream_header_complete(Downstream *downstream) {
 int Http3Upstream::on_downstream_body(Downstream *downstream,
                                       const uint8_t *data, size_t len,
                                       bool flush) {
-  auto body = downstream->get_response_buf();
+  auto body = downstream->get_response_body_buf();
   body->append(data, len);
 
   if (flush) {
@@ -1511,9 +1516,8 @@ int Http3Upstream::on_downstream_body_complete(Downstream *downstream) {
 
 void Http3Upstream::on_handler_delete() {
   for (auto d = downstream_queue_.get_downstreams(); d; d = d->dlnext) {
-    if (d->get_dispatch_state() == DispatchState::ACTIVE &&
-        d->accesslog_ready()) {
-      handler_->write_accesslog(d);
+    if (d->get_dispatch_state() == DispatchState::ACTIVE) {
+      handler_->finish_downstream(d);
     }
   }
 
@@ -1671,11 +1675,19 @@ void Http3Upstream::pause_read(IOCtrlReason reason) {}
 
 int Http3Upstream::resume_read(IOCtrlReason reason, Downstream *downstream,
                                size_t consumed) {
-  consume(downstream->get_stream_id(), consumed);
+  // The buffered request body has been consumed when it was
+  // received.  The spooled one is sent as the backend drains it.
+  if (downstream->get_buffer_request()) {
+    if (downstream->refill_request_buf() != 0) {
+      return -1;
+    }
+  } else {
+    consume(downstream->get_stream_id(), consumed);
 
-  auto &req = downstream->request();
+    auto &req = downstream->request();
 
-  req.consume(consumed);
+    req.consume(consumed);
+  }
 
   handler_->signal_write();
 
@@ -1790,6 +1802,12 @@ bool Http3Upstream::push_enabled() const { return false; }
 void Http3Upstream::cancel_premature_downstream(
   Downstream *promised_downstream) {}
 
+void Http3Upstream::on_downstream_slot_acquired(Downstream *downstream) {
+  start_downstream(downstream);
+
+  handler_->signal_write();
+}
+
 int Http3Upstream::on_read(const UpstreamAddr *faddr,
                            const Address &remote_addr,
                            const Address &local_addr, const ngtcp2_pkt_info &pi,
@@ -2102,6 +2120,14 @@ int Http3Upstream::http_acked_stream_data(Downstream *downstream,
 
   assert(datalen == drained);
 
+  if (downstream->response_spooled()) {
+    if (downstream->refill_response_buf() != 0) {
+      return -1;
+    }
+
+    nghttp3_conn_resume_stream(httpconn_, downstream->get_stream_id());
+  }
+
   if (downstream->resume_read(SHRPX_NO_BUFFER, datalen) != 0) {
     return -1;
   }
@@ -2375,6 +2401,14 @@ int Http3Upstream::http_end_request_headers(Downstream *downstream, int fin) {
     return 0;
   }
 
+  // Receive the entire request body before a backend is selected.
+  // The request is started in http_end_stream().
+  if (req.http2_expect_body && handler_->should_buffer_request(downstream)) {
+    downstream->set_buffer_request(true);
+
+    return 0;
+  }
+
   start_downstream(downstream);
 
   return 0;
@@ -2386,7 +2420,22 @@ void Http3Upstream::start_downstream(Downstream *downstream) {
     return;
   }
 
-  downstream_queue_.mark_blocked(downstream);
+  nghttp3_pri pri;
+
+  if (nghttp3_conn_get_stream_priority(httpconn_, &pri,
+                                       downstream->get_stream_id()) != 0) {
+    pri.urgency = NGHTTP3_DEFAULT_URGENCY;
+    pri.inc = 0;
+  }
+
+  auto priority = downstream->request().fs.header(http2::HD_PRIORITY);
+  if (priority) {
+    nghttp3_pri_parse_priority(
+      &pri, reinterpret_cast<const uint8_t *>(priority->value.data()),
+      priority->value.size());
+  }
+
+  downstream_queue_.mark_blocked(downstream, pri.urgency);
 }
 
 void Http3Upstream::initiate_downstream(Downstream *downstream) {
@@ -2399,12 +2448,17 @@ void Http3Upstream::initiate_downstream(Downstream *downstream) {
   for (;;) {
     auto dconn = handler_->get_downstream_connection(rv, downstream);
     if (!dconn) {
+      if (rv == SHRPX_ERR_QUEUED) {
+        // on_downstream_slot_acquired() is called later.
+        return;
+      }
+
       if (rv == SHRPX_ERR_TLS_REQUIRED) {
         assert(0);
         abort();
       }
 
-      rv = error_reply(downstream, 502);
+      rv = error_reply(downstream, rv == SHRPX_ERR_RATE_LIMITED ? 429 : 502);
       if (rv != 0) {
         shutdown_stream(downstream, NGHTTP3_H3_INTERNAL_ERROR);
       }
@@ -2494,6 +2548,13 @@ int Http3Upstream::http_recv_data(Downstream *downstream,
     return 0;
   }
 
+  // The buffered request body is not forwarded until it is entirely
+  // received.  Consume it now so that the client can send the rest,
+  // unless it would exceed the memory budget.
+  if (downstream->request_buffering()) {
+    consume_buffered_request_body(downstream);
+  }
+
   return 0;
 }
 
@@ -2526,9 +2587,49 @@ int Http3Upstream::http_end_stream(Downstream *downstream) {
 
   downstream->set_request_state(DownstreamState::MSG_COMPLETE);
 
+  if (downstream->request_buffering() &&
+      downstream->get_response_state() != DownstreamState::MSG_COMPLETE) {
+    downstream->end_request_buffering();
+
+    auto &req = downstream->request();
+
+    consume(downstream->get_stream_id(), req.unconsumed_body_length);
+
+    req.unconsumed_body_length = 0;
+
+    consume_buffered_request_bodies();
+
+    start_downstream(downstream);
+  }
+
   return 0;
 }
 
+void Http3Upstream::consume_buffered_request_body(Downstream *downstream) {
+  auto &req = downstream->request();
+
+  // The oldest buffered request always makes progress so that the
+  // requests waiting for the memory budget do not wait for each
+  // other.
+  if (req.unconsumed_body_length == 0 ||
+      (handler_->buffered_request_memory_exceeded() &&
+       downstream_queue_.get_first_request_buffering() != downstream)) {
+    return;
+  }
+
+  consume(downstream->get_stream_id(), req.unconsumed_body_length);
+
+  req.unconsumed_body_length = 0;
+}
+
+void Http3Upstream::consume_buffered_request_bodies() {
+  for (auto d = downstream_queue_.get_downstreams(); d; d = d->dlnext) {
+    if (d->request_buffering()) {
+      consume_buffered_request_body(d);
+    }
+  }
+}
+
 namespace {
 int http_stream_close(nghttp3_conn *conn, int64_t stream_id,
                       uint64_t app_error_code, void *conn_user_data,
@@ -2830,25 +2931,50 @@ void Http3Upstream::consume(int64_t stream_id, size_t nconsumed) {
 }
 
 void Http3Upstream::remove_downstream(Downstream *downstream) {
-  if (downstream->accesslog_ready()) {
-    handler_->write_accesslog(downstream);
-  }
+  handler_->finish_downstream(downstream);
 
   nghttp3_conn_set_stream_user_data(httpconn_, downstream->get_stream_id(),
                                     nullptr);
 
+  auto request_buffering = downstream->request_buffering();
+
   auto next_downstream = downstream_queue_.remove_and_get_blocked(downstream);
 
+  if (request_buffering) {
+    // downstream has released the buffered request body.
+    consume_buffered_request_bodies();
+  }
+
   if (next_downstream) {
     initiate_downstream(next_downstream);
   }
 
+  send_shed_downstreams();
+
   if (downstream_queue_.get_downstreams() == nullptr) {
     // There is no downstream at the moment.  Start idle timer now.
     handler_->repeat_read_timer();
   }
 }
 
+void Http3Upstream::send_shed_downstreams() {
+  auto metrics = handler_->get_worker()->get_metrics();
+
+  for (auto downstream = downstream_queue_.pop_shed(); downstream;
+       downstream = downstream_queue_.pop_shed()) {
+    if (LOG_ENABLED(INFO)) {
+      ULOG(INFO, this) << "Shed queued request stream_id="
+                       << downstream->get_stream_id();
+    }
+
+    metrics->streams_shed_total.inc();
+
+    if (error_reply(downstream, 503) != 0) {
+      shutdown_stream(downstream, NGHTTP3_H3_INTERNAL_ERROR);
+    }
+  }
+}
+
 void Http3Upstream::log_response_headers(
   Downstream *downstream, const std::vector<nghttp3_nv> &nva) const {
   std::stringstream ss;
@@ -91,6 +91,7 @@ public:
                                       Downstream *promised_downstream);
   virtual bool push_enabled() const;
   virtual void cancel_premature_downstream(Downstream *promised_downstream);
+  virtual void on_downstream_slot_acquired(Downstream *downstream);
 
   int init(const UpstreamAddr *faddr, const Address &remote_addr,
            const Address &local_addr, const ngtcp2_pkt_hd &initial_hd,
@@ -128,7 +129,18 @@ public:
   int shutdown_stream_read(int64_t stream_id, uint64_t app_error_code);
   int http_stream_close(Downstream *downstream, uint64_t app_error_code);
   void consume(int64_t stream_id, size_t nconsumed);
+  // Consumes the request body of |downstream| which is buffered by
+  // buffer-request parameter unless the memory budget of this
+  // connection is exceeded.
+  void consume_buffered_request_body(Downstream *downstream);
+  // Consumes the request body which has not been consumed because of
+  // the memory budget.  Call this function when the buffered request
+  // body is released from memory.
+  void consume_buffered_request_bodies();
   void remove_downstream(Downstream *downstream);
+  // Sends 503 response to the queued requests which are shed by
+  // downstream_queue_.
+  void send_shed_downstreams();
   int stream_close(int64_t stream_id, uint64_t app_error_code);
   void log_response_headers(Downstream *downstream,
                             const std::vector<nghttp3_nv> &nva) const;
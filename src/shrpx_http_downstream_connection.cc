@@ -46,6 +46,7 @@
 #include "shrpx_http2_session.h"
 #include "shrpx_tls.h"
 #include "shrpx_log.h"
+#include "shrpx_splice_pipe.h"
 #include "http2.h"
 #include "util.h"
 
@@ -62,11 +63,21 @@ void timeoutcb(struct ev_loop *loop, ev_timer *w, int revents) {
     return;
   }
 
+  if (w == &conn->wt && !conn->expired_wt()) {
+    return;
+  }
+
   if (LOG_ENABLED(INFO)) {
     DCLOG(INFO, dconn) << "Time out";
   }
 
   auto downstream = dconn->get_downstream();
+
+  if (downstream->get_hedge_connection()) {
+    downstream->settle_hedge(dconn, false);
+    return;
+  }
+
   auto upstream = downstream->get_upstream();
   auto handler = upstream->get_client_handler();
   auto &resp = downstream->response();
@@ -142,12 +153,25 @@ void connect_timeoutcb(struct ev_loop *loop, ev_timer *w, int revents) {
 
   auto downstream = dconn->get_downstream();
 
+  if (downstream->get_hedge_connection() == dconn) {
+    downstream->cancel_hedge();
+    return;
+  }
+
   retry_downstream_connection(downstream, 504);
 }
 } // namespace
 
 namespace {
-void backend_retry(Downstream *downstream) {
+void backend_retry(HttpDownstreamConnection *dconn) {
+  auto downstream = dconn->get_downstream();
+
+  // The original request is still in flight if the hedged one fails.
+  if (downstream->get_hedge_connection() == dconn) {
+    downstream->cancel_hedge();
+    return;
+  }
+
   retry_downstream_connection(downstream, 502);
 }
 } // namespace
@@ -161,10 +185,19 @@ void readcb(struct ev_loop *loop, ev_io *w, int revents) {
   auto upstream = downstream->get_upstream();
   auto handler = upstream->get_client_handler();
 
+  // The first one which receives response wins if the hedged request
+  // is in flight.
+  if (downstream->get_hedge_connection()) {
+    rv = dconn->peek_response();
+    if (rv == 0 || !downstream->settle_hedge(dconn, rv > 0)) {
+      return;
+    }
+  }
+
   rv = upstream->downstream_read(dconn);
   if (rv != 0) {
     if (rv == SHRPX_ERR_RETRY) {
-      backend_retry(downstream);
+      backend_retry(dconn);
       return;
     }
 
@@ -182,9 +215,24 @@ void writecb(struct ev_loop *loop, ev_io *w, int revents) {
   auto upstream = downstream->get_upstream();
   auto handler = upstream->get_client_handler();
 
+  if (downstream->get_hedge_connection()) {
+    // The request buffer only holds the hedged request.  The original
+    // request has been written.
+    if (downstream->get_hedge_connection() != dconn) {
+      conn->wlimit.stopw();
+      return;
+    }
+
+    if (dconn->on_write() != 0) {
+      downstream->cancel_hedge();
+    }
+
+    return;
+  }
+
   rv = upstream->downstream_write(dconn);
   if (rv == SHRPX_ERR_RETRY) {
-    backend_retry(downstream);
+    backend_retry(dconn);
     return;
   }
 
@@ -198,9 +246,8 @@ namespace {
 void connectcb(struct ev_loop *loop, ev_io *w, int revents) {
   auto conn = static_cast<Connection *>(w->data);
   auto dconn = static_cast<HttpDownstreamConnection *>(conn->data);
-  auto downstream = dconn->get_downstream();
   if (dconn->connected() != 0) {
-    backend_retry(downstream);
+    backend_retry(dconn);
     return;
   }
   writecb(loop, w, revents);
@@ -225,6 +272,7 @@ HttpDownstreamConnection::HttpDownstreamConnection(
     raddr_(nullptr),
     ioctrl_(&conn_.rlimit),
     response_htp_{0},
+    response_splice_left_(0),
     first_write_done_(false),
     reusable_(true),
     request_header_written_(false) {}
@@ -238,6 +286,10 @@ HttpDownstreamConnection::~HttpDownstreamConnection() {
     auto dns_tracker = worker_->get_dns_tracker();
     dns_tracker->cancel(dns_query_.get());
   }
+
+  if (downstream_) {
+    --addr_->num_inflight;
+  }
 }
 
 int HttpDownstreamConnection::attach_downstream(Downstream *downstream) {
@@ -255,6 +307,8 @@ int HttpDownstreamConnection::attach_downstream(Downstream *downstream) {
     return rv;
   }
 
+  ++addr_->num_inflight;
+
   return 0;
 }
 
@@ -290,9 +344,11 @@ int HttpDownstreamConnection::initiate_connection() {
     return SHRPX_ERR_NETWORK;
   }
 
-  auto &downstreamconf = *worker_->get_downstream_config();
-
   if (conn_.fd == -1) {
+    auto &timings = downstream_->timings();
+    timings.backend_connect_start = std::chrono::high_resolution_clock::now();
+    timings.backend_connect_end = {};
+
     auto check_dns_result = dns_query_.get() != nullptr;
 
     if (check_dns_result) {
@@ -325,8 +381,7 @@ int HttpDownstreamConnection::initiate_connection() {
             rv = this->initiate_connection();
             if (rv != 0) {
               // This callback destroys |this|.
-              auto downstream = this->downstream_;
-              backend_retry(downstream);
+              backend_retry(this);
             }
           });
 
@@ -367,90 +422,104 @@ int HttpDownstreamConnection::initiate_connection() {
       raddr = &addr_->addr;
     }
 
-    conn_.fd = util::create_nonblock_socket(raddr->su.storage.ss_family);
+    rv = connect_to(raddr);
+    if (rv != 0) {
+      return rv;
+    }
+  } else {
+    // we may set read timer cb to idle_timeoutcb.  Reset again.
+    ev_set_cb(&conn_.rt, timeoutcb);
+    if (conn_.read_timeout < group_->shared_addr->timeout.read) {
+      conn_.read_timeout = group_->shared_addr->timeout.read;
+      conn_.last_read = std::chrono::steady_clock::now();
+    } else {
+      conn_.again_rt(group_->shared_addr->timeout.read);
+    }
+
+    ev_set_cb(&conn_.rev, readcb);
 
-    if (conn_.fd == -1) {
-      auto error = errno;
-      DCLOG(WARN, this) << "socket() failed; addr="
-                        << util::to_numeric_addr(raddr) << ", errno=" << error;
+    on_write_ = &HttpDownstreamConnection::write_first;
+    first_write_done_ = false;
+    request_header_written_ = false;
+  }
 
-      worker_blocker->on_failure();
+  llhttp_init(&response_htp_, HTTP_RESPONSE, &htp_hooks);
+  response_htp_.data = downstream_;
 
-      return SHRPX_ERR_NETWORK;
-    }
+  return 0;
+}
 
-    worker_blocker->on_success();
+int HttpDownstreamConnection::connect_to(const Address *raddr) {
+  int rv;
 
-    rv = connect(conn_.fd, &raddr->su.sa, raddr->len);
-    if (rv != 0 && errno != EINPROGRESS) {
-      auto error = errno;
-      DCLOG(WARN, this) << "connect() failed; addr="
-                        << util::to_numeric_addr(raddr) << ", errno=" << error;
+  auto worker_blocker = worker_->get_connect_blocker();
+  auto &downstreamconf = *worker_->get_downstream_config();
 
-      downstream_failure(addr_, raddr);
+  conn_.fd = util::create_nonblock_socket(raddr->su.storage.ss_family);
 
-      return SHRPX_ERR_NETWORK;
-    }
+  if (conn_.fd == -1) {
+    auto error = errno;
+    DCLOG(WARN, this) << "socket() failed; addr="
+                      << util::to_numeric_addr(raddr) << ", errno=" << error;
 
-    if (LOG_ENABLED(INFO)) {
-      DCLOG(INFO, this) << "Connecting to downstream server";
-    }
+    worker_blocker->on_failure();
 
-    raddr_ = raddr;
+    return SHRPX_ERR_NETWORK;
+  }
 
-    if (addr_->tls) {
-      assert(ssl_ctx_);
+  worker_blocker->on_success();
 
-      auto ssl = tls::create_ssl(ssl_ctx_);
-      if (!ssl) {
-        return -1;
-      }
+  rv = connect(conn_.fd, &raddr->su.sa, raddr->len);
+  if (rv != 0 && errno != EINPROGRESS) {
+    auto error = errno;
+    DCLOG(WARN, this) << "connect() failed; addr="
+                      << util::to_numeric_addr(raddr) << ", errno=" << error;
 
-      tls::setup_downstream_http1_alpn(ssl);
+    downstream_failure(addr_, raddr);
 
-      conn_.set_ssl(ssl);
-      conn_.tls.client_session_cache = &addr_->tls_session_cache;
+    return SHRPX_ERR_NETWORK;
+  }
 
-      auto sni_name = addr_->sni.empty() ? addr_->host : addr_->sni;
-      if (!util::numeric_host(sni_name.data())) {
-        SSL_set_tlsext_host_name(conn_.tls.ssl, sni_name.data());
-      }
+  if (LOG_ENABLED(INFO)) {
+    DCLOG(INFO, this) << "Connecting to downstream server";
+  }
 
-      auto session = tls::reuse_tls_session(addr_->tls_session_cache);
-      if (session) {
-        SSL_set_session(conn_.tls.ssl, session);
-        SSL_SESSION_free(session);
-      }
+  raddr_ = raddr;
+
+  if (addr_->tls) {
+    assert(ssl_ctx_);
 
-      conn_.prepare_client_handshake();
+    auto ssl = tls::create_ssl(ssl_ctx_);
+    if (!ssl) {
+      return -1;
     }
 
-    ev_io_set(&conn_.wev, conn_.fd, EV_WRITE);
-    ev_io_set(&conn_.rev, conn_.fd, EV_READ);
+    tls::setup_downstream_http1_alpn(ssl);
 
-    conn_.wlimit.startw();
+    conn_.set_ssl(ssl);
+    conn_.tls.client_session_cache = &addr_->tls_session_cache;
 
-    conn_.wt.repeat = downstreamconf.timeout.connect;
-    ev_timer_again(conn_.loop, &conn_.wt);
-  } else {
-    // we may set read timer cb to idle_timeoutcb.  Reset again.
-    ev_set_cb(&conn_.rt, timeoutcb);
-    if (conn_.read_timeout < group_->shared_addr->timeout.read) {
-      conn_.read_timeout = group_->shared_addr->timeout.read;
-      conn_.last_read = std::chrono::steady_clock::now();
-    } else {
-      conn_.again_rt(group_->shared_addr->timeout.read);
+    auto sni_name = addr_->sni.empty() ? addr_->host : addr_->sni;
+    if (!util::numeric_host(sni_name.data())) {
+      SSL_set_tlsext_host_name(conn_.tls.ssl, sni_name.data());
     }
 
-    ev_set_cb(&conn_.rev, readcb);
+    auto session = tls::reuse_tls_session(addr_->tls_session_cache);
+    if (session) {
+      SSL_set_session(conn_.tls.ssl, session);
+      SSL_SESSION_free(session);
+    }
 
-    on_write_ = &HttpDownstreamConnection::write_first;
-    first_write_done_ = false;
-    request_header_written_ = false;
+    conn_.prepare_client_handshake();
   }
 
-  llhttp_init(&response_htp_, HTTP_RESPONSE, &htp_hooks);
-  response_htp_.data = downstream_;
+  ev_io_set(&conn_.wev, conn_.fd, EV_WRITE);
+  ev_io_set(&conn_.rev, conn_.fd, EV_READ);
+
+  conn_.wlimit.startw();
+
+  conn_.wt.repeat = downstreamconf.timeout.connect;
+  ev_timer_again(conn_.loop, &conn_.wt);
 
   return 0;
 }
@@ -472,6 +541,9 @@ int HttpDownstreamConnection::push_request_headers() {
 
   request_header_written_ = true;
 
+  downstream_->timings().backend_request_start =
+    std::chrono::high_resolution_clock::now();
+
   // For HTTP/1.0 request, there is no authority in request.  In that
   // case, we use backend server's host nonetheless.
   auto authority = addr_->hostport;
@@ -821,6 +893,17 @@ namespace {
 void idle_readcb(struct ev_loop *loop, ev_io *w, int revents) {
   auto conn = static_cast<Connection *>(w->data);
   auto dconn = static_cast<HttpDownstreamConnection *>(conn->data);
+
+  if (conn->tls.ssl) {
+    // Post-handshake messages (e.g., TLSv1.3 NewSessionTicket) may
+    // arrive while the connection is idle.  This is typical for the
+    // connection established in advance.
+    std::array<uint8_t, 1> buf;
+    if (conn->read_tls(buf.data(), buf.size()) == 0) {
+      return;
+    }
+  }
+
   if (LOG_ENABLED(INFO)) {
     DCLOG(INFO, dconn) << "Idle connection EOF";
   }
@@ -854,6 +937,8 @@ void HttpDownstreamConnection::detach_downstream(Downstream *downstream) {
   }
   downstream_ = nullptr;
 
+  --addr_->num_inflight;
+
   ev_set_cb(&conn_.rev, idle_readcb);
   ioctrl_.force_resume_read();
 
@@ -871,6 +956,111 @@ void HttpDownstreamConnection::detach_downstream(Downstream *downstream) {
   ev_timer_stop(conn_.loop, &conn_.wt);
 }
 
+namespace {
+void prewarm_timeoutcb(struct ev_loop *loop, ev_timer *w, int revents) {
+  auto conn = static_cast<Connection *>(w->data);
+  auto dconn = static_cast<HttpDownstreamConnection *>(conn->data);
+
+  if (w == &conn->rt && !conn->expired_rt()) {
+    return;
+  }
+
+  if (w == &conn->wt && !conn->expired_wt()) {
+    return;
+  }
+
+  if (LOG_ENABLED(INFO)) {
+    DCLOG(INFO, dconn) << "Time out while establishing connection in advance";
+  }
+
+  downstream_failure(dconn->get_addr(), dconn->get_raddr());
+
+  remove_from_pool(dconn);
+  // dconn was deleted
+}
+} // namespace
+
+namespace {
+void prewarm_readcb(struct ev_loop *loop, ev_io *w, int revents) {
+  auto conn = static_cast<Connection *>(w->data);
+  auto dconn = static_cast<HttpDownstreamConnection *>(conn->data);
+
+  if (dconn->on_read() != 0) {
+    remove_from_pool(dconn);
+    // dconn was deleted
+  }
+}
+} // namespace
+
+namespace {
+void prewarm_writecb(struct ev_loop *loop, ev_io *w, int revents) {
+  auto conn = static_cast<Connection *>(w->data);
+  auto dconn = static_cast<HttpDownstreamConnection *>(conn->data);
+
+  if (dconn->on_write() != 0) {
+    remove_from_pool(dconn);
+    // dconn was deleted
+  }
+}
+} // namespace
+
+namespace {
+void prewarm_connectcb(struct ev_loop *loop, ev_io *w, int revents) {
+  auto conn = static_cast<Connection *>(w->data);
+  auto dconn = static_cast<HttpDownstreamConnection *>(conn->data);
+
+  if (dconn->connected() != 0) {
+    remove_from_pool(dconn);
+    // dconn was deleted
+  }
+}
+} // namespace
+
+int HttpDownstreamConnection::prewarm() {
+  assert(conn_.fd == -1);
+  assert(!addr_->dns);
+
+  if (worker_->get_connect_blocker()->blocked() ||
+      addr_->connect_blocker->blocked()) {
+    return -1;
+  }
+
+  auto rv = connect_to(&addr_->addr);
+  if (rv != 0) {
+    return rv;
+  }
+
+  ev_set_cb(&conn_.wev, prewarm_connectcb);
+  ev_set_cb(&conn_.rev, prewarm_readcb);
+  ev_set_cb(&conn_.rt, prewarm_timeoutcb);
+  ev_set_cb(&conn_.wt, prewarm_timeoutcb);
+
+  return 0;
+}
+
+int HttpDownstreamConnection::on_prewarmed() {
+  if (LOG_ENABLED(INFO)) {
+    DCLOG(INFO, this) << "Connection established in advance";
+  }
+
+  ev_set_cb(&conn_.wev, writecb);
+  ev_set_cb(&conn_.wt, timeoutcb);
+
+  ev_set_cb(&conn_.rev, idle_readcb);
+  ev_set_cb(&conn_.rt, idle_timeoutcb);
+
+  auto &downstreamconf = *worker_->get_downstream_config();
+
+  conn_.again_rt(downstreamconf.timeout.idle_read);
+
+  conn_.wlimit.stopw();
+  ev_timer_stop(conn_.loop, &conn_.wt);
+
+  addr_->dconn_pool->on_prewarmed(this);
+
+  return 0;
+}
+
 void HttpDownstreamConnection::pause_read(IOCtrlReason reason) {
   ioctrl_.pause_read(reason);
 }
@@ -879,6 +1069,10 @@ int HttpDownstreamConnection::resume_read(IOCtrlReason reason,
                                           size_t consumed) {
   auto &downstreamconf = *worker_->get_downstream_config();
 
+  if (auto pipe = downstream_->get_response_pipe(); pipe && pipe->full()) {
+    return 0;
+  }
+
   if (downstream_->get_response_buf()->rleft() <=
       downstreamconf.request_buffer_size / 2) {
     ioctrl_.resume_read(reason);
@@ -995,6 +1189,11 @@ int htp_hdrs_completecb(llhttp_t *htp) {
 
   resp.connection_close = !llhttp_should_keep_alive(htp);
   downstream->set_response_state(DownstreamState::HEADER_COMPLETE);
+  downstream->timings().response_header_end =
+    std::chrono::high_resolution_clock::now();
+  downstream_response_header_received(
+    dconn->get_downstream_addr_group()->shared_addr.get(), dconn->get_addr(),
+    downstream->timings());
   downstream->inspect_http1_response();
 
   if (htp->flags & F_CHUNKED) {
@@ -1050,7 +1249,19 @@ int htp_hdrs_completecb(llhttp_t *htp) {
 
   // TODO It seems that the cases other than HEAD are handled by
   // llhttp.  Need test.
-  return !http2::expect_response_body(req.method, resp.http_status);
+  if (!http2::expect_response_body(req.method, resp.http_status)) {
+    return 1;
+  }
+
+  // Stop parsing just after the header fields so that the response
+  // body is relayed with splice(2).  See
+  // HttpDownstreamConnection::process_input().
+  if (static_cast<HttpDownstreamConnection *>(dconn)
+        ->response_body_splicable()) {
+    return HPE_PAUSED;
+  }
+
+  return 0;
 }
 } // namespace
 
@@ -1269,6 +1480,10 @@ int HttpDownstreamConnection::read_clear() {
       return rv;
     }
 
+    if (response_splice_left_) {
+      return read_splice_body();
+    }
+
     if (!ev_is_active(&conn_.rev)) {
       return 0;
     }
@@ -1321,6 +1536,161 @@ int HttpDownstreamConnection::write_clear() {
   return 0;
 }
 
+int HttpDownstreamConnection::read_splice() {
+  conn_.last_read = std::chrono::steady_clock::now();
+
+  auto handler = downstream_->get_upstream()->get_client_handler();
+  auto pipe = downstream_->get_response_pipe();
+
+  for (;;) {
+    if (pipe->full()) {
+      downstream_->pause_read(SHRPX_NO_BUFFER);
+      return 0;
+    }
+
+    auto nread = conn_.splice_read(*pipe, pipe->capacity);
+    if (nread == 0) {
+      return 0;
+    }
+
+    if (nread < 0) {
+      return static_cast<int>(nread);
+    }
+
+    downstream_->response_sent_body_length += nread;
+
+    handler->signal_write();
+
+    if (!ev_is_active(&conn_.rev)) {
+      return 0;
+    }
+  }
+}
+
+int HttpDownstreamConnection::read_splice_body() {
+  conn_.last_read = std::chrono::steady_clock::now();
+
+  auto upstream = downstream_->get_upstream();
+  auto handler = upstream->get_client_handler();
+  auto pipe = downstream_->get_response_pipe();
+  auto &resp = downstream_->response();
+
+  while (response_splice_left_) {
+    if (!ev_is_active(&conn_.rev)) {
+      return 0;
+    }
+
+    if (pipe->full()) {
+      downstream_->pause_read(SHRPX_NO_BUFFER);
+      return 0;
+    }
+
+    auto nread =
+      conn_.splice_read(*pipe, static_cast<size_t>(response_splice_left_));
+    if (nread == 0) {
+      return 0;
+    }
+
+    if (nread < 0) {
+      if (nread == SHRPX_ERR_EOF && LOG_ENABLED(INFO)) {
+        DCLOG(INFO, this) << "HTTP response ended prematurely";
+      }
+
+      return -1;
+    }
+
+    resp.recv_body_length += nread;
+    downstream_->response_sent_body_length += nread;
+    response_splice_left_ -= nread;
+
+    handler->signal_write();
+  }
+
+  on_read_ = &HttpDownstreamConnection::read_clear;
+
+  // See htp_msg_completecb().
+  downstream_->set_response_state(DownstreamState::MSG_COMPLETE);
+  downstream_->pause_read(SHRPX_MSG_BLOCK);
+
+  return upstream->on_downstream_body_complete(downstream_);
+}
+
+int HttpDownstreamConnection::write_splice() {
+  conn_.last_read = std::chrono::steady_clock::now();
+
+  auto upstream = downstream_->get_upstream();
+  auto input = downstream_->get_request_buf();
+  auto pipe = downstream_->get_request_pipe();
+
+  std::array<struct iovec, MAX_WR_IOVCNT> iov;
+
+  for (;;) {
+    nghttp2_ssize nwrite;
+
+    // The data in request buffer precede the data in the pipe.
+    if (input->rleft()) {
+      auto iovcnt = input->riovec(iov.data(), iov.size());
+
+      nwrite = conn_.writev_clear(iov.data(), iovcnt);
+      if (nwrite > 0) {
+        input->drain(as_unsigned(nwrite));
+      }
+    } else if (pipe->len) {
+      nwrite = conn_.splice_write(*pipe);
+    } else {
+      break;
+    }
+
+    if (nwrite == 0) {
+      return 0;
+    }
+
+    if (nwrite < 0) {
+      // See write_clear().
+      ev_feed_event(conn_.loop, &conn_.rev, EV_READ);
+      on_write_ = &HttpDownstreamConnection::noop;
+      reusable_ = false;
+      return 0;
+    }
+  }
+
+  conn_.wlimit.stopw();
+  ev_timer_stop(conn_.loop, &conn_.wt);
+
+  upstream->resume_read(SHRPX_NO_BUFFER, downstream_, 0);
+
+  return 0;
+}
+
+void HttpDownstreamConnection::start_splice() {
+  if (!get_config()->conn.splice || conn_.tls.ssl ||
+      !downstream_->get_request_header_sent()) {
+    return;
+  }
+
+  auto upstream = downstream_->get_upstream();
+  if (upstream->start_splice(downstream_) != 0) {
+    return;
+  }
+
+  on_read_ = &HttpDownstreamConnection::read_splice;
+  on_write_ = &HttpDownstreamConnection::write_splice;
+
+  if (LOG_ENABLED(INFO)) {
+    DCLOG(INFO, this) << "Relay tunnel with splice";
+  }
+}
+
+bool HttpDownstreamConnection::response_body_splicable() const {
+  const auto &resp = downstream_->response();
+
+  return get_config()->conn.splice && !conn_.tls.ssl &&
+         downstream_->get_response_state() ==
+           DownstreamState::HEADER_COMPLETE &&
+         !downstream_->get_upgraded() && resp.fs.content_length > 0 &&
+         !resp.fs.header(http2::HD_TRANSFER_ENCODING);
+}
+
 int HttpDownstreamConnection::tls_handshake() {
   ERR_clear_error();
 
@@ -1354,17 +1724,60 @@ int HttpDownstreamConnection::tls_handshake() {
 
   connect_blocker->on_success();
 
-  ev_set_cb(&conn_.rt, timeoutcb);
-  ev_set_cb(&conn_.wt, timeoutcb);
-
   on_read_ = &HttpDownstreamConnection::read_tls;
   on_write_ = &HttpDownstreamConnection::write_first;
 
+  if (!downstream_) {
+    return on_prewarmed();
+  }
+
+  downstream_->timings().backend_connect_end =
+    std::chrono::high_resolution_clock::now();
+
+  ev_set_cb(&conn_.rt, timeoutcb);
+  ev_set_cb(&conn_.wt, timeoutcb);
+
   // TODO Check negotiated ALPN
 
   return on_write();
 }
 
+int HttpDownstreamConnection::peek_response() {
+  if (conn_.tls.ssl) {
+    if (!conn_.tls.initial_handshake_done) {
+      return on_read() == 0 ? 0 : -1;
+    }
+
+    ERR_clear_error();
+
+    uint8_t b;
+    auto rv = SSL_peek(conn_.tls.ssl, &b, 1);
+    if (rv > 0) {
+      return 1;
+    }
+
+    switch (SSL_get_error(conn_.tls.ssl, rv)) {
+    case SSL_ERROR_WANT_READ:
+    case SSL_ERROR_WANT_WRITE:
+      return 0;
+    default:
+      return -1;
+    }
+  }
+
+  uint8_t b;
+  ssize_t nread;
+
+  while ((nread = recv(conn_.fd, &b, 1, MSG_PEEK)) == -1 && errno == EINTR)
+    ;
+
+  if (nread == -1) {
+    return errno == EAGAIN || errno == EWOULDBLOCK ? 0 : -1;
+  }
+
+  return nread == 0 ? -1 : 1;
+}
+
 int HttpDownstreamConnection::read_tls() {
   conn_.last_read = std::chrono::steady_clock::now();
 
@@ -1485,6 +1898,42 @@ int HttpDownstreamConnection::process_input(const uint8_t *data,
                                          llhttp_get_error_pos(&response_htp_)) -
                                        data);
 
+  if (htperr == HPE_PAUSED) {
+    // htp_hdrs_completecb() paused the parser to relay the response
+    // body with splice(2).  The part of body which has already been
+    // read is sent from the response buffer.  If it contains the
+    // whole body, or frontend cannot splice, parse it as usual.
+    auto &resp = downstream_->response();
+    auto bodylen = datalen - nproc;
+    auto left = resp.fs.content_length - as_signed(bodylen);
+
+    if (left <= 0 || downstream_->get_upstream()->start_response_splice(
+                       downstream_) != 0) {
+      llhttp_resume(&response_htp_);
+
+      return process_input(data + nproc, bodylen);
+    }
+
+    if (bodylen) {
+      resp.recv_body_length += bodylen;
+
+      rv = downstream_->get_upstream()->on_downstream_body(
+        downstream_, data + nproc, bodylen, true);
+      if (rv != 0) {
+        return rv;
+      }
+    }
+
+    response_splice_left_ = left;
+    on_read_ = &HttpDownstreamConnection::read_splice_body;
+
+    if (LOG_ENABLED(INFO)) {
+      DCLOG(INFO, this) << "Relay response body with splice";
+    }
+
+    return 0;
+  }
+
   if (htperr != HPE_OK &&
       (!downstream_->get_upgraded() || htperr != HPE_PAUSED_UPGRADE)) {
     // Handling early return (in other words, response was hijacked by
@@ -1503,6 +1952,8 @@ int HttpDownstreamConnection::process_input(const uint8_t *data,
   }
 
   if (downstream_->get_upgraded()) {
+    start_splice();
+
     if (nproc < datalen) {
       // Data from data + nproc are for upgraded protocol.
       rv = downstream_->get_upstream()->on_downstream_body(
@@ -1554,7 +2005,9 @@ int HttpDownstreamConnection::connected() {
   conn_.rlimit.startw();
   conn_.again_rt();
 
-  ev_set_cb(&conn_.wev, writecb);
+  // downstream_ is nullptr if this connection is established in
+  // advance by prewarm().
+  ev_set_cb(&conn_.wev, downstream_ ? writecb : prewarm_writecb);
 
   if (conn_.tls.ssl) {
     on_read_ = &HttpDownstreamConnection::tls_handshake;
@@ -1567,12 +2020,19 @@ int HttpDownstreamConnection::connected() {
 
   connect_blocker->on_success();
 
-  ev_set_cb(&conn_.rt, timeoutcb);
-  ev_set_cb(&conn_.wt, timeoutcb);
-
   on_read_ = &HttpDownstreamConnection::read_clear;
   on_write_ = &HttpDownstreamConnection::write_first;
 
+  if (!downstream_) {
+    return on_prewarmed();
+  }
+
+  downstream_->timings().backend_connect_end =
+    std::chrono::high_resolution_clock::now();
+
+  ev_set_cb(&conn_.rt, timeoutcb);
+  ev_set_cb(&conn_.wt, timeoutcb);
+
   return 0;
 }
 
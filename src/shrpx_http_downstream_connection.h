@@ -71,14 +71,40 @@ public:
   virtual DownstreamAddr *get_addr() const;
 
   int initiate_connection();
+  // Starts connecting to the backend without a request attached so
+  // that the connection is put into the connection pool when it is
+  // established.  The caller must add this object to the pool by
+  // DownstreamConnectionPool::add_prewarming_downstream_connection()
+  // if this function succeeds.
+  int prewarm();
+  int on_prewarmed();
 
   int write_first();
   int read_clear();
   int write_clear();
   int read_tls();
   int write_tls();
+  // Relay the tunneled data with splice(2).
+  int read_splice();
+  int write_splice();
+  // Relays the rest of the response body with splice(2), and
+  // completes the response when content-length bytes are received.
+  int read_splice_body();
+
+  // Checks whether the response has started arriving without
+  // consuming it.  The TLS handshake is advanced if it has not
+  // finished yet.  This function returns 1 if data is available, 0
+  // if nothing has arrived yet, or -1 if the connection has failed.
+  int peek_response();
 
   int process_input(const uint8_t *data, size_t datalen);
+  // Switches I/O to relay the tunneled data with splice(2) if it is
+  // enabled, and both frontend and backend connections are
+  // cleartext.
+  void start_splice();
+  // Returns true if the response body whose header fields have just
+  // been parsed may be relayed with splice(2).
+  bool response_body_splicable() const;
   int tls_handshake();
 
   int connected();
@@ -93,6 +119,8 @@ public:
   int process_blocked_request_buf();
 
 private:
+  int connect_to(const Address *raddr);
+
   Connection conn_;
   std::function<int(HttpDownstreamConnection &)> on_read_, on_write_,
     signal_write_;
@@ -111,6 +139,9 @@ private:
   std::unique_ptr<DNSQuery> dns_query_;
   IOControl ioctrl_;
   llhttp_t response_htp_;
+  // The number of bytes of response body left to relay with
+  // splice(2).  It is nonzero only while read_splice_body() is used.
+  int64_t response_splice_left_;
   // true if first write succeeded.
   bool first_write_done_;
   // true if this object can be reused
@@ -37,6 +37,7 @@
 #include "shrpx_worker.h"
 #include "shrpx_http2_session.h"
 #include "shrpx_log.h"
+#include "shrpx_splice_pipe.h"
 #ifdef HAVE_MRUBY
 #  include "shrpx_mruby.h"
 #endif // HAVE_MRUBY
@@ -140,10 +141,11 @@ int htp_uricb(llhttp_t *htp, const char *data, size_t len) {
   req.fs.add_extra_buffer_size(len);
 
   if (req.method == HTTP_CONNECT) {
-    req.authority =
-      concat_string_ref(balloc, req.authority, std::string_view{data, len});
+    req.authority = realloc_concat_string_ref(balloc, req.authority,
+                                              std::string_view{data, len});
   } else {
-    req.path = concat_string_ref(balloc, req.path, std::string_view{data, len});
+    req.path =
+      realloc_concat_string_ref(balloc, req.path, std::string_view{data, len});
   }
 
   return 0;
@@ -314,6 +316,81 @@ void rewrite_request_host_path_from_uri(BlockAllocator &balloc, Request &req,
 }
 } // namespace
 
+namespace {
+// Selects a backend for |downstream|, and sends the request header
+// fields to it.
+int initiate_downstream(HttpsUpstream *upstream, Downstream *downstream) {
+  int rv;
+  auto handler = upstream->get_client_handler();
+  auto faddr = handler->get_upstream_addr();
+  auto &resp = downstream->response();
+
+#ifdef HAVE_MRUBY
+  DownstreamConnection *dconn_ptr;
+#endif // HAVE_MRUBY
+
+  for (;;) {
+    auto dconn = handler->get_downstream_connection(rv, downstream);
+
+    if (!dconn) {
+      if (rv == SHRPX_ERR_TLS_REQUIRED) {
+        upstream->redirect_to_https(downstream);
+      } else if (rv == SHRPX_ERR_CONCURRENCY_LIMIT) {
+        resp.http_status = 503;
+      } else if (rv == SHRPX_ERR_RATE_LIMITED) {
+        resp.http_status = 429;
+      }
+      downstream->set_request_state(DownstreamState::CONNECT_FAIL);
+      return -1;
+    }
+
+#ifdef HAVE_MRUBY
+    dconn_ptr = dconn.get();
+#endif // HAVE_MRUBY
+    if (downstream->attach_downstream_connection(std::move(dconn)) == 0) {
+      break;
+    }
+  }
+
+#ifdef HAVE_MRUBY
+  const auto &group = dconn_ptr->get_downstream_addr_group();
+  if (group) {
+    const auto &dmruby_ctx = group->shared_addr->mruby_ctx;
+
+    if (dmruby_ctx->run_on_request_proc(downstream) != 0) {
+      resp.http_status = 500;
+      return -1;
+    }
+
+    if (downstream->get_response_state() == DownstreamState::MSG_COMPLETE) {
+      return 0;
+    }
+  }
+#endif // HAVE_MRUBY
+
+  rv = downstream->push_request_headers();
+
+  if (rv != 0) {
+    return -1;
+  }
+
+  if (faddr->alt_mode != UpstreamAltMode::NONE) {
+    // Normally, we forward expect: 100-continue to backend server,
+    // and let them decide whether responds with 100 Continue or not.
+    // For alternative mode, we have no backend, so just send 100
+    // Continue here to make the client happy.
+    if (downstream->get_expect_100_continue()) {
+      auto output = downstream->get_response_buf();
+      constexpr auto res = "HTTP/1.1 100 Continue\r\n\r\n"sv;
+      output->append(res);
+      handler->signal_write();
+    }
+  }
+
+  return 0;
+}
+} // namespace
+
 namespace {
 int htp_hdrs_completecb(llhttp_t *htp) {
   int rv;
@@ -485,65 +562,26 @@ int htp_hdrs_completecb(llhttp_t *htp) {
     return 0;
   }
 
-#ifdef HAVE_MRUBY
-  DownstreamConnection *dconn_ptr;
-#endif // HAVE_MRUBY
-
-  for (;;) {
-    auto dconn = handler->get_downstream_connection(rv, downstream);
-
-    if (!dconn) {
-      if (rv == SHRPX_ERR_TLS_REQUIRED) {
-        upstream->redirect_to_https(downstream);
-      }
-      downstream->set_request_state(DownstreamState::CONNECT_FAIL);
-      return -1;
-    }
-
-#ifdef HAVE_MRUBY
-    dconn_ptr = dconn.get();
-#endif // HAVE_MRUBY
-    if (downstream->attach_downstream_connection(std::move(dconn)) == 0) {
-      break;
-    }
-  }
-
-#ifdef HAVE_MRUBY
-  const auto &group = dconn_ptr->get_downstream_addr_group();
-  if (group) {
-    const auto &dmruby_ctx = group->shared_addr->mruby_ctx;
-
-    if (dmruby_ctx->run_on_request_proc(downstream) != 0) {
-      resp.http_status = 500;
-      return -1;
-    }
-
-    if (downstream->get_response_state() == DownstreamState::MSG_COMPLETE) {
-      return 0;
-    }
-  }
-#endif // HAVE_MRUBY
-
-  rv = downstream->push_request_headers();
+  // Receive the entire request body before a backend is selected.
+  // The request is forwarded in htp_msg_completecb.
+  if (req.fs.content_length != 0 &&
+      handler->should_buffer_request(downstream)) {
+    downstream->set_buffer_request(true);
 
-  if (rv != 0) {
-    return -1;
-  }
-
-  if (faddr->alt_mode != UpstreamAltMode::NONE) {
-    // Normally, we forward expect: 100-continue to backend server,
-    // and let them decide whether responds with 100 Continue or not.
-    // For alternative mode, we have no backend, so just send 100
-    // Continue here to make the client happy.
+    // We do not forward the request to a backend until the request
+    // body is received.  Send 100 Continue here so that the client
+    // sends it.
     if (downstream->get_expect_100_continue()) {
       auto output = downstream->get_response_buf();
       constexpr auto res = "HTTP/1.1 100 Continue\r\n\r\n"sv;
       output->append(res);
       handler->signal_write();
     }
+
+    return 0;
   }
 
-  return 0;
+  return initiate_downstream(upstream, downstream);
 }
 } // namespace
 
@@ -599,6 +637,15 @@ int htp_msg_completecb(llhttp_t *htp) {
     return -1;
   }
 
+  if (downstream->request_buffering() &&
+      downstream->get_response_state() != DownstreamState::MSG_COMPLETE) {
+    downstream->end_request_buffering();
+
+    if (initiate_downstream(upstream, downstream) != 0) {
+      return -1;
+    }
+  }
+
   if (handler->get_http2_upgrade_allowed() &&
       downstream->get_http2_upgrade_request() &&
       handler->perform_http2_upgrade(upstream) != 0) {
@@ -757,6 +804,12 @@ int HttpsUpstream::on_write() {
     return 0;
   }
 
+  // The spooled response body must be moved before we check that
+  // the response has been sent.
+  if (downstream->refill_response_buf() != 0) {
+    return -1;
+  }
+
   auto output = downstream->get_response_buf();
   const auto &resp = downstream->response();
 
@@ -764,9 +817,21 @@ int HttpsUpstream::on_write() {
     return 0;
   }
 
+  if (auto pipe = downstream->get_response_pipe(); pipe && pipe->len) {
+    // Let backend fill the pipe while we are draining it.
+    return downstream->resume_read(SHRPX_NO_BUFFER, 0);
+  }
+
   // We need to postpone detachment until all data are sent so that
   // we can notify nghttp2 library all data consumed.
   if (downstream->get_response_state() == DownstreamState::MSG_COMPLETE) {
+    if (downstream->get_response_pipe() && !downstream->get_upgraded()) {
+      // The response body has been relayed with splice(2).  The next
+      // response is written from the response buffer.
+      downstream->release_splice_pipes();
+      handler_->end_response_splice();
+    }
+
     if (downstream->can_detach_downstream_connection()) {
       // Keep-alive
       downstream->detach_downstream_connection();
@@ -812,8 +877,15 @@ void HttpsUpstream::pause_read(IOCtrlReason reason) {
 int HttpsUpstream::resume_read(IOCtrlReason reason, Downstream *downstream,
                                size_t consumed) {
   // downstream could be nullptr
-  if (downstream && downstream->request_buf_full()) {
-    return 0;
+  if (downstream) {
+    // The spooled request body is sent as the backend drains it.
+    if (downstream->refill_request_buf() != 0) {
+      return -1;
+    }
+
+    if (downstream->request_buf_full()) {
+      return 0;
+    }
   }
   if (ioctrl_.resume_read(reason)) {
     // Process remaining data in input buffer here because these bytes
@@ -1090,8 +1162,8 @@ void HttpsUpstream::attach_downstream(std::unique_ptr<Downstream> downstream) {
 }
 
 void HttpsUpstream::delete_downstream() {
-  if (downstream_ && downstream_->accesslog_ready()) {
-    handler_->write_accesslog(downstream_.get());
+  if (downstream_) {
+    handler_->finish_downstream(downstream_.get());
   }
 
   downstream_.reset();
@@ -1336,7 +1408,7 @@ int HttpsUpstream::on_downstream_body(Downstream *downstream,
   if (len == 0) {
     return 0;
   }
-  auto output = downstream->get_response_buf();
+  auto output = downstream->get_response_body_buf();
   if (downstream->get_chunked_response()) {
     output->append(sizeof(len) * 2,
                    std::bind_front(util::CompactHexFormatter{}, len));
@@ -1357,7 +1429,7 @@ int HttpsUpstream::on_downstream_body_complete(Downstream *downstream) {
   auto &resp = downstream->response();
 
   if (downstream->get_chunked_response()) {
-    auto output = downstream->get_response_buf();
+    auto output = downstream->get_response_body_buf();
     const auto &trailers = resp.fs.trailers();
     if (trailers.empty()) {
       output->append("0\r\n\r\n"sv);
@@ -1446,8 +1518,8 @@ void HttpsUpstream::log_response_headers(DefaultMemchunks *buf) const {
 }
 
 void HttpsUpstream::on_handler_delete() {
-  if (downstream_ && downstream_->accesslog_ready()) {
-    handler_->write_accesslog(downstream_.get());
+  if (downstream_) {
+    handler_->finish_downstream(downstream_.get());
   }
 }
 
@@ -1548,8 +1620,45 @@ bool HttpsUpstream::response_empty() const {
   }
 
   auto buf = downstream_->get_response_buf();
+  auto pipe = downstream_->get_response_pipe();
+
+  return buf->rleft() == 0 && (!pipe || pipe->len == 0);
+}
+
+int HttpsUpstream::start_splice(Downstream *downstream) {
+  if (handler_->get_ssl()) {
+    return -1;
+  }
 
-  return buf->rleft() == 0;
+  if (downstream->create_splice_pipes() != 0) {
+    return -1;
+  }
+
+  handler_->start_splice();
+
+  if (LOG_ENABLED(INFO)) {
+    ULOG(INFO, this) << "Relay tunnel with splice";
+  }
+
+  return 0;
+}
+
+int HttpsUpstream::start_response_splice(Downstream *downstream) {
+  if (handler_->get_ssl()) {
+    return -1;
+  }
+
+  if (downstream->create_response_pipe() != 0) {
+    return -1;
+  }
+
+  handler_->start_response_splice();
+
+  if (LOG_ENABLED(INFO)) {
+    ULOG(INFO, this) << "Relay response body with splice";
+  }
+
+  return 0;
 }
 
 Downstream *
@@ -91,6 +91,8 @@ public:
                                       Downstream *promised_downstream);
   virtual bool push_enabled() const;
   virtual void cancel_premature_downstream(Downstream *promised_downstream);
+  virtual int start_splice(Downstream *downstream);
+  virtual int start_response_splice(Downstream *downstream);
 
   void reset_current_header_length();
   void log_response_headers(DefaultMemchunks *buf) const;
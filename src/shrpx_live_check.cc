@@ -71,6 +71,10 @@ void timeoutcb(struct ev_loop *loop, ev_timer *w, int revents) {
     return;
   }
 
+  if (w == &conn->wt && !conn->expired_wt()) {
+    return;
+  }
+
   live_check->on_failure();
 }
 } // namespace
@@ -336,12 +336,6 @@ std::span<char> copy(R &&src, std::span<char> dest) {
 }
 } // namespace
 
-namespace {
-std::span<char> copy(const char *src, std::span<char> dest) {
-  return copy(std::string_view{src}, dest);
-}
-} // namespace
-
 namespace {
 std::span<char> copy(char c, std::span<char> dest) {
   if (dest.empty()) {
@@ -511,22 +505,505 @@ std::string_view construct_absolute_request_uri(BlockAllocator &balloc,
 }
 } // namespace
 
-void upstream_accesslog(const std::vector<LogFragment> &lfv,
-                        const LogSpec &lgsp) {
-  auto config = get_config();
-  auto lgconf = log_config();
-  auto &accessconf = get_config()->logging.access;
+namespace {
+// Returns HTTP version string (e.g., "HTTP/1.1", "HTTP/2") of |req|
+// written in |buf|.
+std::string_view format_http_version(const Request &req,
+                                     std::span<char, 16> buf) {
+  auto p = std::ranges::copy("HTTP/"sv, std::ranges::begin(buf)).out;
+  p = util::utos(as_unsigned(req.http_major), p);
+  if (req.http_major < 2) {
+    *p++ = '.';
+    p = util::utos(as_unsigned(req.http_minor), p);
+  }
 
-  if (lgconf->accesslog_fd == -1 && !accessconf.syslog) {
+  return as_string_view(std::ranges::begin(buf), p);
+}
+} // namespace
+
+namespace {
+// Escaped wraps a string which is escaped when it is written by
+// TextLogEncoder.
+struct Escaped {
+  std::string_view s;
+};
+} // namespace
+
+namespace {
+size_t str_len(const std::string_view &s) { return s.size(); }
+size_t str_len(const Escaped &e) { return e.s.size(); }
+} // namespace
+
+namespace {
+// TextLogEncoder writes access log fields as text.
+class TextLogEncoder {
+public:
+  explicit TextLogEncoder(std::span<char> dest) : dest_{dest} {}
+
+  void literal(const std::string_view &s) { dest_ = copy(s, dest_); }
+  void field(const LogFragment &lf) {}
+  void none() { dest_ = copy('-', dest_); }
+  template <typename... Args> void string(const Args &...args) {
+    (write(args), ...);
+  }
+  template <std::unsigned_integral T> void uint(T n) {
+    dest_ = copy(n, dest_);
+  }
+  void msec(uint64_t t) {
+    dest_ = copy(t / 1000, dest_);
+    dest_ = copy('.', dest_);
+    auto frac = t % 1000;
+    if (frac < 100) {
+      auto n = static_cast<size_t>(frac < 10 ? 2 : 1);
+      dest_ = copy(std::string_view{"000", n}, dest_);
+    }
+    dest_ = copy(frac, dest_);
+  }
+  void bytes(std::span<const uint8_t> b) { dest_ = copy_hex_low(b, dest_); }
+  std::span<char> finish() { return dest_; }
+
+private:
+  void write(const std::string_view &s) { dest_ = copy(s, dest_); }
+  void write(const Escaped &e) { dest_ = copy_escape(e.s, dest_); }
+
+  std::span<char> dest_;
+};
+} // namespace
+
+namespace {
+// Returns the name of log variable of type |type|.  It returns empty
+// string for LogFragmentType::HTTP because its name is built from
+// the header field name.
+std::string_view log_var_name(LogFragmentType type) {
+  switch (type) {
+  case LogFragmentType::REMOTE_ADDR:
+    return "remote_addr"sv;
+  case LogFragmentType::TIME_LOCAL:
+    return "time_local"sv;
+  case LogFragmentType::TIME_ISO8601:
+    return "time_iso8601"sv;
+  case LogFragmentType::REQUEST:
+    return "request"sv;
+  case LogFragmentType::STATUS:
+    return "status"sv;
+  case LogFragmentType::BODY_BYTES_SENT:
+    return "body_bytes_sent"sv;
+  case LogFragmentType::AUTHORITY:
+    return "http_host"sv;
+  case LogFragmentType::REMOTE_PORT:
+    return "remote_port"sv;
+  case LogFragmentType::SERVER_PORT:
+    return "server_port"sv;
+  case LogFragmentType::REQUEST_TIME:
+    return "request_time"sv;
+  case LogFragmentType::PID:
+    return "pid"sv;
+  case LogFragmentType::ALPN:
+    return "alpn"sv;
+  case LogFragmentType::TLS_CIPHER:
+    return "tls_cipher"sv;
+  case LogFragmentType::TLS_PROTOCOL:
+    return "tls_protocol"sv;
+  case LogFragmentType::TLS_SESSION_ID:
+    return "tls_session_id"sv;
+  case LogFragmentType::TLS_SESSION_REUSED:
+    return "tls_session_reused"sv;
+  case LogFragmentType::TLS_SNI:
+    return "tls_sni"sv;
+  case LogFragmentType::TLS_CLIENT_FINGERPRINT_SHA1:
+    return "tls_client_fingerprint_sha1"sv;
+  case LogFragmentType::TLS_CLIENT_FINGERPRINT_SHA256:
+    return "tls_client_fingerprint_sha256"sv;
+  case LogFragmentType::TLS_CLIENT_ISSUER_NAME:
+    return "tls_client_issuer_name"sv;
+  case LogFragmentType::TLS_CLIENT_SERIAL:
+    return "tls_client_serial"sv;
+  case LogFragmentType::TLS_CLIENT_SUBJECT_NAME:
+    return "tls_client_subject_name"sv;
+  case LogFragmentType::BACKEND_HOST:
+    return "backend_host"sv;
+  case LogFragmentType::BACKEND_PORT:
+    return "backend_port"sv;
+  case LogFragmentType::METHOD:
+    return "method"sv;
+  case LogFragmentType::PATH:
+    return "path"sv;
+  case LogFragmentType::PATH_WITHOUT_QUERY:
+    return "path_without_query"sv;
+  case LogFragmentType::PROTOCOL_VERSION:
+    return "protocol_version"sv;
+  case LogFragmentType::TLS_HANDSHAKE_TIME:
+    return "tls_handshake_time"sv;
+  case LogFragmentType::REQUEST_HEADER_TIME:
+    return "request_header_time"sv;
+  case LogFragmentType::BACKEND_QUEUE_TIME:
+    return "backend_queue_time"sv;
+  case LogFragmentType::BACKEND_CONNECT_TIME:
+    return "backend_connect_time"sv;
+  case LogFragmentType::BACKEND_RESPONSE_TIME:
+    return "backend_response_time"sv;
+  case LogFragmentType::RESPONSE_TRANSFER_TIME:
+    return "response_transfer_time"sv;
+  default:
+    return ""sv;
+  }
+}
+} // namespace
+
+namespace {
+// Returns the length of UTF-8 sequence at the beginning of |s| if it
+// is well-formed as defined in RFC 3629.  Otherwise returns 0.
+size_t utf8_seqlen(const std::string_view &s) {
+  auto b = as_unsigned(s[0]);
+  size_t n;
+  // The range of the second byte.
+  uint8_t lo = 0x80, hi = 0xbf;
+
+  if (b < 0x80) {
+    return 1;
+  }
+  if (b < 0xc2) {
+    return 0;
+  }
+  if (b < 0xe0) {
+    n = 2;
+  } else if (b < 0xf0) {
+    n = 3;
+    if (b == 0xe0) {
+      // Overlong
+      lo = 0xa0;
+    } else if (b == 0xed) {
+      // Surrogates
+      hi = 0x9f;
+    }
+  } else if (b < 0xf5) {
+    n = 4;
+    if (b == 0xf0) {
+      // Overlong
+      lo = 0x90;
+    } else if (b == 0xf4) {
+      // Larger than U+10FFFF
+      hi = 0x8f;
+    }
+  } else {
+    return 0;
+  }
+
+  if (s.size() < n) {
+    return 0;
+  }
+
+  auto c = as_unsigned(s[1]);
+  if (c < lo || hi < c) {
+    return 0;
+  }
+
+  for (size_t i = 2; i < n; ++i) {
+    c = as_unsigned(s[i]);
+    if (c < 0x80 || 0xbf < c) {
+      return 0;
+    }
+  }
+
+  return n;
+}
+} // namespace
+
+namespace {
+// JSONLogEncoder writes access log fields as a single JSON object.
+// Literals are ignored.  The output is always valid JSON even if it
+// is truncated.
+class JSONLogEncoder {
+public:
+  explicit JSONLogEncoder(std::span<char> dest)
+    : dest_{dest.first(dest.size() - 1)}, first_{true}, full_{false} {
+    dest_ = copy('{', dest_);
+  }
+
+  void literal(const std::string_view &s) {}
+  void field(const LogFragment &lf) {
+    if (full_) {
+      return;
+    }
+
+    auto name = log_var_name(lf.type);
+    // Reserve enough space to write separator, name, and the least
+    // value which are a number, or empty string.
+    auto len = 1 + 3 + (name.empty() ? str_size("http_") + lf.value.size()
+                                     : name.size()) +
+               std::numeric_limits<uint64_t>::digits10 + 2;
+    if (dest_.size() < len) {
+      full_ = true;
+      return;
+    }
+
+    if (!first_) {
+      dest_ = copy(',', dest_);
+    }
+
+    first_ = false;
+
+    dest_ = copy('"', dest_);
+    if (name.empty()) {
+      dest_ = copy("http_"sv, dest_);
+      for (auto c : lf.value) {
+        dest_ = copy(c == '-' ? '_' : c, dest_);
+      }
+    } else {
+      dest_ = copy(name, dest_);
+    }
+    dest_ = copy("\":"sv, dest_);
+  }
+  void none() {
+    if (full_) {
+      return;
+    }
+
+    dest_ = copy("null"sv, dest_);
+  }
+  template <typename... Args> void string(const Args &...args) {
+    if (full_) {
+      return;
+    }
+
+    dest_ = copy('"', dest_);
+    // Leave 1 byte for the closing quote.
+    auto d = dest_.first(dest_.size() - 1);
+    (write(args, d), ...);
+    dest_ = copy('"', dest_.last(d.size() + 1));
+  }
+  template <std::unsigned_integral T> void uint(T n) {
+    if (full_) {
+      return;
+    }
+
+    dest_ = copy(n, dest_);
+  }
+  void msec(uint64_t t) {
+    if (full_) {
+      return;
+    }
+
+    auto enc = TextLogEncoder{dest_};
+    enc.msec(t);
+    dest_ = enc.finish();
+  }
+  void bytes(std::span<const uint8_t> b) {
+    if (full_) {
+      return;
+    }
+
+    dest_ = copy('"', dest_);
+    auto d = dest_.first(dest_.size() - 1);
+    d = copy_hex_low(b, d);
+    dest_ = copy('"', dest_.last(d.size() + 1));
+  }
+  std::span<char> finish() {
+    // We reserved 1 byte for the closing brace in constructor.
+    auto p = std::span{std::ranges::begin(dest_), dest_.size() + 1};
+    return copy('}', p);
+  }
+
+private:
+  static void write(const std::string_view &s, std::span<char> &dest) {
+    for (auto it = std::ranges::begin(s); it != std::ranges::end(s);) {
+      auto b = as_unsigned(*it);
+      if (b >= 0x80) {
+        auto n = utf8_seqlen(std::string_view{it, std::ranges::end(s)});
+        if (n) {
+          // Valid UTF-8 is written as is.  Do not split a sequence
+          // when truncated.
+          if (dest.size() < n) {
+            return;
+          }
+
+          dest = copy(std::string_view{it, n}, dest);
+          it += as_signed(n);
+
+          continue;
+        }
+      } else if (b >= 0x20 && b != 0x7f) {
+        if (b == '"' || b == '\\') {
+          if (dest.size() < 2) {
+            return;
+          }
+
+          dest[0] = '\\';
+          dest[1] = static_cast<char>(b);
+          dest = dest.subspan(2);
+        } else {
+          if (dest.empty()) {
+            return;
+          }
+
+          dest[0] = static_cast<char>(b);
+          dest = dest.subspan(1);
+        }
+
+        ++it;
+
+        continue;
+      }
+
+      // Control characters and bytes which are not part of valid
+      // UTF-8 sequence.
+      if (dest.size() < 6) {
+        return;
+      }
+
+      dest = copy("\\u00"sv, dest);
+      util::format_hex(b, std::ranges::begin(dest));
+      dest = dest.subspan(2);
+
+      ++it;
+    }
+  }
+  static void write(const Escaped &e, std::span<char> &dest) {
+    write(e.s, dest);
+  }
+
+  std::span<char> dest_;
+  bool first_;
+  bool full_;
+};
+} // namespace
+
+namespace {
+// BinaryLogEncoder writes access log fields in a length prefixed
+// binary record.  See AccessLogEncoding::BINARY for the format.
+class BinaryLogEncoder {
+public:
+  explicit BinaryLogEncoder(std::span<char> dest)
+    : begin_{std::ranges::begin(dest)}, dest_{dest.subspan(4)}, full_{false} {}
+
+  void literal(const std::string_view &s) {}
+  void field(const LogFragment &lf) {}
+  void none() { tag(AccessLogFieldType::NONE, 0); }
+  template <typename... Args> void string(const Args &...args) {
+    auto len = (str_len(args) + ...);
+    if (!tag(AccessLogFieldType::STRING, 1 + varint_len(len))) {
+      return;
+    }
+
+    if (dest_.size() < varint_len(len) + len) {
+      // The value is truncated.  Stop writing further fields so that
+      // reader can tell that the record is incomplete.
+      len = dest_.size() - varint_len(len);
+      full_ = true;
+    }
+
+    dest_ = copy_varint(len, dest_);
+    auto d = dest_.first(len);
+    (write(args, d), ...);
+    dest_ = dest_.subspan(len);
+  }
+  template <std::unsigned_integral T> void uint(T n) {
+    if (!tag(AccessLogFieldType::UINT, varint_len(n))) {
+      return;
+    }
+
+    dest_ = copy_varint(n, dest_);
+  }
+  void msec(uint64_t t) {
+    if (!tag(AccessLogFieldType::MSEC, varint_len(t))) {
+      return;
+    }
+
+    dest_ = copy_varint(t, dest_);
+  }
+  void bytes(std::span<const uint8_t> b) {
+    if (!tag(AccessLogFieldType::BYTES, varint_len(b.size()) + b.size())) {
+      return;
+    }
+
+    dest_ = copy_varint(b.size(), dest_);
+    dest_ = copy(b, dest_);
+  }
+  std::span<char> finish() {
+    auto len = static_cast<uint32_t>(std::ranges::begin(dest_) - begin_ - 4);
+    for (size_t i = 0; i < 4; ++i) {
+      begin_[as_signed(i)] = static_cast<char>(len >> (24 - i * 8));
+    }
+
+    return dest_;
+  }
+
+private:
+  // Writes field type |t|.  |minlen| is the number of bytes which the
+  // following value occupies at least.  It returns false if there is
+  // not enough space.  Once it returns false, no further field is
+  // written so that reader can tell that the record is truncated.
+  bool tag(AccessLogFieldType t, size_t minlen) {
+    if (full_ || dest_.size() < 1 + minlen) {
+      full_ = true;
+      return false;
+    }
+
+    dest_ = copy(static_cast<char>(t), dest_);
+
+    return true;
+  }
+  static size_t varint_len(uint64_t n) {
+    size_t len = 1;
+    for (; n >= 0x80; n >>= 7, ++len)
+      ;
+    return len;
+  }
+  static std::span<char> copy_varint(uint64_t n, std::span<char> dest) {
+    auto p = std::ranges::begin(dest);
+    for (; n >= 0x80; n >>= 7) {
+      *p++ = static_cast<char>((n & 0x7f) | 0x80);
+    }
+    *p++ = static_cast<char>(n);
+
+    return {p, std::ranges::end(dest)};
+  }
+  static void write(const std::string_view &s, std::span<char> &dest) {
+    dest = copy(s, dest);
+  }
+  static void write(const Escaped &e, std::span<char> &dest) {
+    dest = copy(e.s, dest);
+  }
+
+  std::span<char>::iterator begin_;
+  std::span<char> dest_;
+  bool full_;
+};
+} // namespace
+
+namespace {
+// Encodes the duration between |start| and |end| in milliseconds.  If
+// either of them is not set, or |end| precedes |start|, the value is
+// not available.
+template <typename Encoder>
+void encode_duration(
+  Encoder &enc, const std::chrono::high_resolution_clock::time_point &start,
+  const std::chrono::high_resolution_clock::time_point &end) {
+  constexpr auto unset = std::chrono::high_resolution_clock::time_point{};
+
+  if (start == unset || end == unset || end < start) {
+    enc.none();
     return;
   }
 
-  std::array<char, 4_k> buf;
+  enc.msec(as_unsigned(
+    std::chrono::duration_cast<std::chrono::milliseconds>(end - start)
+      .count()));
+}
+} // namespace
+
+namespace {
+template <typename Encoder>
+std::span<char> encode_accesslog(Encoder enc,
+                                 const std::vector<LogFragment> &lfv,
+                                 const LogSpec &lgsp) {
+  auto config = get_config();
 
   auto downstream = lgsp.downstream;
 
   const auto &req = downstream->request();
   const auto &resp = downstream->response();
+  const auto &timings = downstream->timings();
   const auto &tstamp = req.tstamp;
   auto &balloc = downstream->get_block_allocator();
 
@@ -542,150 +1019,143 @@ void upstream_accesslog(const std::vector<LogFragment> &lfv,
                               ? path
                               : std::string_view{std::ranges::begin(path),
                                                  std::ranges::find(path, '?')};
-
-  auto p = std::span{buf}.first(buf.size() - 2);
+  std::array<char, 16> versionbuf;
+  auto version = format_http_version(req, versionbuf);
 
   for (auto &lf : lfv) {
     switch (lf.type) {
     case LogFragmentType::LITERAL:
-      p = copy(lf.value, p);
+      enc.literal(lf.value);
+      continue;
+    case LogFragmentType::NONE:
+      continue;
+    default:
       break;
+    }
+
+    enc.field(lf);
+
+    switch (lf.type) {
     case LogFragmentType::REMOTE_ADDR:
-      p = copy(lgsp.remote_addr, p);
+      enc.string(lgsp.remote_addr);
       break;
     case LogFragmentType::TIME_LOCAL:
-      p = copy(tstamp->time_local, p);
+      enc.string(tstamp->time_local);
       break;
     case LogFragmentType::TIME_ISO8601:
-      p = copy(tstamp->time_iso8601, p);
+      enc.string(tstamp->time_iso8601);
       break;
     case LogFragmentType::REQUEST:
-      p = copy(method, p);
-      p = copy(' ', p);
-      p = copy_escape(path, p);
-      p = copy(" HTTP/"sv, p);
-      p = copy(as_unsigned(req.http_major), p);
-      if (req.http_major < 2) {
-        p = copy('.', p);
-        p = copy(as_unsigned(req.http_minor), p);
-      }
+      enc.string(method, " "sv, Escaped{path}, " "sv, version);
       break;
     case LogFragmentType::METHOD:
-      p = copy(method, p);
+      enc.string(method);
       break;
     case LogFragmentType::PATH:
-      p = copy_escape(path, p);
+      enc.string(Escaped{path});
       break;
     case LogFragmentType::PATH_WITHOUT_QUERY:
-      p = copy_escape(path_without_query, p);
+      enc.string(Escaped{path_without_query});
       break;
     case LogFragmentType::PROTOCOL_VERSION:
-      p = copy("HTTP/"sv, p);
-      p = copy(as_unsigned(req.http_major), p);
-      if (req.http_major < 2) {
-        p = copy('.', p);
-        p = copy(as_unsigned(req.http_minor), p);
-      }
+      enc.string(version);
       break;
     case LogFragmentType::STATUS:
-      p = copy(resp.http_status, p);
+      enc.uint(resp.http_status);
       break;
     case LogFragmentType::BODY_BYTES_SENT:
-      p = copy(as_unsigned(downstream->response_sent_body_length), p);
+      enc.uint(as_unsigned(downstream->response_sent_body_length));
       break;
     case LogFragmentType::HTTP: {
       auto hd = req.fs.header(lf.value);
       if (hd) {
-        p = copy_escape((*hd).value, p);
+        enc.string(Escaped{(*hd).value});
         break;
       }
 
-      p = copy('-', p);
+      enc.none();
 
       break;
     }
     case LogFragmentType::AUTHORITY:
       if (!req.authority.empty()) {
-        p = copy(req.authority, p);
+        enc.string(req.authority);
         break;
       }
 
-      p = copy('-', p);
+      enc.none();
 
       break;
     case LogFragmentType::REMOTE_PORT:
-      p = copy(lgsp.remote_port, p);
+      enc.string(lgsp.remote_port);
       break;
     case LogFragmentType::SERVER_PORT:
-      p = copy(lgsp.server_port, p);
+      enc.uint(lgsp.server_port);
       break;
     case LogFragmentType::REQUEST_TIME: {
       auto t = std::chrono::duration_cast<std::chrono::milliseconds>(
                  lgsp.request_end_time - downstream->get_request_start_time())
                  .count();
-      p = copy(as_unsigned(t / 1000), p);
-      p = copy('.', p);
-      auto frac = t % 1000;
-      if (frac < 100) {
-        auto n = static_cast<size_t>(frac < 10 ? 2 : 1);
-        p = copy(std::string_view{"000", n}, p);
-      }
-      p = copy(as_unsigned(frac), p);
+      enc.msec(as_unsigned(t));
       break;
     }
     case LogFragmentType::PID:
-      p = copy(as_unsigned(lgsp.pid), p);
+      enc.uint(as_unsigned(lgsp.pid));
       break;
     case LogFragmentType::ALPN:
-      p = copy_escape(lgsp.alpn, p);
+      enc.string(Escaped{lgsp.alpn});
       break;
     case LogFragmentType::TLS_CIPHER:
       if (!lgsp.ssl) {
-        p = copy('-', p);
+        enc.none();
         break;
       }
-      p = copy(SSL_get_cipher_name(lgsp.ssl), p);
+      enc.string(std::string_view{SSL_get_cipher_name(lgsp.ssl)});
       break;
     case LogFragmentType::TLS_PROTOCOL:
       if (!lgsp.ssl) {
-        p = copy('-', p);
+        enc.none();
         break;
       }
-      p = copy(nghttp2::tls::get_tls_protocol(lgsp.ssl), p);
+      enc.string(nghttp2::tls::get_tls_protocol(lgsp.ssl));
       break;
     case LogFragmentType::TLS_SESSION_ID: {
+      if (!lgsp.ssl) {
+        enc.none();
+        break;
+      }
       auto session = SSL_get_session(lgsp.ssl);
       if (!session) {
-        p = copy('-', p);
+        enc.none();
         break;
       }
       unsigned int session_id_length = 0;
       auto session_id = SSL_SESSION_get_id(session, &session_id_length);
       if (session_id_length == 0) {
-        p = copy('-', p);
+        enc.none();
         break;
       }
-      p = copy_hex_low({session_id, session_id_length}, p);
+      enc.bytes({session_id, session_id_length});
       break;
     }
     case LogFragmentType::TLS_SESSION_REUSED:
       if (!lgsp.ssl) {
-        p = copy('-', p);
+        enc.none();
         break;
       }
-      p = copy(SSL_session_reused(lgsp.ssl) ? 'r' : '.', p);
+      enc.string(SSL_session_reused(lgsp.ssl) ? "r"sv : "."sv);
       break;
     case LogFragmentType::TLS_SNI:
       if (lgsp.sni.empty()) {
-        p = copy('-', p);
+        enc.none();
         break;
       }
-      p = copy_escape(lgsp.sni, p);
+      enc.string(Escaped{lgsp.sni});
       break;
     case LogFragmentType::TLS_CLIENT_FINGERPRINT_SHA1:
     case LogFragmentType::TLS_CLIENT_FINGERPRINT_SHA256: {
       if (!lgsp.ssl) {
-        p = copy('-', p);
+        enc.none();
         break;
       }
 #if OPENSSL_3_0_0_API
@@ -694,7 +1164,7 @@ void upstream_accesslog(const std::vector<LogFragment> &lfv,
       auto x = SSL_get_peer_certificate(lgsp.ssl);
 #endif // !OPENSSL_3_0_0_API
       if (!x) {
-        p = copy('-', p);
+        enc.none();
         break;
       }
       std::array<uint8_t, 32> buf;
@@ -706,16 +1176,16 @@ void upstream_accesslog(const std::vector<LogFragment> &lfv,
       X509_free(x);
 #endif // !OPENSSL_3_0_0_API
       if (len <= 0) {
-        p = copy('-', p);
+        enc.none();
         break;
       }
-      p = copy_hex_low({buf.data(), static_cast<size_t>(len)}, p);
+      enc.bytes({buf.data(), static_cast<size_t>(len)});
       break;
     }
     case LogFragmentType::TLS_CLIENT_ISSUER_NAME:
     case LogFragmentType::TLS_CLIENT_SUBJECT_NAME: {
       if (!lgsp.ssl) {
-        p = copy('-', p);
+        enc.none();
         break;
       }
 #if OPENSSL_3_0_0_API
@@ -724,7 +1194,7 @@ void upstream_accesslog(const std::vector<LogFragment> &lfv,
       auto x = SSL_get_peer_certificate(lgsp.ssl);
 #endif // !OPENSSL_3_0_0_API
       if (!x) {
-        p = copy('-', p);
+        enc.none();
         break;
       }
       auto name = lf.type == LogFragmentType::TLS_CLIENT_ISSUER_NAME
@@ -734,15 +1204,15 @@ void upstream_accesslog(const std::vector<LogFragment> &lfv,
       X509_free(x);
 #endif // !OPENSSL_3_0_0_API
       if (name.empty()) {
-        p = copy('-', p);
+        enc.none();
         break;
       }
-      p = copy(name, p);
+      enc.string(name);
       break;
     }
     case LogFragmentType::TLS_CLIENT_SERIAL: {
       if (!lgsp.ssl) {
-        p = copy('-', p);
+        enc.none();
         break;
       }
 #if OPENSSL_3_0_0_API
@@ -751,7 +1221,7 @@ void upstream_accesslog(const std::vector<LogFragment> &lfv,
       auto x = SSL_get_peer_certificate(lgsp.ssl);
 #endif // !OPENSSL_3_0_0_API
       if (!x) {
-        p = copy('-', p);
+        enc.none();
         break;
       }
       auto sn = tls::get_x509_serial(balloc, x);
@@ -759,33 +1229,92 @@ void upstream_accesslog(const std::vector<LogFragment> &lfv,
       X509_free(x);
 #endif // !OPENSSL_3_0_0_API
       if (sn.empty()) {
-        p = copy('-', p);
+        enc.none();
         break;
       }
-      p = copy(sn, p);
+      enc.string(sn);
       break;
     }
     case LogFragmentType::BACKEND_HOST:
       if (!downstream_addr) {
-        p = copy('-', p);
+        enc.none();
         break;
       }
-      p = copy(downstream_addr->host, p);
+      enc.string(downstream_addr->host);
       break;
     case LogFragmentType::BACKEND_PORT:
       if (!downstream_addr) {
-        p = copy('-', p);
+        enc.none();
         break;
       }
-      p = copy(downstream_addr->port, p);
+      enc.uint(downstream_addr->port);
       break;
-    case LogFragmentType::NONE:
+    case LogFragmentType::TLS_HANDSHAKE_TIME:
+      encode_duration(enc, lgsp.tls_handshake_start_time,
+                      lgsp.tls_handshake_end_time);
+      break;
+    case LogFragmentType::REQUEST_HEADER_TIME:
+      encode_duration(enc, downstream->get_request_start_time(),
+                      timings.request_header_end);
+      break;
+    case LogFragmentType::BACKEND_QUEUE_TIME:
+      encode_duration(enc, timings.request_header_end,
+                      timings.backend_attach);
+      break;
+    case LogFragmentType::BACKEND_CONNECT_TIME:
+      encode_duration(enc, timings.backend_connect_start,
+                      timings.backend_connect_end);
+      break;
+    case LogFragmentType::BACKEND_RESPONSE_TIME:
+      // Request header fields might be buffered before a backend
+      // connection is established.  Do not count connection time.
+      encode_duration(enc,
+                      std::max(timings.backend_request_start,
+                               timings.backend_connect_end),
+                      timings.response_header_end);
+      break;
+    case LogFragmentType::RESPONSE_TRANSFER_TIME:
+      encode_duration(enc, timings.response_header_end,
+                      lgsp.request_end_time);
       break;
     default:
+      enc.none();
       break;
     }
   }
 
+  return enc.finish();
+}
+} // namespace
+
+std::span<char> encode_accesslog(AccessLogEncoding encoding,
+                                 std::span<char> dest,
+                                 const std::vector<LogFragment> &lfv,
+                                 const LogSpec &lgsp) {
+  switch (encoding) {
+  case AccessLogEncoding::JSON:
+    return encode_accesslog(JSONLogEncoder{dest}, lfv, lgsp);
+  case AccessLogEncoding::BINARY:
+    return encode_accesslog(BinaryLogEncoder{dest}, lfv, lgsp);
+  default:
+    return encode_accesslog(TextLogEncoder{dest}, lfv, lgsp);
+  }
+}
+
+void upstream_accesslog(const std::vector<LogFragment> &lfv,
+                        const LogSpec &lgsp) {
+  auto lgconf = log_config();
+  auto &accessconf = get_config()->logging.access;
+
+  if (lgconf->accesslog_fd == -1 && !accessconf.syslog) {
+    return;
+  }
+
+  std::array<char, 4_k> buf;
+
+  auto dest = std::span{buf}.first(buf.size() - 2);
+  auto p = encode_accesslog(accessconf.encoding, dest, lfv, lgsp);
+
   if (accessconf.syslog) {
     p[0] = '\0';
 
@@ -794,8 +1323,10 @@ void upstream_accesslog(const std::vector<LogFragment> &lfv,
     return;
   }
 
-  p[0] = '\n';
-  p = p.subspan(1);
+  if (accessconf.encoding != AccessLogEncoding::BINARY) {
+    p[0] = '\n';
+    p = p.subspan(1);
+  }
 
   auto nwrite = as_unsigned(std::ranges::distance(
     std::ranges::begin(std::span<char>{buf}), std::ranges::begin(p)));
@@ -275,6 +275,45 @@ enum class LogFragmentType {
   PATH,
   PATH_WITHOUT_QUERY,
   PROTOCOL_VERSION,
+  TLS_HANDSHAKE_TIME,
+  REQUEST_HEADER_TIME,
+  BACKEND_QUEUE_TIME,
+  BACKEND_CONNECT_TIME,
+  BACKEND_RESPONSE_TIME,
+  RESPONSE_TRANSFER_TIME,
+};
+
+enum class AccessLogEncoding {
+  // Human readable text, one line per request.
+  TEXT,
+  // JSON object per line.  Each variable in accesslog-format becomes
+  // a member, and literals are ignored.
+  JSON,
+  // Length prefixed binary record.  Each record starts with 4 bytes
+  // length in network byte order, which does not include the length
+  // field itself.  It is followed by fields, one for each variable
+  // in accesslog-format in the same order (literals are omitted).
+  // Each field starts with 1 byte AccessLogFieldType, and followed
+  // by its value.  Integers and lengths are encoded in unsigned
+  // LEB128.
+  BINARY,
+};
+
+// The type of a field in AccessLogEncoding::BINARY record.
+enum class AccessLogFieldType : uint8_t {
+  // Value is not available.  It has no payload, and is written as
+  // "-" in text.
+  NONE = 0,
+  // String.  The length, and the string follows.
+  STRING = 1,
+  // Unsigned integer.
+  UINT = 2,
+  // Duration in milliseconds.  It is written as seconds with
+  // milliseconds resolution in text.
+  MSEC = 3,
+  // Opaque bytes.  The length, and the bytes follows.  It is written
+  // as lower-cased hex string in text.
+  BYTES = 4,
 };
 
 struct LogFragment {
@@ -291,11 +330,21 @@ struct LogSpec {
   std::string_view sni;
   SSL *ssl;
   std::chrono::high_resolution_clock::time_point request_end_time;
+  std::chrono::high_resolution_clock::time_point tls_handshake_start_time;
+  std::chrono::high_resolution_clock::time_point tls_handshake_end_time;
   std::string_view remote_port;
   uint16_t server_port;
   pid_t pid;
 };
 
+// Encodes access log entry described by |lgsp| in the format |lfv|
+// into |dest| using |encoding|.  The output is truncated if |dest| is
+// not large enough.  It returns the unused portion of |dest|.
+std::span<char> encode_accesslog(AccessLogEncoding encoding,
+                                 std::span<char> dest,
+                                 const std::vector<LogFragment> &lfv,
+                                 const LogSpec &lgsp);
+
 void upstream_accesslog(const std::vector<LogFragment> &lf,
                         const LogSpec &lgsp);
 
@@ -0,0 +1,174 @@
+/*
+ * nghttp2 - HTTP/2 C Library
+ *
+ * Copyright (c) 2026 Tatsuhiro Tsujikawa
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+ * LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include "shrpx_log_test.h"
+
+#include <string>
+#include <vector>
+
+#include "munitxx.h"
+
+#include "shrpx_log.h"
+#include "shrpx_downstream.h"
+
+using namespace std::literals;
+
+namespace shrpx {
+
+namespace {
+const MunitTest tests[]{
+  munit_void_test(test_shrpx_log_json_escape),
+  munit_void_test(test_shrpx_log_json_truncate),
+  munit_void_test(test_shrpx_log_binary),
+  munit_void_test(test_shrpx_log_binary_truncate),
+  munit_test_end(),
+};
+} // namespace
+
+const MunitSuite log_suite{
+  "/log", tests, nullptr, 1, MUNIT_SUITE_OPTION_NONE,
+};
+
+namespace {
+std::string_view encode(AccessLogEncoding encoding, std::span<char> dest,
+                        const std::vector<LogFragment> &lfv,
+                        const LogSpec &lgsp) {
+  auto p = encode_accesslog(encoding, dest, lfv, lgsp);
+  return {std::ranges::begin(dest), std::ranges::begin(p)};
+}
+} // namespace
+
+void test_shrpx_log_json_escape(void) {
+  Downstream d(nullptr, nullptr, 0);
+  std::vector<LogFragment> lfv{
+    {LogFragmentType::REMOTE_ADDR},
+    {LogFragmentType::ALPN},
+  };
+  LogSpec lgsp{
+    .downstream = &d,
+    // Valid UTF-8 sequences of 2, 3, and 4 bytes.
+    .remote_addr = "a\"b\\c\x01\x7f\xc3\xa9\xe2\x82\xac\xf0\x9f\x98\x80"sv,
+    // Overlong, surrogate, out of range, lone continuation, and
+    // incomplete sequences.
+    .alpn = "\xc0\xaf\xed\xa0\x80\xf4\x90\x80\x80\x80\xe2\x82"sv,
+  };
+  std::array<char, 4096> buf;
+
+  assert_stdsv_equal(
+    "{\"remote_addr\":\"a\\\"b\\\\c\\u0001\\u007f\xc3\xa9\xe2\x82\xac"
+    "\xf0\x9f\x98\x80\","
+    "\"alpn\":\"\\u00c0\\u00af\\u00ed\\u00a0\\u0080\\u00f4\\u0090\\u0080"
+    "\\u0080\\u0080\\u00e2\\u0082\"}"sv,
+    encode(AccessLogEncoding::JSON, buf, lfv, lgsp));
+}
+
+void test_shrpx_log_json_truncate(void) {
+  Downstream d(nullptr, nullptr, 0);
+  std::vector<LogFragment> lfv{
+    {LogFragmentType::REMOTE_ADDR},
+    {LogFragmentType::ALPN},
+  };
+  LogSpec lgsp{
+    .downstream = &d,
+    .alpn = "h2"sv,
+  };
+  // 20 bytes are left for the value of remote_addr.  The field for
+  // alpn does not fit at all.
+  std::array<char, 38> buf;
+
+  // Multi byte sequence is not split.
+  lgsp.remote_addr = "0123456789012345678\xc3\xa9"sv;
+
+  assert_stdsv_equal("{\"remote_addr\":\"0123456789012345678\"}"sv,
+                     encode(AccessLogEncoding::JSON, buf, lfv, lgsp));
+
+  // Escape sequence is not split.
+  lgsp.remote_addr = "012345678901234\x01"sv;
+
+  assert_stdsv_equal("{\"remote_addr\":\"012345678901234\"}"sv,
+                     encode(AccessLogEncoding::JSON, buf, lfv, lgsp));
+}
+
+void test_shrpx_log_binary(void) {
+  Downstream d(nullptr, nullptr, 0);
+  d.response().http_status = 300;
+  std::vector<LogFragment> lfv{
+    {LogFragmentType::STATUS},
+    {LogFragmentType::LITERAL, " "sv},
+    {LogFragmentType::REMOTE_ADDR},
+    {LogFragmentType::AUTHORITY},
+    {LogFragmentType::ALPN},
+  };
+  auto alpn = std::string(200, 'a');
+  LogSpec lgsp{
+    .downstream = &d,
+    .remote_addr = "127.0.0.1"sv,
+    .alpn = alpn,
+  };
+  std::array<char, 4096> buf;
+
+  auto s = encode(AccessLogEncoding::BINARY, buf, lfv, lgsp);
+
+  // 4 bytes length prefix in network byte order.
+  assert_size(4 + 218, ==, s.size());
+  assert_stdsv_equal("\x00\x00\x00\xda"sv, s.substr(0, 4));
+  // STATUS: UINT 300 in LEB128
+  assert_stdsv_equal("\x02\xac\x02"sv, s.substr(4, 3));
+  // REMOTE_ADDR: STRING, length, and the value
+  assert_stdsv_equal("\x01\x09"
+                     "127.0.0.1"sv,
+                     s.substr(7, 11));
+  // AUTHORITY: NONE
+  assert_stdsv_equal("\x00"sv, s.substr(18, 1));
+  // ALPN: STRING, 2 bytes length, and the value
+  assert_stdsv_equal("\x01\xc8\x01"sv, s.substr(19, 3));
+  assert_stdsv_equal(alpn, s.substr(22));
+}
+
+void test_shrpx_log_binary_truncate(void) {
+  Downstream d(nullptr, nullptr, 0);
+  std::vector<LogFragment> lfv{
+    {LogFragmentType::REMOTE_ADDR},
+    {LogFragmentType::AUTHORITY},
+  };
+  auto remote_addr = std::string(200, 'a');
+  LogSpec lgsp{
+    .downstream = &d,
+    .remote_addr = remote_addr,
+  };
+  // The length of remote_addr takes 2 bytes, but the truncated
+  // length only takes 1 byte.  The remaining 1 byte must not be used
+  // by the following field.
+  std::array<char, 4 + 1 + 2 + 50> buf;
+
+  auto s = encode(AccessLogEncoding::BINARY, buf, lfv, lgsp);
+
+  assert_size(4 + 52, ==, s.size());
+  assert_stdsv_equal("\x00\x00\x00\x34"sv, s.substr(0, 4));
+  assert_stdsv_equal("\x01\x32"sv, s.substr(4, 2));
+  assert_stdsv_equal(std::string_view{remote_addr}.substr(0, 50),
+                     s.substr(6));
+}
+
+} // namespace shrpx
@@ -47,6 +47,10 @@ void timeoutcb(struct ev_loop *loop, ev_timer *w, int revents) {
     return;
   }
 
+  if (w == &conn->wt && !conn->expired_wt()) {
+    return;
+  }
+
   if (LOG_ENABLED(INFO)) {
     MCLOG(INFO, mconn) << "Time out";
   }
@@ -0,0 +1,493 @@
+/*
+ * nghttp2 - HTTP/2 C Library
+ *
+ * Copyright (c) 2026 Tatsuhiro Tsujikawa
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+ * LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include "shrpx_metrics.h"
+
+#include <cassert>
+#include <bit>
+#include <cmath>
+
+#include "shrpx_downstream.h"
+#include "shrpx_worker.h"
+#include "util.h"
+
+namespace shrpx {
+
+void LatencyHistogram::observe(std::chrono::microseconds d) {
+  auto us = d.count() < 0 ? 0 : as_unsigned(d.count());
+
+  buckets_[bucket_index(us)].inc();
+  sum_.add(us);
+}
+
+size_t LatencyHistogram::bucket_index(uint64_t us) {
+  if (us < NUM_SUB_BUCKETS) {
+    return us;
+  }
+
+  if (us >= (1ULL << MAX_EXP)) {
+    return NUM_BUCKETS - 1;
+  }
+
+  auto shift = as_unsigned(std::bit_width(us)) - 1 - SUB_BUCKET_BITS;
+
+  return shift * NUM_SUB_BUCKETS + (us >> shift);
+}
+
+uint64_t LatencyHistogram::bucket_upper_bound(size_t idx) {
+  assert(idx < NUM_BUCKETS - 1);
+
+  if (idx < NUM_SUB_BUCKETS) {
+    return idx + 1;
+  }
+
+  auto shift = idx / NUM_SUB_BUCKETS - 1;
+  auto m = idx % NUM_SUB_BUCKETS + NUM_SUB_BUCKETS;
+
+  return (m + 1) << shift;
+}
+
+uint64_t LatencyHistogram::percentile(double p) const {
+  uint64_t total = 0;
+  for (auto &b : buckets_) {
+    total += b.value();
+  }
+
+  // At least one sample must be above the percentile.
+  if (static_cast<double>(total) * (100. - p) < 100.) {
+    return 0;
+  }
+
+  auto rank =
+    static_cast<uint64_t>(std::ceil(static_cast<double>(total) * p / 100.));
+  uint64_t cumulative = 0;
+
+  for (size_t i = 0; i < NUM_BUCKETS - 1; ++i) {
+    cumulative += buckets_[i].value();
+    if (cumulative >= rank) {
+      return bucket_upper_bound(i);
+    }
+  }
+
+  return 1ULL << MAX_EXP;
+}
+
+Metrics::Metrics(size_t num_workers) : workers_(num_workers) {}
+
+WorkerMetrics *Metrics::get_worker_metrics(size_t index) {
+  return &workers_[index];
+}
+
+RequestMetrics *Metrics::get_labeled_metrics(LabeledMetrics &m, size_t index,
+                                             const std::string_view &label) {
+  std::lock_guard<std::mutex> g(mu_);
+
+  auto it = m.find(label);
+  if (it == std::ranges::end(m)) {
+    std::tie(it, std::ignore) =
+      m.try_emplace(std::string{label}, workers_.size());
+  }
+
+  return &(*it).second[index];
+}
+
+RequestMetrics *Metrics::get_pattern_metrics(size_t index,
+                                             const std::string_view &pattern) {
+  return get_labeled_metrics(patterns_, index, pattern);
+}
+
+RequestMetrics *Metrics::get_backend_metrics(size_t index,
+                                             const std::string_view &hostport) {
+  return get_labeled_metrics(backends_, index, hostport);
+}
+
+namespace {
+// Histograms are exported from this bound in microseconds.  Smaller
+// buckets are merged into the first exported bucket.
+constexpr uint64_t HISTOGRAM_MIN_EXPORT_BOUND = 256;
+} // namespace
+
+namespace {
+// Histograms are exported with 1 << HISTOGRAM_EXPORT_SUB_BUCKET_BITS
+// sub buckets per power of 2 range to keep the number of time series
+// reasonable.  The finer buckets are only used internally.
+constexpr size_t HISTOGRAM_EXPORT_SUB_BUCKET_BITS = 1;
+} // namespace
+
+namespace {
+void append_header(std::string &out, const std::string_view &name,
+                   const std::string_view &type,
+                   const std::string_view &help) {
+  out += "# HELP "sv;
+  out += name;
+  out += ' ';
+  out += help;
+  out += "\n# TYPE "sv;
+  out += name;
+  out += ' ';
+  out += type;
+  out += '\n';
+}
+} // namespace
+
+namespace {
+void append_sample(std::string &out, const std::string_view &name,
+                   uint64_t value) {
+  out += name;
+  out += ' ';
+  out += util::utos(value);
+  out += '\n';
+}
+} // namespace
+
+namespace {
+// Appends |us| microseconds in seconds.
+void append_seconds(std::string &out, uint64_t us) {
+  out += util::utos(us / 1000000);
+
+  auto frac = us % 1000000;
+  if (frac == 0) {
+    return;
+  }
+
+  std::array<char, 7> buf;
+  buf[0] = '.';
+  for (size_t i = 6; i > 0; --i) {
+    buf[i] = static_cast<char>('0' + frac % 10);
+    frac /= 10;
+  }
+
+  auto end = buf.size();
+  for (; buf[end - 1] == '0'; --end)
+    ;
+
+  out.append(buf.data(), end);
+}
+} // namespace
+
+namespace {
+void append_label_value(std::string &out, const std::string_view &s) {
+  for (auto c : s) {
+    switch (c) {
+    case '\\':
+      out += "\\\\"sv;
+      break;
+    case '"':
+      out += "\\\""sv;
+      break;
+    case '\n':
+      out += "\\n"sv;
+      break;
+    default:
+      out += c;
+    }
+  }
+}
+} // namespace
+
+namespace {
+template <typename F>
+uint64_t sum_counter(const std::vector<WorkerMetrics> &workers, F f) {
+  uint64_t n = 0;
+  for (auto &wm : workers) {
+    n += f(wm).value();
+  }
+  return n;
+}
+} // namespace
+
+namespace {
+template <typename F>
+void append_counter(std::string &out, const std::vector<WorkerMetrics> &workers,
+                    const std::string_view &name, const std::string_view &help,
+                    F f) {
+  append_header(out, name, "counter"sv, help);
+  append_sample(out, name, sum_counter(workers, f));
+}
+} // namespace
+
+namespace {
+template <typename F>
+void append_gauge(std::string &out, const std::vector<WorkerMetrics> &workers,
+                  const std::string_view &name, const std::string_view &help,
+                  F f) {
+  int64_t n = 0;
+  for (auto &wm : workers) {
+    n += f(wm).value();
+  }
+
+  append_header(out, name, "gauge"sv, help);
+  append_sample(out, name, n < 0 ? 0 : as_unsigned(n));
+}
+} // namespace
+
+namespace {
+template <typename F>
+void append_histogram(std::string &out,
+                      const std::vector<WorkerMetrics> &workers,
+                      const std::string_view &name,
+                      const std::string_view &help, F f) {
+  std::array<uint64_t, LatencyHistogram::NUM_BUCKETS> counts{};
+  uint64_t sum = 0;
+
+  for (auto &wm : workers) {
+    auto &h = f(wm);
+    for (size_t i = 0; i < counts.size(); ++i) {
+      counts[i] += h.bucket_count(i);
+    }
+    sum += h.sum();
+  }
+
+  append_header(out, name, "histogram"sv, help);
+
+  uint64_t cumulative = 0;
+  for (size_t i = 0; i < counts.size() - 1; ++i) {
+    cumulative += counts[i];
+
+    if ((i + 1) % (LatencyHistogram::NUM_SUB_BUCKETS >>
+                   HISTOGRAM_EXPORT_SUB_BUCKET_BITS)) {
+      continue;
+    }
+
+    auto bound = LatencyHistogram::bucket_upper_bound(i);
+    if (bound < HISTOGRAM_MIN_EXPORT_BOUND) {
+      continue;
+    }
+
+    out += name;
+    out += "_bucket{le=\""sv;
+    append_seconds(out, bound);
+    out += "\"} "sv;
+    out += util::utos(cumulative);
+    out += '\n';
+  }
+
+  cumulative += counts.back();
+
+  out += name;
+  out += "_bucket{le=\"+Inf\"} "sv;
+  out += util::utos(cumulative);
+  out += '\n';
+
+  out += name;
+  out += "_sum "sv;
+  append_seconds(out, sum);
+  out += '\n';
+
+  out += name;
+  out += "_count "sv;
+  out += util::utos(cumulative);
+  out += '\n';
+}
+} // namespace
+
+namespace {
+void append_labeled_responses(std::string &out, const auto &m,
+                              const std::string_view &name,
+                              const std::string_view &label_name,
+                              const std::string_view &help) {
+  append_header(out, name, "counter"sv, help);
+
+  for (auto &[label, slots] : m) {
+    for (size_t i = 0; i < 5; ++i) {
+      uint64_t n = 0;
+      for (auto &rm : slots) {
+        n += rm.responses[i].value();
+      }
+
+      if (n == 0) {
+        continue;
+      }
+
+      out += name;
+      out += '{';
+      out += label_name;
+      out += "=\""sv;
+      append_label_value(out, label);
+      out += "\",code=\""sv;
+      out += static_cast<char>('1' + i);
+      out += "xx\"} "sv;
+      out += util::utos(n);
+      out += '\n';
+    }
+  }
+}
+} // namespace
+
+std::string Metrics::format_prometheus() {
+  std::string out;
+
+  append_gauge(out, workers_, "nghttpx_connections_active"sv,
+               "The number of active frontend connections."sv,
+               [](auto &wm) -> auto & { return wm.connections_active; });
+  append_counter(out, workers_, "nghttpx_connections_total"sv,
+                 "The number of accepted frontend connections."sv,
+                 [](auto &wm) -> auto & { return wm.connections_total; });
+  append_gauge(out, workers_, "nghttpx_streams_active"sv,
+               "The number of requests in flight."sv,
+               [](auto &wm) -> auto & { return wm.streams_active; });
+  append_gauge(
+    out, workers_, "nghttpx_streams_blocked"sv,
+    "The number of requests queued by backend-connections-per-host limit."sv,
+    [](auto &wm) -> auto & { return wm.streams_blocked; });
+  append_gauge(out, workers_, "nghttpx_memchunk_pool_bytes"sv,
+               "The number of bytes allocated by buffer pool."sv,
+               [](auto &wm) -> auto & { return wm.memchunk_pool_bytes; });
+  append_gauge(
+    out, workers_, "nghttpx_memchunk_pool_free_bytes"sv,
+    "The number of bytes in the freelist of buffer pool."sv,
+    [](auto &wm) -> auto & { return wm.memchunk_pool_free_bytes; });
+  append_counter(
+    out, workers_, "nghttpx_streams_shed_total"sv,
+    "The number of queued requests shed by backend-queue-delay-target."sv,
+    [](auto &wm) -> auto & { return wm.streams_shed_total; });
+  append_counter(
+    out, workers_, "nghttpx_streams_rate_limited_total"sv,
+    "The number of requests rejected by request-rate limit."sv,
+    [](auto &wm) -> auto & { return wm.streams_rate_limited_total; });
+  append_counter(out, workers_, "nghttpx_tls_handshakes_total"sv,
+                 "The number of completed frontend TLS handshakes."sv,
+                 [](auto &wm) -> auto & { return wm.tls_handshakes_total; });
+  append_counter(
+    out, workers_, "nghttpx_tls_handshake_failures_total"sv,
+    "The number of failed frontend TLS handshakes."sv,
+    [](auto &wm) -> auto & { return wm.tls_handshake_failures_total; });
+  append_counter(
+    out, workers_, "nghttpx_tls_sessions_reused_total"sv,
+    "The number of frontend TLS handshakes which resumed a session."sv,
+    [](auto &wm) -> auto & { return wm.tls_sessions_reused_total; });
+  append_histogram(
+    out, workers_, "nghttpx_tls_handshake_duration_seconds"sv,
+    "Time taken to complete frontend TLS handshake."sv,
+    [](auto &wm) -> auto & { return wm.tls_handshake_duration; });
+  append_counter(
+    out, workers_, "nghttpx_request_body_bytes_total"sv,
+    "The number of request body bytes received from clients."sv,
+    [](auto &wm) -> auto & { return wm.request_body_bytes_total; });
+  append_counter(
+    out, workers_, "nghttpx_response_body_bytes_total"sv,
+    "The number of response body bytes sent to clients."sv,
+    [](auto &wm) -> auto & { return wm.response_body_bytes_total; });
+
+  constexpr auto responses_name = "nghttpx_responses_total"sv;
+
+  append_header(out, responses_name, "counter"sv,
+                "The number of responses by status code."sv);
+
+  for (size_t i = 0; i < workers_[0].responses.size(); ++i) {
+    auto n = sum_counter(workers_,
+                         [i](auto &wm) -> auto & { return wm.responses[i]; });
+    if (n == 0) {
+      continue;
+    }
+
+    out += responses_name;
+    out += "{code=\""sv;
+    out += util::utos(i + 100);
+    out += "\"} "sv;
+    out += util::utos(n);
+    out += '\n';
+  }
+
+  if (auto n = sum_counter(
+        workers_, [](auto &wm) -> auto & { return wm.other_responses; });
+      n) {
+    out += responses_name;
+    out += "{code=\"other\"} "sv;
+    out += util::utos(n);
+    out += '\n';
+  }
+
+  append_histogram(out, workers_, "nghttpx_request_duration_seconds"sv,
+                   "Time taken to process a request."sv,
+                   [](auto &wm) -> auto & { return wm.request_duration; });
+  append_histogram(
+    out, workers_, "nghttpx_backend_response_duration_seconds"sv,
+    "Time between sending a request to backend and receiving response "
+    "header fields."sv,
+    [](auto &wm) -> auto & { return wm.backend_response_duration; });
+
+  std::lock_guard<std::mutex> g(mu_);
+
+  append_labeled_responses(out, patterns_, "nghttpx_pattern_responses_total"sv,
+                           "pattern"sv,
+                           "The number of responses by pattern."sv);
+  append_labeled_responses(out, backends_, "nghttpx_backend_responses_total"sv,
+                           "backend"sv,
+                           "The number of responses by backend."sv);
+
+  return out;
+}
+
+void record_request_metrics(
+  WorkerMetrics &wm, const Downstream &downstream,
+  const std::chrono::high_resolution_clock::time_point &request_end_time) {
+  const auto &req = downstream.request();
+  const auto &resp = downstream.response();
+  const auto &timings = downstream.timings();
+
+  if (req.recv_body_length > 0) {
+    wm.request_body_bytes_total.add(as_unsigned(req.recv_body_length));
+  }
+
+  if (downstream.response_sent_body_length > 0) {
+    wm.response_body_bytes_total.add(
+      as_unsigned(downstream.response_sent_body_length));
+  }
+
+  wm.request_duration.observe(
+    std::chrono::duration_cast<std::chrono::microseconds>(
+      request_end_time - downstream.get_request_start_time()));
+
+  constexpr auto unset = std::chrono::high_resolution_clock::time_point{};
+
+  if (timings.backend_request_start != unset &&
+      timings.response_header_end != unset) {
+    wm.backend_response_duration.observe(
+      std::chrono::duration_cast<std::chrono::microseconds>(
+        timings.response_header_end -
+        std::max(timings.backend_request_start, timings.backend_connect_end)));
+  }
+
+  if (resp.http_status < 100 || resp.http_status > 599) {
+    wm.other_responses.inc();
+    return;
+  }
+
+  wm.responses[resp.http_status - 100].inc();
+
+  auto status_class = resp.http_status / 100 - 1;
+
+  auto addr = downstream.get_addr();
+  if (addr && addr->metrics) {
+    addr->metrics->responses[status_class].inc();
+  }
+
+  const auto &group = downstream.get_downstream_addr_group();
+  if (group && group->metrics) {
+    group->metrics->responses[status_class].inc();
+  }
+}
+
+} // namespace shrpx
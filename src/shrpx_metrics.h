@@ -0,0 +1,208 @@
+/*
+ * nghttp2 - HTTP/2 C Library
+ *
+ * Copyright (c) 2026 Tatsuhiro Tsujikawa
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+ * LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#ifndef SHRPX_METRICS_H
+#define SHRPX_METRICS_H
+
+#include "shrpx.h"
+
+#include <atomic>
+#include <array>
+#include <vector>
+#include <map>
+#include <mutex>
+#include <string>
+#include <chrono>
+
+#include "template.h"
+
+using namespace nghttp2;
+
+namespace shrpx {
+
+class Downstream;
+
+// The size of cache line.  Metrics updated by different workers are
+// aligned to this boundary to avoid false sharing.
+constexpr size_t METRICS_CACHE_LINE_SIZE = 64;
+
+// Counter is a monotonically increasing value.  It is updated only by
+// the owning worker thread, and it may be read by the other thread
+// concurrently.  Because there is a single writer, increment does not
+// require an atomic read-modify-write operation.
+class Counter {
+public:
+  void add(uint64_t n) {
+    v_.store(v_.load(std::memory_order_relaxed) + n,
+             std::memory_order_relaxed);
+  }
+  void inc() { add(1); }
+  uint64_t value() const { return v_.load(std::memory_order_relaxed); }
+
+private:
+  std::atomic<uint64_t> v_;
+};
+
+// Gauge is a value which can go up and down.  The same threading
+// rule as Counter applies.
+class Gauge {
+public:
+  void inc() {
+    v_.store(v_.load(std::memory_order_relaxed) + 1,
+             std::memory_order_relaxed);
+  }
+  void dec() {
+    v_.store(v_.load(std::memory_order_relaxed) - 1,
+             std::memory_order_relaxed);
+  }
+  void set(int64_t n) { v_.store(n, std::memory_order_relaxed); }
+  int64_t value() const { return v_.load(std::memory_order_relaxed); }
+
+private:
+  std::atomic<int64_t> v_;
+};
+
+// LatencyHistogram records durations in microseconds in log-linear
+// buckets in the same way as HdrHistogram does.  Each power of 2
+// range is divided into 1 << SUB_BUCKET_BITS linear sub buckets, so
+// that the relative error of a recorded value is at most 1 / (1 <<
+// SUB_BUCKET_BITS).  The durations which are equal to or larger than
+// 1 << MAX_EXP microseconds are counted in the last bucket.
+class LatencyHistogram {
+public:
+  static constexpr size_t SUB_BUCKET_BITS = 4;
+  static constexpr size_t NUM_SUB_BUCKETS = 1 << SUB_BUCKET_BITS;
+  static constexpr size_t MAX_EXP = 25;
+  static constexpr size_t NUM_BUCKETS =
+    (MAX_EXP - SUB_BUCKET_BITS + 1) * NUM_SUB_BUCKETS + 1;
+
+  void observe(std::chrono::microseconds d);
+
+  // Returns the index of bucket which |us| microseconds falls into.
+  static size_t bucket_index(uint64_t us);
+  // Returns the exclusive upper bound of the bucket at |idx| in
+  // microseconds.  |idx| must be less than NUM_BUCKETS - 1.
+  static uint64_t bucket_upper_bound(size_t idx);
+
+  uint64_t bucket_count(size_t idx) const { return buckets_[idx].value(); }
+  // Returns the sum of recorded durations in microseconds.
+  uint64_t sum() const { return sum_.value(); }
+  // Returns the upper bound of the bucket which contains the |p|-th
+  // percentile in microseconds.  |p| must be in the range [0, 100).
+  // This function returns 0 if there are not enough samples to
+  // estimate it.
+  uint64_t percentile(double p) const;
+
+private:
+  std::array<Counter, NUM_BUCKETS> buckets_;
+  Counter sum_;
+};
+
+// RequestMetrics counts responses for a particular pattern or
+// backend in a worker.
+struct alignas(METRICS_CACHE_LINE_SIZE) RequestMetrics {
+  // The number of responses by status code class.  Index 0 is 1xx,
+  // and index 4 is 5xx.
+  std::array<Counter, 5> responses;
+};
+
+// WorkerMetrics is a set of metrics which a worker updates.
+struct alignas(METRICS_CACHE_LINE_SIZE) WorkerMetrics {
+  Gauge connections_active;
+  Counter connections_total;
+  // The number of frontend streams (requests) in flight.
+  Gauge streams_active;
+  // The number of requests which are queued because of
+  // backend-connections-per-host limit.
+  Gauge streams_blocked;
+  // The number of queued requests which are shed because they have
+  // waited too long.
+  Counter streams_shed_total;
+  // The number of requests which are rejected by per-client request
+  // rate limit.
+  Counter streams_rate_limited_total;
+  Counter tls_handshakes_total;
+  Counter tls_handshake_failures_total;
+  Counter tls_sessions_reused_total;
+  Counter request_body_bytes_total;
+  Counter response_body_bytes_total;
+  // The number of bytes allocated by Memchunk pool, and the number of
+  // bytes in its freelist.  They are sampled periodically.
+  Gauge memchunk_pool_bytes;
+  Gauge memchunk_pool_free_bytes;
+  // The number of responses by status code.  Index 0 is for status
+  // code 100.  The status code outside of [100, 599] is counted in
+  // other_responses.
+  std::array<Counter, 500> responses;
+  Counter other_responses;
+  LatencyHistogram tls_handshake_duration;
+  LatencyHistogram request_duration;
+  LatencyHistogram backend_response_duration;
+};
+
+// Metrics owns the metrics of all workers in a process, and
+// aggregates them to export.
+class Metrics {
+public:
+  explicit Metrics(size_t num_workers);
+
+  WorkerMetrics *get_worker_metrics(size_t index);
+  // Returns RequestMetrics for the worker at |index| and |pattern|.
+  // The object is created if it does not exist yet.  It is valid
+  // until this object is destroyed.  This function is thread-safe.
+  // It is intended to be called on configuration changes, and the
+  // returned object should be cached.
+  RequestMetrics *get_pattern_metrics(size_t index,
+                                      const std::string_view &pattern);
+  // Returns RequestMetrics for the worker at |index| and backend
+  // |hostport|.  The same rule as get_pattern_metrics() applies.
+  RequestMetrics *get_backend_metrics(size_t index,
+                                      const std::string_view &hostport);
+
+  // Returns all metrics in Prometheus text exposition format.  This
+  // function is thread-safe.
+  std::string format_prometheus();
+
+private:
+  using LabeledMetrics =
+    std::map<std::string, std::vector<RequestMetrics>, std::less<>>;
+
+  RequestMetrics *get_labeled_metrics(LabeledMetrics &m, size_t index,
+                                      const std::string_view &label);
+
+  std::mutex mu_;
+  std::vector<WorkerMetrics> workers_;
+  LabeledMetrics patterns_;
+  LabeledMetrics backends_;
+};
+
+// Records the metrics of |downstream| which has finished at
+// |request_end_time| to |wm|.
+void record_request_metrics(
+  WorkerMetrics &wm, const Downstream &downstream,
+  const std::chrono::high_resolution_clock::time_point &request_end_time);
+
+} // namespace shrpx
+
+#endif // SHRPX_METRICS_H
@@ -0,0 +1,197 @@
+/*
+ * nghttp2 - HTTP/2 C Library
+ *
+ * Copyright (c) 2026 Tatsuhiro Tsujikawa
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+ * LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include "shrpx_metrics_test.h"
+
+#include "munitxx.h"
+
+#include "shrpx_metrics.h"
+
+using namespace std::literals;
+
+namespace shrpx {
+
+namespace {
+const MunitTest tests[]{
+  munit_void_test(test_shrpx_metrics_histogram_bucket),
+  munit_void_test(test_shrpx_metrics_histogram_percentile),
+  munit_void_test(test_shrpx_metrics_format_prometheus),
+  munit_test_end(),
+};
+} // namespace
+
+const MunitSuite metrics_suite{
+  "/metrics", tests, nullptr, 1, MUNIT_SUITE_OPTION_NONE,
+};
+
+void test_shrpx_metrics_histogram_bucket(void) {
+  for (uint64_t v = 0; v < 32; ++v) {
+    assert_size(v, ==, LatencyHistogram::bucket_index(v));
+  }
+  assert_size(32, ==, LatencyHistogram::bucket_index(32));
+  assert_size(32, ==, LatencyHistogram::bucket_index(33));
+  assert_size(33, ==, LatencyHistogram::bucket_index(34));
+  assert_size(47, ==, LatencyHistogram::bucket_index(63));
+  assert_size(48, ==, LatencyHistogram::bucket_index(64));
+  assert_size(LatencyHistogram::NUM_BUCKETS - 2, ==,
+              LatencyHistogram::bucket_index((1 << 25) - 1));
+  assert_size(LatencyHistogram::NUM_BUCKETS - 1, ==,
+              LatencyHistogram::bucket_index(1 << 25));
+  assert_size(LatencyHistogram::NUM_BUCKETS - 1, ==,
+              LatencyHistogram::bucket_index(UINT64_MAX));
+
+  assert_uint64(1, ==, LatencyHistogram::bucket_upper_bound(0));
+  assert_uint64(32, ==, LatencyHistogram::bucket_upper_bound(31));
+  assert_uint64(34, ==, LatencyHistogram::bucket_upper_bound(32));
+  assert_uint64(64, ==, LatencyHistogram::bucket_upper_bound(47));
+  assert_uint64(68, ==, LatencyHistogram::bucket_upper_bound(48));
+  assert_uint64(1 << 25, ==,
+                LatencyHistogram::bucket_upper_bound(
+                  LatencyHistogram::NUM_BUCKETS - 2));
+
+  // Every value must fall into the bucket whose range includes it.
+  for (uint64_t v = 1; v < (1 << 25); v = v * 3 / 2 + 1) {
+    auto idx = LatencyHistogram::bucket_index(v);
+
+    assert_uint64(v, <, LatencyHistogram::bucket_upper_bound(idx));
+    assert_uint64(v, >=, LatencyHistogram::bucket_upper_bound(idx - 1));
+  }
+}
+
+namespace {
+// Asserts that |est|, the estimated value of a percentile, is not
+// less than the actual value |v|, and it is not too far from |v|.
+void assert_percentile(uint64_t v, uint64_t est) {
+  assert_uint64(v, <, est);
+  assert_uint64(est, <=, v + v / LatencyHistogram::NUM_SUB_BUCKETS + 1);
+}
+} // namespace
+
+void test_shrpx_metrics_histogram_percentile(void) {
+  {
+    LatencyHistogram h;
+
+    for (int64_t v = 1; v <= 10000; ++v) {
+      h.observe(std::chrono::microseconds(v));
+    }
+
+    assert_percentile(5000, h.percentile(50));
+    assert_percentile(9000, h.percentile(90));
+    assert_percentile(9500, h.percentile(95));
+    assert_percentile(9900, h.percentile(99));
+    assert_percentile(9990, h.percentile(99.9));
+  }
+  {
+    LatencyHistogram h;
+
+    for (size_t i = 0; i < 900; ++i) {
+      h.observe(std::chrono::microseconds(1000));
+    }
+    for (size_t i = 0; i < 100; ++i) {
+      h.observe(std::chrono::microseconds(50000));
+    }
+
+    assert_percentile(1000, h.percentile(50));
+    assert_percentile(1000, h.percentile(90));
+    assert_percentile(50000, h.percentile(95));
+    assert_percentile(50000, h.percentile(99));
+  }
+  {
+    LatencyHistogram h;
+
+    for (size_t i = 0; i < 10; ++i) {
+      h.observe(std::chrono::microseconds(1000));
+    }
+
+    assert_percentile(1000, h.percentile(50));
+    // Not enough samples above 99th percentile.
+    assert_uint64(0, ==, h.percentile(99));
+  }
+  {
+    LatencyHistogram h;
+
+    h.observe(std::chrono::seconds(3600));
+    h.observe(std::chrono::seconds(3600));
+
+    assert_uint64(1 << LatencyHistogram::MAX_EXP, ==, h.percentile(50));
+  }
+}
+
+namespace {
+bool contains(const std::string_view &s, const std::string_view &needle) {
+  return s.find(needle) != std::string_view::npos;
+}
+} // namespace
+
+void test_shrpx_metrics_format_prometheus(void) {
+  Metrics metrics(2);
+
+  auto w0 = metrics.get_worker_metrics(0);
+  auto w1 = metrics.get_worker_metrics(1);
+
+  w0->connections_total.inc();
+  w1->connections_total.add(2);
+  w0->connections_active.inc();
+  w1->connections_active.inc();
+  w1->connections_active.dec();
+  w0->responses[200 - 100].inc();
+  w1->responses[200 - 100].inc();
+  w1->responses[404 - 100].inc();
+  w0->request_duration.observe(std::chrono::microseconds(300));
+  w1->request_duration.observe(std::chrono::microseconds(1500000));
+  w1->request_duration.observe(std::chrono::microseconds(100));
+
+  metrics.get_pattern_metrics(0, "example.com/\"a\\"sv)->responses[1].inc();
+  metrics.get_pattern_metrics(1, "example.com/\"a\\"sv)->responses[1].inc();
+  metrics.get_backend_metrics(1, "127.0.0.1:8080"sv)->responses[4].inc();
+
+  assert_ptr_equal(metrics.get_backend_metrics(1, "127.0.0.1:8080"sv),
+                   metrics.get_backend_metrics(1, "127.0.0.1:8080"sv));
+
+  auto s = metrics.format_prometheus();
+
+  assert_true(contains(s, "# TYPE nghttpx_connections_total counter\n"
+                          "nghttpx_connections_total 3\n"sv));
+  assert_true(contains(s, "# TYPE nghttpx_connections_active gauge\n"
+                          "nghttpx_connections_active 1\n"sv));
+  assert_true(contains(s, "nghttpx_responses_total{code=\"200\"} 2\n"
+                          "nghttpx_responses_total{code=\"404\"} 1\n"sv));
+  assert_false(contains(s, "nghttpx_responses_total{code=\"500\"}"sv));
+  assert_true(contains(s, "nghttpx_request_duration_seconds_bucket{le="
+                          "\"0.000256\"} 1\n"
+                          "nghttpx_request_duration_seconds_bucket{le="
+                          "\"0.000384\"} 2\n"sv));
+  assert_true(contains(s, "nghttpx_request_duration_seconds_bucket{le="
+                          "\"1.572864\"} 3\n"sv));
+  assert_true(contains(s, "nghttpx_request_duration_seconds_bucket{le="
+                          "\"+Inf\"} 3\n"
+                          "nghttpx_request_duration_seconds_sum 1.5004\n"
+                          "nghttpx_request_duration_seconds_count 3\n"sv));
+  assert_true(contains(s, "nghttpx_pattern_responses_total{pattern="
+                          "\"example.com/\\\"a\\\\\",code=\"2xx\"} 2\n"sv));
+  assert_true(contains(s, "nghttpx_backend_responses_total{backend="
+                          "\"127.0.0.1:8080\",code=\"5xx\"} 1\n"sv));
+}
+
+} // namespace shrpx
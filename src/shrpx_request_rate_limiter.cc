@@ -0,0 +1,76 @@
+/*
+ * nghttp2 - HTTP/2 C Library
+ *
+ * Copyright (c) 2026 Tatsuhiro Tsujikawa
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+ * LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include "shrpx_request_rate_limiter.h"
+
+#include <algorithm>
+
+namespace shrpx {
+
+RequestRateLimiter::RequestRateLimiter(size_t rate, size_t burst,
+                                       size_t max_entries)
+  : rate_(static_cast<double>(rate)),
+    burst_(static_cast<double>(std::max(burst, static_cast<size_t>(1)))),
+    max_entries_(std::max(max_entries, static_cast<size_t>(1))) {}
+
+bool RequestRateLimiter::allow(const std::string_view &key, ev_tstamp now) {
+  auto itr = buckets_.find(key);
+  if (itr == std::ranges::end(buckets_)) {
+    if (buckets_.size() >= max_entries_) {
+      auto b = lru_.head;
+      lru_.remove(b);
+      buckets_.erase(std::string_view{b->key.begin(), b->key.end()});
+    }
+
+    auto b = std::make_unique<Bucket>(ImmutableString{key}, burst_ - 1, now);
+    auto key_ref = std::string_view{b->key.begin(), b->key.end()};
+
+    lru_.append(b.get());
+    buckets_.emplace(key_ref, std::move(b));
+
+    return true;
+  }
+
+  auto b = (*itr).second.get();
+
+  lru_.remove(b);
+  lru_.append(b);
+
+  if (now > b->last) {
+    b->tokens = std::min(burst_, b->tokens + (now - b->last) * rate_);
+    b->last = now;
+  }
+
+  if (b->tokens < 1.) {
+    return false;
+  }
+
+  b->tokens -= 1.;
+
+  return true;
+}
+
+size_t RequestRateLimiter::size() const { return buckets_.size(); }
+
+} // namespace shrpx
@@ -0,0 +1,93 @@
+/*
+ * nghttp2 - HTTP/2 C Library
+ *
+ * Copyright (c) 2026 Tatsuhiro Tsujikawa
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+ * LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#ifndef SHRPX_REQUEST_RATE_LIMITER_H
+#define SHRPX_REQUEST_RATE_LIMITER_H
+
+#include "shrpx.h"
+
+#include <memory>
+#include <unordered_map>
+
+#include <ev.h>
+
+#include "template.h"
+
+using namespace nghttp2;
+
+namespace shrpx {
+
+// The maximum number of clients which RequestRateLimiter tracks.  If
+// it is exceeded, the least recently used entry is evicted.
+constexpr size_t REQUEST_RATE_LIMITER_MAX_ENTRIES = 65536;
+
+// RequestRateLimiter limits the number of requests per client using
+// token bucket algorithm.  Each client has its own bucket which holds
+// at most burst tokens, and it is refilled at rate tokens per second.
+// A request consumes a token.  The buckets are looked up in O(1), and
+// the least recently used bucket is evicted if the number of buckets
+// exceeds REQUEST_RATE_LIMITER_MAX_ENTRIES.
+class RequestRateLimiter {
+public:
+  RequestRateLimiter(size_t rate, size_t burst,
+                     size_t max_entries = REQUEST_RATE_LIMITER_MAX_ENTRIES);
+
+  RequestRateLimiter(const RequestRateLimiter &) = delete;
+  RequestRateLimiter &operator=(const RequestRateLimiter &) = delete;
+
+  // Consumes a token from the bucket of |key| at |now|.  It returns
+  // true if a token is available, and the request is allowed.
+  bool allow(const std::string_view &key, ev_tstamp now);
+
+  // Returns the number of buckets.
+  size_t size() const;
+
+private:
+  struct Bucket {
+    Bucket(ImmutableString &&key, double tokens, ev_tstamp last)
+      : key(std::move(key)),
+        dlnext(nullptr),
+        dlprev(nullptr),
+        tokens(tokens),
+        last(last) {}
+
+    ImmutableString key;
+    Bucket *dlnext, *dlprev;
+    // The number of tokens available at last.
+    double tokens;
+    // The time when tokens is updated.
+    ev_tstamp last;
+  };
+
+  std::unordered_map<std::string_view, std::unique_ptr<Bucket>> buckets_;
+  // The buckets in least recently used order.
+  DList<Bucket> lru_;
+  double rate_;
+  double burst_;
+  size_t max_entries_;
+};
+
+} // namespace shrpx
+
+#endif // SHRPX_REQUEST_RATE_LIMITER_H
@@ -0,0 +1,91 @@
+/*
+ * nghttp2 - HTTP/2 C Library
+ *
+ * Copyright (c) 2026 Tatsuhiro Tsujikawa
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+ * LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include "shrpx_request_rate_limiter_test.h"
+
+#include "munitxx.h"
+
+#include "shrpx_request_rate_limiter.h"
+
+using namespace std::literals;
+
+namespace shrpx {
+
+namespace {
+const MunitTest tests[]{
+  munit_void_test(test_shrpx_request_rate_limiter_allow),
+  munit_void_test(test_shrpx_request_rate_limiter_evict),
+  munit_test_end(),
+};
+} // namespace
+
+const MunitSuite request_rate_limiter_suite{
+  "/request_rate_limiter", tests, nullptr, 1, MUNIT_SUITE_OPTION_NONE,
+};
+
+void test_shrpx_request_rate_limiter_allow(void) {
+  RequestRateLimiter rl(2, 3);
+
+  // The bucket starts with burst tokens.
+  assert_true(rl.allow("alpha"sv, 1.));
+  assert_true(rl.allow("alpha"sv, 1.));
+  assert_true(rl.allow("alpha"sv, 1.));
+  assert_false(rl.allow("alpha"sv, 1.));
+
+  // The other client has its own bucket.
+  assert_true(rl.allow("bravo"sv, 1.));
+
+  // 2 tokens per second are refilled.
+  assert_true(rl.allow("alpha"sv, 1.5));
+  assert_false(rl.allow("alpha"sv, 1.5));
+
+  // Tokens never exceed burst.
+  assert_true(rl.allow("alpha"sv, 100.));
+  assert_true(rl.allow("alpha"sv, 100.));
+  assert_true(rl.allow("alpha"sv, 100.));
+  assert_false(rl.allow("alpha"sv, 100.));
+
+  assert_size(2, ==, rl.size());
+}
+
+void test_shrpx_request_rate_limiter_evict(void) {
+  RequestRateLimiter rl(1, 1, 2);
+
+  assert_true(rl.allow("alpha"sv, 1.));
+  assert_true(rl.allow("bravo"sv, 1.));
+
+  assert_false(rl.allow("alpha"sv, 1.));
+
+  // bravo is the least recently used, and it is evicted.
+  assert_true(rl.allow("charlie"sv, 1.));
+
+  assert_size(2, ==, rl.size());
+
+  assert_false(rl.allow("alpha"sv, 1.));
+  assert_true(rl.allow("bravo"sv, 1.));
+  // charlie has been evicted by bravo.
+  assert_true(rl.allow("charlie"sv, 1.));
+}
+
+} // namespace shrpx
@@ -0,0 +1,163 @@
+/*
+ * nghttp2 - HTTP/2 C Library
+ *
+ * Copyright (c) 2026 Tatsuhiro Tsujikawa
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+ * LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include "shrpx_response_spool.h"
+
+#ifdef HAVE_UNISTD_H
+#  include <unistd.h>
+#endif // HAVE_UNISTD_H
+
+#include <cerrno>
+#include <algorithm>
+#include <array>
+#include <string>
+
+#include "shrpx_log.h"
+#include "util.h"
+#include "xsi_strerror.h"
+
+using namespace std::literals;
+
+namespace shrpx {
+
+ResponseSpool::ResponseSpool(MemchunkPool *mcpool,
+                             const std::string_view &dir)
+  : buf_(mcpool), fd_(-1), roff_(0), woff_(0) {
+  std::array<char, STRERROR_BUFSIZE> errbuf;
+
+  auto path = std::string{dir};
+  path += "/nghttpx-spool.XXXXXX"sv;
+
+  fd_ = mkstemp(path.data());
+  if (fd_ == -1) {
+    auto error = errno;
+    LOG(WARN) << "Could not create response spool file in " << dir << ": "
+              << xsi_strerror(error, errbuf.data(), errbuf.size());
+    return;
+  }
+
+  unlink(path.c_str());
+  util::make_socket_closeonexec(fd_);
+}
+
+ResponseSpool::~ResponseSpool() {
+  if (fd_ != -1) {
+    close(fd_);
+  }
+}
+
+DefaultMemchunks *ResponseSpool::get_buf() {
+  flush();
+
+  return &buf_;
+}
+
+void ResponseSpool::flush() {
+  if (fd_ == -1) {
+    return;
+  }
+
+  for (;;) {
+    std::array<iovec, 1> iov{};
+
+    if (buf_.riovec(iov.data(), iov.size()) == 0) {
+      return;
+    }
+
+    ssize_t nwrite;
+    while ((nwrite = pwrite(fd_, iov[0].iov_base, iov[0].iov_len, woff_)) ==
+             -1 &&
+           errno == EINTR)
+      ;
+
+    if (nwrite == -1) {
+      std::array<char, STRERROR_BUFSIZE> errbuf;
+      auto error = errno;
+      LOG(WARN) << "Could not write response spool file: "
+                << xsi_strerror(error, errbuf.data(), errbuf.size());
+
+      // Keep the remaining data in memory.  roff_ and woff_ are still
+      // valid to read the data written so far.
+      return;
+    }
+
+    buf_.drain(static_cast<size_t>(nwrite));
+    woff_ += nwrite;
+  }
+}
+
+nghttp2_ssize ResponseSpool::remove(DefaultMemchunks &dest, size_t max) {
+  size_t nmoved = 0;
+
+  while (nmoved < max && roff_ < woff_) {
+    auto n = std::min({max - nmoved, static_cast<size_t>(woff_ - roff_),
+                       Memchunk16K::size});
+    if (dest.tail && dest.tail->left()) {
+      n = std::min(n, dest.tail->left());
+    }
+
+    ssize_t nread = 0;
+
+    dest.append(n, [this, n, &nread](uint8_t *p) {
+      while ((nread = pread(fd_, p, n, roff_)) == -1 && errno == EINTR)
+        ;
+
+      return p + std::max(nread, static_cast<ssize_t>(0));
+    });
+
+    if (nread <= 0) {
+      std::array<char, STRERROR_BUFSIZE> errbuf;
+      auto error = nread == 0 ? EIO : errno;
+      LOG(ERROR) << "Could not read response spool file: "
+                 << xsi_strerror(error, errbuf.data(), errbuf.size());
+
+      return -1;
+    }
+
+    roff_ += nread;
+    nmoved += static_cast<size_t>(nread);
+  }
+
+  if (roff_ == woff_ && roff_ > 0) {
+    // All data in the file have been read.  Truncate the file to
+    // reuse it from the beginning.
+    if (ftruncate(fd_, 0) == 0) {
+      roff_ = woff_ = 0;
+    }
+  }
+
+  if (nmoved < max && roff_ == woff_) {
+    nmoved += buf_.remove(dest, max - nmoved);
+  }
+
+  return static_cast<nghttp2_ssize>(nmoved);
+}
+
+size_t ResponseSpool::rleft() const {
+  return static_cast<size_t>(woff_ - roff_) + buf_.rleft();
+}
+
+size_t ResponseSpool::rleft_memory() const { return buf_.rleft(); }
+
+} // namespace shrpx
@@ -0,0 +1,86 @@
+/*
+ * nghttp2 - HTTP/2 C Library
+ *
+ * Copyright (c) 2026 Tatsuhiro Tsujikawa
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+ * LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#ifndef SHRPX_RESPONSE_SPOOL_H
+#define SHRPX_RESPONSE_SPOOL_H
+
+#include "shrpx.h"
+
+#include <sys/types.h>
+
+#include <string_view>
+
+#include <nghttp2/nghttp2.h>
+
+#include "memchunk.h"
+#include "template.h"
+
+using namespace nghttp2;
+
+namespace shrpx {
+
+// ResponseSpool stores the response body which does not fit in the
+// response buffer so that a backend connection can read the whole
+// response without waiting for a slow client.  The data appended to
+// the spool are written to an unlinked temporary file, and read back
+// in the same order.  If the temporary file cannot be created or
+// written, the data are kept in memory.  It also stores the request
+// body buffered by buffer-request parameter.
+class ResponseSpool {
+public:
+  // |dir| is the directory where the temporary file is created.
+  ResponseSpool(MemchunkPool *mcpool, const std::string_view &dir);
+  ~ResponseSpool();
+
+  ResponseSpool(const ResponseSpool &) = delete;
+  ResponseSpool &operator=(const ResponseSpool &) = delete;
+
+  // Returns the buffer to append data to the end of spool.  The data
+  // appended previously are written to the temporary file before
+  // this function returns.
+  DefaultMemchunks *get_buf();
+  // Moves at most |max| bytes from the head of spool to |dest|.  It
+  // returns the number of bytes moved, or -1 if it fails to read the
+  // temporary file.
+  nghttp2_ssize remove(DefaultMemchunks &dest, size_t max);
+  // Returns the number of bytes in spool.
+  size_t rleft() const;
+  // Returns the number of bytes in spool which are kept in memory.
+  size_t rleft_memory() const;
+  // Writes the data in buf_ to the temporary file.
+  void flush();
+
+private:
+  DefaultMemchunks buf_;
+  // The file descriptor of the temporary file, or -1.
+  int fd_;
+  // The offset in the temporary file to read next.
+  off_t roff_;
+  // The offset in the temporary file to write next.
+  off_t woff_;
+};
+
+} // namespace shrpx
+
+#endif // SHRPX_RESPONSE_SPOOL_H
@@ -0,0 +1,129 @@
+/*
+ * nghttp2 - HTTP/2 C Library
+ *
+ * Copyright (c) 2026 Tatsuhiro Tsujikawa
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+ * LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include "shrpx_response_spool_test.h"
+
+#include <string>
+
+#include "munitxx.h"
+
+#include "shrpx_response_spool.h"
+
+using namespace std::literals;
+
+namespace shrpx {
+
+namespace {
+const MunitTest tests[]{
+  munit_void_test(test_shrpx_response_spool_file),
+  munit_void_test(test_shrpx_response_spool_memory),
+  munit_test_end(),
+};
+} // namespace
+
+const MunitSuite response_spool_suite{
+  "/response_spool", tests, nullptr, 1, MUNIT_SUITE_OPTION_NONE,
+};
+
+namespace {
+std::string make_data(size_t len, char c) {
+  std::string s;
+  s.reserve(len);
+  for (size_t i = 0; i < len; ++i) {
+    s += static_cast<char>(c + static_cast<char>(i % 26));
+  }
+  return s;
+}
+} // namespace
+
+namespace {
+std::string remove_all(DefaultMemchunks &buf) {
+  std::string s(buf.rleft(), '\0');
+  buf.remove(s.data(), s.size());
+  return s;
+}
+} // namespace
+
+void test_shrpx_response_spool_file(void) {
+  MemchunkPool pool;
+  ResponseSpool spool(&pool, "/tmp"sv);
+  DefaultMemchunks dest(&pool);
+
+  auto a = make_data(20000, 'a');
+  auto b = make_data(30000, 'A');
+
+  spool.get_buf()->append(a);
+  spool.get_buf()->append(b);
+
+  assert_size(50000, ==, spool.rleft());
+  // The first data have been written to the file.
+  assert_size(30000, ==, spool.rleft_memory());
+
+  assert_ptrdiff(10000, ==, spool.remove(dest, 10000));
+  assert_stdstring_equal(a.substr(0, 10000), remove_all(dest));
+
+  // Data appended later come after the data in the file.
+  auto c = make_data(100, '0');
+
+  spool.get_buf()->append(c);
+
+  assert_size(40100, ==, spool.rleft());
+  assert_size(100, ==, spool.rleft_memory());
+
+  assert_ptrdiff(40100, ==, spool.remove(dest, 100000));
+  assert_stdstring_equal(a.substr(10000) + b + c, remove_all(dest));
+
+  assert_size(0, ==, spool.rleft());
+  assert_ptrdiff(0, ==, spool.remove(dest, 100000));
+
+  // The file is reused after all data are read.
+  spool.get_buf()->append(a);
+  spool.get_buf();
+
+  assert_size(20000, ==, spool.rleft());
+  assert_size(0, ==, spool.rleft_memory());
+
+  assert_ptrdiff(20000, ==, spool.remove(dest, 20000));
+  assert_stdstring_equal(a, remove_all(dest));
+}
+
+void test_shrpx_response_spool_memory(void) {
+  MemchunkPool pool;
+  // The temporary file cannot be created.
+  ResponseSpool spool(&pool, "/nonexistent-nghttpx-spool-dir"sv);
+  DefaultMemchunks dest(&pool);
+
+  auto a = make_data(20000, 'a');
+
+  spool.get_buf()->append(a);
+  spool.get_buf();
+
+  assert_size(20000, ==, spool.rleft());
+  assert_size(20000, ==, spool.rleft_memory());
+
+  assert_ptrdiff(20000, ==, spool.remove(dest, 30000));
+  assert_stdstring_equal(a, remove_all(dest));
+}
+
+} // namespace shrpx
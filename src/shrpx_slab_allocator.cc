@@ -0,0 +1,250 @@
+/*
+ * nghttp2 - HTTP/2 C Library
+ *
+ * Copyright (c) 2026 Tatsuhiro Tsujikawa
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+ * LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include "shrpx_slab_allocator.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <cassert>
+#include <bit>
+#include <limits>
+#include <algorithm>
+
+namespace shrpx {
+
+namespace {
+// Returns the index of the size class which |size| falls into.
+// |size| must be equal to or less than SLAB_MAX_BLOCK_SIZE.
+size_t size_class(size_t size) {
+  if (size <= SLAB_MIN_BLOCK_SIZE) {
+    return 0;
+  }
+
+  return static_cast<size_t>(std::bit_width(size - 1)) -
+         static_cast<size_t>(std::bit_width(SLAB_MIN_BLOCK_SIZE - 1));
+}
+} // namespace
+
+SlabAllocator::SlabAllocator() : freelist_{}, freelistsize_{} {}
+
+SlabAllocator::~SlabAllocator() {
+  for (auto p : freelist_) {
+    for (; p;) {
+      auto next = p->next;
+      ::free(p);
+      p = next;
+    }
+  }
+}
+
+void *SlabAllocator::alloc(size_t size) {
+  BlockHeader *hd;
+
+  if (size > SLAB_MAX_BLOCK_SIZE) {
+    hd = static_cast<BlockHeader *>(malloc(sizeof(BlockHeader) + size));
+    if (!hd) {
+      return nullptr;
+    }
+  } else {
+    auto idx = size_class(size);
+    auto blocksize = SLAB_MIN_BLOCK_SIZE << idx;
+
+    if (freelist_[idx]) {
+      hd = freelist_[idx];
+      freelist_[idx] = hd->next;
+      freelistsize_[idx] -= blocksize;
+    } else {
+      hd =
+        static_cast<BlockHeader *>(malloc(sizeof(BlockHeader) + blocksize));
+      if (!hd) {
+        return nullptr;
+      }
+    }
+  }
+
+  hd->size = size;
+  hd->next = nullptr;
+
+  return hd + 1;
+}
+
+void SlabAllocator::free(void *ptr) {
+  if (!ptr) {
+    return;
+  }
+
+  auto hd = static_cast<BlockHeader *>(ptr) - 1;
+
+  if (hd->size > SLAB_MAX_BLOCK_SIZE) {
+    ::free(hd);
+    return;
+  }
+
+  auto idx = size_class(hd->size);
+  auto blocksize = SLAB_MIN_BLOCK_SIZE << idx;
+
+  if (freelistsize_[idx] + blocksize > SLAB_FREELIST_MAX) {
+    ::free(hd);
+    return;
+  }
+
+  hd->next = freelist_[idx];
+  freelist_[idx] = hd;
+  freelistsize_[idx] += blocksize;
+}
+
+void *SlabAllocator::realloc(void *ptr, size_t size) {
+  if (!ptr) {
+    return alloc(size);
+  }
+
+  auto hd = static_cast<BlockHeader *>(ptr) - 1;
+
+  if (hd->size > SLAB_MAX_BLOCK_SIZE) {
+    if (size > SLAB_MAX_BLOCK_SIZE) {
+      auto nhd = static_cast<BlockHeader *>(
+        ::realloc(hd, sizeof(BlockHeader) + size));
+      if (!nhd) {
+        return nullptr;
+      }
+
+      nhd->size = size;
+
+      return nhd + 1;
+    }
+  } else if (size <= SLAB_MAX_BLOCK_SIZE &&
+             size_class(size) <= size_class(hd->size)) {
+    // The current block is large enough.  We do not move the data
+    // to the smaller class to avoid copying.
+    hd->size = std::max(hd->size, size);
+
+    return ptr;
+  }
+
+  auto p = alloc(size);
+  if (!p) {
+    return nullptr;
+  }
+
+  memcpy(p, ptr, std::min(hd->size, size));
+
+  free(ptr);
+
+  return p;
+}
+
+size_t SlabAllocator::get_size(const void *ptr) {
+  return (static_cast<const BlockHeader *>(ptr) - 1)->size;
+}
+
+namespace {
+void *slab_mem_malloc(size_t size, void *mem_user_data) {
+  return static_cast<SlabMem *>(mem_user_data)->alloc(size);
+}
+} // namespace
+
+namespace {
+void slab_mem_free(void *ptr, void *mem_user_data) {
+  static_cast<SlabMem *>(mem_user_data)->free(ptr);
+}
+} // namespace
+
+namespace {
+void *slab_mem_calloc(size_t nmemb, size_t size, void *mem_user_data) {
+  return static_cast<SlabMem *>(mem_user_data)->calloc(nmemb, size);
+}
+} // namespace
+
+namespace {
+void *slab_mem_realloc(void *ptr, size_t size, void *mem_user_data) {
+  return static_cast<SlabMem *>(mem_user_data)->realloc(ptr, size);
+}
+} // namespace
+
+SlabMem::SlabMem(SlabAllocator *slab)
+  : mem_{
+      .mem_user_data = this,
+      .malloc = slab_mem_malloc,
+      .free = slab_mem_free,
+      .calloc = slab_mem_calloc,
+      .realloc = slab_mem_realloc,
+    },
+    slab_{slab},
+    allocated_{0},
+    peak_{0} {}
+
+void *SlabMem::alloc(size_t size) {
+  auto p = slab_->alloc(size);
+  if (!p) {
+    return nullptr;
+  }
+
+  allocated_ += size;
+  peak_ = std::max(peak_, allocated_);
+
+  return p;
+}
+
+void SlabMem::free(void *ptr) {
+  if (!ptr) {
+    return;
+  }
+
+  assert(allocated_ >= SlabAllocator::get_size(ptr));
+
+  allocated_ -= SlabAllocator::get_size(ptr);
+
+  slab_->free(ptr);
+}
+
+void *SlabMem::calloc(size_t nmemb, size_t size) {
+  if (size && nmemb > std::numeric_limits<size_t>::max() / size) {
+    return nullptr;
+  }
+
+  auto p = alloc(nmemb * size);
+  if (!p) {
+    return nullptr;
+  }
+
+  memset(p, 0, nmemb * size);
+
+  return p;
+}
+
+void *SlabMem::realloc(void *ptr, size_t size) {
+  size_t oldsize = ptr ? SlabAllocator::get_size(ptr) : 0;
+
+  auto p = slab_->realloc(ptr, size);
+  if (!p) {
+    return nullptr;
+  }
+
+  allocated_ = allocated_ - oldsize + SlabAllocator::get_size(p);
+  peak_ = std::max(peak_, allocated_);
+
+  return p;
+}
+
+} // namespace shrpx
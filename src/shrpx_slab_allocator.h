@@ -0,0 +1,124 @@
+/*
+ * nghttp2 - HTTP/2 C Library
+ *
+ * Copyright (c) 2026 Tatsuhiro Tsujikawa
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+ * LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#ifndef SHRPX_SLAB_ALLOCATOR_H
+#define SHRPX_SLAB_ALLOCATOR_H
+
+#include "shrpx.h"
+
+#include <array>
+
+#include <nghttp2/nghttp2.h>
+
+#include "template.h"
+
+using namespace nghttp2;
+
+namespace shrpx {
+
+// The block size of the smallest size class of SlabAllocator.  The
+// block size of the size class i is SLAB_MIN_BLOCK_SIZE << i.
+constexpr size_t SLAB_MIN_BLOCK_SIZE = 16;
+// The number of size classes of SlabAllocator.
+constexpr size_t SLAB_NUM_CLASSES = 9;
+// The block size of the largest size class of SlabAllocator.  The
+// larger allocation is directly served by malloc.
+constexpr size_t SLAB_MAX_BLOCK_SIZE = SLAB_MIN_BLOCK_SIZE
+                                       << (SLAB_NUM_CLASSES - 1);
+// The maximum number of bytes kept in the freelist of each size
+// class.
+constexpr size_t SLAB_FREELIST_MAX = 256_k;
+
+// SlabAllocator is a size class allocator which is owned by a
+// worker.  The freed blocks are kept in the freelist of their size
+// class, and reused by the subsequent allocations without calling
+// malloc.  This object is not thread-safe.
+class SlabAllocator {
+public:
+  SlabAllocator();
+  ~SlabAllocator();
+
+  SlabAllocator(const SlabAllocator &) = delete;
+  SlabAllocator &operator=(const SlabAllocator &) = delete;
+
+  // Allocates |size| bytes.  This function returns nullptr if it
+  // fails to allocate memory.
+  void *alloc(size_t size);
+  // Frees |ptr| which is allocated by this object.  |ptr| may be
+  // nullptr.
+  void free(void *ptr);
+  // Resizes |ptr| to |size| bytes in the same way as realloc(3).
+  void *realloc(void *ptr, size_t size);
+
+  // Returns the size of |ptr| which was passed to alloc() or
+  // realloc().  |ptr| must not be nullptr.
+  static size_t get_size(const void *ptr);
+
+  // Returns the number of bytes in the freelist of the size class
+  // |idx|.
+  size_t get_freelistsize(size_t idx) const { return freelistsize_[idx]; }
+
+private:
+  struct alignas(std::max_align_t) BlockHeader {
+    // The size requested by the caller.
+    size_t size;
+    // The next block in the freelist.
+    BlockHeader *next;
+  };
+
+  std::array<BlockHeader *, SLAB_NUM_CLASSES> freelist_;
+  std::array<size_t, SLAB_NUM_CLASSES> freelistsize_;
+};
+
+// SlabMem is nghttp2_mem which allocates memory from SlabAllocator,
+// and accounts the memory used by a single nghttp2_session.  It must
+// outlive the session created with it.
+class SlabMem {
+public:
+  explicit SlabMem(SlabAllocator *slab);
+
+  SlabMem(const SlabMem &) = delete;
+  SlabMem &operator=(const SlabMem &) = delete;
+
+  void *alloc(size_t size);
+  void free(void *ptr);
+  void *calloc(size_t nmemb, size_t size);
+  void *realloc(void *ptr, size_t size);
+
+  nghttp2_mem *get_nghttp2_mem() { return &mem_; }
+  // Returns the number of bytes currently allocated.
+  size_t get_allocated() const { return allocated_; }
+  // Returns the maximum number of bytes allocated at the same time.
+  size_t get_peak() const { return peak_; }
+
+private:
+  nghttp2_mem mem_;
+  SlabAllocator *slab_;
+  size_t allocated_;
+  size_t peak_;
+};
+
+} // namespace shrpx
+
+#endif // SHRPX_SLAB_ALLOCATOR_H
@@ -0,0 +1,154 @@
+/*
+ * nghttp2 - HTTP/2 C Library
+ *
+ * Copyright (c) 2026 Tatsuhiro Tsujikawa
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+ * LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include "shrpx_slab_allocator_test.h"
+
+#include <cstring>
+
+#include "munitxx.h"
+
+#include "shrpx_slab_allocator.h"
+
+namespace shrpx {
+
+namespace {
+const MunitTest tests[]{
+  munit_void_test(test_shrpx_slab_allocator_recycle),
+  munit_void_test(test_shrpx_slab_allocator_realloc),
+  munit_void_test(test_shrpx_slab_mem),
+  munit_test_end(),
+};
+} // namespace
+
+const MunitSuite slab_allocator_suite{
+  "/slab_allocator", tests, nullptr, 1, MUNIT_SUITE_OPTION_NONE,
+};
+
+void test_shrpx_slab_allocator_recycle(void) {
+  SlabAllocator slab;
+
+  auto p = slab.alloc(100);
+
+  assert_not_null(p);
+  assert_size(100, ==, SlabAllocator::get_size(p));
+
+  slab.free(p);
+
+  // 100 bytes fall into 128 bytes class.
+  assert_size(128, ==, slab.get_freelistsize(3));
+
+  // 120 bytes are in the same class, and reuse the freed block.
+  auto q = slab.alloc(120);
+
+  assert_ptr_equal(p, q);
+  assert_size(0, ==, slab.get_freelistsize(3));
+
+  slab.free(q);
+
+  // The allocation larger than SLAB_MAX_BLOCK_SIZE is not kept.
+  p = slab.alloc(SLAB_MAX_BLOCK_SIZE + 1);
+
+  assert_not_null(p);
+
+  slab.free(p);
+
+  for (size_t i = 0; i < SLAB_NUM_CLASSES; ++i) {
+    assert_size(i == 3 ? 128 : 0, ==, slab.get_freelistsize(i));
+  }
+
+  slab.free(nullptr);
+}
+
+void test_shrpx_slab_allocator_realloc(void) {
+  SlabAllocator slab;
+
+  auto p = static_cast<uint8_t *>(slab.alloc(10));
+  memset(p, 'a', 10);
+
+  // Fits in the current block.
+  auto q = static_cast<uint8_t *>(slab.realloc(p, 16));
+
+  assert_ptr_equal(p, q);
+
+  q = static_cast<uint8_t *>(slab.realloc(q, 1000));
+
+  assert_not_null(q);
+  assert_size(1000, ==, SlabAllocator::get_size(q));
+  assert_memory_equal(10, "aaaaaaaaaa", q);
+  assert_size(16, ==, slab.get_freelistsize(0));
+
+  q = static_cast<uint8_t *>(slab.realloc(q, SLAB_MAX_BLOCK_SIZE * 2));
+
+  assert_not_null(q);
+  assert_memory_equal(10, "aaaaaaaaaa", q);
+
+  q = static_cast<uint8_t *>(slab.realloc(q, SLAB_MAX_BLOCK_SIZE * 4));
+
+  assert_not_null(q);
+  assert_memory_equal(10, "aaaaaaaaaa", q);
+
+  q = static_cast<uint8_t *>(slab.realloc(q, 10));
+
+  assert_not_null(q);
+  assert_size(10, ==, SlabAllocator::get_size(q));
+  assert_memory_equal(10, "aaaaaaaaaa", q);
+
+  slab.free(q);
+
+  q = static_cast<uint8_t *>(slab.realloc(nullptr, 10));
+
+  assert_ptr_equal(p, q);
+
+  slab.free(q);
+}
+
+void test_shrpx_slab_mem(void) {
+  SlabAllocator slab;
+  SlabMem mem(&slab);
+
+  auto nmem = mem.get_nghttp2_mem();
+
+  auto p = nmem->malloc(100, nmem->mem_user_data);
+
+  assert_size(100, ==, mem.get_allocated());
+
+  auto q = static_cast<uint8_t *>(nmem->calloc(4, 50, nmem->mem_user_data));
+
+  assert_size(300, ==, mem.get_allocated());
+  for (size_t i = 0; i < 200; ++i) {
+    assert_uint8(0, ==, q[i]);
+  }
+
+  q = static_cast<uint8_t *>(nmem->realloc(q, 1000, nmem->mem_user_data));
+
+  assert_size(1100, ==, mem.get_allocated());
+
+  nmem->free(p, nmem->mem_user_data);
+  nmem->free(q, nmem->mem_user_data);
+
+  assert_size(0, ==, mem.get_allocated());
+  assert_size(1100, ==, mem.get_peak());
+}
+
+} // namespace shrpx
@@ -0,0 +1,101 @@
+/*
+ * nghttp2 - HTTP/2 C Library
+ *
+ * Copyright (c) 2026 Tatsuhiro Tsujikawa
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+ * LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include "shrpx_splice_pipe.h"
+
+#ifdef HAVE_UNISTD_H
+#  include <unistd.h>
+#endif // HAVE_UNISTD_H
+#include <fcntl.h>
+
+#include <cerrno>
+#include <array>
+
+#include "shrpx_log.h"
+#include "util.h"
+#include "xsi_strerror.h"
+
+namespace shrpx {
+
+namespace {
+// The pipe size which we ask the kernel for.  The default pipe size
+// is usually 64KiB, which requires too many wakeups for a large
+// transfer.
+constexpr size_t SPLICE_PIPE_SIZE = 256_k;
+} // namespace
+
+SplicePipe::SplicePipe(int rfd, int wfd, size_t capacity)
+  : rfd{rfd}, wfd{wfd}, len{0}, capacity{capacity}, stalled{false} {}
+
+SplicePipe::~SplicePipe() {
+  close(rfd);
+  close(wfd);
+}
+
+std::unique_ptr<SplicePipe> SplicePipePool::get() {
+  if (!pool_.empty()) {
+    auto pipe = std::move(pool_.back());
+    pool_.pop_back();
+    return pipe;
+  }
+
+#ifdef HAVE_SPLICE
+  std::array<int, 2> pfd;
+
+  if (pipe2(pfd.data(), O_NONBLOCK | O_CLOEXEC) == -1) {
+    auto error = errno;
+    std::array<char, STRERROR_BUFSIZE> errbuf;
+    LOG(WARN) << "Could not create pipe for splice: "
+              << xsi_strerror(error, errbuf.data(), errbuf.size());
+    return nullptr;
+  }
+
+  size_t capacity = 64_k;
+
+#  if defined(F_SETPIPE_SZ) && defined(F_GETPIPE_SZ)
+  fcntl(pfd[1], F_SETPIPE_SZ, static_cast<int>(SPLICE_PIPE_SIZE));
+
+  auto rv = fcntl(pfd[1], F_GETPIPE_SZ);
+  if (rv > 0) {
+    capacity = static_cast<size_t>(rv);
+  }
+#  endif // F_SETPIPE_SZ && F_GETPIPE_SZ
+
+  return std::make_unique<SplicePipe>(pfd[0], pfd[1], capacity);
+#else  // !HAVE_SPLICE
+  return nullptr;
+#endif // !HAVE_SPLICE
+}
+
+void SplicePipePool::recycle(std::unique_ptr<SplicePipe> pipe) {
+  if (pipe->len || pool_.size() >= SPLICE_PIPE_POOL_MAX) {
+    return;
+  }
+
+  pipe->stalled = false;
+
+  pool_.push_back(std::move(pipe));
+}
+
+} // namespace shrpx
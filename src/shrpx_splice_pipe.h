@@ -0,0 +1,82 @@
+/*
+ * nghttp2 - HTTP/2 C Library
+ *
+ * Copyright (c) 2026 Tatsuhiro Tsujikawa
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+ * LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#ifndef SHRPX_SPLICE_PIPE_H
+#define SHRPX_SPLICE_PIPE_H
+
+#include "shrpx.h"
+
+#include <memory>
+#include <vector>
+
+namespace shrpx {
+
+// SplicePipe is a pipe which relays data from one socket to another
+// with splice(2) without copying them into user space.
+struct SplicePipe {
+  SplicePipe(int rfd, int wfd, size_t capacity);
+  ~SplicePipe();
+
+  // Returns true if no more data should be written into this pipe
+  // until it is drained.
+  bool full() const { return stalled || len >= capacity; }
+
+  // The read end of the pipe.
+  int rfd;
+  // The write end of the pipe.
+  int wfd;
+  // The number of bytes in the pipe.
+  size_t len;
+  // The capacity of the pipe in bytes.
+  size_t capacity;
+  // true if the pipe could not accept data although it has room in
+  // terms of bytes.  The pipe buffer is managed in pages, and a
+  // small segment may occupy a whole page.
+  bool stalled;
+};
+
+// The maximum number of pipes kept in SplicePipePool.
+constexpr size_t SPLICE_PIPE_POOL_MAX = 64;
+
+// SplicePipePool keeps the pipes which are no longer used, so that
+// the subsequent tunnels do not have to create them.
+class SplicePipePool {
+public:
+  // Returns a pipe from the pool, or creates new one if the pool is
+  // empty.  This function returns nullptr if it cannot create a pipe,
+  // or splice(2) is not available.
+  std::unique_ptr<SplicePipe> get();
+  // Returns |pipe| to the pool.  |pipe| is closed if it still has
+  // data or the pool is full.
+  void recycle(std::unique_ptr<SplicePipe> pipe);
+  // Returns the number of pipes in the pool.
+  size_t size() const { return pool_.size(); }
+
+private:
+  std::vector<std::unique_ptr<SplicePipe>> pool_;
+};
+
+} // namespace shrpx
+
+#endif // SHRPX_SPLICE_PIPE_H
@@ -106,6 +106,22 @@ public:
   // PUSH_PROMISE for |promised_downstream| is not submitted to
   // upstream session.
   virtual void cancel_premature_downstream(Downstream *promised_downstream) = 0;
+  // Called when |downstream| which was queued by FairQueue acquired
+  // a slot.  Only the upstream which queues requests should override
+  // this function.
+  virtual void on_downstream_slot_acquired(Downstream *downstream) {}
+  // Called when the tunnel of |downstream| is established, and its
+  // backend connection can relay data with splice(2).  It returns 0
+  // if the frontend connection also relays data with splice(2), or
+  // -1.  Only the upstream which can splice should override this
+  // function.
+  virtual int start_splice(Downstream *downstream) { return -1; }
+  // Called when the response body of |downstream| which has
+  // content-length can be relayed with splice(2).  It returns 0 if
+  // the frontend connection sends the rest of the body from the
+  // response pipe, or -1.  Only the upstream which can splice should
+  // override this function.
+  virtual int start_response_splice(Downstream *downstream) { return -1; }
 };
 
 } // namespace shrpx
@@ -33,6 +33,8 @@
 #include <cstdio>
 #include <memory>
 #include <map>
+#include <unordered_set>
+#include <algorithm>
 
 #include "ssl_compat.h"
 
@@ -52,6 +54,8 @@
 #include "shrpx_log.h"
 #include "shrpx_client_handler.h"
 #include "shrpx_http2_session.h"
+#include "shrpx_http_downstream_connection.h"
+#include "shrpx_downstream.h"
 #include "shrpx_log_config.h"
 #ifdef HAVE_MRUBY
 #  include "shrpx_mruby.h"
@@ -61,6 +65,7 @@
 #endif // ENABLE_HTTP3
 #include "shrpx_connection_handler.h"
 #include "shrpx_accept_handler.h"
+#include "shrpx_metrics.h"
 #include "util.h"
 #include "template.h"
 #include "xsi_strerror.h"
@@ -95,6 +100,25 @@ void mcpool_clear_cb(struct ev_loop *loop, ev_timer *w, int revents) {
 }
 } // namespace
 
+namespace {
+// The interval at which the freelist of Memchunk pool is reclaimed.
+constexpr ev_tstamp MCPOOL_RECLAIM_INTERVAL = 10.;
+} // namespace
+
+namespace {
+void mcpool_reclaim_cb(struct ev_loop *loop, ev_timer *w, int revents) {
+  auto worker = static_cast<Worker *>(w->data);
+
+  if (worker->get_graceful_shutdown()) {
+    ev_timer_stop(loop, w);
+
+    return;
+  }
+
+  worker->reclaim_mcpool();
+}
+} // namespace
+
 namespace {
 void proc_wev_cb(struct ev_loop *loop, ev_timer *w, int revents) {
   auto worker = static_cast<Worker *>(w->data);
@@ -116,7 +140,36 @@ void disable_listener_cb(struct ev_loop *loop, ev_timer *w, int revent) {
 }
 } // namespace
 
-DownstreamAddrGroup::DownstreamAddrGroup() : retired{false} {}
+namespace {
+void prewarm_cb(struct ev_loop *loop, ev_timer *w, int revents) {
+  auto worker = static_cast<Worker *>(w->data);
+
+  if (worker->get_graceful_shutdown()) {
+    ev_timer_stop(loop, w);
+
+    return;
+  }
+
+  worker->prewarm_downstream_connections();
+}
+} // namespace
+
+namespace {
+void outlier_cb(struct ev_loop *loop, ev_timer *w, int revents) {
+  auto worker = static_cast<Worker *>(w->data);
+
+  if (worker->get_graceful_shutdown()) {
+    ev_timer_stop(loop, w);
+
+    return;
+  }
+
+  worker->detect_outliers();
+}
+} // namespace
+
+DownstreamAddrGroup::DownstreamAddrGroup()
+  : metrics{nullptr}, retired{false} {}
 
 DownstreamAddrGroup::~DownstreamAddrGroup() {}
 
@@ -125,10 +178,12 @@ DownstreamAddrGroup::~DownstreamAddrGroup() {}
 using DownstreamKey = std::tuple<
   std::vector<std::tuple<std::string_view, std::string_view, std::string_view,
                          size_t, size_t, Proto, uint32_t, uint32_t, uint32_t,
-                         bool, bool, bool, bool>>,
+                         bool, bool, bool, bool, size_t, ev_tstamp>>,
   bool, SessionAffinity, std::string_view, std::string_view,
-  SessionAffinityCookieSecure, SessionAffinityCookieStickiness, ev_tstamp,
-  ev_tstamp, std::string_view, bool>;
+  SessionAffinityCookieSecure, SessionAffinityCookieStickiness,
+  std::string_view, AffinityHashMethod, ev_tstamp, ev_tstamp,
+  std::string_view, bool, LoadBalancing, ev_tstamp, size_t, size_t, size_t,
+  bool, bool>;
 
 namespace {
 DownstreamKey
@@ -153,6 +208,8 @@ create_downstream_key(const std::shared_ptr<SharedDownstreamAddr> &shared_addr,
     std::get<10>(*p) = a.tls;
     std::get<11>(*p) = a.dns;
     std::get<12>(*p) = a.upgrade_scheme;
+    std::get<13>(*p) = a.min_idle;
+    std::get<14>(*p) = a.slow_start;
     ++p;
   }
   std::ranges::sort(addrs);
@@ -165,11 +222,20 @@ create_downstream_key(const std::shared_ptr<SharedDownstreamAddr> &shared_addr,
   std::get<4>(dkey) = affinity.cookie.path;
   std::get<5>(dkey) = affinity.cookie.secure;
   std::get<6>(dkey) = affinity.cookie.stickiness;
+  std::get<7>(dkey) = affinity.header.name;
+  std::get<8>(dkey) = affinity.hash_method;
   auto &timeout = shared_addr->timeout;
-  std::get<7>(dkey) = timeout.read;
-  std::get<8>(dkey) = timeout.write;
-  std::get<9>(dkey) = mruby_file;
-  std::get<10>(dkey) = shared_addr->dnf;
+  std::get<9>(dkey) = timeout.read;
+  std::get<10>(dkey) = timeout.write;
+  std::get<11>(dkey) = mruby_file;
+  std::get<12>(dkey) = shared_addr->dnf;
+  std::get<13>(dkey) = shared_addr->lb;
+  std::get<14>(dkey) = shared_addr->hedge_delay;
+  std::get<15>(dkey) = shared_addr->max_concurrency;
+  std::get<16>(dkey) = shared_addr->request_rate;
+  std::get<17>(dkey) = shared_addr->request_burst;
+  std::get<18>(dkey) = shared_addr->buffer_request;
+  std::get<19>(dkey) = shared_addr->spool_response;
 
   return dkey;
 }
@@ -187,6 +253,7 @@ Worker::Worker(struct ev_loop *loop, SSL_CTX *sv_ssl_ctx, SSL_CTX *cl_ssl_ctx,
   : index_{index},
     randgen_(util::make_mt19937()),
     worker_stat_{},
+    metrics_{conn_handler->get_metrics()->get_worker_metrics(index)},
     dns_tracker_(loop, get_config()->conn.downstream->family),
     upstream_addrs_{get_config()->conn.listener.addrs},
 #ifdef ENABLE_HTTP3
@@ -206,7 +273,10 @@ Worker::Worker(struct ev_loop *loop, SSL_CTX *sv_ssl_ctx, SSL_CTX *cl_ssl_ctx,
     ticket_keys_(ticket_keys),
     connect_blocker_(
       std::make_unique<ConnectBlocker>(randgen_, loop_, nullptr, nullptr)),
-    graceful_shutdown_(false) {
+    fair_queue_(loop_, downstreamconf->client_max_concurrency,
+                downstreamconf->client_weights),
+    graceful_shutdown_(false),
+    buffer_request_(false) {
   ev_async_init(&w_, eventcb);
   w_.data = this;
   ev_async_start(loop_, &w_);
@@ -214,12 +284,23 @@ Worker::Worker(struct ev_loop *loop, SSL_CTX *sv_ssl_ctx, SSL_CTX *cl_ssl_ctx,
   ev_timer_init(&mcpool_clear_timer_, mcpool_clear_cb, 0., 0.);
   mcpool_clear_timer_.data = this;
 
+  ev_timer_init(&mcpool_reclaim_timer_, mcpool_reclaim_cb,
+                MCPOOL_RECLAIM_INTERVAL, MCPOOL_RECLAIM_INTERVAL);
+  mcpool_reclaim_timer_.data = this;
+  ev_timer_start(loop_, &mcpool_reclaim_timer_);
+
   ev_timer_init(&proc_wev_timer_, proc_wev_cb, 0., 0.);
   proc_wev_timer_.data = this;
 
   ev_timer_init(&disable_listener_timer_, disable_listener_cb, 0., 0.);
   disable_listener_timer_.data = this;
 
+  ev_timer_init(&prewarm_timer_, prewarm_cb, 0., 1.);
+  prewarm_timer_.data = this;
+
+  ev_timer_init(&outlier_timer_, outlier_cb, 0., 0.);
+  outlier_timer_.data = this;
+
   replace_downstream_config(std::move(downstreamconf));
 }
 
@@ -259,12 +340,18 @@ void ensure_enqueue_addr(
 
 void Worker::replace_downstream_config(
   std::shared_ptr<DownstreamConfig> downstreamconf) {
-  for (auto &g : downstream_addr_groups_) {
+  // Keep the old groups until the new ones are built so that their
+  // addresses can be looked up.
+  auto old_groups = std::move(downstream_addr_groups_);
+  std::unordered_set<std::string_view> old_hostports;
+
+  for (auto &g : old_groups) {
     g->retired = true;
 
     auto &shared_addr = g->shared_addr;
     for (auto &addr : shared_addr->addrs) {
       addr.dconn_pool->remove_all();
+      old_hostports.emplace(addr.hostport);
     }
   }
 
@@ -278,6 +365,10 @@ void Worker::replace_downstream_config(
     std::vector<std::shared_ptr<DownstreamAddrGroup>>(groups.size());
 
   std::map<DownstreamKey, size_t> addr_groups_indexer;
+
+  buffer_request_ = false;
+
+  auto metrics = conn_handler_->get_metrics();
 #ifdef HAVE_MRUBY
   // TODO It is a bit less efficient because
   // mruby::create_mruby_context returns std::unique_ptr and we cannot
@@ -292,6 +383,7 @@ void Worker::replace_downstream_config(
 
     dst = std::make_shared<DownstreamAddrGroup>();
     dst->pattern = ImmutableString{src.pattern};
+    dst->metrics = metrics->get_pattern_metrics(index_, src.pattern);
 
     auto shared_addr = std::make_shared<SharedDownstreamAddr>();
 
@@ -306,13 +398,31 @@ void Worker::replace_downstream_config(
       }
       shared_addr->affinity.cookie.secure = src.affinity.cookie.secure;
       shared_addr->affinity.cookie.stickiness = src.affinity.cookie.stickiness;
+    } else if (src.affinity.type == SessionAffinity::HEADER) {
+      shared_addr->affinity.header.name =
+        make_string_ref(shared_addr->balloc, src.affinity.header.name);
     }
+    shared_addr->affinity.hash_method = src.affinity.hash_method;
     shared_addr->affinity_hash = src.affinity_hash;
     shared_addr->affinity_hash_map = src.affinity_hash_map;
+    shared_addr->maglev_table = src.maglev_table;
     shared_addr->redirect_if_not_tls = src.redirect_if_not_tls;
     shared_addr->dnf = src.dnf;
+    shared_addr->buffer_request = src.buffer_request;
+    if (src.buffer_request) {
+      buffer_request_ = true;
+    }
+    shared_addr->spool_response = src.spool_response;
+    shared_addr->lb = src.lb;
     shared_addr->timeout.read = src.timeout.read;
     shared_addr->timeout.write = src.timeout.write;
+    shared_addr->hedge_delay = src.hedge_delay;
+    if (src.hedge_delay > 0.) {
+      shared_addr->hedge_latency = std::make_unique<LatencyHistogram>();
+    }
+    shared_addr->max_concurrency = src.max_concurrency;
+    shared_addr->request_rate = src.request_rate;
+    shared_addr->request_burst = src.request_burst;
 
     for (size_t j = 0; j < src.addrs.size(); ++j) {
       auto &src_addr = src.addrs[j];
@@ -333,8 +443,18 @@ void Worker::replace_downstream_config(
       dst_addr.sni = make_string_ref(shared_addr->balloc, src_addr.sni);
       dst_addr.fall = src_addr.fall;
       dst_addr.rise = src_addr.rise;
+      dst_addr.min_idle = src_addr.min_idle;
+      dst_addr.slow_start = src_addr.slow_start;
+      // An address which is added by the configuration change starts
+      // in slow start.
+      if (dst_addr.slow_start > 0. && !old_groups.empty() &&
+          !old_hostports.contains(dst_addr.hostport)) {
+        dst_addr.slow_start_begin = ev_now(loop_);
+      }
       dst_addr.dns = src_addr.dns;
       dst_addr.upgrade_scheme = src_addr.upgrade_scheme;
+      dst_addr.metrics =
+        metrics->get_backend_metrics(index_, src_addr.hostport);
     }
 
 #ifdef HAVE_MRUBY
@@ -359,7 +479,11 @@ void Worker::replace_downstream_config(
 
       for (auto &addr : shared_addr->addrs) {
         addr.connect_blocker = std::make_unique<ConnectBlocker>(
-          randgen_, loop_, nullptr, [shared_addr_ptr, &addr]() {
+          randgen_, loop_, nullptr, [loop = loop_, shared_addr_ptr, &addr]() {
+            if (addr.slow_start > 0.) {
+              addr.slow_start_begin = ev_now(loop);
+            }
+
             if (!addr.queued) {
               if (!addr.wg) {
                 return;
@@ -372,6 +496,13 @@ void Worker::replace_downstream_config(
                                                       &addr, randgen_);
       }
 
+      if (shared_addr->request_rate) {
+        shared_addr->rate_limiter = std::make_unique<RequestRateLimiter>(
+          shared_addr->request_rate, shared_addr->request_burst
+                                       ? shared_addr->request_burst
+                                       : shared_addr->request_rate);
+      }
+
       size_t seq = 0;
       for (auto &addr : shared_addr->addrs) {
         addr.dconn_pool = std::make_unique<DownstreamConnectionPool>();
@@ -428,13 +559,120 @@ void Worker::replace_downstream_config(
       dst->shared_addr = g->shared_addr;
     }
   }
+
+  auto config = get_config();
+
+  // The dedicated API worker never forwards requests to backends.
+  if (!config->single_thread && config->api.enabled && index_ == 0) {
+    return;
+  }
+
+  ev_timer_stop(loop_, &outlier_timer_);
+
+  auto &outlierconf = downstreamconf_->outlier;
+  if (outlierconf.interval > 0.) {
+    ev_timer_set(&outlier_timer_, outlierconf.interval, outlierconf.interval);
+    ev_timer_start(loop_, &outlier_timer_);
+  }
+
+  ev_timer_stop(loop_, &prewarm_timer_);
+
+  for (auto &g : downstream_addr_groups_) {
+    for (auto &addr : g->shared_addr->addrs) {
+      if (addr.min_idle) {
+        ev_timer_set(&prewarm_timer_, 0., 1.);
+        ev_timer_start(loop_, &prewarm_timer_);
+
+        return;
+      }
+    }
+  }
+}
+
+namespace {
+// The minimum number of requests in the evaluation window to judge a
+// backend address by its failure rate.
+constexpr size_t OUTLIER_MIN_REQUESTS = 5;
+// The maximum multiplier applied to the ejection time.
+constexpr size_t OUTLIER_MAX_EJECTION_MULTIPLIER = 10;
+} // namespace
+
+void Worker::detect_outliers() {
+  std::unordered_set<SharedDownstreamAddr *> seen;
+
+  for (auto &group : downstream_addr_groups_) {
+    auto &shared_addr = group->shared_addr;
+
+    // Several patterns may share the same backend group.
+    if (shared_addr->dnf || !seen.emplace(shared_addr.get()).second) {
+      continue;
+    }
+
+    shrpx::detect_outliers(*shared_addr, downstreamconf_->outlier);
+  }
+}
+
+void Worker::prewarm_downstream_connections() {
+  for (auto &group : downstream_addr_groups_) {
+    auto &shared_addr = group->shared_addr;
+
+    if (shared_addr->dnf) {
+      continue;
+    }
+
+    for (auto &addr : shared_addr->addrs) {
+      if (addr.min_idle == 0 || connect_blocker_->blocked() ||
+          addr.connect_blocker->blocked()) {
+        continue;
+      }
+
+      if (addr.proto == Proto::HTTP2) {
+        for (auto n = addr.http2_extra_freelist.size(); n < addr.min_idle;
+             ++n) {
+          auto session =
+            new Http2Session(loop_, cl_ssl_ctx_, this, group, &addr);
+
+          if (LOG_ENABLED(INFO)) {
+            LOG(INFO) << "Create new Http2Session " << session
+                      << " in advance";
+          }
+
+          session->add_to_extra_freelist();
+          // This starts connecting to the backend.
+          session->signal_write();
+        }
+
+        continue;
+      }
+
+      // Address which requires DNS lookup is not supported because
+      // the lookup is bound to a request.
+      if (addr.dns) {
+        continue;
+      }
+
+      while (addr.dconn_pool->size() < addr.min_idle) {
+        auto dconn =
+          std::make_unique<HttpDownstreamConnection>(group, &addr, loop_, this);
+        if (dconn->prewarm() != 0) {
+          break;
+        }
+
+        addr.dconn_pool->add_prewarming_downstream_connection(
+          std::move(dconn));
+      }
+    }
+  }
 }
 
 Worker::~Worker() {
   ev_async_stop(loop_, &w_);
   ev_timer_stop(loop_, &mcpool_clear_timer_);
+  ev_timer_stop(loop_, &mcpool_reclaim_timer_);
   ev_timer_stop(loop_, &proc_wev_timer_);
   ev_timer_stop(loop_, &disable_listener_timer_);
+  ev_timer_stop(loop_, &prewarm_timer_);
+  ev_timer_stop(loop_, &outlier_timer_);
 }
 
 void Worker::schedule_clear_mcpool() {
@@ -444,6 +682,14 @@ void Worker::schedule_clear_mcpool() {
   ev_timer_start(loop_, &mcpool_clear_timer_);
 }
 
+void Worker::reclaim_mcpool() {
+  mcpool_.shrink(get_config()->memchunk_pool_max_free);
+
+  metrics_->memchunk_pool_bytes.set(static_cast<int64_t>(mcpool_.poolsize));
+  metrics_->memchunk_pool_free_bytes.set(
+    static_cast<int64_t>(mcpool_.freelistsize));
+}
+
 void Worker::wait() {
 #ifndef NOTHREADS
   fut_.get();
@@ -618,6 +864,8 @@ void Worker::set_ticket_keys(std::shared_ptr<TicketKeys> ticket_keys) {
 
 WorkerStat *Worker::get_worker_stat() { return &worker_stat_; }
 
+WorkerMetrics *Worker::get_metrics() const { return metrics_; }
+
 struct ev_loop *Worker::get_loop() const { return loop_; }
 
 SSL_CTX *Worker::get_sv_ssl_ctx() const { return sv_ssl_ctx_; }
@@ -634,6 +882,12 @@ bool Worker::get_graceful_shutdown() const { return graceful_shutdown_; }
 
 MemchunkPool *Worker::get_mcpool() { return &mcpool_; }
 
+SplicePipePool *Worker::get_splice_pipe_pool() { return &splice_pipe_pool_; }
+
+SlabAllocator *Worker::get_slab_allocator() { return &slab_allocator_; }
+
+DownstreamPool *Worker::get_downstream_pool() { return &downstream_pool_; }
+
 std::mt19937 &Worker::get_randgen() { return randgen_; }
 
 #ifdef HAVE_MRUBY
@@ -660,6 +914,10 @@ ConnectBlocker *Worker::get_connect_blocker() const {
   return connect_blocker_.get();
 }
 
+FairQueue *Worker::get_fair_queue() { return &fair_queue_; }
+
+bool Worker::get_buffer_request() const { return buffer_request_; }
+
 const DownstreamConfig *Worker::get_downstream_config() const {
   return downstreamconf_.get();
 }
@@ -1637,6 +1895,65 @@ void downstream_failure(DownstreamAddr *addr, const Address *raddr) {
   }
 }
 
+void downstream_request_done(DownstreamAddr *addr, bool failed) {
+  auto &outlier = addr->outlier;
+
+  ++outlier.requests[0];
+
+  if (failed) {
+    ++outlier.failures[0];
+  }
+}
+
+uint32_t get_downstream_addr_effective_weight(DownstreamAddr *addr,
+                                              ev_tstamp now) {
+  if (addr->slow_start_begin == 0.) {
+    return addr->weight * DOWNSTREAM_ADDR_RAMP_SCALE;
+  }
+
+  auto elapsed = std::max(now - addr->slow_start_begin, 0.);
+  if (elapsed >= addr->slow_start) {
+    addr->slow_start_begin = 0.;
+
+    return addr->weight * DOWNSTREAM_ADDR_RAMP_SCALE;
+  }
+
+  auto ramp = static_cast<uint32_t>(DOWNSTREAM_ADDR_RAMP_SCALE * elapsed /
+                                    addr->slow_start);
+
+  return addr->weight * std::max(ramp, DOWNSTREAM_ADDR_MIN_RAMP);
+}
+
+void downstream_response_header_received(SharedDownstreamAddr *shared_addr,
+                                         DownstreamAddr *addr,
+                                         const DownstreamTimings &timings) {
+  constexpr auto unset = std::chrono::high_resolution_clock::time_point{};
+
+  if (timings.backend_request_start == unset) {
+    return;
+  }
+
+  auto d = std::chrono::duration<double, std::micro>(
+             timings.response_header_end -
+             std::max(timings.backend_request_start,
+                      timings.backend_connect_end))
+             .count();
+
+  // The same smoothing factor as TCP smoothed RTT (RFC 6298) uses.
+  constexpr auto alpha = 1. / 8;
+
+  if (addr->latency_ewma == 0.) {
+    addr->latency_ewma = d;
+  } else {
+    addr->latency_ewma += alpha * (d - addr->latency_ewma);
+  }
+
+  if (shared_addr && shared_addr->hedge_latency) {
+    shared_addr->hedge_latency->observe(
+      std::chrono::microseconds(static_cast<int64_t>(d)));
+  }
+}
+
 int Worker::handle_connection(int fd, sockaddr *addr, socklen_t addrlen,
                               const UpstreamAddr *faddr) {
   if (LOG_ENABLED(INFO)) {
@@ -1676,4 +1993,104 @@ int Worker::handle_connection(int fd, sockaddr *addr, socklen_t addrlen,
   return 0;
 }
 
+void detect_outliers(SharedDownstreamAddr &shared_addr,
+                     const OutlierConfig &outlierconf) {
+  std::vector<double> latencies;
+
+  auto &addrs = shared_addr.addrs;
+  size_t num_ejected = 0;
+
+  for (auto &addr : addrs) {
+    if (addr.outlier.ejected) {
+      if (addr.connect_blocker->blocked()) {
+        ++num_ejected;
+
+        continue;
+      }
+
+      addr.outlier.ejected = false;
+    }
+
+    if (!addr.connect_blocker->blocked() && addr.latency_ewma > 0.) {
+      latencies.push_back(addr.latency_ewma);
+    }
+  }
+
+  // The latency of an address is compared against the median of
+  // the group.  At least 2 samples are required.
+  auto median_latency = 0.;
+  if (latencies.size() >= 2) {
+    auto mid = std::ranges::begin(latencies) +
+               static_cast<ptrdiff_t>((latencies.size() - 1) / 2);
+    std::ranges::nth_element(latencies, mid);
+    median_latency = *mid;
+  }
+
+  auto max_ejected = addrs.size() * outlierconf.max_ejection_percent / 100;
+
+  for (auto &addr : addrs) {
+    auto &outlier = addr.outlier;
+
+    // The window consists of the current and the previous interval.
+    auto requests = outlier.requests[0] + outlier.requests[1];
+    auto failures = outlier.failures[0] + outlier.failures[1];
+
+    outlier.requests = {0, outlier.requests[0]};
+    outlier.failures = {0, outlier.failures[0]};
+
+    if (outlier.ejected || addr.connect_blocker->blocked()) {
+      continue;
+    }
+
+    auto failure_outlier =
+      outlierconf.failure_rate && requests >= OUTLIER_MIN_REQUESTS &&
+      failures * 100 >= requests * outlierconf.failure_rate;
+    auto latency_outlier =
+      outlierconf.latency_factor && median_latency > 0. &&
+      addr.latency_ewma >
+        median_latency * static_cast<double>(outlierconf.latency_factor);
+
+    if (!failure_outlier && !latency_outlier) {
+      if (requests && outlier.num_ejections) {
+        --outlier.num_ejections;
+      }
+
+      continue;
+    }
+
+    if (num_ejected >= max_ejected) {
+      if (LOG_ENABLED(INFO)) {
+        LOG(INFO) << "Backend " << addr.hostport
+                  << " is an outlier, but too many backends are ejected";
+      }
+
+      continue;
+    }
+
+    ++num_ejected;
+
+    outlier.ejected = true;
+    if (outlier.num_ejections < OUTLIER_MAX_EJECTION_MULTIPLIER) {
+      ++outlier.num_ejections;
+    }
+
+    auto t =
+      outlierconf.ejection_time * static_cast<double>(outlier.num_ejections);
+
+    LOG(WARN) << "Eject backend " << addr.hostport << " for "
+              << util::duration_str(t) << "; requests=" << requests
+              << ", failures=" << failures << ", latency="
+              << static_cast<uint64_t>(addr.latency_ewma)
+              << "us, median latency="
+              << static_cast<uint64_t>(median_latency) << "us";
+
+    // Start measuring from scratch when it comes back.
+    addr.latency_ewma = 0.;
+    outlier.requests = {};
+    outlier.failures = {};
+
+    addr.connect_blocker->block(t);
+  }
+}
+
 } // namespace shrpx
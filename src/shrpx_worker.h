@@ -34,6 +34,7 @@
 #include <deque>
 #include <thread>
 #include <queue>
+#include <array>
 #ifndef NOTHREADS
 #  include <future>
 #endif // NOTHREADS
@@ -57,7 +58,13 @@
 #include "shrpx_tls.h"
 #include "shrpx_live_check.h"
 #include "shrpx_connect_blocker.h"
+#include "shrpx_fair_queue.h"
+#include "shrpx_request_rate_limiter.h"
+#include "shrpx_splice_pipe.h"
+#include "shrpx_slab_allocator.h"
+#include "shrpx_downstream_pool.h"
 #include "shrpx_dns_tracker.h"
+#include "shrpx_metrics.h"
 #ifdef ENABLE_HTTP3
 #  include "shrpx_quic_connection_handler.h"
 #  include "shrpx_quic.h"
@@ -90,6 +97,9 @@ class CertLookupTree;
 } // namespace tls
 
 struct WeightGroup;
+struct DownstreamTimings;
+struct WorkerMetrics;
+struct RequestMetrics;
 
 struct DownstreamAddr {
   Address addr;
@@ -112,6 +122,14 @@ struct DownstreamAddr {
   std::unique_ptr<DownstreamConnectionPool> dconn_pool;
   size_t fall;
   size_t rise;
+  // The number of idle connections which are established to this
+  // address in advance.
+  size_t min_idle;
+  // The duration of slow start.  0 if slow start is disabled.
+  ev_tstamp slow_start;
+  // The timestamp when slow start of this address began.  0 if this
+  // address is not in slow start.
+  ev_tstamp slow_start_begin;
   // Client side TLS session cache
   tls::TLSSessionCache tls_session_cache;
   // List of Http2Session which is not fully utilized (i.e., the
@@ -119,6 +137,9 @@ struct DownstreamAddr {
   // coalesce as much stream as possible in one Http2Session to fully
   // utilize TCP connection.
   DList<Http2Session> http2_extra_freelist;
+  // The number of Http2Session objects which connect to this
+  // address.
+  size_t num_http2_sessions;
   WeightGroup *wg;
   // total number of streams created in HTTP/2 connections for this
   // address.
@@ -131,7 +152,8 @@ struct DownstreamAddr {
   // cycle is used to prioritize this address.  Lower value takes
   // higher priority.
   uint32_t cycle;
-  // penalty which is applied to the next cycle calculation.
+  // penalty which is applied to the next cycle calculation.  It is
+  // scaled by DOWNSTREAM_ADDR_RAMP_SCALE.
   uint32_t pending_penalty;
   // Weight of this address inside a weight group.  Its range is [1,
   // 256], inclusive.
@@ -154,9 +176,42 @@ struct DownstreamAddr {
   bool upgrade_scheme;
   // true if this address is queued.
   bool queued;
+  // Metrics for this address in the worker.
+  RequestMetrics *metrics;
+  // The number of requests which are currently forwarded to this
+  // address.
+  size_t num_inflight;
+  // Exponentially weighted moving average of the time between the
+  // request is sent to this address and its response header is
+  // received, in microseconds.  0 if no response has been received
+  // yet.
+  double latency_ewma;
+  // Statistics for outlier detection.
+  struct {
+    // The number of requests which finished, and the number of them
+    // which failed.  Index 0 is for the current interval, and index
+    // 1 is for the previous one.
+    std::array<size_t, 2> requests;
+    std::array<size_t, 2> failures;
+    // The number of consecutive ejections.
+    size_t num_ejections;
+    // true if this address is currently ejected by outlier
+    // detection.
+    bool ejected;
+  } outlier;
 };
 
 constexpr uint32_t MAX_DOWNSTREAM_ADDR_WEIGHT = 256;
+// The weight of an address is multiplied by the ramp in the range
+// [DOWNSTREAM_ADDR_MIN_RAMP, DOWNSTREAM_ADDR_RAMP_SCALE], inclusive.
+// The ramp grows linearly during slow start, and it is
+// DOWNSTREAM_ADDR_RAMP_SCALE otherwise.
+constexpr uint32_t DOWNSTREAM_ADDR_RAMP_SCALE = 256;
+constexpr uint32_t DOWNSTREAM_ADDR_MIN_RAMP = DOWNSTREAM_ADDR_RAMP_SCALE / 16;
+// The maximum increment of the cycle of an address.
+constexpr uint32_t MAX_DOWNSTREAM_ADDR_CYCLE_STEP =
+  MAX_DOWNSTREAM_ADDR_WEIGHT * DOWNSTREAM_ADDR_RAMP_SCALE /
+  DOWNSTREAM_ADDR_MIN_RAMP;
 
 struct DownstreamAddrEntry {
   DownstreamAddr *addr;
@@ -171,7 +226,7 @@ struct DownstreamAddrEntryGreater {
     if (d == 0) {
       return rhs.seq < lhs.seq;
     }
-    return d <= 2 * MAX_DOWNSTREAM_ADDR_WEIGHT - 1;
+    return d <= 2 * MAX_DOWNSTREAM_ADDR_CYCLE_STEP - 1;
   }
 };
 
@@ -208,9 +263,19 @@ struct SharedDownstreamAddr {
   SharedDownstreamAddr()
     : balloc(1024, 1024),
       affinity{SessionAffinity::NONE},
+      lb{LoadBalancing::ROUND_ROBIN},
+      next_addr_idx{0},
       redirect_if_not_tls{false},
       dnf{false},
-      timeout{} {}
+      buffer_request{false},
+      spool_response{false},
+      timeout{},
+      hedge_delay{0},
+      max_concurrency{0},
+      request_rate{0},
+      request_burst{0},
+      num_active_requests{0},
+      num_waiting_requests{0} {}
 
   SharedDownstreamAddr(const SharedDownstreamAddr &) = delete;
   SharedDownstreamAddr(SharedDownstreamAddr &&) = delete;
@@ -229,22 +294,57 @@ struct SharedDownstreamAddr {
   // Maps affinity hash of each DownstreamAddr to its index in addrs.
   // It is only assigned when strict stickiness is enabled.
   std::unordered_map<uint32_t, size_t> affinity_hash_map;
+  // Maglev lookup table.  Only used if affinity.hash_method ==
+  // AffinityHashMethod::MAGLEV.
+  std::shared_ptr<const std::vector<uint32_t>> maglev_table;
 #ifdef HAVE_MRUBY
   std::shared_ptr<mruby::MRubyContext> mruby_ctx;
 #endif // HAVE_MRUBY
   // Configuration for session affinity
   AffinityConfig affinity;
+  // Load balancing method.  It is ignored if session affinity is
+  // enabled.
+  LoadBalancing lb;
+  // The index of addrs where the scan for LoadBalancing::LEAST_REQUEST
+  // starts next time.  It is rotated so that ties are broken
+  // fairly.
+  size_t next_addr_idx;
   // Session affinity
   // true if this group requires that client connection must be TLS,
   // and the request must be redirected to https URI.
   bool redirect_if_not_tls;
   // true if a request should not be forwarded to a backend.
   bool dnf;
+  // true if a request body is buffered entirely before a backend is
+  // selected.
+  bool buffer_request;
+  // true if a response body is spooled so that a backend
+  // connection is released regardless of a client.
+  bool spool_response;
   // Timeouts for backend connection.
   struct {
     ev_tstamp read;
     ev_tstamp write;
   } timeout;
+  // The delay before a hedged request is sent.  0 if hedged request
+  // is disabled.
+  ev_tstamp hedge_delay;
+  // The latency of response header from the backends of this group.
+  // The hedge delay is derived from its percentile.  nullptr if
+  // hedged request is disabled.
+  std::unique_ptr<LatencyHistogram> hedge_latency;
+  // The maximum number of concurrent requests to this group.  0 means
+  // no limit.
+  size_t max_concurrency;
+  // The per-client request rate limit.  0 means no limit.
+  size_t request_rate;
+  size_t request_burst;
+  // Limits the request rate per client if request_rate > 0.
+  std::unique_ptr<RequestRateLimiter> rate_limiter;
+  // The number of requests which hold a slot of FairQueue, and which
+  // wait for it.
+  size_t num_active_requests;
+  size_t num_waiting_requests;
 };
 
 struct DownstreamAddrGroup {
@@ -258,6 +358,8 @@ struct DownstreamAddrGroup {
 
   ImmutableString pattern;
   std::shared_ptr<SharedDownstreamAddr> shared_addr;
+  // Metrics for this pattern in the worker.
+  RequestMetrics *metrics;
   // true if this group is no longer used for new request.  If this is
   // true, the connection made using one of address in shared_addr
   // must not be pooled.
@@ -334,6 +436,7 @@ public:
   void set_ticket_keys(std::shared_ptr<TicketKeys> ticket_keys);
 
   WorkerStat *get_worker_stat();
+  WorkerMetrics *get_metrics() const;
   struct ev_loop *get_loop() const;
   SSL_CTX *get_sv_ssl_ctx() const;
   SSL_CTX *get_cl_ssl_ctx() const;
@@ -346,6 +449,13 @@ public:
 
   MemchunkPool *get_mcpool();
   void schedule_clear_mcpool();
+  // Frees the chunks in the freelist of mcpool_ above
+  // --memchunk-pool-max-free, and updates its metrics.
+  void reclaim_mcpool();
+
+  SplicePipePool *get_splice_pipe_pool();
+  SlabAllocator *get_slab_allocator();
+  DownstreamPool *get_downstream_pool();
 
   std::mt19937 &get_randgen();
 
@@ -360,6 +470,12 @@ public:
 
   ConnectBlocker *get_connect_blocker() const;
 
+  FairQueue *get_fair_queue();
+
+  // Returns true if at least one backend group has buffer-request
+  // parameter.
+  bool get_buffer_request() const;
+
   const DownstreamConfig *get_downstream_config() const;
 
   void
@@ -401,6 +517,14 @@ public:
   int handle_connection(int fd, sockaddr *addr, socklen_t addrlen,
                         const UpstreamAddr *faddr);
 
+  // Establishes backend connections in advance so that each backend
+  // address has at least min_idle idle connections.
+  void prewarm_downstream_connections();
+
+  // Evaluates the backend addresses, and ejects outliers from load
+  // balancing temporarily.
+  void detect_outliers();
+
 private:
 #ifndef NOTHREADS
   std::future<void> fut_;
@@ -412,10 +536,20 @@ private:
   std::mt19937 randgen_;
   ev_async w_;
   ev_timer mcpool_clear_timer_;
+  ev_timer mcpool_reclaim_timer_;
   ev_timer proc_wev_timer_;
   ev_timer disable_listener_timer_;
+  ev_timer prewarm_timer_;
+  ev_timer outlier_timer_;
   MemchunkPool mcpool_;
+  SplicePipePool splice_pipe_pool_;
+  // Allocates memory for nghttp2 sessions.  This must be declared
+  // before the objects which own the sessions so that it outlives
+  // them.
+  SlabAllocator slab_allocator_;
+  DownstreamPool downstream_pool_;
   WorkerStat worker_stat_;
+  WorkerMetrics *metrics_;
   DNSTracker dns_tracker_;
 
   std::vector<UpstreamAddr> upstream_addrs_;
@@ -456,8 +590,13 @@ private:
   // Worker level blocker for downstream connection.  For example,
   // this is used when file descriptor is exhausted.
   std::unique_ptr<ConnectBlocker> connect_blocker_;
+  // Limits the number of concurrent requests per group and per
+  // client.
+  FairQueue fair_queue_;
 
   bool graceful_shutdown_;
+  // true if at least one backend group has buffer-request parameter.
+  bool buffer_request_;
 };
 
 // Selects group based on request's |hostport| and |path|.  |hostport|
@@ -477,6 +616,32 @@ size_t match_downstream_addr_group(
 // nullptr.  This function may schedule live check.
 void downstream_failure(DownstreamAddr *addr, const Address *raddr);
 
+// Calls this function when a request forwarded to |addr| finished.
+// |failed| is true if the backend responded with 5xx status code, or
+// nghttpx could not get a complete response from it.  The result is
+// used by outlier detection.
+void downstream_request_done(DownstreamAddr *addr, bool failed);
+
+// Evaluates the backend addresses in |shared_addr| with the settings
+// in |outlierconf|, and ejects outliers from load balancing.  The
+// statistics of each address are shifted to the next interval.
+void detect_outliers(SharedDownstreamAddr &shared_addr,
+                     const OutlierConfig &outlierconf);
+
+// Returns the weight of |addr| multiplied by the ramp at |now| (see
+// DOWNSTREAM_ADDR_RAMP_SCALE).
+uint32_t get_downstream_addr_effective_weight(DownstreamAddr *addr,
+                                              ev_tstamp now);
+
+// Calls this function when a response header from |addr| is
+// received.  |timings| is the timing information of the request.
+// This function updates the latency estimate of |addr|.  If
+// |shared_addr| is not nullptr, the latency is also recorded to its
+// hedge_latency.
+void downstream_response_header_received(SharedDownstreamAddr *shared_addr,
+                                         DownstreamAddr *addr,
+                                         const DownstreamTimings &timings);
+
 } // namespace shrpx
 
 #endif // SHRPX_WORKER_H
@@ -29,6 +29,8 @@
 #endif // HAVE_UNISTD_H
 
 #include <cstdlib>
+#include <random>
+#include <algorithm>
 
 #include "munitxx.h"
 
@@ -41,6 +43,10 @@ namespace shrpx {
 namespace {
 const MunitTest tests[]{
   munit_void_test(test_shrpx_worker_match_downstream_addr_group),
+  munit_void_test(test_shrpx_worker_detect_outliers_failure),
+  munit_void_test(test_shrpx_worker_detect_outliers_latency),
+  munit_void_test(test_shrpx_worker_detect_outliers_max_ejection),
+  munit_void_test(test_shrpx_worker_detect_outliers_backoff),
   munit_test_end(),
 };
 } // namespace
@@ -259,4 +265,225 @@ void test_shrpx_worker_match_downstream_addr_group(void) {
                                           groups, 255, balloc));
 }
 
+namespace {
+// Adds |n| backend addresses to |shared_addr|.  Their connect
+// blockers are driven by |loop|.
+void add_addrs(SharedDownstreamAddr &shared_addr, size_t n,
+               struct ev_loop *loop, std::mt19937 &gen) {
+  shared_addr.addrs = std::vector<DownstreamAddr>(n);
+  for (auto &addr : shared_addr.addrs) {
+    addr.connect_blocker =
+      std::make_unique<ConnectBlocker>(gen, loop, nullptr, nullptr);
+  }
+}
+} // namespace
+
+namespace {
+// Records that |addr| finished |requests| requests in the current
+// interval, and |failures| of them failed.
+void set_stats(DownstreamAddr &addr, size_t requests, size_t failures) {
+  addr.outlier.requests[0] = requests;
+  addr.outlier.failures[0] = failures;
+}
+} // namespace
+
+void test_shrpx_worker_detect_outliers_failure(void) {
+  auto loop = ev_loop_new(0);
+  std::mt19937 gen;
+  {
+    auto shared_addr = std::make_shared<SharedDownstreamAddr>();
+    add_addrs(*shared_addr, 4, loop, gen);
+
+    auto &addrs = shared_addr->addrs;
+
+    set_stats(addrs[0], 10, 5);
+    // Too few requests to judge by failure rate.
+    set_stats(addrs[1], 4, 4);
+    set_stats(addrs[2], 10, 4);
+    set_stats(addrs[3], 10, 0);
+
+    auto outlierconf = OutlierConfig{
+      .interval = 10.,
+      .ejection_time = 30.,
+      .failure_rate = 50,
+      .latency_factor = 0,
+      .max_ejection_percent = 50,
+    };
+
+    detect_outliers(*shared_addr, outlierconf);
+
+    assert_true(addrs[0].outlier.ejected);
+    assert_true(addrs[0].connect_blocker->blocked());
+    assert_size(1, ==, addrs[0].outlier.num_ejections);
+    assert_size(0, ==, addrs[0].outlier.requests[1]);
+    assert_size(0, ==, addrs[0].outlier.failures[1]);
+
+    for (size_t i = 1; i < addrs.size(); ++i) {
+      assert_false(addrs[i].outlier.ejected);
+      assert_false(addrs[i].connect_blocker->blocked());
+      assert_size(0, ==, addrs[i].outlier.num_ejections);
+    }
+
+    // The statistics are shifted to the previous interval.
+    assert_size(0, ==, addrs[2].outlier.requests[0]);
+    assert_size(10, ==, addrs[2].outlier.requests[1]);
+    assert_size(4, ==, addrs[2].outlier.failures[1]);
+
+    // The failures in the previous interval are still taken into
+    // account.
+    set_stats(addrs[2], 2, 2);
+
+    detect_outliers(*shared_addr, outlierconf);
+
+    assert_true(addrs[2].outlier.ejected);
+    assert_true(addrs[2].connect_blocker->blocked());
+  }
+  ev_loop_destroy(loop);
+}
+
+void test_shrpx_worker_detect_outliers_latency(void) {
+  auto loop = ev_loop_new(0);
+  std::mt19937 gen;
+  {
+    auto shared_addr = std::make_shared<SharedDownstreamAddr>();
+    add_addrs(*shared_addr, 4, loop, gen);
+
+    auto &addrs = shared_addr->addrs;
+
+    addrs[0].latency_ewma = 1000.;
+    addrs[1].latency_ewma = 1200.;
+    addrs[2].latency_ewma = 10000.;
+    // No response has been received yet.
+    addrs[3].latency_ewma = 0.;
+
+    for (auto &addr : addrs) {
+      set_stats(addr, 10, 0);
+    }
+
+    auto outlierconf = OutlierConfig{
+      .interval = 10.,
+      .ejection_time = 30.,
+      .failure_rate = 50,
+      .latency_factor = 3,
+      .max_ejection_percent = 50,
+    };
+
+    detect_outliers(*shared_addr, outlierconf);
+
+    assert_false(addrs[0].outlier.ejected);
+    assert_false(addrs[1].outlier.ejected);
+    assert_true(addrs[2].outlier.ejected);
+    assert_true(addrs[2].connect_blocker->blocked());
+    // Latency is measured from scratch after ejection.
+    assert_double(0., ==, addrs[2].latency_ewma);
+    assert_false(addrs[3].outlier.ejected);
+
+    // Latency based ejection needs at least 2 samples.
+    addrs[0].latency_ewma = 0.;
+    addrs[3].latency_ewma = 0.;
+    addrs[1].latency_ewma = 100000.;
+
+    detect_outliers(*shared_addr, outlierconf);
+
+    assert_false(addrs[1].outlier.ejected);
+  }
+  ev_loop_destroy(loop);
+}
+
+void test_shrpx_worker_detect_outliers_max_ejection(void) {
+  auto loop = ev_loop_new(0);
+  std::mt19937 gen;
+  {
+    auto shared_addr = std::make_shared<SharedDownstreamAddr>();
+    add_addrs(*shared_addr, 5, loop, gen);
+
+    auto &addrs = shared_addr->addrs;
+
+    for (auto &addr : addrs) {
+      set_stats(addr, 10, 10);
+    }
+
+    // 5 * 50 / 100 = 2 addresses can be ejected.
+    auto outlierconf = OutlierConfig{
+      .interval = 10.,
+      .ejection_time = 30.,
+      .failure_rate = 50,
+      .latency_factor = 0,
+      .max_ejection_percent = 50,
+    };
+
+    detect_outliers(*shared_addr, outlierconf);
+
+    assert_true(addrs[0].outlier.ejected);
+    assert_true(addrs[1].outlier.ejected);
+    assert_false(addrs[2].outlier.ejected);
+    assert_false(addrs[2].connect_blocker->blocked());
+    assert_size(0, ==, addrs[2].outlier.num_ejections);
+    assert_false(addrs[3].outlier.ejected);
+    assert_false(addrs[4].outlier.ejected);
+
+    // The addresses which are still ejected count toward the limit.
+    for (size_t i = 2; i < addrs.size(); ++i) {
+      set_stats(addrs[i], 10, 10);
+    }
+
+    detect_outliers(*shared_addr, outlierconf);
+
+    assert_true(addrs[0].outlier.ejected);
+    assert_true(addrs[1].outlier.ejected);
+    for (size_t i = 2; i < addrs.size(); ++i) {
+      assert_false(addrs[i].outlier.ejected);
+    }
+  }
+  ev_loop_destroy(loop);
+}
+
+void test_shrpx_worker_detect_outliers_backoff(void) {
+  auto loop = ev_loop_new(0);
+  std::mt19937 gen;
+  {
+    auto shared_addr = std::make_shared<SharedDownstreamAddr>();
+    add_addrs(*shared_addr, 2, loop, gen);
+
+    auto &addrs = shared_addr->addrs;
+    auto &outlier = addrs[0].outlier;
+
+    // The ejection time is kept short so that the test can wait for
+    // each ejection to end.
+    auto outlierconf = OutlierConfig{
+      .interval = 10.,
+      .ejection_time = 0.001,
+      .failure_rate = 50,
+      .latency_factor = 0,
+      .max_ejection_percent = 50,
+    };
+
+    for (size_t i = 1; i <= 12; ++i) {
+      set_stats(addrs[0], 10, 10);
+      set_stats(addrs[1], 10, 0);
+
+      detect_outliers(*shared_addr, outlierconf);
+
+      assert_true(outlier.ejected);
+      // The multiplier of the ejection time stops at 10.
+      assert_size(std::min(i, static_cast<size_t>(10)), ==,
+                  outlier.num_ejections);
+
+      // Wait for the ejection to end.
+      ev_run(loop, 0);
+
+      assert_false(addrs[0].connect_blocker->blocked());
+    }
+
+    // A healthy interval decreases the multiplier.
+    set_stats(addrs[0], 10, 0);
+
+    detect_outliers(*shared_addr, outlierconf);
+
+    assert_false(outlier.ejected);
+    assert_size(9, ==, outlier.num_ejections);
+  }
+  ev_loop_destroy(loop);
+}
+
 } // namespace shrpx
@@ -38,6 +38,10 @@ namespace shrpx {
 extern const MunitSuite worker_suite;
 
 munit_void_test_decl(test_shrpx_worker_match_downstream_addr_group)
+munit_void_test_decl(test_shrpx_worker_detect_outliers_failure)
+munit_void_test_decl(test_shrpx_worker_detect_outliers_latency)
+munit_void_test_decl(test_shrpx_worker_detect_outliers_max_ejection)
+munit_void_test_decl(test_shrpx_worker_detect_outliers_backoff)
 
 } // namespace shrpx
 